@@ -0,0 +1,691 @@
+#include "byte_stream.hh"
+#include "ipv4_datagram.hh"
+#include "prefix_table.hh"
+#include "stream_reassembler.hh"
+#include "tcp_connection.hh"
+#include "tcp_header_template.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+//! Keeps benchmarked results alive so the compiler can't discard the work
+static volatile uint64_t sink = 0;
+
+struct Options {
+    bool quick = false;             // fewer samples and smaller transfers
+    string filter{};                // only run benchmarks whose names contain this
+    string json_path{};             // where to write the JSON results
+    string baseline_path{};         // JSON results to compare against
+    double threshold_percent = 10;  // change in the median that counts as a regression
+
+    size_t samples() const { return quick ? 5 : 30; }
+    size_t repeats() const { return quick ? 3 : 7; }
+    bool wants(const string &name) const { return name.find(filter) != string::npos; }
+};
+
+//! One measurement per sample
+struct Result {
+    string name{};
+    string unit{};
+    bool higher_is_better = false;
+    vector<double> samples{};
+};
+
+struct Summary {
+    double min = 0, p50 = 0, p90 = 0, p99 = 0, max = 0, mean = 0;
+};
+
+//! Nearest-rank percentiles
+static Summary summarize(vector<double> samples) {
+    Summary ret;
+    if (samples.empty()) {
+        return ret;
+    }
+    sort(samples.begin(), samples.end());
+    const auto percentile = [&](const double p) {
+        const size_t rank = size_t(p / 100 * double(samples.size()) + 0.999999);
+        return samples.at(min(samples.size(), max(rank, size_t{1})) - 1);
+    };
+    ret.min = samples.front();
+    ret.p50 = percentile(50);
+    ret.p90 = percentile(90);
+    ret.p99 = percentile(99);
+    ret.max = samples.back();
+    ret.mean = accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+    return ret;
+}
+
+static string random_string(const size_t len, mt19937 &rng) {
+    string ret(len, 0);
+    for (auto &ch : ret) {
+        ch = char(rng());
+    }
+    return ret;
+}
+
+//! \brief Time `sample` (after one warm-up call), which returns the number of operations it did,
+//! and add the nanoseconds per operation of each sample to `results`
+static void run_micro(const Options &options,
+                      vector<Result> &results,
+                      const string &name,
+                      const function<size_t()> &sample) {
+    if (not options.wants(name)) {
+        return;
+    }
+    Result ret{name, "ns/op", false, {}};
+    sample();
+    for (size_t i = 0; i < options.samples(); i++) {
+        const auto start = steady_clock::now();
+        const size_t ops = sample();
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        ret.samples.push_back(double(elapsed) / double(ops));
+    }
+    results.push_back(move(ret));
+}
+
+// ---------------------------------------------------------------- microbenchmarks
+
+static vector<Result> bench_byte_stream(const Options &options) {
+    vector<Result> ret;
+    for (const size_t chunk : {size_t{1}, size_t{1452}, size_t{16384}}) {
+        const string data(chunk, 'x');
+        run_micro(options, ret, "byte_stream/write_read_" + to_string(chunk), [&] {
+            ByteStream stream{64000};
+            const size_t ops = (1 << 24) / chunk / 4 + 1000;
+            for (size_t i = 0; i < ops; i++) {
+                stream.write(data);
+                sink = sink + stream.read(chunk).size();
+            }
+            return ops;
+        });
+    }
+    return ret;
+}
+
+//! The order segments are pushed to a StreamReassembler, within each window
+enum class PushOrder { InOrder, Reverse, Shuffled, Overlapping, Duplicated };
+
+static vector<Result> bench_reassembler(const Options &options) {
+    constexpr size_t window = 64000, chunk = 1452, windows = 16;
+    mt19937 rng{1};
+    const string data = random_string(window * windows, rng);
+
+    const vector<pair<string, PushOrder>> orders{{"in_order", PushOrder::InOrder},
+                                                 {"reverse", PushOrder::Reverse},
+                                                 {"shuffled", PushOrder::Shuffled},
+                                                 {"overlapping", PushOrder::Overlapping},
+                                                 {"duplicated", PushOrder::Duplicated}};
+    vector<Result> ret;
+    for (const auto &[order_name, order] : orders) {
+        // (index, length) of each push into one window, relative to the window's start
+        vector<pair<size_t, size_t>> pushes;
+        const size_t stride = order == PushOrder::Overlapping ? chunk / 2 : chunk;
+        for (size_t index = 0; index < window; index += stride) {
+            pushes.emplace_back(index, min(chunk, window - index));
+            if (order == PushOrder::Duplicated) {
+                pushes.emplace_back(index, min(chunk, window - index));
+            }
+        }
+        if (order == PushOrder::Reverse) {
+            reverse(pushes.begin(), pushes.end());
+        } else if (order == PushOrder::Shuffled) {
+            shuffle(pushes.begin(), pushes.end(), rng);
+        }
+
+        // the substrings are built outside the timed region
+        vector<vector<string>> substrings(windows);
+        for (size_t w = 0; w < windows; w++) {
+            for (const auto &[index, length] : pushes) {
+                substrings[w].push_back(data.substr(w * window + index, length));
+            }
+        }
+
+        run_micro(options, ret, "reassembler/" + order_name, [&] {
+            StreamReassembler reassembler{window};
+            for (size_t w = 0; w < windows; w++) {
+                for (size_t i = 0; i < pushes.size(); i++) {
+                    reassembler.push_substring(substrings[w][i], w * window + pushes[i].first, false);
+                }
+                sink = sink + reassembler.stream_out().read(window).size();
+            }
+            return windows * pushes.size();
+        });
+    }
+    return ret;
+}
+
+static vector<Result> bench_checksum(const Options &options) {
+    mt19937 rng{2};
+    const string packet = random_string(1500, rng);
+    vector<Result> ret;
+    run_micro(options, ret, "checksum/1500", [&] {
+        const size_t ops = 20000;
+        for (size_t i = 0; i < ops; i++) {
+            InternetChecksum check;
+            check.add(packet);
+            sink = sink + check.value();
+        }
+        return ops;
+    });
+    return ret;
+}
+
+static vector<Result> bench_parse_serialize(const Options &options) {
+    mt19937 rng{3};
+    const size_t ops = 20000;
+
+    TCPSegment seg;
+    seg.header().ack = true;
+    seg.header().seqno = WrappingInt32{12345};
+    seg.header().ackno = WrappingInt32{67890};
+    seg.header().win = 64000;
+    seg.payload() = random_string(TCPConfig::MAX_PAYLOAD_SIZE, rng);
+
+    InternetDatagram dgram;
+    dgram.header().src = 0x0a000001;
+    dgram.header().dst = 0x0a000002;
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+    const string tcp_wire = seg.serialize(dgram.header().pseudo_cksum()).concatenate();
+    const string ip_wire = dgram.serialize().concatenate();
+
+    vector<Result> ret;
+    run_micro(options, ret, "tcp/serialize_1452", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            sink = sink + seg.serialize(dgram.header().pseudo_cksum()).size();
+        }
+        return ops;
+    });
+    run_micro(options, ret, "tcp/parse_1452", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            TCPSegment parsed;
+            if (parsed.parse(string(tcp_wire), dgram.header().pseudo_cksum()) != ParseResult::NoError) {
+                throw runtime_error("tcp/parse_1452: parse failed");
+            }
+            sink = sink + parsed.payload().size();
+        }
+        return ops;
+    });
+    run_micro(options, ret, "ipv4/serialize_1492", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            sink = sink + dgram.serialize().size();
+        }
+        return ops;
+    });
+    // a whole datagram for a pure ACK (so the payload checksum doesn't dominate): assembled field by
+    // field, then from a connection's prebuilt headers
+    TCPSegment ack;
+    ack.header() = seg.header();
+    run_micro(options, ret, "tcp_ipv4/wrap_ack", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            InternetDatagram wrapped;
+            wrapped.header().src = dgram.header().src;
+            wrapped.header().dst = dgram.header().dst;
+            wrapped.header().len = wrapped.header().hlen * 4 + ack.header().doff * 4;
+            wrapped.payload() = ack.serialize(wrapped.header().pseudo_cksum());
+            sink = sink + wrapped.serialize().size();
+        }
+        return ops;
+    });
+    const TCPHeaderTemplate headers{{dgram.header().src, 1234, dgram.header().dst, 80}};
+    run_micro(options, ret, "tcp_ipv4/template_ack", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            sink = sink + headers.serialize(ack).size();
+        }
+        return ops;
+    });
+    run_micro(options, ret, "ipv4/parse_1492", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            InternetDatagram parsed;
+            if (parsed.parse(string(ip_wire)) != ParseResult::NoError) {
+                throw runtime_error("ipv4/parse_1492: parse failed");
+            }
+            sink = sink + parsed.payload().size();
+        }
+        return ops;
+    });
+    return ret;
+}
+
+static vector<Result> bench_wrapping(const Options &options) {
+    const WrappingInt32 isn{0xfffff000};
+    const size_t ops = 1 << 20;
+    vector<Result> ret;
+    run_micro(options, ret, "wrapping/wrap", [&] {
+        for (size_t i = 0; i < ops; i++) {
+            sink = sink + wrap((uint64_t{1} << 32) * (i % 7) + i * 1452, isn).raw_value();
+        }
+        return ops;
+    });
+    run_micro(options, ret, "wrapping/unwrap", [&] {
+        uint64_t checkpoint = 0;
+        for (size_t i = 0; i < ops; i++) {
+            checkpoint = unwrap(WrappingInt32{isn.raw_value() + uint32_t(i * 1452)}, isn, checkpoint);
+            sink = sink + checkpoint;
+        }
+        return ops;
+    });
+    return ret;
+}
+
+//! Longest-prefix match in a table the size of a full Internet routing table
+static vector<Result> bench_prefix_table(const Options &options) {
+    const string name = "router/lookup_1M";
+    vector<Result> ret;
+    if (not options.wants(name)) {
+        return ret;
+    }
+
+    // prefix lengths roughly as in a BGP table: over half /24, most of the rest /16 to /23
+    mt19937 rng{4};
+    PrefixTable table;
+    const size_t prefixes = 1 << 20;
+    for (size_t i = 0; i < prefixes; i++) {
+        const uint32_t percentile = rng() % 100;
+        const uint8_t length = percentile < 58   ? 24
+                               : percentile < 95 ? 16 + rng() % 8
+                               : percentile < 99 ? 8 + rng() % 8
+                                                 : 25 + rng() % 8;
+        table.insert(rng(), length, uint32_t(i));
+    }
+
+    vector<uint32_t> addresses(1 << 16);
+    for (auto &address : addresses) {
+        address = rng();
+    }
+    run_micro(options, ret, name, [&] {
+        const size_t ops = 1 << 22;
+        for (size_t i = 0; i < ops; i++) {
+            sink = sink + table.lookup(addresses[i & (addresses.size() - 1)]).value_or(0);
+        }
+        return ops;
+    });
+    return ret;
+}
+
+// ---------------------------------------------------------------- macro scenarios
+
+//! Carries segments one way between two TCPConnections, with optional loss and delay
+class Link {
+  private:
+    double _loss;
+    uint64_t _delay_ms;
+    mt19937 _rng;
+    bernoulli_distribution _drop;
+    deque<pair<uint64_t, TCPSegment>> _in_flight{};  // (arrival time, segment)
+
+  public:
+    Link(const double loss, const uint64_t delay_ms, const unsigned seed)
+        : _loss(loss), _delay_ms(delay_ms), _rng(seed), _drop(loss) {}
+
+    //! Take the segments `from` has queued
+    void send(TCPConnection &from, const uint64_t now_ms) {
+        while (not from.segments_out().empty()) {
+            if (_loss == 0 or not _drop(_rng)) {
+                _in_flight.emplace_back(now_ms + _delay_ms, move(from.segments_out().front()));
+            }
+            from.segments_out().pop();
+        }
+    }
+
+    //! Give `to` the segments that have arrived
+    void deliver(TCPConnection &to, const uint64_t now_ms) {
+        while (not _in_flight.empty() and _in_flight.front().first <= now_ms) {
+            to.segment_received(_in_flight.front().second);
+            _in_flight.pop_front();
+        }
+    }
+};
+
+struct Scenario {
+    size_t bytes = 0;       // sent from client to server
+    size_t write_size = 0;  // bytes per write() by the client
+    double loss = 0;        // probability of dropping each segment, each way
+    uint64_t delay_ms = 0;  // one-way delay
+};
+
+//! A client sending a stream to a server, one simulated millisecond per step()
+class Transfer {
+  private:
+    const Scenario _scenario;
+    const string &_data;
+    TCPConfig _cfg;
+    TCPConnection _client, _server;
+    Link _up, _down;
+    size_t _written = 0;
+    string _received{};
+    uint64_t _now_ms = 0;
+
+    static TCPConfig config() {
+        TCPConfig cfg;
+        cfg.rt_timeout = 10;
+        return cfg;
+    }
+
+  public:
+    Transfer(const Scenario &scenario, const string &data, const unsigned seed)
+        : _scenario(scenario)
+        , _data(data)
+        , _cfg(config())
+        , _client(_cfg)
+        , _server(_cfg)
+        , _up(scenario.loss, scenario.delay_ms, seed)
+        , _down(scenario.loss, scenario.delay_ms, seed + 1) {
+        _received.reserve(scenario.bytes);
+        _client.connect();
+        _server.end_input_stream();
+    }
+
+    bool received_all() const { return _server.inbound_stream().eof(); }
+    bool closed() const { return not _client.active() and not _server.active(); }
+
+    void step() {
+        while (_written < _scenario.bytes and _client.remaining_outbound_capacity() > 0) {
+            const size_t len = min({_scenario.write_size, _scenario.bytes - _written,
+                                    _client.remaining_outbound_capacity()});
+            _written += _client.write(_data.substr(_written, len));
+            if (_written == _scenario.bytes) {
+                _client.end_input_stream();
+            }
+        }
+
+        _up.send(_client, _now_ms);
+        _down.send(_server, _now_ms);
+        _up.deliver(_server, _now_ms);
+        _down.deliver(_client, _now_ms);
+
+        _received.append(_server.inbound_stream().read(_server.inbound_stream().buffer_size()));
+
+        _now_ms++;
+        _client.tick(1);
+        _server.tick(1);
+    }
+
+    //! Let both sides close cleanly, then check what arrived
+    void finish() {
+        while (not closed()) {
+            step();
+        }
+        if (_received != _data.substr(0, _scenario.bytes)) {
+            throw runtime_error("bytes received don't match bytes sent");
+        }
+    }
+};
+
+//! Throughput of one connection at a time, in Gbit/s
+static vector<Result> macro_transfer(const Options &options, const string &name, const Scenario &scenario) {
+    if (not options.wants(name)) {
+        return {};
+    }
+    mt19937 rng{4};
+    const string data = random_string(scenario.bytes, rng);
+
+    Result ret{name, "Gbit/s", true, {}};
+    for (size_t i = 0; i < options.repeats(); i++) {
+        Transfer transfer{scenario, data, unsigned(i)};
+        const auto start = steady_clock::now();
+        while (not transfer.received_all()) {
+            transfer.step();
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        ret.samples.push_back(double(scenario.bytes) * 8 / double(elapsed));
+        transfer.finish();
+    }
+    return {ret};
+}
+
+//! Many connections stepped round-robin: each one's completion time, and their total throughput
+static vector<Result> macro_connections(const Options &options, const size_t connections) {
+    const string prefix = "tcp/connections_" + to_string(connections);
+    if (not options.wants(prefix)) {
+        return {};
+    }
+    Scenario scenario;
+    scenario.bytes = options.quick ? 64 * 1024 : 256 * 1024;
+    scenario.write_size = 4096;
+
+    mt19937 rng{5};
+    const string data = random_string(scenario.bytes, rng);
+
+    Result completion{prefix + "/completion", "ms", false, {}};
+    Result throughput{prefix + "/throughput", "Gbit/s", true, {}};
+    for (size_t repeat = 0; repeat < options.repeats(); repeat++) {
+        vector<unique_ptr<Transfer>> transfers;
+        for (size_t i = 0; i < connections; i++) {
+            transfers.push_back(make_unique<Transfer>(scenario, data, unsigned(repeat * connections + i)));
+        }
+
+        const auto start = steady_clock::now();
+        vector<bool> done(connections, false);
+        size_t remaining = connections;
+        while (remaining > 0) {
+            for (size_t i = 0; i < connections; i++) {
+                if (done[i]) {
+                    continue;
+                }
+                transfers[i]->step();
+                if (transfers[i]->received_all()) {
+                    done[i] = true;
+                    remaining--;
+                    const auto elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+                    completion.samples.push_back(double(elapsed) / 1000);
+                }
+            }
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        throughput.samples.push_back(double(scenario.bytes * connections) * 8 / double(elapsed));
+
+        for (auto &transfer : transfers) {
+            transfer->finish();
+        }
+    }
+    return {completion, throughput};
+}
+
+static vector<Result> bench_tcp(const Options &options) {
+    const size_t bytes = options.quick ? 4 << 20 : 32 << 20;
+    vector<Result> ret;
+    const auto add = [&](const string &name, const Scenario &scenario) {
+        for (auto &result : macro_transfer(options, name, scenario)) {
+            ret.push_back(move(result));
+        }
+    };
+    add("tcp/transfer", {bytes, 64000, 0, 0});
+    add("tcp/loss_1pct", {bytes / 4, 64000, 0.01, 0});
+    add("tcp/delay_10ms", {bytes / 4, 64000, 0, 10});
+    add("tcp/loss_1pct_delay_10ms", {bytes / 8, 64000, 0.01, 10});
+    add("tcp/small_writes_16", {bytes / 32, 16, 0, 0});
+    for (auto &result : macro_connections(options, 256)) {
+        ret.push_back(move(result));
+    }
+    return ret;
+}
+
+// ---------------------------------------------------------------- output and comparison
+
+static void print_results(const vector<Result> &results) {
+    cout << left << setw(36) << "benchmark" << right << setw(12) << "p50" << setw(12) << "p90" << setw(12)
+         << "p99" << "  unit\n";
+    cout << fixed << setprecision(3);
+    for (const auto &result : results) {
+        const Summary s = summarize(result.samples);
+        cout << left << setw(36) << result.name << right << setw(12) << s.p50 << setw(12) << s.p90 << setw(12)
+             << s.p99 << "  " << result.unit << "\n";
+    }
+}
+
+//! One benchmark per line, which is what read_baseline() expects
+static void write_json(const Options &options, const vector<Result> &results, ostream &out) {
+    out << "{\"quick\": " << (options.quick ? "true" : "false") << ", \"benchmarks\": [\n"
+        << setprecision(6) << defaultfloat;
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        const Summary s = summarize(result.samples);
+        out << "  {\"name\": \"" << result.name << "\", \"unit\": \"" << result.unit
+            << "\", \"higher_is_better\": " << (result.higher_is_better ? "true" : "false")
+            << ", \"samples\": " << result.samples.size() << ", \"min\": " << s.min << ", \"p50\": " << s.p50
+            << ", \"p90\": " << s.p90 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << ", \"mean\": " << s.mean
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+//! The median of each benchmark in a file written by write_json()
+static map<string, double> read_baseline(const Options &options) {
+    ifstream in{options.baseline_path};
+    if (not in) {
+        throw runtime_error("can't open baseline " + options.baseline_path);
+    }
+
+    map<string, double> ret;
+    const string name_key = "\"name\": \"", p50_key = "\"p50\": ";
+    string line;
+    getline(in, line);
+    if ((line.find("\"quick\": true") != string::npos) != options.quick) {
+        cerr << "Warning: the baseline was " << (options.quick ? "not " : "") << "a quick (-q) run\n";
+    }
+    while (getline(in, line)) {
+        const auto name_pos = line.find(name_key), p50_pos = line.find(p50_key);
+        if (name_pos == string::npos or p50_pos == string::npos) {
+            continue;
+        }
+        const auto name_start = name_pos + name_key.size();
+        const string name = line.substr(name_start, line.find('"', name_start) - name_start);
+        ret[name] = strtod(line.c_str() + p50_pos + p50_key.size(), nullptr);
+    }
+    return ret;
+}
+
+//! \returns the number of regressions
+static size_t compare(const vector<Result> &results, const map<string, double> &baseline, const double threshold) {
+    size_t regressions = 0;
+    cout << "\n"
+         << left << setw(36) << "benchmark (p50)" << right << setw(12) << "baseline" << setw(12) << "current"
+         << setw(10) << "change\n";
+    for (const auto &result : results) {
+        const auto base = baseline.find(result.name);
+        if (base == baseline.end() or base->second == 0) {
+            continue;
+        }
+        const double current = summarize(result.samples).p50;
+        const double change = (current - base->second) / base->second * 100;
+        const double worse = result.higher_is_better ? -change : change;
+
+        cout << left << setw(36) << result.name << right << setprecision(3) << setw(12) << base->second
+             << setw(12) << current << setprecision(1) << setw(9) << showpos << change << noshowpos << "%";
+        if (worse > threshold) {
+            cout << "  REGRESSION";
+            regressions++;
+        } else if (-worse > threshold) {
+            cout << "  improved";
+        }
+        cout << "\n";
+    }
+    return regressions;
+}
+
+static void show_usage(const char *argv0) {
+    cerr << "Usage: " << argv0 << " [options]\n\n"
+         << "   -q              Quick run: fewer samples and smaller transfers\n"
+         << "   -f <substr>     Only run benchmarks whose names contain <substr>\n"
+         << "   -j <file>       Write results as JSON to <file> (\"-\" for stdout)\n"
+         << "   -b <file>       Compare medians with JSON written earlier by -j;\n"
+         << "                   exits with failure if any regressed\n"
+         << "   -t <percent>    Change in a median that counts as a regression (default 10)\n"
+         << "   -h              Show this message and quit.\n";
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        if (argc <= 0) {
+            abort();  // For sticklers: don't try to access argv[0] if argc <= 0.
+        }
+
+        // single-threaded, so Buffer refcounts needn't be atomic
+        Buffer::set_thread_confined(true);
+
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            const bool has_arg = i + 1 < argc;
+            if (strcmp(argv[i], "-q") == 0) {
+                options.quick = true;
+            } else if (strcmp(argv[i], "-f") == 0 and has_arg) {
+                options.filter = argv[++i];
+            } else if (strcmp(argv[i], "-j") == 0 and has_arg) {
+                options.json_path = argv[++i];
+            } else if (strcmp(argv[i], "-b") == 0 and has_arg) {
+                options.baseline_path = argv[++i];
+            } else if (strcmp(argv[i], "-t") == 0 and has_arg) {
+                options.threshold_percent = strtod(argv[++i], nullptr);
+            } else {
+                show_usage(argv[0]);
+                return strcmp(argv[i], "-h") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+        }
+
+        // read the baseline first, so a bad path fails before the benchmarks run
+        const map<string, double> baseline =
+            options.baseline_path.empty() ? map<string, double>{} : read_baseline(options);
+
+        const vector<function<vector<Result>(const Options &)>> groups{bench_byte_stream,
+                                                                       bench_reassembler,
+                                                                       bench_checksum,
+                                                                       bench_parse_serialize,
+                                                                       bench_wrapping,
+                                                                       bench_prefix_table,
+                                                                       bench_tcp};
+
+        vector<Result> results;
+        for (const auto &group : groups) {
+            for (auto &result : group(options)) {
+                results.push_back(move(result));
+            }
+        }
+
+        print_results(results);
+
+        if (options.json_path == "-") {
+            write_json(options, results, cout);
+        } else if (not options.json_path.empty()) {
+            ofstream out{options.json_path};
+            write_json(options, results, out);
+            if (not out) {
+                throw runtime_error("can't write " + options.json_path);
+            }
+        }
+
+        if (not options.baseline_path.empty()) {
+            const size_t regressions = compare(results, baseline, options.threshold_percent);
+            if (regressions > 0) {
+                cout << regressions << " regression(s) beyond " << options.threshold_percent << "%\n";
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include "tcp_connection.hh"
+#include "tcp_trace.hh"
 
 #include <chrono>
 #include <cstdlib>
@@ -103,10 +104,31 @@ void main_loop(const bool reorder) {
     }
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     try {
+        if (argc <= 0) {
+            abort();  // For sticklers: don't try to access argv[0] if argc <= 0.
+        }
+
+        // single-threaded, so Buffer refcounts needn't be atomic
+        Buffer::set_thread_confined(true);
+        if (argc > 2) {
+            cerr << "Usage: " << argv[0] << " [TRACE_FILE]\n";
+            return EXIT_FAILURE;
+        }
+
+        // with a trace file, record every event (for trace_decode) and include the cost in the throughput
+        if (argc == 2) {
+            TCPTracer::start(argv[1]);
+        }
+
         main_loop(false);
         main_loop(true);
+
+        if (argc == 2) {
+            TCPTracer::stop();
+            cout << "Trace written to " << argv[1] << " (" << TCPTracer::dropped() << " events dropped)\n";
+        }
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
@@ -0,0 +1,361 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// every flow connects to this port on the server side
+static constexpr uint16_t SERVER_PORT = 80;
+
+// flow i uses client port FIRST_CLIENT_PORT + i, which is how segments find their flow
+static constexpr uint16_t FIRST_CLIENT_PORT = 10000;
+
+static constexpr size_t MAX_FLOWS = 10000;
+
+// size of a full segment on the wire, for sizing the queue in packets
+static constexpr size_t PACKET_BYTES = TCPConfig::MAX_PAYLOAD_SIZE + 40;
+
+struct Options {
+    size_t flows = 10;
+    double rate_mbps = 100;
+    uint64_t delay_us = 10 * 1000;
+    size_t queue_packets = 0;  // 0 means one bandwidth-delay product
+    bool red = false;
+    double loss = 0;
+    uint64_t duration_us = 10 * 1000 * 1000;
+    uint64_t warmup_us = 1000 * 1000;
+    uint64_t stagger_us = 100 * 1000;
+    uint64_t granularity_us = 1000;
+    uint64_t seed = 1;
+    bool verbose = false;
+};
+
+// a sender and receiver, each with the virtual time it has been ticked to
+struct Flow {
+    TCPConnection client;
+    TCPConnection server;
+    uint64_t start_us;
+    uint64_t client_clock_us = 0;
+    uint64_t server_clock_us = 0;
+    bool started = false;
+    uint64_t delivered = 0;  // bytes read by the server after the warm-up
+
+    Flow(const TCPConfig &cfg, const uint64_t start) : client{cfg}, server{cfg}, start_us{start} {}
+};
+
+// N bulk flows from clients to one server, sharing a bottleneck, in virtual time
+class Simulation {
+  private:
+    Options _opt;
+    EmulatedLink _forward;   // client to server: the bottleneck
+    EmulatedLink _backward;  // server to client: delay only
+    vector<Flow> _flows{};
+    string _payload;  // what clients write, enough to fill the send buffer
+    uint64_t _now_us = 0;
+
+    static void catch_up(TCPConnection &conn, uint64_t &clock_us, const uint64_t now_us) {
+        if (now_us > clock_us) {
+            conn.tick_us(now_us - clock_us);
+            clock_us = now_us;
+        }
+    }
+
+    void flush(TCPConnection &conn, EmulatedLink &link, const uint16_t sport, const uint16_t dport) {
+        while (not conn.segments_out().empty()) {
+            TCPSegment &seg = conn.segments_out().front();
+            seg.header().sport = sport;
+            seg.header().dport = dport;
+            link.send(seg);
+            conn.segments_out().pop();
+        }
+    }
+
+    void flush_client(const size_t i) {
+        Flow &flow = _flows[i];
+        flow.client.write(_payload);
+        flush(flow.client, _forward, FIRST_CLIENT_PORT + i, SERVER_PORT);
+    }
+
+    void flush_server(const size_t i) {
+        Flow &flow = _flows[i];
+        ByteStream &inbound = flow.server.inbound_stream();
+        if (_now_us >= _opt.warmup_us) {
+            flow.delivered += inbound.buffer_size();
+        }
+        inbound.pop_output(inbound.buffer_size());
+        flush(flow.server, _backward, SERVER_PORT, FIRST_CLIENT_PORT + i);
+    }
+
+    // hand every segment that has arrived to its flow; returns how many there were
+    size_t deliver() {
+        size_t n = 0;
+        while (auto seg = _forward.receive()) {
+            const size_t i = seg->header().sport - FIRST_CLIENT_PORT;
+            catch_up(_flows[i].server, _flows[i].server_clock_us, _now_us);
+            _flows[i].server.segment_received(seg.value());
+            flush_server(i);
+            n++;
+        }
+        while (auto seg = _backward.receive()) {
+            const size_t i = seg->header().dport - FIRST_CLIENT_PORT;
+            catch_up(_flows[i].client, _flows[i].client_clock_us, _now_us);
+            _flows[i].client.segment_received(seg.value());
+            flush_client(i);
+            n++;
+        }
+        return n;
+    }
+
+    static EmulatedLinkConfig forward_config(const Options &opt) {
+        EmulatedLinkConfig cfg{};
+        cfg.seed = opt.seed;
+        cfg.delay_us = opt.delay_us;
+        cfg.rate_bps = uint64_t(opt.rate_mbps * 1000 * 1000);
+        const size_t bdp = size_t(opt.rate_mbps * double(2 * opt.delay_us) / 8);
+        cfg.queue_bytes = opt.queue_packets != 0 ? opt.queue_packets * PACKET_BYTES : max(bdp, 2 * PACKET_BYTES);
+        if (opt.red) {
+            cfg.discipline = EmulatedLinkConfig::QueueDiscipline::RED;
+            cfg.red_min_bytes = cfg.queue_bytes / 4;
+            cfg.red_max_bytes = cfg.queue_bytes * 3 / 4;
+        }
+        cfg.loss_good = opt.loss;
+        return cfg;
+    }
+
+    static EmulatedLinkConfig backward_config(const Options &opt) {
+        EmulatedLinkConfig cfg{};
+        cfg.seed = opt.seed + 1;
+        cfg.delay_us = opt.delay_us;
+        return cfg;
+    }
+
+  public:
+    explicit Simulation(const Options &opt)
+        : _opt(opt), _forward(forward_config(opt)), _backward(backward_config(opt)), _payload() {
+        TCPConfig cfg{};
+        // in-flight data is held by the sender, so a small buffer is enough to keep a flow busy
+        // and keeps the memory for 10,000 flows in check
+        cfg.send_capacity = 16 * TCPConfig::MAX_PAYLOAD_SIZE;
+        _payload = string(cfg.send_capacity, 'x');
+
+        mt19937_64 rng{opt.seed};
+        _flows.reserve(opt.flows);
+        for (size_t i = 0; i < opt.flows; i++) {
+            cfg.fixed_isn = WrappingInt32{uint32_t(rng())};
+            const uint64_t start_us = opt.flows == 1 ? 0 : opt.stagger_us * i / (opt.flows - 1);
+            _flows.emplace_back(cfg, start_us);
+        }
+    }
+
+    ~Simulation() {
+        // the run stops mid-transfer, so reset each connection rather than have its destructor complain
+        TCPSegment rst;
+        rst.header().rst = true;
+        for (auto &flow : _flows) {
+            flow.client.segment_received(rst);
+            flow.server.segment_received(rst);
+        }
+    }
+
+    Simulation(const Simulation &other) = delete;
+    Simulation &operator=(const Simulation &other) = delete;
+
+    void run() {
+        uint64_t next_tick_us = 0;
+        size_t next_start = 0;
+        while (_now_us < _opt.duration_us) {
+            // the next event: a timer tick, a flow starting, or a segment arriving
+            uint64_t next_us = min(next_tick_us, _opt.duration_us);
+            if (next_start < _flows.size()) {
+                next_us = min(next_us, _flows[next_start].start_us);
+            }
+            for (const auto &link : {&_forward, &_backward}) {
+                if (const auto wait = link->time_until_next_arrival_us()) {
+                    next_us = min(next_us, _now_us + wait.value());
+                }
+            }
+
+            _forward.tick_us(next_us - _now_us);
+            _backward.tick_us(next_us - _now_us);
+            _now_us = next_us;
+
+            for (; next_start < _flows.size() and _flows[next_start].start_us <= _now_us; next_start++) {
+                Flow &flow = _flows[next_start];
+                flow.started = true;
+                flow.client_clock_us = flow.server_clock_us = _now_us;
+                flow.client.connect();
+                flush_client(next_start);
+            }
+
+            while (deliver() > 0) {
+            }
+
+            if (_now_us >= next_tick_us) {
+                for (size_t i = 0; i < next_start; i++) {
+                    catch_up(_flows[i].client, _flows[i].client_clock_us, _now_us);
+                    catch_up(_flows[i].server, _flows[i].server_clock_us, _now_us);
+                    flush_client(i);
+                    flush_server(i);
+                }
+                next_tick_us += _opt.granularity_us;
+            }
+        }
+    }
+
+    const vector<Flow> &flows() const { return _flows; }
+    const EmulatedLink &bottleneck() const { return _forward; }
+};
+
+static void report(const Options &opt, const Simulation &sim, const double cpu_s, const double wall_s) {
+    const double measured_s = double(opt.duration_us - opt.warmup_us) / 1e6;
+    uint64_t total = 0, all_bytes = 0, retransmitted = 0, timeouts = 0;
+    double sum_squares = 0;
+    double min_mbps = numeric_limits<double>::max(), max_mbps = 0;
+    for (const auto &flow : sim.flows()) {
+        const double mbps = double(flow.delivered) * 8 / measured_s / 1e6;
+        total += flow.delivered;
+        all_bytes += flow.server.inbound_stream().bytes_read();
+        sum_squares += mbps * mbps;
+        min_mbps = min(min_mbps, mbps);
+        max_mbps = max(max_mbps, mbps);
+        retransmitted += flow.client.stats().retransmitted_segments;
+        timeouts += flow.client.stats().rto_expirations;
+    }
+    const double total_mbps = double(total) * 8 / measured_s / 1e6;
+    // Jain's index: 1 when every flow gets the same share, 1/N when one flow gets everything
+    const double jain = sum_squares == 0 ? 0 : total_mbps * total_mbps / (double(sim.flows().size()) * sum_squares);
+
+    const EmulatedLinkStats &link = sim.bottleneck().stats();
+    const double mean_queue_ms =
+        link.segments_queued == 0 ? 0 : double(link.queue_delay_us) / double(link.segments_queued) / 1000;
+
+    cout << fixed << setprecision(3);
+    cout << "Flows:                " << sim.flows().size() << "\n"
+         << "Bottleneck:           " << opt.rate_mbps << " Mbit/s, " << double(opt.delay_us) / 1000
+         << " ms one-way delay, " << sim.bottleneck().config().queue_bytes << " byte "
+         << (opt.red ? "RED" : "drop-tail") << " queue\n"
+         << "Measured:             " << measured_s << " s after a " << double(opt.warmup_us) / 1e6
+         << " s warm-up\n\n";
+    cout << "Aggregate throughput: " << total_mbps << " Mbit/s (" << 100 * total_mbps / opt.rate_mbps
+         << "% of the bottleneck, payload only)\n"
+         << "Per-flow throughput:  min " << min_mbps << ", mean " << total_mbps / double(sim.flows().size())
+         << ", max " << max_mbps << " Mbit/s\n"
+         << "Jain's fairness:      " << jain << "\n"
+         << "Queueing delay:       mean " << mean_queue_ms << " ms, max "
+         << double(link.max_queue_delay_us) / 1000 << " ms\n"
+         << "Bottleneck drops:     " << link.queue_drops << " tail, " << link.red_drops << " RED, " << link.lost
+         << " random (of " << link.segments_sent << " segments)\n"
+         << "Retransmissions:      " << retransmitted << " segments, " << timeouts << " timeouts\n\n";
+    cout << "CPU time:             " << cpu_s << " s (" << setprecision(2)
+         << (all_bytes == 0 ? 0 : cpu_s * 1e9 / double(all_bytes)) << " ns per byte delivered)\n"
+         << "Wall time:            " << setprecision(3) << wall_s << " s ("
+         << double(opt.duration_us) / 1e6 / wall_s << "x real time)\n";
+
+    if (opt.verbose) {
+        cout << "\n  port     Mbit/s   srtt (ms)\n";
+        for (size_t i = 0; i < sim.flows().size(); i++) {
+            const Flow &flow = sim.flows()[i];
+            const auto srtt = flow.client.stats().srtt_us;
+            cout << setw(6) << FIRST_CLIENT_PORT + i << setw(11)
+                 << double(flow.delivered) * 8 / measured_s / 1e6 << setw(12)
+                 << (srtt.has_value() ? double(srtt.value()) / 1000 : 0) << "\n";
+        }
+    }
+}
+
+static void show_usage(const char *argv0) {
+    cerr << "Usage: " << argv0 << " [options]\n\n"
+         << "   -n <flows>      Number of flows, 1 to " << MAX_FLOWS << " (default 10)\n"
+         << "   -r <Mbit/s>     Bottleneck rate (default 100)\n"
+         << "   -d <ms>         One-way delay in each direction (default 10)\n"
+         << "   -q <packets>    Bottleneck queue limit (default: one bandwidth-delay product)\n"
+         << "   -R              Use RED at the bottleneck instead of drop-tail\n"
+         << "   -l <rate>       Random loss rate at the bottleneck (default 0)\n"
+         << "   -t <seconds>    Virtual time to run for (default 10)\n"
+         << "   -w <seconds>    Warm-up not counted in throughput (default 1)\n"
+         << "   -S <ms>         Spread the flows' starts over this long (default 100)\n"
+         << "   -g <us>         Interval between timer ticks (default 1000)\n"
+         << "   -s <seed>       Random seed (default 1)\n"
+         << "   -v              Show each flow's throughput\n"
+         << "   -h              Show this message and quit.\n";
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        if (argc <= 0) {
+            abort();  // For sticklers: don't try to access argv[0] if argc <= 0.
+        }
+
+        // single-threaded, so Buffer refcounts needn't be atomic
+        Buffer::set_thread_confined(true);
+
+        Options opt;
+        for (int i = 1; i < argc; i++) {
+            const bool has_arg = i + 1 < argc;
+            if (strcmp(argv[i], "-n") == 0 and has_arg) {
+                opt.flows = strtoul(argv[++i], nullptr, 0);
+            } else if (strcmp(argv[i], "-r") == 0 and has_arg) {
+                opt.rate_mbps = strtod(argv[++i], nullptr);
+            } else if (strcmp(argv[i], "-d") == 0 and has_arg) {
+                opt.delay_us = uint64_t(strtod(argv[++i], nullptr) * 1000);
+            } else if (strcmp(argv[i], "-q") == 0 and has_arg) {
+                opt.queue_packets = strtoul(argv[++i], nullptr, 0);
+            } else if (strcmp(argv[i], "-R") == 0) {
+                opt.red = true;
+            } else if (strcmp(argv[i], "-l") == 0 and has_arg) {
+                opt.loss = strtod(argv[++i], nullptr);
+            } else if (strcmp(argv[i], "-t") == 0 and has_arg) {
+                opt.duration_us = uint64_t(strtod(argv[++i], nullptr) * 1e6);
+            } else if (strcmp(argv[i], "-w") == 0 and has_arg) {
+                opt.warmup_us = uint64_t(strtod(argv[++i], nullptr) * 1e6);
+            } else if (strcmp(argv[i], "-S") == 0 and has_arg) {
+                opt.stagger_us = uint64_t(strtod(argv[++i], nullptr) * 1000);
+            } else if (strcmp(argv[i], "-g") == 0 and has_arg) {
+                opt.granularity_us = strtoull(argv[++i], nullptr, 0);
+            } else if (strcmp(argv[i], "-s") == 0 and has_arg) {
+                opt.seed = strtoull(argv[++i], nullptr, 0);
+            } else if (strcmp(argv[i], "-v") == 0) {
+                opt.verbose = true;
+            } else {
+                show_usage(argv[0]);
+                return strcmp(argv[i], "-h") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+        }
+
+        if (opt.flows == 0 or opt.flows > MAX_FLOWS) {
+            throw runtime_error("number of flows must be between 1 and " + to_string(MAX_FLOWS));
+        }
+        if (opt.rate_mbps <= 0 or opt.granularity_us == 0) {
+            throw runtime_error("rate and timer interval must be positive");
+        }
+        if (opt.warmup_us >= opt.duration_us) {
+            throw runtime_error("warm-up must be shorter than the run");
+        }
+
+        Simulation sim{opt};
+        const clock_t first_cpu = clock();
+        const auto first_time = chrono::steady_clock::now();
+        sim.run();
+        const double cpu_s = double(clock() - first_cpu) / CLOCKS_PER_SEC;
+        const double wall_s = chrono::duration<double>(chrono::steady_clock::now() - first_time).count();
+
+        report(opt, sim, cpu_s, wall_s);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
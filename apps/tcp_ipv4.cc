@@ -15,6 +15,7 @@ using namespace std;
 
 constexpr const char *TUN_DFLT = "tun144";
 const string LOCAL_ADDRESS_DFLT = "169.254.144.9";
+const string LOCAL_ADDRESS6_DFLT = "fd00:169:254:144::9";
 
 static void show_usage(const char *argv0, const char *msg) {
     cout << "Usage: " << argv0 << " [options] <host> <port>\n\n"
@@ -24,12 +25,18 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -l              Server (listen) mode.                           (client mode)\n"
          << "                   In server mode, <host>:<port> is the address to bind.\n\n"
 
+         << "   -6              Use IPv6 instead of IPv4                        (IPv4)\n\n"
+
          << "   -a <addr>       Set source address (client mode only)           " << LOCAL_ADDRESS_DFLT << "\n"
+         << "                                                         (with -6) " << LOCAL_ADDRESS6_DFLT << "\n"
          << "   -s <port>       Set source port (client mode only)              (random)\n\n"
 
          << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
          << "\n\n"
 
+         << "   -W <maxwin>     Start at <winsz> and grow the window toward     (fixed window)\n"
+         << "                   <maxwin> bytes as the application keeps up.\n\n"
+
          << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
          << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
@@ -37,6 +44,8 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -m <mtu>        Fragment datagrams bigger than <mtu> bytes      (no fragmentation)\n\n"
+
          << "   -h              Show this message.\n\n";
 
     if (msg != nullptr) {
@@ -52,15 +61,16 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, bool, bool, char *> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
     char *tundev = nullptr;
 
     int curr = 1;
     bool listen = false;
+    bool ipv6 = false;
 
-    string source_address = LOCAL_ADDRESS_DFLT;
+    string source_address{};
     string source_port = to_string(uint16_t(random_device()()));
 
     while (argc - curr > 2) {
@@ -68,6 +78,10 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
             listen = true;
             curr += 1;
 
+        } else if (strncmp("-6", argv[curr], 3) == 0) {
+            ipv6 = true;
+            curr += 1;
+
         } else if (strncmp("-a", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -a requires one argument.");
             source_address = argv[curr + 1];
@@ -83,6 +97,11 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
             c_fsm.recv_capacity = strtol(argv[curr + 1], nullptr, 0);
             curr += 2;
 
+        } else if (strncmp("-W", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -W requires one argument.");
+            c_fsm.recv_capacity_max = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
         } else if (strncmp("-t", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -t requires one argument.");
             c_fsm.rt_timeout = strtol(argv[curr + 1], nullptr, 0);
@@ -109,6 +128,11 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-m", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -m requires one argument.");
+            c_filt.mtu = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -121,17 +145,32 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
 
     // parse positional command-line arguments
     if (listen) {
-        c_filt.source = {"0", argv[curr + 1]};
+        c_filt.source = {ipv6 ? "::" : "0", argv[curr + 1]};
         if (c_filt.source.port() == 0) {
             show_usage(argv[0], "ERROR: listen port cannot be zero in server mode.");
             exit(1);
         }
     } else {
         c_filt.destination = {argv[curr], argv[curr + 1]};
+        if (source_address.empty()) {
+            source_address = ipv6 ? LOCAL_ADDRESS6_DFLT : LOCAL_ADDRESS_DFLT;
+        }
         c_filt.source = {source_address, source_port};
     }
 
-    return make_tuple(c_fsm, c_filt, listen, tundev);
+    return make_tuple(c_fsm, c_filt, listen, ipv6, tundev);
+}
+
+template <typename SocketT>
+static void run(SocketT &tcp_socket, const TCPConfig &c_fsm, const FdAdapterConfig &c_filt, const bool listen) {
+    if (listen) {
+        tcp_socket.listen_and_accept(c_fsm, c_filt);
+    } else {
+        tcp_socket.connect(c_fsm, c_filt);
+    }
+
+    bidirectional_stream_copy(tcp_socket);
+    tcp_socket.wait_until_closed();
 }
 
 int main(int argc, char **argv) {
@@ -141,18 +180,17 @@ int main(int argc, char **argv) {
             return EXIT_FAILURE;
         }
 
-        auto [c_fsm, c_filt, listen, tun_dev_name] = get_config(argc, argv);
-        LossyTCPOverIPv4SpongeSocket tcp_socket(LossyTCPOverIPv4OverTunFdAdapter(
-            TCPOverIPv4OverTunFdAdapter(TunFD(tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name))));
-
-        if (listen) {
-            tcp_socket.listen_and_accept(c_fsm, c_filt);
+        auto [c_fsm, c_filt, listen, ipv6, tun_dev_name] = get_config(argc, argv);
+        TunFD tun{tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name};
+        if (ipv6) {
+            LossyTCPOverIPv6SpongeSocket tcp_socket(
+                LossyTCPOverIPv6OverTunFdAdapter(TCPOverIPv6OverTunFdAdapter(move(tun))));
+            run(tcp_socket, c_fsm, c_filt, listen);
         } else {
-            tcp_socket.connect(c_fsm, c_filt);
+            LossyTCPOverIPv4SpongeSocket tcp_socket(
+                LossyTCPOverIPv4OverTunFdAdapter(TCPOverIPv4OverTunFdAdapter(move(tun))));
+            run(tcp_socket, c_fsm, c_filt, listen);
         }
-
-        bidirectional_stream_copy(tcp_socket);
-        tcp_socket.wait_until_closed();
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <random>
 #include <string>
 #include <tuple>
@@ -26,11 +27,17 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
          << "\n\n"
 
+         << "   -W <maxwin>     Start at <winsz> and grow the window toward     (fixed window)\n"
+         << "                   <maxwin> bytes as the application keeps up.\n\n"
+
          << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -p <file>       Write the segments sent and received to a       (no capture)\n"
+         << "                   pcap file, in synthesized IPv4 headers.\n\n"
+
          << "   -h              Show this message and quit.\n\n";
 
     if (msg != nullptr) {
@@ -46,9 +53,10 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, bool, optional<string>> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
+    optional<string> pcap_path{};
 
     int curr = 1;
     bool listen = false;
@@ -63,6 +71,11 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
             c_fsm.recv_capacity = strtol(argv[curr + 1], nullptr, 0);
             curr += 2;
 
+        } else if (strncmp("-W", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -W requires one argument.");
+            c_fsm.recv_capacity_max = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
         } else if (strncmp("-t", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -t requires one argument.");
             c_fsm.rt_timeout = strtol(argv[curr + 1], nullptr, 0);
@@ -84,6 +97,11 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-p", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -p requires one argument.");
+            pcap_path = argv[curr + 1];
+            curr += 2;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -100,7 +118,19 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
         c_filt.destination = {argv[argc - 2], argv[argc - 1]};
     }
 
-    return make_tuple(c_fsm, c_filt, listen);
+    return make_tuple(c_fsm, c_filt, listen, pcap_path);
+}
+
+template <typename SocketT>
+static void run(SocketT &tcp_socket, const TCPConfig &c_fsm, const FdAdapterConfig &c_filt, const bool listen) {
+    if (listen) {
+        tcp_socket.listen_and_accept(c_fsm, c_filt);
+    } else {
+        tcp_socket.connect(c_fsm, c_filt);
+    }
+
+    bidirectional_stream_copy(tcp_socket);
+    tcp_socket.wait_until_closed();
 }
 
 int main(int argc, char **argv) {
@@ -111,22 +141,21 @@ int main(int argc, char **argv) {
         }
 
         // handle configuration and UDP setup from cmdline arguments
-        auto [c_fsm, c_filt, listen] = get_config(argc, argv);
+        auto [c_fsm, c_filt, listen, pcap_path] = get_config(argc, argv);
 
         // build a TCP FSM on top of the UDP socket
         UDPSocket udp_sock;
         if (listen) {
             udp_sock.bind(c_filt.source);
         }
-        LossyTCPOverUDPSpongeSocket tcp_socket(LossyTCPOverUDPSocketAdapter(TCPOverUDPSocketAdapter(move(udp_sock))));
-        if (listen) {
-            tcp_socket.listen_and_accept(c_fsm, c_filt);
+        LossyTCPOverUDPSocketAdapter adapter{TCPOverUDPSocketAdapter(move(udp_sock))};
+        if (pcap_path.has_value()) {
+            PcapLossyTCPOverUDPSpongeSocket tcp_socket(PcapLossyTCPOverUDPSocketAdapter(move(adapter), *pcap_path));
+            run(tcp_socket, c_fsm, c_filt, listen);
         } else {
-            tcp_socket.connect(c_fsm, c_filt);
+            LossyTCPOverUDPSpongeSocket tcp_socket(move(adapter));
+            run(tcp_socket, c_fsm, c_filt, listen);
         }
-
-        bidirectional_stream_copy(tcp_socket);
-        tcp_socket.wait_until_closed();
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
@@ -0,0 +1,42 @@
+#include "tcp_trace.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    try {
+        if (argc <= 0) {
+            abort();  // For sticklers: don't try to access argv[0] if argc <= 0.
+        }
+
+        const bool chrome = argc == 3 and strcmp(argv[1], "--chrome") == 0;
+        if (argc != 2 and not chrome) {
+            cerr << "Usage: " << argv[0] << " [--chrome] TRACE_FILE\n";
+            cerr << "\tPrints one line per event, or with --chrome, JSON for chrome://tracing or Perfetto\n";
+            return EXIT_FAILURE;
+        }
+
+        const string path = argv[argc - 1];
+        ifstream trace{path, ios::binary};
+        if (not trace) {
+            cerr << "Can't open " << path << "\n";
+            return EXIT_FAILURE;
+        }
+
+        if (chrome) {
+            TCPTracer::decode_chrome_json(trace, cout);
+        } else {
+            TCPTracer::decode_text(trace, cout);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
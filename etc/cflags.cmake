@@ -1,14 +1,14 @@
-set (CMAKE_CXX_STANDARD 17)
+set (CMAKE_CXX_STANDARD 20)
 set (CMAKE_EXPORT_COMPILE_COMMANDS ON)
-set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++17 -g -pedantic -pedantic-errors -Werror -Wall -Wextra -Wshadow -Wpointer-arith -Wcast-qual -Wformat=2 -Weffc++ -Wold-style-cast")
+set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++20 -g -pedantic -pedantic-errors -Werror -Wall -Wextra -Wshadow -Wpointer-arith -Wcast-qual -Wformat=2 -Weffc++ -Wold-style-cast")
 
 # check for supported compiler versions
 set (IS_GNU_COMPILER ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "GNU"))
 set (IS_CLANG_COMPILER ("${CMAKE_CXX_COMPILER_ID}" MATCHES "[Cc][Ll][Aa][Nn][Gg]"))
-set (CXX_VERSION_LT_6 ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_LESS 6))
-set (CXX_VERSION_LT_8 ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_LESS 8))
-if ((${IS_GNU_COMPILER} AND ${CXX_VERSION_LT_8}) OR (${IS_CLANG_COMPILER} AND ${CXX_VERSION_LT_6}))
-    message (FATAL_ERROR "You must compile this project with g++ >= 8 or clang >= 6.")
+set (CXX_VERSION_LT_11 ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_LESS 11))
+set (CXX_VERSION_LT_14 ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_LESS 14))
+if ((${IS_GNU_COMPILER} AND ${CXX_VERSION_LT_11}) OR (${IS_CLANG_COMPILER} AND ${CXX_VERSION_LT_14}))
+    message (FATAL_ERROR "You must compile this project with g++ >= 11 or clang >= 14.")
 endif ()
 if (${IS_CLANG_COMPILER})
     set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wloop-analysis")
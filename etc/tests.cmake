@@ -40,8 +40,10 @@ add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
 add_test(NAME arp_network_interface    COMMAND net_interface)
+add_test(NAME arp_interface_scale      COMMAND net_interface_scale)
 
-add_test(NAME router_test    COMMAND network_simulator)
+add_test(NAME router_test            COMMAND network_simulator)
+add_test(NAME router_prefix_table    COMMAND prefix_table)
 
 add_test(NAME t_tcp_parser           COMMAND tcp_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
 add_test(NAME t_ipv4_parser          COMMAND ipv4_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
@@ -62,6 +64,23 @@ add_test(NAME t_retx_win             COMMAND fsm_retx_win)
 add_test(NAME t_loopback             COMMAND fsm_loopback)
 add_test(NAME t_loopback_win         COMMAND fsm_loopback_win)
 add_test(NAME t_reorder              COMMAND fsm_reorder)
+add_test(NAME t_tcp_demux            COMMAND tcp_demux)
+add_test(NAME t_tcp_header_template  COMMAND tcp_header_template)
+add_test(NAME t_ipv4_reassembler     COMMAND ipv4_reassembler)
+add_test(NAME t_tcp_over_ipv6        COMMAND tcp_over_ipv6)
+add_test(NAME t_tcp_sharded_stack    COMMAND tcp_sharded_stack)
+add_test(NAME t_tcp_sponge_ring      COMMAND tcp_sponge_ring)
+add_test(NAME t_tcp_async_stack      COMMAND tcp_async_stack)
+add_test(NAME t_tcp_stats            COMMAND tcp_stats)
+add_test(NAME t_tcp_trace            COMMAND tcp_trace)
+add_test(NAME t_pcap_writer          COMMAND pcap_writer)
+add_test(NAME t_emulated_link        COMMAND emulated_link)
+add_test(NAME t_tcp_allocations      COMMAND tcp_allocations)
+add_test(NAME t_tcp_idle_memory      COMMAND tcp_idle_memory)
+add_test(NAME t_recv_autotune        COMMAND recv_autotune)
+add_test(NAME t_send_autotune        COMMAND send_autotune)
+add_test(NAME t_memory_pressure      COMMAND memory_pressure)
+add_test(NAME t_buffer_slab          COMMAND buffer_slab)
 
 add_test(NAME t_address_dt           COMMAND address_dt)
 add_test(NAME t_parser_dt            COMMAND parser_dt)
@@ -1,5 +1,7 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
+
 
 
 // 这是一个虚拟实现的内存中流控制的字节流。
@@ -29,7 +31,7 @@ using namespace std;
 
 // 构造函数进行初始化双端队列及成员变量
 ByteStream::ByteStream(const size_t _capacity)
-    : _buff(),           // 初始化 _buff，使用默认构造函数创建一个空的双端队列
+    : _buff(),           // 初始化 _buff，第一次写入时才分配
       capacity(_capacity), // 初始化 capacity，用传入的 _capacity 参数
       bytes_r(0),         // 初始化 bytes_r，将其设置为0
       bytes_w(0),         // 初始化 bytes_w，将其设置为0
@@ -41,8 +43,31 @@ ByteStream::ByteStream(const size_t _capacity)
 
 
 
+// 函数功能：扩大环形缓冲区，至少能再容纳 len 个字节
+void ByteStream::grow(const size_t len)
+{
+    // 每次至少翻倍，避免频繁扩容；但不超过容量
+    // 内存池再向上取整到 2 的幂
+    const size_t new_size = min(capacity, max(_size + len, 2 * _buff.size()));
+    StreamStorage bigger(new_size);
+    copy_out(bigger.data(), _size);
+    _buff = move(bigger);
+    _head = 0;
+}
+
+
+// 函数功能：把接下来的 len 个字节复制到 dest，数据可能绕回缓冲区开头，分两段复制
+void ByteStream::copy_out(char *dest, const size_t len) const
+{
+    const size_t first = min(len, _buff.size() - _head);
+    copy_n(_buff.data() + _head, first, dest);
+    copy_n(_buff.data(), len - first, dest + first);
+}
+
+
+
 // 函数功能：用于向字节流中写入字符串 data
-size_t ByteStream::write(const string &data) 
+size_t ByteStream::write(string_view data) 
 {
     // 如果输入端已经结束，则直接返回0，表示没有写入任何字节
     if (input_ended())
@@ -51,12 +76,18 @@ size_t ByteStream::write(const string &data)
     // 计算实际可以写入的字节数，即 data 的大小和剩余容量的较小值
     size_t write_size = min(data.size(), remaining_capacity());
 
+    if (_size + write_size > _buff.size())
+        grow(write_size);
+
     // 更新已写入的字节数，用于后续的数据流量统计和管理
     bytes_w += write_size;
 
-    // 将 data 中的字节逐个写入 _buff 中
-    for (size_t i = 0; i < write_size; i++)
-        _buff.push_back(data[i]);
+    // 从尾部写入，到末尾后绕回开头
+    const size_t tail = (_head + _size) % max(_buff.size(), size_t{1});
+    const size_t first = min(write_size, _buff.size() - tail);
+    copy_n(data.data(), first, _buff.data() + tail);
+    copy_n(data.data() + first, write_size - first, _buff.data());
+    _size += write_size;
 
     // 返回实际写入的字节数
     return write_size;
@@ -69,10 +100,11 @@ size_t ByteStream::write(const string &data)
 string ByteStream::peek_output(const size_t len) const 
 {
     // 计算实际可以查看的字节数，即 len 和当前缓冲区中的字节数量的较小值
-    size_t peek_size = min(len, _buff.size());
+    size_t peek_size = min(len, _size);
 
-    // 使用 string 类的构造函数，从 _buff 的开头复制 peek_size 个字节到新建的字符串中
-    return string(_buff.begin(), _buff.begin() + peek_size);
+    string r(peek_size, 0);
+    copy_out(r.data(), peek_size);
+    return r;
 }
 
 
@@ -83,14 +115,24 @@ string ByteStream::peek_output(const size_t len) const
 void ByteStream::pop_output(const size_t len) 
 {
     // 计算实际可以弹出的字节数，即 len 和当前缓冲区中的字节数量的较小值
-    size_t pop_size = min(len, _buff.size());
+    size_t pop_size = min(len, _size);
 
     // 更新已读取的字节数
     bytes_r += pop_size;
 
-    // 循环弹出指定数量的字节，即从 _buff 的前端依次弹出 pop_size 次
-    for (size_t i = 0; i < pop_size; i++)
-        _buff.pop_front();
+    // 移动读指针即可，不需要逐个弹出
+    _size -= pop_size;
+    _head = _size == 0 ? 0 : (_head + pop_size) % _buff.size();
+}
+
+
+
+// 函数功能：读空的流把存储还给内存池，下次写入时再取。
+// 读空时不自动归还：繁忙的流经常读空，每次都归还的话，下一次突发又要从小块重新扩容
+void ByteStream::release_storage()
+{
+    if (_size == 0)
+        _buff.reset();
 }
 
 
@@ -116,10 +158,26 @@ std::string ByteStream::read(const size_t len) {
 }
 
 
+// 函数功能：同 read()，但直接复制到内存池中的 Buffer，不经过临时字符串
+Buffer ByteStream::read_buffer(const size_t len) {
+    const size_t read_size = min(len, _size);
+    Buffer r = Buffer::make(read_size, [&](char *dest) { copy_out(dest, read_size); });
+    pop_output(read_size);
+    return r;
+}
+
+
+
 
 
 
 
+// 函数功能：调整容量。缩小时不丢弃已有的字节；已取得的存储等读空时再还回内存池
+void ByteStream::set_capacity(const size_t new_capacity)
+{
+    capacity = max(new_capacity, _size);
+}
+
 
 // 函数功能：标记输入端已经结束
 void ByteStream::end_input() 
@@ -138,14 +196,14 @@ bool ByteStream::input_ended() const
 // 函数功能：用于返回当前字节流缓冲区的大小
 size_t ByteStream::buffer_size() const 
 {
-    return _buff.size(); // 返回 _buff 的大小，即当前缓冲区中的字节数量
+    return _size; // 返回当前缓冲区中的字节数量
 }
 
 
 // 函数功能：于检查当前字节流缓冲区是否为空
 bool ByteStream::buffer_empty() const 
 {
-    return _buff.empty(); // 返回 _buff 是否为空的结果，即当前缓冲区是否没有字节
+    return _size == 0; // 返回当前缓冲区是否没有字节
 }
 
 
@@ -175,5 +233,5 @@ size_t ByteStream::bytes_read() const
 size_t ByteStream::remaining_capacity() const 
 {
     // 返回当前字节流的容量减去缓冲区当前的大小，即剩余的可写入容量
-    return capacity - _buff.size();
+    return capacity - _size;
 }
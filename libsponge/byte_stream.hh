@@ -2,8 +2,11 @@
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 // 预处理器指令，通常用于防止头文件的多重包含
 
-#include <deque>
+#include "buffer.hh"
+#include "stream_storage.hh"
+
 #include <string>
+#include <string_view>
 
 
 //! \brief An in-order byte stream.
@@ -22,7 +25,12 @@ class ByteStream {
     // 这表明你可能希望继续探索不同的方法。
 
 
-    std::deque<char> _buff; // 使用标准库中的双端队列（deque），存储字符类型的数据，用作字节流的缓冲区
+    // 环形缓冲区：数据从 _head 开始，共 _size 个字节，到末尾后绕回开头。
+    // 按需增长（最多到 capacity），不像 deque 每读写几百字节就分配/释放一块。
+    // 存储来自共享的内存池：第一次写入时才取，读空时就还回去，所以空闲的流不占缓冲区
+    StreamStorage _buff;
+    size_t _head{0};
+    size_t _size{0};
     size_t capacity; // 保存缓冲区的容量，即可以存储的最大字节数量
     size_t bytes_r; // 记录已经读取的字节数量
     size_t bytes_w; // 记录已经写入的字节数量
@@ -35,6 +43,12 @@ class ByteStream {
     以及流的结束状态和错误状态。
     */
 
+    // 扩大环形缓冲区，至少能再容纳 `len` 个字节
+    void grow(const size_t len);
+
+    // 把接下来的 `len` 个字节复制到 `dest`（不弹出）
+    void copy_out(char *dest, const size_t len) const;
+
   public:
 
     // 构建一个容量为 `capacity` 字节的流。
@@ -49,7 +63,7 @@ class ByteStream {
     //! \returns 接受到流中的字节数
 
     // 写入字节流函数，返回成功写入的字节数
-    size_t write(const std::string &data);
+    size_t write(std::string_view data);
 
 
     // 流中还有空间可容纳的额外字节数
@@ -64,6 +78,12 @@ class ByteStream {
     // 指示流发生了错误。
     void set_error() { _error = true; }
 
+    // 调整容量（不会小于流中现有的字节数）；存储仍然按需增长
+    void set_capacity(const size_t new_capacity);
+
+    // 当前容量
+    size_t capacity_size() const { return capacity; }
+
 
 
 
@@ -81,6 +101,9 @@ class ByteStream {
     // 读取（即复制然后弹出）流的下一个 "len" 字节
     std::string read(const size_t len);
 
+    // 同 read()，但结果放在 Buffer 中；Buffer 的存储来自内存池，稳定传输时不分配内存
+    Buffer read_buffer(const size_t len);
+
 
 
     // 如果流的输入已经结束则返回 true
@@ -95,6 +118,12 @@ class ByteStream {
     // 当前可以从流中读取的最大量
     size_t buffer_size() const;
 
+    // 当前占用的存储字节数（读空后仍然保留，直到 release_storage()）
+    size_t storage_size() const { return _buff.size(); }
+
+    // 流已经读空时，把存储还给内存池（连接空闲时调用）
+    void release_storage();
+
 
     // 判断缓冲区是否为空，空则返回 true
     bool buffer_empty() const;
@@ -0,0 +1,195 @@
+#include "network_interface.hh"
+
+#include "arp_message.hh"
+
+using namespace std;
+
+//! \param[in] ethernet_address Ethernet (what ARP calls "hardware") address of the interface
+//! \param[in] ip_address IP (what ARP calls "protocol") address of the interface
+NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address)
+    : _ethernet_address(ethernet_address), _ip_address(ip_address), _neighbors(16) {}
+
+// 哈希：乘以 2^64 / 黄金分割比，取高位作为槽位下标（容量是 2 的幂）
+size_t NetworkInterface::_home_slot(const uint32_t ip) const {
+    return (uint64_t{ip} * 0x9E3779B97F4A7C15ULL) >> 32 & (_neighbors.size() - 1);
+}
+
+// 查找 IP 地址对应的表项，没有则返回 nullptr
+NetworkInterface::Neighbor *NetworkInterface::_find(const uint32_t ip) {
+    for (size_t i = _home_slot(ip);; i = (i + 1) & (_neighbors.size() - 1)) {
+        Neighbor &slot = _neighbors[i];
+        if (!slot.used) {
+            return nullptr;
+        }
+        if (slot.ip == ip) {
+            return &slot;
+        }
+    }
+}
+
+// 查找 IP 地址对应的表项，没有则插入一个空表项；返回表项以及是否是新插入的
+// 注意：插入可能扩容，之前取得的表项指针都会失效
+pair<NetworkInterface::Neighbor *, bool> NetworkInterface::_find_or_insert(const uint32_t ip) {
+    if (Neighbor *neighbor = _find(ip)) {
+        return {neighbor, false};
+    }
+
+    // 保持负载不超过一半，探测序列就很短
+    if (2 * (_neighbor_count + 1) > _neighbors.size()) {
+        _grow();
+    }
+
+    size_t i = _home_slot(ip);
+    while (_neighbors[i].used) {
+        i = (i + 1) & (_neighbors.size() - 1);
+    }
+    _neighbors[i].used = true;
+    _neighbors[i].ip = ip;
+    _neighbor_count++;
+    return {&_neighbors[i], true};
+}
+
+// 删除表项：把后面探测链上的表项往前移（backward shift），不需要墓碑
+void NetworkInterface::_erase(Neighbor &neighbor) {
+    const size_t mask = _neighbors.size() - 1;
+    size_t hole = &neighbor - _neighbors.data();
+    for (size_t i = (hole + 1) & mask; _neighbors[i].used; i = (i + 1) & mask) {
+        // 表项 i 的理想位置在 (hole, i] 之间（循环意义下）时留在原处，否则填到洞里
+        const size_t home = _home_slot(_neighbors[i].ip);
+        const bool stays = hole < i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!stays) {
+            _neighbors[hole] = std::move(_neighbors[i]);
+            hole = i;
+        }
+    }
+    _neighbors[hole] = Neighbor{};
+    _neighbor_count--;
+}
+
+// 容量翻倍，重新插入所有表项
+void NetworkInterface::_grow() {
+    vector<Neighbor> old = std::move(_neighbors);
+    _neighbors = vector<Neighbor>(2 * old.size());
+    for (Neighbor &neighbor : old) {
+        if (neighbor.used) {
+            size_t i = _home_slot(neighbor.ip);
+            while (_neighbors[i].used) {
+                i = (i + 1) & (_neighbors.size() - 1);
+            }
+            _neighbors[i] = std::move(neighbor);
+        }
+    }
+}
+
+// 设置表项在 ttl_ms 后过期；之前的定时器到期时发现时间对不上，就会被忽略
+void NetworkInterface::_expire_after(Neighbor &neighbor, const uint64_t ttl_ms) {
+    neighbor.expires_ms = _timers.now_ms() + ttl_ms;
+    _timers.schedule(neighbor.ip, neighbor.expires_ms);
+}
+
+void NetworkInterface::_send_frame(const uint16_t type, const EthernetAddress &dst, BufferList payload) {
+    EthernetFrame frame;
+    frame.header().src = _ethernet_address;
+    frame.header().dst = dst;
+    frame.header().type = type;
+    frame.payload() = std::move(payload);
+    _frames_out.push(std::move(frame));
+}
+
+void NetworkInterface::_send_arp(const uint16_t opcode,
+                                 const EthernetAddress &dst,
+                                 const EthernetAddress &target_ethernet_address,
+                                 const uint32_t target_ip_address) {
+    ARPMessage arp;
+    arp.opcode = opcode;
+    arp.sender_ethernet_address = _ethernet_address;
+    arp.sender_ip_address = _ip_address.ipv4_numeric();
+    arp.target_ethernet_address = target_ethernet_address;
+    arp.target_ip_address = target_ip_address;
+    _send_frame(EthernetHeader::TYPE_ARP, dst, arp.serialize());
+}
+
+//! \param[in] dgram the IPv4 datagram to be sent
+//! \param[in] next_hop the IP address of the interface to send it to (typically a router or default gateway,
+//! but may also be another host if directly connected to the same network as the destination)
+void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Address &next_hop) {
+    send_serialized(dgram.serialize(), next_hop);
+}
+
+//! \param[in] dgram the serialized IPv4 datagram to be sent
+//! \param[in] next_hop the IP address of the interface to send it to
+void NetworkInterface::send_serialized(BufferList dgram, const Address &next_hop) {
+    const uint32_t next_hop_ip = next_hop.ipv4_numeric();
+    auto [neighbor, inserted] = _find_or_insert(next_hop_ip);
+
+    // 已知以太网地址，直接发送
+    if (neighbor->resolved) {
+        _send_frame(EthernetHeader::TYPE_IPv4, neighbor->ethernet_address, std::move(dgram));
+        return;
+    }
+
+    // 第一次遇到这个下一跳：广播 ARP 请求；之后 5 秒内的数据报只排队，不再重复请求
+    if (inserted) {
+        _expire_after(*neighbor, REQUEST_TTL_MS);
+        _send_arp(ARPMessage::OPCODE_REQUEST, ETHERNET_BROADCAST, {}, next_hop_ip);
+    }
+    if (neighbor->waiting.size() < MAX_WAITING) {
+        neighbor->waiting.push_back(std::move(dgram));
+    }
+}
+
+//! \param[in] frame the incoming Ethernet frame
+optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &frame) {
+    // 只接收发给自己或广播的帧
+    if (frame.header().dst != _ethernet_address && frame.header().dst != ETHERNET_BROADCAST) {
+        return nullopt;
+    }
+
+    // 本地构造的帧（例如模拟网络里直接传递的）负载可能由几段组成，解析前先合并
+    const Buffer payload = frame.payload().buffers().size() == 1 ? frame.payload().buffers().front()
+                                                                  : Buffer{frame.payload().concatenate()};
+
+    if (frame.header().type == EthernetHeader::TYPE_IPv4) {
+        InternetDatagram dgram;
+        if (dgram.parse(payload) != ParseResult::NoError) {
+            return nullopt;
+        }
+        return dgram;
+    }
+
+    if (frame.header().type != EthernetHeader::TYPE_ARP) {
+        return nullopt;
+    }
+    ARPMessage arp;
+    if (arp.parse(payload) != ParseResult::NoError) {
+        return nullopt;
+    }
+
+    // 请求和回复都能学到发送方的映射，记住 30 秒，并发出等待这个下一跳的数据报
+    Neighbor *neighbor = _find_or_insert(arp.sender_ip_address).first;
+    neighbor->resolved = true;
+    neighbor->ethernet_address = arp.sender_ethernet_address;
+    _expire_after(*neighbor, MAPPING_TTL_MS);
+    for (BufferList &dgram : neighbor->waiting) {
+        _send_frame(EthernetHeader::TYPE_IPv4, neighbor->ethernet_address, std::move(dgram));
+    }
+    neighbor->waiting.clear();
+
+    // 询问自己 IP 地址的请求需要回复
+    if (arp.opcode == ARPMessage::OPCODE_REQUEST && arp.target_ip_address == _ip_address.ipv4_numeric()) {
+        _send_arp(
+            ARPMessage::OPCODE_REPLY, arp.sender_ethernet_address, arp.sender_ethernet_address, arp.sender_ip_address);
+    }
+    return nullopt;
+}
+
+//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+void NetworkInterface::tick(const size_t ms_since_last_tick) {
+    // 删除过期的映射和没有回复的请求（连同等待的数据报）
+    _timers.advance(ms_since_last_tick, [&](const TimerWheel::Timer &timer) {
+        Neighbor *neighbor = _find(uint32_t(timer.key));
+        if (neighbor && neighbor->expires_ms == timer.deadline_ms) {
+            _erase(*neighbor);
+        }
+    });
+}
@@ -0,0 +1,102 @@
+#ifndef SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
+#define SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
+
+#include "ethernet_frame.hh"
+#include "tcp_over_ip.hh"
+#include "timer_wheel.hh"
+#include "tun.hh"
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+// 连接 IP（网络层）与以太网（链路层）的“网络接口”
+
+// 这个模块是 TCP/IP 协议栈的最底层（把 IP 和更低层的网络协议连接起来，例如以太网）。
+// 它也被路由器反复使用：路由器通常有多个网络接口，路由器的工作就是在不同接口之间转发数据报。
+
+// 网络接口把数据报（来自“客户”，如 TCP/IP 协议栈或路由器）转换为以太网帧。
+// 为了填写以太网目的地址，它用 ARP 查询每个数据报下一跳 IP 地址对应的以太网地址，
+// 并且把结果缓存起来。反方向上，它接收以太网帧，检查是否是发给自己的，
+// 如果是，就根据类型处理负载：IPv4 数据报交给上层，ARP 请求或回复用于学习或应答。
+
+// 每帧的开销都是 O(1)：ARP 缓存是开放寻址的哈希表，过期由时间轮处理，
+// 等待 ARP 回复的数据报按下一跳排队，同一个 IP 的 ARP 请求每 5 秒最多发一次。
+class NetworkInterface {
+  private:
+    // 一个下一跳 IP 地址的 ARP 状态：已知的映射，或者一个正在等待回复的请求
+    struct Neighbor {
+        uint32_t ip = 0;
+        bool used = false;      // 哈希表中这个槽位是否有表项
+        bool resolved = false;  // 是否已知以太网地址（否则 ARP 请求还在等待回复）
+        EthernetAddress ethernet_address{};
+
+        // 映射（或者等待中的请求）失效的时间
+        uint64_t expires_ms = 0;
+
+        // 等待 ARP 回复、发往这个下一跳的数据报（已经序列化）
+        std::vector<BufferList> waiting{};
+    };
+
+    // 学到的映射保留 30 秒
+    static constexpr uint64_t MAPPING_TTL_MS = 30 * 1000;
+
+    // ARP 请求 5 秒内没有回复就放弃（同时丢弃等待的数据报），在此之前不会重发
+    static constexpr uint64_t REQUEST_TTL_MS = 5 * 1000;
+
+    // 每个下一跳最多排队这么多数据报，多出来的丢弃
+    static constexpr size_t MAX_WAITING = 64;
+
+    // 接口的以太网（硬件/链路层）地址
+    EthernetAddress _ethernet_address;
+
+    // 接口的 IP（网络层）地址
+    Address _ip_address;
+
+    // 待发送的以太网帧
+    EthernetFrameQueue _frames_out{};
+
+    // ARP 缓存：线性探测的开放寻址哈希表，容量是 2 的幂，负载不超过一半
+    std::vector<Neighbor> _neighbors;
+    size_t _neighbor_count = 0;
+
+    // 每个表项过期的定时器，键是 IP 地址
+    TimerWheel _timers{};
+
+    size_t _home_slot(const uint32_t ip) const;
+    Neighbor *_find(const uint32_t ip);
+    std::pair<Neighbor *, bool> _find_or_insert(const uint32_t ip);
+    void _erase(Neighbor &neighbor);
+    void _grow();
+    void _expire_after(Neighbor &neighbor, const uint64_t ttl_ms);
+
+    void _send_frame(const uint16_t type, const EthernetAddress &dst, BufferList payload);
+    void _send_arp(const uint16_t opcode,
+                   const EthernetAddress &dst,
+                   const EthernetAddress &target_ethernet_address,
+                   const uint32_t target_ip_address);
+
+  public:
+    // 用以太网地址和 IP 地址构造一个网络接口
+    NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address);
+
+    // 访问待发送的帧队列
+    EthernetFrameQueue &frames_out() { return _frames_out; }
+
+    // 发送一个 IPv4 数据报，封装在以太网帧里（如果已知以太网目的地址）
+    // 否则发送 ARP 请求，并把数据报排队等待回复
+    // `next_hop` 通常是路由器或默认网关的 IP 地址，也可以是同一网络上的另一台主机
+    void send_datagram(const InternetDatagram &dgram, const Address &next_hop);
+
+    // 同上，但数据报已经序列化（例如路由器转发时只增量更新了首部校验和，不需要重新计算）
+    void send_serialized(BufferList dgram, const Address &next_hop);
+
+    // 收到一个以太网帧并做出相应处理
+    // 如果是 IPv4 数据报，返回它；如果是 ARP 请求或回复，学习映射，必要时发送回复
+    std::optional<InternetDatagram> recv_frame(const EthernetFrame &frame);
+
+    // 随时间推移周期性调用
+    void tick(const size_t ms_since_last_tick);
+};
+
+#endif  // SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
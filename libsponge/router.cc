@@ -0,0 +1,58 @@
+#include "router.hh"
+
+#include <iostream>
+
+using namespace std;
+
+//! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
+//! \param[in] prefix_length For this route to be applicable, how many high-order (most-significant) bits of
+//!            the route_prefix will need to match the corresponding bits of the datagram's destination address?
+//! \param[in] next_hop The IP address of the next hop. Will be empty if the network is directly attached to the
+//!            router (in which case, the next hop address should be the datagram's final destination).
+//! \param[in] interface_num The index of the interface to send the datagram out on.
+void Router::add_route(const uint32_t route_prefix,
+                       const uint8_t prefix_length,
+                       const optional<Address> next_hop,
+                       const size_t interface_num) {
+    cerr << "DEBUG: adding route " << Address::from_ipv4_numeric(route_prefix).ip() << "/" << int(prefix_length)
+         << " => " << (next_hop.has_value() ? next_hop->ip() : "(direct)") << " on interface " << interface_num << "\n";
+
+    _table.insert(route_prefix, prefix_length, _routes.size());
+    _routes.push_back({route_prefix, prefix_length, next_hop, interface_num});
+}
+
+//! \param[in] dgram The datagram to be routed
+void Router::route_one_datagram(InternetDatagram &dgram) {
+    IPv4Header &header = dgram.header();
+
+    // TTL 耗尽的数据报丢弃
+    if (header.ttl <= 1) {
+        return;
+    }
+
+    const optional<uint32_t> match = _table.lookup(header.dst);
+    if (not match.has_value()) {
+        return;
+    }
+    const Route &route = _routes[match.value()];
+
+    // TTL 和协议号共用首部里的一个 16 位字：只需按这个字的变化调整校验和（RFC 1624），不必重新计算
+    const uint16_t old_word = uint16_t(header.ttl << 8 | header.proto);
+    header.ttl--;
+    header.cksum = InternetChecksum::update(header.cksum, old_word, uint16_t(header.ttl << 8 | header.proto));
+
+    const Address next_hop =
+        route.next_hop.has_value() ? route.next_hop.value() : Address::from_ipv4_numeric(header.dst);
+    _interfaces[route.interface_num].send_serialized(dgram.serialize(false), next_hop);
+}
+
+void Router::route() {
+    // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
+    for (auto &interface : _interfaces) {
+        auto &queue = interface.datagrams_out();
+        while (not queue.empty()) {
+            route_one_datagram(queue.front());
+            queue.pop();
+        }
+    }
+}
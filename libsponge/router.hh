@@ -0,0 +1,75 @@
+#ifndef SPONGE_LIBSPONGE_ROUTER_HH
+#define SPONGE_LIBSPONGE_ROUTER_HH
+
+#include "network_interface.hh"
+#include "prefix_table.hh"
+
+#include <optional>
+#include <queue>
+#include <vector>
+
+// 一个在路由器中使用的网络接口：收到的 IPv4 数据报不直接返回，而是放进队列，由路由器取走转发
+class AsyncNetworkInterface : public NetworkInterface {
+    std::queue<InternetDatagram> _datagrams_out{};
+
+  public:
+    using NetworkInterface::NetworkInterface;
+
+    // 从 NetworkInterface 构造
+    AsyncNetworkInterface(NetworkInterface &&interface) : NetworkInterface(std::move(interface)) {}
+
+    // 收到一个以太网帧；如果它携带 IPv4 数据报，就放进队列
+    void recv_frame(const EthernetFrame &frame) {
+        auto optional_dgram = NetworkInterface::recv_frame(frame);
+        if (optional_dgram.has_value()) {
+            _datagrams_out.push(std::move(optional_dgram.value()));
+        }
+    };
+
+    // 访问收到的数据报队列
+    std::queue<InternetDatagram> &datagrams_out() { return _datagrams_out; }
+};
+
+// 一个有多个网络接口的路由器，按最长前缀匹配在接口之间转发数据报
+// 查找用 PrefixTable（16-8-8 多比特前缀树），最多三次内存访问，与路由表大小无关
+class Router {
+    // 一条路由：匹配的数据报从哪个接口发往哪个下一跳
+    struct Route {
+        uint32_t route_prefix;
+        uint8_t prefix_length;
+        // 为空表示目的网络直接连在接口上，下一跳就是数据报的目的地址
+        std::optional<Address> next_hop;
+        size_t interface_num;
+    };
+
+    // 路由器的网络接口
+    std::vector<AsyncNetworkInterface> _interfaces{};
+
+    // 路由表；前缀表里存的是路由在这里的下标
+    std::vector<Route> _routes{};
+    PrefixTable _table{};
+
+    // 转发一个数据报：TTL 减一并增量更新校验和，按最长前缀匹配选出接口和下一跳
+    void route_one_datagram(InternetDatagram &dgram);
+
+  public:
+    // 添加一个接口，返回它的编号
+    size_t add_interface(AsyncNetworkInterface &&interface) {
+        _interfaces.push_back(std::move(interface));
+        return _interfaces.size() - 1;
+    }
+
+    // 访问一个接口
+    AsyncNetworkInterface &interface(const size_t N) { return _interfaces.at(N); }
+
+    // 添加一条路由（如果前缀已经存在，新的路由会替换它）
+    void add_route(const uint32_t route_prefix,
+                   const uint8_t prefix_length,
+                   const std::optional<Address> next_hop,
+                   const size_t interface_num);
+
+    // 转发所有接口上收到的数据报
+    void route();
+};
+
+#endif  // SPONGE_LIBSPONGE_ROUTER_HH
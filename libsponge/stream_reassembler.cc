@@ -1,5 +1,6 @@
 #include "stream_reassembler.hh"
 
+#include <algorithm>
 #include <iostream>
 // 流重组器的示例实现。
 
@@ -24,7 +25,8 @@ StreamReassembler::StreamReassembler(const size_t capacity)
       _eof_index(0),             // 初始化终止字节的索引为 0
       _unassembled_bytes(0),     // 初始化未组装字节数为 0
       _eof(false),               // 初始化终止标志为 false
-      _buf()                  // 初始化用于存储片段的集合为空
+      _buf(),                 // 初始化用于存储片段的集合为空
+      _charge()               // 还没有记账的字节
 {
 
 } 
@@ -50,7 +52,7 @@ void StreamReassembler::_buf_insert(const Segment &seg)
 // 并组装任何新的连续子字符串，将它们按顺序写入输出流。
 
 // 函数功能：将子字符串 data 推入流中，将其传递给流重新组装器
-void StreamReassembler::push_substring(const string &data, const size_t index, const bool eof) 
+void StreamReassembler::push_substring(string_view data, const size_t index, const bool eof) 
 {
     if (eof) 
     {  // 若 eof 为 true，表明到达了流的末尾，计算出结束索引并将标志符置为 true
@@ -58,7 +60,16 @@ void StreamReassembler::push_substring(const string &data, const size_t index, c
         _eof = true;
     }
 
-    if (!data.empty()) 
+    if (_buf.empty() && index <= first_unassembled() && index + data.size() > first_unassembled() &&
+        first_unassembled() < first_unacceptable())
+    {  // 快速路径：没有乱序片段在等待，且数据正好接上，直接写入输出流，不经过缓冲区（也不复制成字符串）
+        const size_t skip = first_unassembled() - index;
+        const size_t len = min(data.size() - skip, first_unacceptable() - first_unassembled());
+        _duplicate_bytes += skip;
+        _out_of_window_bytes += data.size() - skip - len;
+        _output.write(data.substr(skip, len));
+    }
+    else if (!data.empty()) 
     {  // 如果 data 不为空，则处理该子字符串
         Segment seg{index, data};
         _handle_substring(seg);  // 处理该片段
@@ -77,7 +88,11 @@ void StreamReassembler::push_substring(const string &data, const size_t index, c
     {
         _output.end_input();
         _buf.clear();
+        _unassembled_bytes = 0;
     }
+
+    // 更新内存账
+    _charge.set(_unassembled_bytes);
 }
 
 // 函数功能：处理子字符串，将字符串插入到集合set未组装的集合中
@@ -92,8 +107,14 @@ void StreamReassembler::_handle_substring(Segment &seg)
     // 情况1：丢弃、
     // 如果该片段索引值已经 大于 不可接收的索引值，return
     // 片段结尾的索引值 小于 字节流当前末尾的索引值，return 
-    if (index >= first_unacceptable() || seg.tail_idx() < first_unassembled())
+    if (index >= first_unacceptable()) {
+        _out_of_window_bytes += seg.length();
         return;
+    }
+    if (seg.tail_idx() < first_unassembled()) {
+        _duplicate_bytes += seg.length();
+        return;
+    }
 
 
     // 情况2：截断
@@ -102,13 +123,17 @@ void StreamReassembler::_handle_substring(Segment &seg)
     // 前边包重复所以截取
     if (index < first_unassembled() && seg.tail_idx() >= first_unassembled()) 
     {
+        _duplicate_bytes += first_unassembled() - index;
         seg._data = seg._data.substr(first_unassembled() - index);
         seg._idx = first_unassembled();
     }
 
     // 如果片段的尾部索引大于第一个不可接受的字节索引，则截取片段数据，使其结束于第一个不可接受的字节之前
-    if (index < first_unacceptable() && seg.tail_idx() >= first_unacceptable())
+    if (index < first_unacceptable() && seg.tail_idx() >= first_unacceptable()) {
+        const size_t length = seg.length();
         seg._data = seg._data.substr(0, first_unacceptable() - index);
+        _out_of_window_bytes += length - seg.length();
+    }
 
 
     // 情况3：将片段插入到缓冲区中，如果缓冲区为空则直接插入
@@ -119,7 +144,11 @@ void StreamReassembler::_handle_substring(Segment &seg)
     }
 
     // 插入后，对set集合进行处理，处理重叠部分
+    // 合并后未组装字节数的增量就是新字节数，其余都是与缓冲区重叠的重复字节
+    const size_t length = seg.length();
+    const size_t unassembled = _unassembled_bytes;
     _handle_overlap(seg);
+    _duplicate_bytes += length - (_unassembled_bytes - unassembled);
 }
 
 
@@ -198,6 +227,33 @@ void StreamReassembler::_merge_seg(Segment &seg1, const Segment &seg2)
 }
 
 
+// 函数功能：调整容量，输出流的容量跟着一起调整
+void StreamReassembler::set_capacity(const size_t capacity)
+{
+    // 不能小于已经存下的字节：输出流中的，以及缓冲区中最远的片段（片段互不重叠，最后一个最远）
+    size_t needed = _output.buffer_size();
+    if (!_buf.empty())
+        needed = max(needed, _buf.rbegin()->tail_idx() + 1 - first_unread());
+
+    _capacity = max(capacity, needed);
+    _output.set_capacity(_capacity);
+}
+
+
+
+// 函数功能：丢弃所有乱序片段，eof 的位置仍然记着
+size_t StreamReassembler::drop_unassembled()
+{
+    const size_t dropped = _unassembled_bytes;
+    _dropped_bytes += dropped;
+    _buf.clear();
+    _unassembled_bytes = 0;
+    _charge.set(0);
+    return dropped;
+}
+
+
+
 // 函数功能：返回存储但尚未重新组装的子字符串中的总字节数
 size_t StreamReassembler::unassembled_bytes() const 
 {
@@ -2,12 +2,14 @@
 #define SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
 
 #include "byte_stream.hh"
+#include "memory_accountant.hh"
 
 // 这个头文件提供了一组精确宽度整数类型的 typedefs，以及一些指定整数类型限制的宏
 // 如int32_t
 #include <cstdint>
 #include <set>
 #include <string>
+#include <string_view>
 
 
 // 一个类，将来自字节流的一系列片段（可能是无序的，可能是重叠的）组装成一个有序的字节流。
@@ -26,7 +28,7 @@ class StreamReassembler {
         Segment() : _idx(0), _data() {}
 
         // 参数化构造函数根据给定的 index 和 data 初始化 _idx 和 _data
-        Segment(size_t index, const std::string &data) : _idx(index), _data(data) {}
+        Segment(size_t index, std::string_view data) : _idx(index), _data(data) {}
 
         // 方法
         // 返回片段数据的长度
@@ -57,9 +59,21 @@ class StreamReassembler {
     // 终止标志  
     bool _eof;        
 
+    // 因重复（已经组装或已在缓冲区中）而丢弃的字节数
+    uint64_t _duplicate_bytes{0};
+
+    // 因超出容量（窗口之外）而丢弃的字节数
+    uint64_t _out_of_window_bytes{0};
+
+    // 内存紧张时丢弃的乱序字节数
+    uint64_t _dropped_bytes{0};
+
     // 使用集合存储片段数据，缓冲区,为组装的数据片段的集合        
     std::set<Segment> _buf;      
 
+    // 缓冲区中的字节记在全局内存账上（见 MemoryAccountant）
+    MemoryCharge _charge;
+
 
     // 除去已经写入流中的缓冲区的字符串
     void _buf_erase(const std::set<Segment>::iterator &iter);
@@ -97,7 +111,7 @@ class StreamReassembler {
 
 
     // 将子字符串 data 推入流中，将其传递给流重新组装器
-    void push_substring(const std::string &data, const uint64_t index, const bool eof);
+    void push_substring(std::string_view data, const uint64_t index, const bool eof);
 
 
 
@@ -120,10 +134,24 @@ class StreamReassembler {
 
 
 
+    // 收到的重复字节数（已经组装过，或已在缓冲区中）
+    uint64_t duplicate_bytes() const { return _duplicate_bytes; }
+
+    // 因超出容量而被丢弃的字节数
+    uint64_t out_of_window_bytes() const { return _out_of_window_bytes; }
+
+    // 内存紧张时丢弃的乱序字节数（见 drop_unassembled()）
+    uint64_t dropped_bytes() const { return _dropped_bytes; }
+
+
     // 内部状态是否为空（除了输出流）？
     // 如果没有等待组装的子字符串，则返回 `true`
     bool empty() const;
 
+    // 丢弃缓冲区中所有乱序片段（内存紧张时使用），返回丢弃的字节数。
+    // 这些字节还没有被确认，对端会重传
+    size_t drop_unassembled();
+
     // 获取未读取的第一个字节索引，字节流的开始索引
     size_t first_unread() const { return _output.bytes_read(); }
 
@@ -132,6 +160,13 @@ class StreamReassembler {
 
     // 获取第一个不可接受的字节索引
     size_t first_unacceptable() const { return first_unread() + _capacity; }
+
+    // 容量
+    size_t capacity() const { return _capacity; }
+
+    // 调整容量（接收缓冲区自动调整时使用）
+    // 调用者负责不让窗口右沿后退：新容量不小于已经缓存的字节所需要的
+    void set_capacity(const size_t capacity);
 };
 
 #endif  // SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
@@ -1,5 +1,6 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
 #include <numeric>
 // Dummy implementation of a TCP connection
@@ -14,11 +15,20 @@ using namespace std;
 
 size_t TCPConnection::remaining_outbound_capacity() const { return _sender.stream_in().remaining_capacity();}
 
+bool TCPConnection::outbound_writable() const {
+    const size_t free = remaining_outbound_capacity();
+    return free > 0 && free >= min(_cfg.send_lowat, _sender.stream_in().capacity_size());
+}
+
 size_t TCPConnection::bytes_in_flight() const { return _sender.bytes_in_flight(); }
 
 size_t TCPConnection::unassembled_bytes() const { return _receiver.unassembled_bytes(); }
 
-size_t TCPConnection::time_since_last_segment_received() const { return _time_since_last_segment_received;}
+size_t TCPConnection::memory_usage() const {
+    return _sender.stream_in().storage_size() + _receiver.stream_out().storage_size() + _receiver.unassembled_bytes();
+}
+
+size_t TCPConnection::time_since_last_segment_received() const { return _time_since_last_segment_received / 1000;}
 
 bool TCPConnection::active() const { return _isactive; }
 
@@ -27,8 +37,12 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     if(!_isactive) return;
     // 若连接关闭，返回
 
+    TCPTracer::segment_received(_trace_id, seg);
+
     // 重设时间
     _time_since_last_segment_received = 0;
+    _segments_received++;
+    _bytes_received += seg.payload().size();
 
     // 如果RST（reset）标志位为真，将发送端stream和接受端stream设置成error state并终止连接。
     if(seg.header().rst){
@@ -40,15 +54,25 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     _receiver.segment_received(seg);
 
     // 若处于监听状态，则建立连接。
-    if(TCPState::state_summary(_receiver) == TCPReceiverStateSummary::SYN_RECV && 
-        TCPState::state_summary(_sender) == TCPSenderStateSummary::CLOSED){
+    // 与 TCPState::state_summary() 的判断相同，但不构造字符串（这里每个段都会走到）
+    const bool syn_recv = !_receiver.stream_out().error() && _receiver.ackno().has_value() &&
+                          !_receiver.stream_out().input_ended();
+    const bool closed = !_sender.stream_in().error() && _sender.next_seqno_absolute() == 0;
+    if(syn_recv && closed){
             connect();
             return;
     }
 
     // 如果ACK标志位为真，通知TCPSender有segment被确认，TCPSender关心的字段有ackno和window_size
-    if(seg.header().ack)
-        _sender.ack_received(seg.header().ackno, seg.header().win);
+    if(seg.header().ack){
+        _sender.ack_received(seg.header().ackno, seg.header().win, 
+                             seg.payload().size() == 0 && !seg.header().syn && !seg.header().fin);
+        // 对端窗口变化
+        if(TCPTracer::enabled() && _traced_window != seg.header().win){
+            _traced_window = seg.header().win;
+            TCPTracer::window_update(_trace_id, seg.header().win);
+        }
+    }
     
     // 如果收到的segment不为空，TCPConnection必须确保至少给这个segment回复一个ACK，以便远端的发送方更新ackno和window_size
     if(seg.length_in_sequence_space() > 0 && _sender.segments_out().empty())
@@ -64,10 +88,10 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
 
     clean_shutdown();
 
-    
+    trace_state();
 }
 
-size_t TCPConnection::write(const string &data) {
+size_t TCPConnection::write(string_view data) {
     // 如果连接关闭，或要传入的数据为空，则返回
     if(!_isactive || data.empty())
         return 0;
@@ -81,14 +105,28 @@ size_t TCPConnection::write(const string &data) {
 
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 // 自上次调用此方法以来的毫秒数
-void TCPConnection::tick(const size_t ms_since_last_tick) {
+void TCPConnection::tick(const size_t ms_since_last_tick) { tick_us(uint64_t{ms_since_last_tick} * 1000); }
+
+//! \param[in] us_since_last_tick number of microseconds since the last call to this method
+// 自上次调用此方法以来的微秒数
+void TCPConnection::tick_us(const uint64_t us_since_last_tick) {
     // 若连接关闭，则返回
     if(!active())
         return;
     
     // 超时重传
-    _sender.tick(ms_since_last_tick);
-    _time_since_last_segment_received += ms_since_last_tick;
+    const uint64_t rto_expirations = _sender.rto_expirations();
+    _sender.tick_us(us_since_last_tick);
+    if(_sender.rto_expirations() != rto_expirations)
+        TCPTracer::timer_fired(_trace_id, _sender.rto_us());
+    _time_since_last_segment_received += us_since_last_tick;
+
+    // 接收缓冲区自动调整，以 RTT 为周期；还没有 RTT 样本时用初始 RTO 代替。
+    // 容量变大时发一个窗口更新，不让对端等到下一个 ACK
+    const size_t recv_capacity = _receiver.capacity();
+    _receiver.tick_us(us_since_last_tick, _sender.srtt_us().value_or(_cfg.initial_rto_us()));
+    if(_receiver.capacity() > recv_capacity && _receiver.ackno().has_value())
+        _sender.send_empty_segment();
     
     // 若连续重传次数超过最大次数，则发送RST数据段，并关闭连接
     if(_sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS){
@@ -100,6 +138,36 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     // 发送数据，关掉连接
     send_segment();
     clean_shutdown();
+    trace_state();
+
+    if(_time_since_last_segment_received >= _sender.rto_us())
+        release_idle_storage();
+}
+
+// 段队列只增长不收缩，流的缓冲区读空后也保留着：一次突发之后，空闲的连接还留着这些存储。
+// 这里把读空的流的存储还给内存池，并释放空队列
+void TCPConnection::release_idle_storage() {
+    _sender.release_idle_storage();
+    _receiver.stream_out().release_storage();
+    if(_segments_out.empty())
+        TCPSegmentQueue{}.swap(_segments_out);
+}
+
+// 下一个到期的计时器：重传计时器，或两个流都结束后的 linger 计时器
+optional<uint64_t> TCPConnection::time_until_next_timeout_us() const {
+    if(!active())
+        return {};
+
+    optional<uint64_t> next = _sender.time_until_timeout_us();
+
+    // 入站流结束后，连接可能在 linger 到期时关闭（可能早一点醒来，但不会晚）
+    if(_linger_after_streams_finish && _receiver.stream_out().input_ended()){
+        const uint64_t linger = 10 * _cfg.initial_rto_us();
+        const uint64_t remaining = _time_since_last_segment_received >= linger ? 0 : 
+                                    linger - _time_since_last_segment_received;
+        next = next.has_value() ? min(next.value(), remaining) : remaining;
+    }
+    return next;
 }
 
 // 结束输入
@@ -107,18 +175,20 @@ void TCPConnection::end_input_stream() {
     _sender.stream_in().end_input();
     _sender.fill_window();
     send_segment();
+    trace_state();
 }
 
 // 建立连接，并填充缓冲区
 void TCPConnection::connect() {
     _sender.fill_window();
     send_segment();
+    trace_state();
 }
 
 void TCPConnection::send_segment() {
     // 待发送队列不为空
     while(!_sender.segments_out().empty()){
-        TCPSegment seg = _sender.segments_out().front();
+        TCPSegment seg = move(_sender.segments_out().front());
         _sender.segments_out().pop();
 
         // 填写头部信息
@@ -130,7 +200,7 @@ void TCPConnection::send_segment() {
         }
 
         // 进入发送队列
-        _segments_out.push(seg);
+        push_segment(move(seg));
     }
 }
 
@@ -143,7 +213,7 @@ void TCPConnection::send_rst_segment()
         return;
     }
 
-    TCPSegment seg = _sender.segments_out().front();
+    TCPSegment seg = move(_sender.segments_out().front());
     _sender.segments_out().pop();
     if(_receiver.ackno().has_value()){
         seg.header().ack = true;
@@ -154,7 +224,60 @@ void TCPConnection::send_rst_segment()
     // 设置重连标志
     seg.header().rst = true;
 
-    _segments_out.push(seg);
+    push_segment(move(seg));
+}
+
+void TCPConnection::push_segment(TCPSegment &&seg)
+{
+    _segments_sent++;
+    _bytes_sent += seg.payload().size();
+    TCPTracer::segment_sent(_trace_id, seg);
+    _segments_out.push(move(seg));
+}
+
+// 只在跟踪时才计算状态，不跟踪时几乎没有开销
+void TCPConnection::trace_state()
+{
+    if(!TCPTracer::enabled())
+        return;
+
+    const optional<TCPState::State> state = 
+        TCPState::official_state(_sender, _receiver, active(), _linger_after_streams_finish);
+    const uint8_t code = state.has_value() ? static_cast<uint8_t>(state.value()) : TCPTraceEvent::UNNAMED_STATE;
+    if(code != _traced_state){
+        _traced_state = code;
+        TCPTracer::state_change(_trace_id, code);
+    }
+}
+
+// 汇总连接、发送方和接收方的统计信息
+TCPStats TCPConnection::stats() const
+{
+    TCPStats stats;
+    stats.segments_sent = _segments_sent;
+    stats.bytes_sent = _bytes_sent;
+    stats.segments_received = _segments_received;
+    stats.bytes_received = _bytes_received;
+
+    stats.retransmitted_segments = _sender.retransmitted_segments();
+    stats.rto_expirations = _sender.rto_expirations();
+    stats.dupacks = _sender.dupacks();
+    stats.duplicate_bytes = _receiver.duplicate_bytes();
+    stats.out_of_window_bytes = _receiver.out_of_window_bytes();
+    stats.dropped_bytes = _receiver.dropped_bytes();
+
+    stats.rwnd_limited_us = _sender.rwnd_limited_us();
+    stats.app_limited_us = _sender.app_limited_us();
+
+    stats.srtt_us = _sender.srtt_us();
+    stats.rttvar_us = _sender.rttvar_us();
+    stats.rto_us = _sender.rto_us();
+    stats.bytes_in_flight = _sender.bytes_in_flight();
+    stats.unassembled_bytes = _receiver.unassembled_bytes();
+    stats.recv_capacity = _receiver.capacity();
+    stats.send_capacity = _sender.stream_in().capacity_size();
+    stats.memory_bytes = memory_usage();
+    return stats;
 }
 
 
@@ -166,11 +289,13 @@ void TCPConnection::clean_shutdown()
         _linger_after_streams_finish = false;
         // 关闭receiver和sender的stream流结束之后的等待，即linger状态。
     }
-    else if(TCPState::state_summary(_sender) == TCPSenderStateSummary::FIN_ACKED && 
-            TCPState::state_summary(_receiver) == TCPReceiverStateSummary::FIN_RECV){
+    // 发送端 FIN_ACKED 且接收端 FIN_RECV（同 TCPState::state_summary() 的判断，但不构造字符串）
+    else if(!_sender.stream_in().error() && _sender.stream_in().eof() && _sender.next_seqno_absolute() > 0 &&
+            _sender.next_seqno_absolute() >= _sender.stream_in().bytes_written() + 2 && _sender.bytes_in_flight() == 0 &&
+            !_receiver.stream_out().error() && _receiver.ackno().has_value() && _receiver.stream_out().input_ended()){
                 // 若TCP连接处于结束且已确认状态
                 // 保留连接活跃为超时重传初始值的10倍时间，确保所有数据都成功发送且成功被接收，然后关闭连接
-                if(!_linger_after_streams_finish || _time_since_last_segment_received >= 10 * _cfg.rt_timeout)
+                if(!_linger_after_streams_finish || _time_since_last_segment_received >= 10 * _cfg.initial_rto_us())
                     _isactive = false;
                     // 关闭连接
             }
@@ -182,6 +307,7 @@ void TCPConnection::unclean_shutdown()
     _sender.stream_in().set_error();
     _receiver.stream_out().set_error();
     _isactive = false;
+    trace_state();
 }
 
 // 析构函数，回收连接
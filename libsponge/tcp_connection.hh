@@ -5,16 +5,18 @@
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 #include "tcp_state.hh"
+#include "tcp_stats.hh"
+#include "tcp_trace.hh"
 
 // TCP连接的完整端点
 class TCPConnection {
   private:
     TCPConfig _cfg;
-    TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPReceiver _receiver{_cfg.recv_capacity, _cfg.recv_capacity_max};
+    TCPSender _sender{_cfg};
 
     // TCPConnection 想要发送的段的出站队列
-    std::queue<TCPSegment> _segments_out{};
+    TCPSegmentQueue _segments_out{};
 
     // 在两个流都结束后，TCPConnection 应该保持活动状态（并保持 ACK）10 * _cfg.rt_timeout 毫秒，
     // 以防远程 TCPConnection 不知道我们已经收到了它的整个流
@@ -22,8 +24,25 @@ class TCPConnection {
 
     bool _isactive{true};
 
-    // 自上次收到数据段以来的时间
-    size_t _time_since_last_segment_received{0};
+    // 自上次收到数据段以来的时间（微秒）
+    uint64_t _time_since_last_segment_received{0};
+
+    // 收发的段数和有效载荷字节数（其余统计信息由 sender 和 receiver 记录）
+    uint64_t _segments_sent{0};
+    uint64_t _bytes_sent{0};
+    uint64_t _segments_received{0};
+    uint64_t _bytes_received{0};
+
+    // 跟踪事件中标识本连接的编号，以及最近一次记录的状态和对端窗口
+    uint32_t _trace_id{TCPTracer::new_connection_id()};
+    uint8_t _traced_state{TCPTraceEvent::UNNAMED_STATE};
+    std::optional<uint16_t> _traced_window{};
+
+    // 将段放入出站队列
+    void push_segment(TCPSegment &&seg);
+
+    // 若正在跟踪且状态变了，记录新状态
+    void trace_state();
 
   public:
     // 写入方的写入接口
@@ -33,11 +52,15 @@ class TCPConnection {
 
     // 将数据写入出站字节流，并在可能的情况下通过 TCP 发送
     // 返回实际写入的“数据”字节数。
-    size_t write(const std::string &data);
+    size_t write(std::string_view data);
 
     // 现在可以写入的“字节”数
     size_t remaining_outbound_capacity() const;
 
+    // 空出来的容量是否值得去读应用的数据：至少 TCPConfig::send_lowat 字节
+    // （容量比低水位还小时，要等全部空出来），这样应用那边不会为几个字节就被读一次
+    bool outbound_writable() const;
+
     // 关闭出站字节流（仍然允许读取传入的数据）
     void end_input_stream();
 
@@ -46,6 +69,7 @@ class TCPConnection {
 
     // 从对等端接收到的入站字节流
     ByteStream &inbound_stream() { return _receiver.stream_out(); }
+    const ByteStream &inbound_stream() const { return _receiver.stream_out(); }
   
 
     // 用于测试的访问器
@@ -58,10 +82,22 @@ class TCPConnection {
     // 尚未重组的字节数
     size_t unassembled_bytes() const;
 
+    // 连接的缓冲区记在全局内存账上的字节数（见 MemoryAccountant）：两个流的存储块加上乱序片段
+    size_t memory_usage() const;
+
+    // 内存紧张时丢弃乱序片段，返回丢弃的字节数。这些字节没有确认过，对端会重传
+    size_t drop_unassembled() { return _receiver.drop_unassembled(); }
+
 
     // 自收到最后一个段以来的毫秒数
     size_t time_since_last_segment_received() const;
 
+    // 自收到最后一个段以来的微秒数
+    uint64_t time_since_last_segment_received_us() const { return _time_since_last_segment_received; }
+
+
+    // 连接的统计信息快照（计数器开销很小，一直开着）
+    TCPStats stats() const;
 
     // 总结发送方、接收方和连接的状态
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
@@ -75,10 +111,17 @@ class TCPConnection {
     // 时间流逝时定期调用
     void tick(const size_t ms_since_last_tick);
 
+    // 同 tick()，以微秒为单位
+    void tick_us(const uint64_t us_since_last_tick);
+
+    // 距离下一个计时器（重传或 linger）到期还剩多少微秒；没有计时器在运行时为空
+    // 所有者据此决定事件循环最多可以睡多久
+    std::optional<uint64_t> time_until_next_timeout_us() const;
+
     // 排队等待传输的 TCPSegments。
     // 所有者或操作系统将出队这些并将每个放入较低层数据报里（通常是互联网数据报（IP），
     // 但也可以是用户数据报（UDP）或任何其他类型）的有效负载中。
-    std::queue<TCPSegment> &segments_out() { return _segments_out; }
+    TCPSegmentQueue &segments_out() { return _segments_out; }
 
     // 连接是否仍然有效？
     // 如果任一流仍在运行或两个流都完成后 TCPConnection 仍然存在（例如，对来自对等方的 ACK 重新传输），则为“true”
@@ -108,6 +151,9 @@ class TCPConnection {
 
     // 非优雅关闭
     void unclean_shutdown();
+
+    // 空闲超过一个 RTO 后，释放读空的流的存储和已经清空的段队列
+    void release_idle_storage();
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_FACTORED_HH
@@ -0,0 +1,186 @@
+#include "emulated_link.hh"
+
+#include "ipv4_header.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+//! \param[in] cfg is the configuration of the link, including the seed of its random number generator
+EmulatedLink::EmulatedLink(const EmulatedLinkConfig &cfg) : _cfg(cfg), _rng(cfg.seed) {}
+
+size_t EmulatedLink::wire_size(const TCPSegment &seg) {
+    return IPv4Header::LENGTH + seg.header().doff * 4 + seg.payload().size();
+}
+
+//! \details Certain outcomes don't draw a random number, so turning a feature off doesn't change the
+//! random choices made for the others
+bool EmulatedLink::_chance(const double p) {
+    if (p <= 0) {
+        return false;
+    }
+    if (p >= 1) {
+        return true;
+    }
+    return _uniform(_rng) < p;
+}
+
+bool EmulatedLink::_gilbert_elliott_lost() {
+    const bool lost = _chance(_bad_state ? _cfg.loss_bad : _cfg.loss_good);
+    if (_bad_state) {
+        _bad_state = not _chance(_cfg.p_bad_to_good);
+    } else {
+        _bad_state = _chance(_cfg.p_good_to_bad);
+    }
+    return lost;
+}
+
+void EmulatedLink::_drain_backlog() {
+    while (not _backlog.empty() and _backlog.front().first <= _now_us) {
+        _backlog_bytes -= _backlog.front().second;
+        if (_backlog.size() == 1) {
+            _idle_since_us = _backlog.front().first;
+        }
+        _backlog.pop_front();
+    }
+}
+
+//! \details RED follows Floyd and Jacobson (1993), with the average in bytes; while the queue
+//! is idle, the average decays as if it had been sampled once per 1500-byte transmission time.
+bool EmulatedLink::_queue_drops(const size_t size) {
+    if (_backlog_bytes + size > _cfg.queue_bytes) {
+        _stats.queue_drops++;
+        return true;
+    }
+    if (_cfg.discipline != EmulatedLinkConfig::QueueDiscipline::RED) {
+        return false;
+    }
+
+    if (_backlog.empty()) {
+        const double typical_tx_us = 1500.0 * 8 * 1000000 / double(_cfg.rate_bps);
+        const double idle_samples = double(_now_us - _idle_since_us) / typical_tx_us;
+        _red_average *= pow(1 - _cfg.red_weight, idle_samples);
+    } else {
+        _red_average = (1 - _cfg.red_weight) * _red_average + _cfg.red_weight * double(_backlog_bytes);
+    }
+
+    const double min_bytes = double(_cfg.red_min_bytes), max_bytes = double(_cfg.red_max_bytes);
+    if (_red_average < min_bytes) {
+        _red_count = -1;
+        return false;
+    }
+    if (_red_average >= max_bytes) {
+        _red_count = 0;
+        _stats.red_drops++;
+        return true;
+    }
+
+    _red_count++;
+    const double p_base = _cfg.red_max_p * (_red_average - min_bytes) / (max_bytes - min_bytes);
+    const double spread = 1 - double(_red_count) * p_base;
+    if (spread <= 0 or _chance(p_base / spread)) {
+        _red_count = 0;
+        _stats.red_drops++;
+        return true;
+    }
+    return false;
+}
+
+void EmulatedLink::_enqueue(const TCPSegment &seg, const size_t size) {
+    uint64_t departure_us = _now_us;
+    if (_cfg.rate_bps != 0) {
+        if (_queue_drops(size)) {
+            return;
+        }
+        const uint64_t start_us = max(_now_us, _busy_until_us);
+        const uint64_t transmit_us = (uint64_t{size} * 8 * 1000000 + _cfg.rate_bps - 1) / _cfg.rate_bps;
+        departure_us = start_us + transmit_us;
+        _busy_until_us = departure_us;
+
+        _backlog.emplace_back(departure_us, size);
+        _backlog_bytes += size;
+        _stats.segments_queued++;
+        _stats.max_queue_bytes = max(_stats.max_queue_bytes, _backlog_bytes);
+        _stats.queue_delay_us += start_us - _now_us;
+        _stats.max_queue_delay_us = max(_stats.max_queue_delay_us, start_us - _now_us);
+    }
+
+    uint64_t arrival_us = departure_us + _cfg.delay_us;
+    if (_cfg.jitter_us != 0) {
+        arrival_us += uniform_int_distribution<uint64_t>{0, _cfg.jitter_us}(_rng);
+    }
+
+    if (_chance(_cfg.reorder_rate)) {
+        arrival_us += _cfg.reorder_delay_us;
+        _stats.reordered++;
+    } else {
+        arrival_us = max(arrival_us, _last_arrival_us);
+        _last_arrival_us = arrival_us;
+    }
+
+    _in_flight.push({arrival_us, _next_serial++, seg});
+}
+
+//! \param[in] seg is the segment to send
+void EmulatedLink::send(const TCPSegment &seg) {
+    _stats.segments_sent++;
+    if (_gilbert_elliott_lost()) {
+        _stats.lost++;
+        return;
+    }
+
+    const size_t size = wire_size(seg);
+    _enqueue(seg, size);
+    if (_chance(_cfg.duplicate_rate)) {
+        _stats.duplicated++;
+        _enqueue(seg, size);
+    }
+
+    // with no delay, a segment arrives at once
+    tick_us(0);
+}
+
+//! \param[in] us_since_last_tick is the virtual time that has passed
+void EmulatedLink::tick_us(const uint64_t us_since_last_tick) {
+    _now_us += us_since_last_tick;
+    _drain_backlog();
+
+    while (not _in_flight.empty() and _in_flight.top().arrival_us <= _now_us) {
+        const TCPSegment &seg = _in_flight.top().seg;
+        _stats.segments_delivered++;
+        _stats.bytes_delivered += wire_size(seg);
+        _arrived.push(seg);
+        _in_flight.pop();
+    }
+}
+
+optional<TCPSegment> EmulatedLink::receive() {
+    if (_arrived.empty()) {
+        return {};
+    }
+    TCPSegment seg = move(_arrived.front());
+    _arrived.pop();
+    return seg;
+}
+
+optional<uint64_t> EmulatedLink::time_until_next_arrival_us() const {
+    if (_in_flight.empty()) {
+        return {};
+    }
+    return _in_flight.top().arrival_us - _now_us;
+}
+
+pair<EmulatedLinkAdapter, EmulatedLinkAdapter> EmulatedLinkAdapter::make_pair(const EmulatedLinkConfig &a_to_b,
+                                                                             const EmulatedLinkConfig &b_to_a) {
+    auto forward = make_shared<EmulatedLink>(a_to_b);
+    auto backward = make_shared<EmulatedLink>(b_to_a);
+    return {EmulatedLinkAdapter(forward, backward), EmulatedLinkAdapter(backward, forward)};
+}
+
+//! \param[in] seg is the segment to send; its ports are set from the configuration
+void EmulatedLinkAdapter::write(TCPSegment &seg) {
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+    _out->send(seg);
+}
@@ -0,0 +1,154 @@
+#ifndef SPONGE_LIBSPONGE_EMULATED_LINK_HH
+#define SPONGE_LIBSPONGE_EMULATED_LINK_HH
+
+#include "fd_adapter.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+//! What happened to the segments sent on an EmulatedLink
+struct EmulatedLinkStats {
+    uint64_t segments_sent = 0;       //!< Segments given to send()
+    uint64_t segments_delivered = 0;  //!< Segments that have arrived, including duplicates
+    uint64_t bytes_delivered = 0;     //!< Wire bytes (IPv4 and TCP headers plus payload) that have arrived
+    uint64_t lost = 0;                //!< Dropped by the Gilbert-Elliott model
+    uint64_t queue_drops = 0;         //!< Dropped because the bottleneck queue was full
+    uint64_t red_drops = 0;           //!< Dropped early by RED
+    uint64_t duplicated = 0;          //!< Sent twice
+    uint64_t reordered = 0;           //!< Held back for reordering
+    uint64_t segments_queued = 0;     //!< Accepted into the bottleneck queue
+    uint64_t queue_delay_us = 0;      //!< Total time queued segments spent waiting in the bottleneck queue
+    uint64_t max_queue_delay_us = 0;  //!< Longest time a segment waited in the bottleneck queue
+    size_t max_queue_bytes = 0;       //!< Largest backlog of the bottleneck queue
+};
+
+//! \brief One direction of an emulated network path, driven by tick_us()
+//! \details A segment passes through, in order: Gilbert-Elliott loss, duplication, the bottleneck
+//! queue (drop-tail or RED) and its serialization delay, then propagation delay with jitter, and
+//! reordering. Nothing depends on the wall clock, so a run is reproducible from the seed.
+class EmulatedLink {
+  private:
+    //! A segment on its way through the link
+    struct InFlight {
+        uint64_t arrival_us;  //!< When it comes out of the link
+        uint64_t serial;      //!< Order of sending, to break ties in arrival time
+        TCPSegment seg;       //!< The segment
+
+        //! Ordering for a min-heap on (arrival_us, serial)
+        bool operator>(const InFlight &other) const {
+            return arrival_us != other.arrival_us ? arrival_us > other.arrival_us : serial > other.serial;
+        }
+    };
+
+    EmulatedLinkConfig _cfg;
+    std::mt19937_64 _rng;
+    std::uniform_real_distribution<double> _uniform{0, 1};
+
+    uint64_t _now_us = 0;  //!< Virtual time: the sum of every tick_us()
+
+    bool _bad_state = false;  //!< Gilbert-Elliott: is the channel in the bad state?
+
+    //! \name Bottleneck queue
+    //!@{
+    uint64_t _busy_until_us = 0;                         //!< When the last queued segment finishes sending
+    std::deque<std::pair<uint64_t, size_t>> _backlog{};  //!< (departure time, size) of each queued segment
+    size_t _backlog_bytes = 0;                           //!< Sum of the sizes in `_backlog`
+    double _red_average = 0;                             //!< RED's moving average of the backlog
+    int64_t _red_count = -1;                             //!< RED: arrivals since the last early drop
+    uint64_t _idle_since_us = 0;                         //!< When the queue last emptied
+    //!@}
+
+    uint64_t _last_arrival_us = 0;  //!< Latest arrival of an in-order segment, so jitter can't reorder
+    uint64_t _next_serial = 0;      //!< Serial number for the next InFlight
+
+    std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight>> _in_flight{};
+    TCPSegmentQueue _arrived{};  //!< Segments that have come out of the link, not yet received
+
+    EmulatedLinkStats _stats{};
+
+    //! Returns `true` with probability `p`
+    bool _chance(const double p);
+
+    //! Step the Gilbert-Elliott chain; returns `true` if this segment is lost
+    bool _gilbert_elliott_lost();
+
+    //! Forget segments that have left the bottleneck queue by `_now_us`
+    void _drain_backlog();
+
+    //! Returns `true` if a segment of `size` bytes should be dropped on arrival at the queue
+    bool _queue_drops(const size_t size);
+
+    //! Put one copy of a segment through the queue and delays
+    void _enqueue(const TCPSegment &seg, const size_t size);
+
+  public:
+    //! Construct an idle link
+    explicit EmulatedLink(const EmulatedLinkConfig &cfg);
+
+    //! Size of a segment on the wire, counting a minimal IPv4 header
+    static size_t wire_size(const TCPSegment &seg);
+
+    //! Send a segment at the current virtual time
+    void send(const TCPSegment &seg);
+
+    //! Advance virtual time, moving segments that have arrived to be received
+    void tick_us(const uint64_t us_since_last_tick);
+
+    //! The next segment that has arrived, if any
+    std::optional<TCPSegment> receive();
+
+    //! Microseconds until the next segment arrives; empty if none is in flight
+    std::optional<uint64_t> time_until_next_arrival_us() const;
+
+    //! Bytes waiting in (or being sent from) the bottleneck queue
+    size_t queue_bytes() const { return _backlog_bytes; }
+
+    //! \name Accessors
+    //!@{
+    uint64_t now_us() const { return _now_us; }
+    const EmulatedLinkStats &stats() const { return _stats; }
+    const EmulatedLinkConfig &config() const { return _cfg; }
+    //!@}
+};
+
+//! \brief An in-process FD adapter whose segments travel over a pair of EmulatedLink%s
+//! \details Unlike other FD adapters this one has no file descriptor, so it's for driving
+//! TCPConnection%s directly (as tcp_benchmark does), not for TCPSpongeSocket.
+class EmulatedLinkAdapter : public FdAdapterBase {
+  private:
+    std::shared_ptr<EmulatedLink> _out;  //!< Carries the segments this end writes
+    std::shared_ptr<EmulatedLink> _in;   //!< Carries the segments this end reads
+
+    EmulatedLinkAdapter(std::shared_ptr<EmulatedLink> out, std::shared_ptr<EmulatedLink> in)
+        : _out(std::move(out)), _in(std::move(in)) {}
+
+  public:
+    //! Two connected ends, with `a_to_b` carrying the first end's writes and `b_to_a` the second's
+    static std::pair<EmulatedLinkAdapter, EmulatedLinkAdapter> make_pair(const EmulatedLinkConfig &a_to_b,
+                                                                         const EmulatedLinkConfig &b_to_a);
+
+    //! The next segment to arrive from the other end, if any
+    std::optional<TCPSegment> read() { return _in->receive(); }
+
+    //! Set the ports from the configuration, and send a segment to the other end
+    void write(TCPSegment &seg);
+
+    //! Advance virtual time on the outgoing link (the other end advances the incoming one)
+    void tick_us(const uint64_t us_since_last_tick) { _out->tick_us(us_since_last_tick); }
+
+    //! \name Access to the links
+    //!@{
+    EmulatedLink &outgoing() { return *_out; }
+    EmulatedLink &incoming() { return *_in; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_EMULATED_LINK_HH
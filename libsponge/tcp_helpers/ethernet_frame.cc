@@ -0,0 +1,23 @@
+#include "ethernet_frame.hh"
+
+#include "parser.hh"
+
+#include <utility>
+
+using namespace std;
+
+ParseResult EthernetFrame::parse(const Buffer buffer) {
+    NetParser p{buffer};
+    _header.parse(p);
+    _payload = p.buffer();
+
+    return p.get_error();
+}
+
+BufferList EthernetFrame::serialize() const {
+    Buffer header = Buffer::make(EthernetHeader::LENGTH, [&](char *data) { _header.serialize(data); });
+
+    BufferList ret{std::move(header)};
+    ret.append(_payload);
+    return ret;
+}
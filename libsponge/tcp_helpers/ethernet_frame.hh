@@ -0,0 +1,37 @@
+#ifndef SPONGE_LIBSPONGE_ETHERNET_FRAME_HH
+#define SPONGE_LIBSPONGE_ETHERNET_FRAME_HH
+
+#include "buffer.hh"
+#include "ethernet_header.hh"
+#include "ring_buffer.hh"
+
+#include <queue>
+
+//! \brief Ethernet frame
+class EthernetFrame {
+  private:
+    EthernetHeader _header{};
+    BufferList _payload{};
+
+  public:
+    //! \brief Parse the frame from a string
+    ParseResult parse(const Buffer buffer);
+
+    //! \brief Serialize the frame to a string
+    //! \details The header goes in a pooled chunk; the payload is referenced, not copied.
+    BufferList serialize() const;
+
+    //! \name Accessors
+    //!@{
+    const EthernetHeader &header() const { return _header; }
+    EthernetHeader &header() { return _header; }
+
+    const BufferList &payload() const { return _payload; }
+    BufferList &payload() { return _payload; }
+    //!@}
+};
+
+//! \brief A queue of frames that stops allocating once it has grown to its working size
+using EthernetFrameQueue = std::queue<EthernetFrame, RingBuffer<EthernetFrame>>;
+
+#endif  // SPONGE_LIBSPONGE_ETHERNET_FRAME_HH
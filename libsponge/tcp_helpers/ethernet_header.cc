@@ -0,0 +1,88 @@
+#include "ethernet_header.hh"
+
+#include "util.hh"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+//! \param[in,out] p is a NetParser from which the Ethernet fields will be extracted
+//! \returns a ParseResult indicating success or the reason for failure
+ParseResult EthernetHeader::parse(NetParser &p) {
+    if (p.buffer().size() < EthernetHeader::LENGTH) {
+        return ParseResult::PacketTooShort;
+    }
+
+    // read destination address
+    for (auto &byte : dst) {
+        byte = p.u8();
+    }
+
+    // read source address
+    for (auto &byte : src) {
+        byte = p.u8();
+    }
+
+    // read the frame's type (e.g. IPv4, ARP, or something else)
+    type = p.u16();
+
+    return p.get_error();
+}
+
+//! Serialize the EthernetHeader to a string
+string EthernetHeader::serialize() const {
+    string ret(LENGTH, 0);
+    serialize(ret.data());
+    return ret;
+}
+
+//! Serialize the EthernetHeader in place
+void EthernetHeader::serialize(char *out) const {
+    // write destination address
+    for (const auto byte : dst) {
+        NetUnparser::u8(out, byte);
+    }
+
+    // write source address
+    for (const auto byte : src) {
+        NetUnparser::u8(out, byte);
+    }
+
+    // write the frame's type
+    NetUnparser::u16(out, type);
+}
+
+//! \returns a string with a textual representation of an Ethernet address
+string to_string(const EthernetAddress address) {
+    stringstream ss{};
+    for (size_t index = 0; index < address.size(); index++) {
+        ss.width(2);
+        ss << setfill('0') << hex << int(address.at(index));
+        if (index != address.size() - 1) {
+            ss << ":";
+        }
+    }
+    return ss.str();
+}
+
+//! \returns A string with the header's contents
+string EthernetHeader::to_string() const {
+    stringstream ss{};
+    ss << "dst=" << ::to_string(dst);
+    ss << ", src=" << ::to_string(src);
+    ss << ", type=";
+    switch (type) {
+        case TYPE_IPv4:
+            ss << "IPv4";
+            break;
+        case TYPE_ARP:
+            ss << "ARP";
+            break;
+        default:
+            ss << "[unknown type " << hex << type << "!]";
+            break;
+    }
+
+    return ss.str();
+}
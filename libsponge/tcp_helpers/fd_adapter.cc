@@ -19,7 +19,7 @@ using namespace std;
 //! the result that future outgoing segments go to the sender of the SYN segment.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
+    auto datagram = _sock.recv_buffer();
 
     // is it for us?
     if (not listening() and (datagram.source_address != config().destination)) {
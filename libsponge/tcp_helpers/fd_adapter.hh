@@ -38,8 +38,8 @@ class FdAdapterBase {
     //! \returns a mutable reference
     FdAdapterConfig &config_mut() { return _cfg; }
 
-    //! Called periodically when time elapses
-    void tick(const size_t) {}
+    //! Called periodically when time elapses, with the number of microseconds since the last call
+    void tick_us(const uint64_t) {}
 };
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
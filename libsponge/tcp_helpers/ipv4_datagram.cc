@@ -3,6 +3,7 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 
@@ -20,22 +21,58 @@ ParseResult IPv4Datagram::parse(const Buffer buffer) {
     return p.get_error();
 }
 
-BufferList IPv4Datagram::serialize() const {
+BufferList IPv4Datagram::serialize(const bool compute_checksum) const {
     if (_payload.size() != _header.payload_length()) {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
     }
 
-    IPv4Header header_out = _header;
-    header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
+    // write the header once, then its checksum -- taken over header only -- into place
+    const size_t header_size = 4 * _header.hlen;
+    Buffer header = Buffer::make(header_size, [&](char *data) {
+        _header.serialize(data);
+        if (not compute_checksum) {
+            return;
+        }
 
-    // calculate checksum -- taken over header only
-    InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+        char *cksum_field = data + 10;
+        NetUnparser::u16(cksum_field, 0);
 
-    BufferList ret;
-    ret.append(header_out.serialize());
+        InternetChecksum check;
+        check.add({data, header_size});
+        cksum_field = data + 10;
+        NetUnparser::u16(cksum_field, check.value());
+    });
+
+    BufferList ret{std::move(header)};
     ret.append(_payload);
     return ret;
 }
+
+//! \param[in] mtu is the largest datagram the link can carry; fragments carry a multiple of 8 payload bytes
+std::vector<IPv4Datagram> IPv4Datagram::fragment(const size_t mtu) const {
+    const size_t header_size = 4 * _header.hlen;
+    if (_header.len <= mtu) {
+        return {*this};
+    }
+    if (mtu < header_size + 8) {
+        throw runtime_error("IPv4Datagram::fragment: mtu is too small");
+    }
+
+    const string payload = _payload.concatenate();
+    const size_t chunk = (mtu - header_size) / 8 * 8;
+
+    vector<IPv4Datagram> ret;
+    for (size_t start = 0; start < payload.size(); start += chunk) {
+        const size_t size = min(chunk, payload.size() - start);
+
+        IPv4Datagram fragment;
+        fragment._header = _header;
+        fragment._header.df = false;
+        fragment._header.mf = _header.mf or start + size < payload.size();
+        fragment._header.offset = _header.offset + start / 8;
+        fragment._header.len = header_size + size;
+        fragment._payload = Buffer::make(size, [&](char *out) { payload.copy(out, size, start); });
+        ret.push_back(std::move(fragment));
+    }
+    return ret;
+}
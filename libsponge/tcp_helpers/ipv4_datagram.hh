@@ -4,6 +4,8 @@
 #include "buffer.hh"
 #include "ipv4_header.hh"
 
+#include <vector>
+
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
 class IPv4Datagram {
   private:
@@ -15,7 +17,14 @@ class IPv4Datagram {
     ParseResult parse(const Buffer buffer);
 
     //! \brief Serialize the segment to a string
-    BufferList serialize() const;
+    //! \param[in] compute_checksum if false, the header's `cksum` is written as is (e.g. when a router
+    //!            has already updated it incrementally)
+    BufferList serialize(const bool compute_checksum = true) const;
+
+    //! \brief Split into fragments of at most `mtu` bytes each (just a copy if it already fits)
+    //! \details The fragments share the header's identification, which the caller must have made
+    //!          unique, and have DF cleared. IPv4Reassembler puts them back together.
+    std::vector<IPv4Datagram> fragment(const size_t mtu) const;
 
     //! \name Accessors
     //!@{
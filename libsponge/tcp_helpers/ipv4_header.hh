@@ -52,6 +52,9 @@ struct IPv4Header {
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! Serialize the IP fields into the `4 * hlen` bytes at `out`
+    void serialize(char *out) const;
+
     //! Length of the payload
     uint16_t payload_length() const;
 
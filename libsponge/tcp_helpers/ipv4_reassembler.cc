@@ -0,0 +1,158 @@
+#include "ipv4_reassembler.hh"
+
+#include "tcp_flow.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+//! Bookkeeping charged for every partial datagram, beyond its pieces
+static constexpr size_t PARTIAL_OVERHEAD = 256;
+
+//! Largest payload a fragment can describe: the 16-bit total length, less the smallest header
+static constexpr size_t MAX_PAYLOAD = 65535 - IPv4Header::LENGTH;
+
+size_t IPv4Reassembler::KeyHash::operator()(const Key &key) const {
+    const uint64_t addrs = (uint64_t(key.src) << 32) | key.dst;
+    const uint64_t rest = (uint64_t(key.id) << 8) | key.proto;
+    return TCPFlowHash::mix(addrs ^ TCPFlowHash::mix(rest));
+}
+
+IPv4Reassembler::IPv4Reassembler(const size_t memory_limit, const uint64_t timeout_ms)
+    : _memory_limit(memory_limit), _timeout_ms(timeout_ms) {}
+
+//! \param[in] dgram is a datagram as parsed from the wire
+//! \details Malformed fragments are dropped: a fragment other than the last whose length isn't a
+//! multiple of 8, or that ends past the largest possible datagram. A last fragment that disagrees
+//! with the data already held about where the datagram ends drops the whole datagram.
+optional<IPv4Datagram> IPv4Reassembler::push(const IPv4Datagram &dgram) {
+    const IPv4Header &header = dgram.header();
+    if (not header.mf and header.offset == 0) {
+        return dgram;
+    }
+
+    const Buffer payload = dgram.payload();
+    const size_t start = size_t{header.offset} * 8;
+    const size_t end = start + payload.size();
+    if ((header.mf and (payload.size() == 0 or payload.size() % 8 != 0)) or end > MAX_PAYLOAD) {
+        return {};
+    }
+
+    // find the datagram, and make it the most recently used
+    const Key key{header.src, header.dst, header.id, header.proto};
+    auto found = _index.find(key);
+    if (found == _index.end()) {
+        _partials.push_back({});
+        _partials.back().key = key;
+        _partials.back().charge = PARTIAL_OVERHEAD;
+        _memory_used += PARTIAL_OVERHEAD;
+        found = _index.emplace(key, prev(_partials.end())).first;
+    } else {
+        _partials.splice(_partials.end(), _partials, found->second);
+    }
+    const auto it = found->second;
+    Partial &partial = *it;
+    partial.last_ms = _now_ms;
+
+    // the last fragment fixes the length; nothing may lie beyond it
+    const size_t held_end =
+        partial.pieces.empty() ? 0 : partial.pieces.back().offset + partial.pieces.back().data.size();
+    if (not header.mf) {
+        if ((partial.total.has_value() and partial.total.value() != end) or held_end > end) {
+            _erase(it);
+            return {};
+        }
+        partial.total = end;
+    } else if (partial.total.has_value() and end > partial.total.value()) {
+        _erase(it);
+        return {};
+    }
+
+    if (header.offset == 0) {
+        partial.header = header;
+    }
+    _add(partial, start, payload);
+
+    // make room by evicting the least recently used datagrams, or give up on this one
+    while (_memory_used > _memory_limit and _partials.begin() != it) {
+        _erase(_partials.begin());
+    }
+    if (_memory_used > _memory_limit) {
+        _erase(it);
+        return {};
+    }
+
+    if (not partial.header.has_value() or not partial.total.has_value() or
+        partial.received != partial.total.value()) {
+        return {};
+    }
+
+    IPv4Datagram ret;
+    ret.header() = partial.header.value();
+    ret.header().mf = false;
+    ret.header().offset = 0;
+    ret.header().len = ret.header().hlen * 4 + partial.total.value();
+    for (const Piece &piece : partial.pieces) {
+        ret.payload().append(BufferList{piece.data});
+    }
+    _erase(it);
+    return ret;
+}
+
+void IPv4Reassembler::_add(Partial &partial, const size_t start, const Buffer &data) {
+    const size_t end = start + data.size();
+
+    // the holes in [start, end) between the pieces already held
+    vector<Piece> added;
+    size_t next = start;
+    auto piece = lower_bound(partial.pieces.begin(),
+                             partial.pieces.end(),
+                             start,
+                             [](const Piece &p, const size_t offset) { return p.offset + p.data.size() <= offset; });
+    for (; next < end; ++piece) {
+        const size_t hole_end = piece == partial.pieces.end() ? end : min(end, piece->offset);
+        if (next < hole_end) {
+            Buffer bytes = data;
+            bytes.remove_prefix(next - start);
+            if (hole_end != end) {
+                // only the front of what's left is new, so copy it
+                const Buffer rest = bytes;
+                const size_t size = hole_end - next;
+                bytes = Buffer::make(size, [&](char *out) { copy_n(rest.str().data(), size, out); });
+            }
+            added.push_back({next, std::move(bytes)});
+        }
+        if (piece == partial.pieces.end()) {
+            break;
+        }
+        next = max(next, piece->offset + piece->data.size());
+    }
+
+    for (Piece &p : added) {
+        const size_t charge = max(p.data.size(), SlabAllocator::CHUNK_SIZE);
+        partial.received += p.data.size();
+        partial.charge += charge;
+        _memory_used += charge;
+        const auto at = lower_bound(partial.pieces.begin(),
+                                    partial.pieces.end(),
+                                    p.offset,
+                                    [](const Piece &q, const size_t offset) { return q.offset < offset; });
+        partial.pieces.insert(at, std::move(p));
+    }
+}
+
+void IPv4Reassembler::_erase(const list<Partial>::iterator it) {
+    _memory_used -= it->charge;
+    _index.erase(it->key);
+    _partials.erase(it);
+}
+
+//! \param[in] ms_since_last_tick is the number of milliseconds since the last call to this method
+void IPv4Reassembler::tick(const uint64_t ms_since_last_tick) {
+    _now_ms += ms_since_last_tick;
+
+    // least recently used first, which is also the order in which they time out
+    while (not _partials.empty() and _now_ms - _partials.front().last_ms >= _timeout_ms) {
+        _erase(_partials.begin());
+    }
+}
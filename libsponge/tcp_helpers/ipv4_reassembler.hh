@@ -0,0 +1,99 @@
+#ifndef SPONGE_LIBSPONGE_IPV4_REASSEMBLER_HH
+#define SPONGE_LIBSPONGE_IPV4_REASSEMBLER_HH
+
+#include "buffer.hh"
+#include "ipv4_datagram.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Reassembles fragmented [IPv4](\ref rfc::rfc791) datagrams, within a fixed memory budget
+//! \details Fragments are grouped by (source, destination, identification, protocol). The pieces
+//! of each datagram are kept as references to the fragments' own storage, so a datagram that
+//! arrives in non-overlapping fragments is reassembled without copying its payload; where
+//! fragments overlap, the bytes that arrived first are kept.
+//!
+//! Every piece is charged at least a pooled chunk (SlabAllocator::CHUNK_SIZE), since that is what
+//! it keeps alive, so a flood of tiny fragments can't hold more memory than the budget. When a
+//! fragment takes the total over budget, the least recently used partial datagrams are evicted;
+//! a partial datagram that goes `timeout_ms` without a new fragment is dropped by tick().
+class IPv4Reassembler {
+  public:
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = 4 * 1024 * 1024;  //!< Default memory budget
+    static constexpr uint64_t DEFAULT_TIMEOUT_MS = 30 * 1000;        //!< Default idle timeout
+
+  private:
+    //! Fragments with the same key belong to the same datagram (RFC 791, section 3.2)
+    struct Key {
+        uint32_t src = 0;
+        uint32_t dst = 0;
+        uint16_t id = 0;
+        uint8_t proto = 0;
+
+        bool operator==(const Key &other) const {
+            return src == other.src and dst == other.dst and id == other.id and proto == other.proto;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    //! Payload bytes starting at `offset`
+    struct Piece {
+        size_t offset;
+        Buffer data;
+    };
+
+    //! A datagram still missing some fragments
+    struct Partial {
+        Key key{};
+        std::optional<IPv4Header> header{};  //!< Header of the first fragment, once it has arrived
+        std::optional<size_t> total{};       //!< Payload length, once the last fragment has arrived
+        std::vector<Piece> pieces{};         //!< Sorted by offset, and not overlapping
+        size_t received = 0;                 //!< Payload bytes held in `pieces`
+        size_t charge = 0;                   //!< Memory charged against the budget
+        uint64_t last_ms = 0;                //!< When the latest fragment arrived
+    };
+
+    size_t _memory_limit;
+    uint64_t _timeout_ms;
+    uint64_t _now_ms = 0;
+    size_t _memory_used = 0;
+
+    //! Partial datagrams, least recently used first
+    std::list<Partial> _partials{};
+    std::unordered_map<Key, std::list<Partial>::iterator, KeyHash> _index{};
+
+    //! Add the bytes of [start, start + data.size()) that `partial` doesn't already have
+    void _add(Partial &partial, const size_t start, const Buffer &data);
+
+    //! Forget a partial datagram and release its memory
+    void _erase(std::list<Partial>::iterator it);
+
+  public:
+    //! \param[in] memory_limit is the most memory that partial datagrams may hold, in bytes
+    //! \param[in] timeout_ms is how long a partial datagram is kept after its latest fragment
+    explicit IPv4Reassembler(const size_t memory_limit = DEFAULT_MEMORY_LIMIT,
+                             const uint64_t timeout_ms = DEFAULT_TIMEOUT_MS);
+
+    //! \brief Accept a datagram that may be a fragment
+    //! \returns the datagram itself if it isn't a fragment, the reassembled datagram if it was
+    //!          the last missing fragment, and nothing otherwise
+    std::optional<IPv4Datagram> push(const IPv4Datagram &dgram);
+
+    //! Advance time, dropping partial datagrams that have timed out
+    void tick(const uint64_t ms_since_last_tick);
+
+    //! \name Accessors
+    //!@{
+    size_t partial_datagrams() const { return _partials.size(); }  //!< Datagrams still missing fragments
+    size_t memory_used() const { return _memory_used; }            //!< Memory charged against the budget
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_IPV4_REASSEMBLER_HH
@@ -0,0 +1,33 @@
+#include "ipv6_datagram.hh"
+
+#include "parser.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+ParseResult IPv6Datagram::parse(const Buffer buffer) {
+    NetParser p{buffer};
+    const ParseResult header_result = _header.parse(p);
+    if (header_result != ParseResult::NoError) {
+        return header_result;
+    }
+    _payload = p.buffer();
+
+    if (_payload.size() != _header.payload_length()) {
+        return ParseResult::PacketTooShort;
+    }
+
+    return p.get_error();
+}
+
+BufferList IPv6Datagram::serialize() const {
+    if (_payload.size() != _header.payload_length()) {
+        throw runtime_error("IPv6Datagram::serialize: payload is wrong size");
+    }
+
+    // unlike IPv4, there is no header checksum to fill in
+    BufferList ret{Buffer::make(IPv6Header::LENGTH, [&](char *data) { _header.serialize(data); })};
+    ret.append(_payload);
+    return ret;
+}
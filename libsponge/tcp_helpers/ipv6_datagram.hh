@@ -0,0 +1,30 @@
+#ifndef SPONGE_LIBSPONGE_IPV6_DATAGRAM_HH
+#define SPONGE_LIBSPONGE_IPV6_DATAGRAM_HH
+
+#include "buffer.hh"
+#include "ipv6_header.hh"
+
+//! \brief [IPv6](\ref rfc::rfc8200) Internet datagram
+class IPv6Datagram {
+  private:
+    IPv6Header _header{};
+    BufferList _payload{};
+
+  public:
+    //! \brief Parse the segment from a string
+    ParseResult parse(const Buffer buffer);
+
+    //! \brief Serialize the segment to a string
+    BufferList serialize() const;
+
+    //! \name Accessors
+    //!@{
+    const IPv6Header &header() const { return _header; }
+    IPv6Header &header() { return _header; }
+
+    const BufferList &payload() const { return _payload; }
+    BufferList &payload() { return _payload; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_IPV6_DATAGRAM_HH
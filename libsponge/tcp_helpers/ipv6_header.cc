@@ -0,0 +1,137 @@
+#include "ipv6_header.hh"
+
+#include "util.hh"
+
+#include <arpa/inet.h>
+#include <array>
+#include <iomanip>
+#include <netinet/in.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+//! \param[in,out] p is a NetParser from which the IP fields will be extracted
+//! \returns a ParseResult indicating success or the reason for failure
+//! \details The errors checked for are:
+//!
+//! - data stream is too short to contain a header
+//! - wrong IP version number
+//! - there is less (or more) data in the full datagram than the `payload_len` field claims
+//!
+//! There is no header checksum to check.
+ParseResult IPv6Header::parse(NetParser &p) {
+    const size_t data_size = p.buffer().size();
+    if (data_size < IPv6Header::LENGTH) {
+        return ParseResult::PacketTooShort;
+    }
+
+    const uint32_t first_word = p.u32();
+    ver = first_word >> 28;              // version
+    tclass = (first_word >> 20) & 0xff;  // traffic class
+    flow_label = first_word & 0xfffff;   // flow label
+    payload_len = p.u16();               // payload length
+    next_header = p.u8();                // next header
+    hop_limit = p.u8();                  // hop limit
+    for (auto &byte : src) {
+        byte = p.u8();  // source address
+    }
+    for (auto &byte : dst) {
+        byte = p.u8();  // destination address
+    }
+
+    if (ver != 6) {
+        return ParseResult::WrongIPVersion;
+    }
+    if (data_size != IPv6Header::LENGTH + payload_len) {
+        return ParseResult::TruncatedPacket;
+    }
+
+    return p.get_error();
+}
+
+//! Serialize the IPv6Header to a string
+string IPv6Header::serialize() const {
+    string ret(IPv6Header::LENGTH, 0);
+    serialize(ret.data());
+    return ret;
+}
+
+//! Serialize the IPv6Header in place
+void IPv6Header::serialize(char *out) const {
+    // sanity checks
+    if (ver != 6) {
+        throw runtime_error("wrong IP version");
+    }
+
+    const uint32_t first_word = (uint32_t{ver} << 28) | (uint32_t{tclass} << 20) | (flow_label & 0xfffff);
+    NetUnparser::u32(out, first_word);   // version, traffic class and flow label
+    NetUnparser::u16(out, payload_len);  // payload length
+    NetUnparser::u8(out, next_header);   // next header
+    NetUnparser::u8(out, hop_limit);     // hop limit
+    for (const auto byte : src) {
+        NetUnparser::u8(out, byte);  // src address
+    }
+    for (const auto byte : dst) {
+        NetUnparser::u8(out, byte);  // dst address
+    }
+}
+
+//! \details This value is needed when computing the checksum of an encapsulated TCP segment.
+//! ~~~{.txt}
+//!   0      7 8     15 16    23 24    31
+//!  +--------+--------+--------+--------+
+//!  |                                   |
+//!  +       source address (128 bits)   +
+//!  |                                   |
+//!  +--------+--------+--------+--------+
+//!  |                                   |
+//!  +    destination address (128 bits) +
+//!  |                                   |
+//!  +--------+--------+--------+--------+
+//!  |     upper-layer packet length     |
+//!  +--------+--------+--------+--------+
+//!  |          zero            |next hdr|
+//!  +--------+--------+--------+--------+
+//! ~~~
+uint32_t IPv6Header::pseudo_cksum() const {
+    uint32_t pcksum = 0;
+    for (size_t i = 0; i < src.size(); i += 2) {
+        pcksum += (uint32_t{src[i]} << 8) + src[i + 1];  // source addr
+        pcksum += (uint32_t{dst[i]} << 8) + dst[i + 1];  // dest addr
+    }
+    pcksum += payload_length();  // upper-layer packet length (no extension headers)
+    pcksum += next_header;       // protocol
+    return pcksum;
+}
+
+//! \returns the address in the usual colon-separated form
+static string ipv6_to_string(const IPv6Numeric &address) {
+    array<char, INET6_ADDRSTRLEN> ret{};
+    inet_ntop(AF_INET6, address.data(), ret.data(), ret.size());
+    return ret.data();
+}
+
+//! \returns A string with the header's contents
+std::string IPv6Header::to_string() const {
+    stringstream ss{};
+    ss << hex << "IP version: " << +ver << '\n'
+       << "Traffic class: " << +tclass << '\n'
+       << "Flow label: " << +flow_label << '\n'
+       << "Payload len: " << +payload_len << '\n'
+       << "Next header: " << +next_header << '\n'
+       << "Hop limit: " << +hop_limit << '\n'
+       << "Src addr: " << ipv6_to_string(src) << '\n'
+       << "Dst addr: " << ipv6_to_string(dst) << '\n';
+    return ss.str();
+}
+
+std::string IPv6Header::summary() const {
+    stringstream ss{};
+    ss << hex << "IPv" << +ver << ", "
+       << "len=" << +payload_len << ", "
+       << "next=" << +next_header << ", " << (hop_limit >= 10 ? "" : "hops=" + ::to_string(hop_limit) + ", ")
+       << "src=" << ipv6_to_string(src) << ", "
+       << "dst=" << ipv6_to_string(dst);
+    return ss.str();
+}
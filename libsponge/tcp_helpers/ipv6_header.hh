@@ -0,0 +1,78 @@
+#ifndef SPONGE_LIBSPONGE_IPV6_HEADER_HH
+#define SPONGE_LIBSPONGE_IPV6_HEADER_HH
+
+#include "address.hh"
+#include "parser.hh"
+
+//! \brief [IPv6](\ref rfc::rfc8200) Internet datagram header
+//! \note Extension headers are not supported: `next_header` names the payload's protocol
+struct IPv6Header {
+    static constexpr size_t LENGTH = 40;               //!< [IPv6](\ref rfc::rfc8200) header length
+    static constexpr uint8_t DEFAULT_HOP_LIMIT = 128;  //!< A reasonable default hop limit
+    static constexpr uint8_t PROTO_TCP = 6;            //!< Protocol number for [tcp](\ref rfc::rfc793)
+
+    //! \struct IPv6Header
+    //! ~~~{.txt}
+    //!   0                   1                   2                   3
+    //!   0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+    //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    //!  |Version| Traffic Class |           Flow Label                  |
+    //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    //!  |         Payload Length        |  Next Header  |   Hop Limit   |
+    //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    //!  |                                                               |
+    //!  +                                                               +
+    //!  |                                                               |
+    //!  +                         Source Address                        +
+    //!  |                                                               |
+    //!  +                                                               +
+    //!  |                                                               |
+    //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    //!  |                                                               |
+    //!  +                                                               +
+    //!  |                                                               |
+    //!  +                      Destination Address                      +
+    //!  |                                                               |
+    //!  +                                                               +
+    //!  |                                                               |
+    //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    //! ~~~
+
+    //! \name IPv6 Header fields
+    //!@{
+    uint8_t ver = 6;                        //!< IP version
+    uint8_t tclass = 0;                     //!< traffic class
+    uint32_t flow_label = 0;                //!< flow label (20 bits)
+    uint16_t payload_len = 0;               //!< length of the payload
+    uint8_t next_header = PROTO_TCP;        //!< protocol of the payload
+    uint8_t hop_limit = DEFAULT_HOP_LIMIT;  //!< hop limit
+    IPv6Numeric src{};                      //!< src address
+    IPv6Numeric dst{};                      //!< dst address
+    //!@}
+
+    //! Parse the IP fields from the provided NetParser
+    ParseResult parse(NetParser &p);
+
+    //! Serialize the IP fields
+    std::string serialize() const;
+
+    //! Serialize the IP fields into the LENGTH bytes at `out`
+    void serialize(char *out) const;
+
+    //! Length of the payload
+    uint16_t payload_length() const { return payload_len; }
+
+    //! [pseudo-header's](\ref rfc::rfc8200) contribution to the TCP checksum
+    uint32_t pseudo_cksum() const;
+
+    //! Return a string containing a header in human-readable format
+    std::string to_string() const;
+
+    //! Return a string containing a human-readable summary of the header
+    std::string summary() const;
+};
+
+//! \struct IPv6Header
+//! This struct can be used to parse an existing IP header or to create a new one.
+
+#endif  // SPONGE_LIBSPONGE_IPV6_HEADER_HH
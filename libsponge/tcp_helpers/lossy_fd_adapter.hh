@@ -63,9 +63,9 @@ class LossyFdAdapter {
     void set_listening(const bool l) { _adapter.set_listening(l); }      //!< FdAdapterBase::set_listening passthrough
     const FdAdapterConfig &config() const { return _adapter.config(); }  //!< FdAdapterBase::config passthrough
     FdAdapterConfig &config_mut() { return _adapter.config_mut(); }      //!< FdAdapterBase::config_mut passthrough
-    void tick(const size_t ms_since_last_tick) {
-        _adapter.tick(ms_since_last_tick);
-    }  //!< FdAdapterBase::tick passthrough
+    void tick_us(const uint64_t us_since_last_tick) {
+        _adapter.tick_us(us_since_last_tick);
+    }  //!< FdAdapterBase::tick_us passthrough
     //!@}
 };
 
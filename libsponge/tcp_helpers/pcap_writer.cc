@@ -0,0 +1,134 @@
+#include "pcap_writer.hh"
+
+#include "ipv4_datagram.hh"
+#include "pcap_writer_adapter.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+//! Append the bytes of a trivially-copyable value, in native byte order
+template <typename T>
+static void append_raw(string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+//! \param[in] path is the file to write; it is truncated
+PcapWriter::PcapWriter(const string &path)
+    : _file(SystemCall("open", ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))) {
+    string header;
+    append_raw(header, uint32_t{0xa1b2c3d4});  // magic number: microsecond timestamps
+    append_raw(header, uint16_t{2});           // major version
+    append_raw(header, uint16_t{4});           // minor version
+    append_raw(header, int32_t{0});            // timestamps are UTC
+    append_raw(header, uint32_t{0});           // accuracy of timestamps
+    append_raw(header, uint32_t{65535});       // snapshot length: whole datagrams
+    append_raw(header, LINKTYPE_RAW);          // link-layer header type
+    _file.write(header);
+
+    _batch.reserve(BATCH_SIZE);
+    _writer = thread([this] { _write_batches(); });
+}
+
+//! \param[in] seg is the segment, with its ports already set
+//! \param[in] src is the numeric IPv4 address the segment is from
+//! \param[in] dst is the numeric IPv4 address the segment is to
+void PcapWriter::write(const TCPSegment &seg, const uint32_t src, const uint32_t dst) {
+    InternetDatagram dgram;
+    dgram.header().src = src;
+    dgram.header().dst = dst;
+    dgram.header().id = _ip_id++;
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+    const BufferList packet = dgram.serialize();
+
+    const auto now = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch());
+    append_raw(_batch, uint32_t(now.count() / 1000000));
+    append_raw(_batch, uint32_t(now.count() % 1000000));
+    append_raw(_batch, uint32_t(packet.size()));  // bytes captured
+    append_raw(_batch, uint32_t(packet.size()));  // bytes on the wire
+    for (const auto &buffer : packet.buffers()) {
+        _batch.append(buffer.str());
+    }
+
+    if (_batch.size() >= BATCH_SIZE) {
+        _hand_off();
+    }
+}
+
+void PcapWriter::flush() {
+    if (not _batch.empty()) {
+        _hand_off();
+    }
+}
+
+void PcapWriter::_hand_off() {
+    unique_lock<mutex> lock(_mutex);
+    _cv.wait(lock, [&] { return _pending.empty() or _error; });
+    if (_error) {
+        rethrow_exception(_error);
+    }
+    swap(_pending, _batch);
+    _cv.notify_all();
+    lock.unlock();
+
+    _batch.clear();
+    _batch.reserve(BATCH_SIZE);
+}
+
+void PcapWriter::_write_batches() {
+    while (true) {
+        string batch;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _cv.wait(lock, [&] { return not _pending.empty() or _stopping; });
+            if (_pending.empty()) {
+                return;
+            }
+            swap(batch, _pending);
+            _cv.notify_all();
+        }
+
+        try {
+            _file.write(batch);
+        } catch (...) {
+            lock_guard<mutex> lock(_mutex);
+            _error = current_exception();
+            _cv.notify_all();
+            return;
+        }
+    }
+}
+
+PcapWriter::~PcapWriter() {
+    try {
+        flush();
+    } catch (const exception &) {
+        // reported below
+    }
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+        _cv.notify_all();
+    }
+    _writer.join();
+
+    if (_error) {
+        try {
+            rethrow_exception(_error);
+        } catch (const exception &e) {
+            cerr << "Warning: pcap capture is incomplete: " << e.what() << endl;
+        }
+    }
+}
+
+//! Specialize PcapWriterAdapter to LossyTCPOverUDPSocketAdapter
+template class PcapWriterAdapter<LossyTCPOverUDPSocketAdapter>;
+
+//! Specialize PcapWriterAdapter to LossyTCPOverIPv4OverTunFdAdapter
+template class PcapWriterAdapter<LossyTCPOverIPv4OverTunFdAdapter>;
@@ -0,0 +1,73 @@
+#ifndef SPONGE_LIBSPONGE_PCAP_WRITER_HH
+#define SPONGE_LIBSPONGE_PCAP_WRITER_HH
+
+#include "file_descriptor.hh"
+#include "tcp_segment.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//! \brief Writes TCP segments to a [pcap](\ref https://wiki.wireshark.org/Development/LibpcapFileFormat) file,
+//! each in a synthesized IPv4 header
+//! \details Records are appended to an in-memory batch. A full batch is handed to a writer
+//! thread, so the caller only waits on the disk if the writer is a whole batch behind.
+class PcapWriter {
+  private:
+    FileDescriptor _file;  //!< The pcap file, only written by `_writer` after construction
+    std::string _batch{};  //!< Records not yet handed to `_writer`
+    uint16_t _ip_id = 0;   //!< Identification field of the next synthesized IPv4 header
+
+    std::mutex _mutex{};            //!< Protects the members below
+    std::condition_variable _cv{};  //!< Signals a change to `_pending` or `_stopping`
+    std::string _pending{};         //!< A batch waiting for `_writer`
+    bool _stopping = false;         //!< Tells `_writer` to exit once `_pending` is written
+    std::exception_ptr _error{};    //!< A write error from `_writer`, rethrown to the caller
+    std::thread _writer{};          //!< Writes each pending batch to `_file`
+
+    //! Body of the `_writer` thread
+    void _write_batches();
+
+    //! Wait for `_writer` to take the previous batch, then give it `_batch`
+    void _hand_off();
+
+  public:
+    //! A batch is handed to the writer thread once it reaches this many bytes
+    static constexpr size_t BATCH_SIZE = 256 * 1024;
+
+    //! [LINKTYPE_RAW](\ref https://www.tcpdump.org/linktypes.html): each packet starts with an IP header
+    static constexpr uint32_t LINKTYPE_RAW = 101;
+
+    //! Create (or truncate) the file at `path` and write the pcap file header
+    explicit PcapWriter(const std::string &path);
+
+    //! Append a segment, in an IPv4 datagram from `src` to `dst`, with the current time
+    void write(const TCPSegment &seg, const uint32_t src, const uint32_t dst);
+
+    //! Hand the records appended so far to the writer thread
+    void flush();
+
+    //! Write out every record and close the file
+    ~PcapWriter();
+
+    //! \name
+    //! Neither copyable nor movable: the writer thread refers to the object
+
+    //!@{
+    PcapWriter(const PcapWriter &other) = delete;
+    PcapWriter &operator=(const PcapWriter &other) = delete;
+    PcapWriter(PcapWriter &&other) = delete;
+    PcapWriter &operator=(PcapWriter &&other) = delete;
+    //!@}
+};
+
+//! \class PcapWriter
+//! The TCP checksum is computed against the synthesized IPv4 header, so Wireshark's checksum
+//! validation passes. Records use the microsecond-resolution pcap format in native byte order.
+//! A write error in the writer thread is rethrown by the next write() or flush(); the destructor
+//! reports it on stderr instead.
+
+#endif  // SPONGE_LIBSPONGE_PCAP_WRITER_HH
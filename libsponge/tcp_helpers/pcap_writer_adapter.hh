@@ -0,0 +1,93 @@
+#ifndef SPONGE_LIBSPONGE_PCAP_WRITER_ADAPTER_HH
+#define SPONGE_LIBSPONGE_PCAP_WRITER_ADAPTER_HH
+
+#include "fd_adapter.hh"
+#include "file_descriptor.hh"
+#include "pcap_writer.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+#include "tuntap_adapter.hh"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+//! An adapter class that records every segment read from or written to an FD adapter in a pcap file
+template <typename AdapterT>
+class PcapWriterAdapter {
+  private:
+    //! The underlying FD adapter
+    AdapterT _adapter;
+
+    //! The capture file (behind a pointer so the adapter stays movable)
+    std::unique_ptr<PcapWriter> _pcap;
+
+    //! Microseconds since the capture was last handed to the writer thread
+    uint64_t _us_since_flush = 0;
+
+  public:
+    //! Records still in memory are handed to the writer thread at least this often (by tick_us)
+    static constexpr uint64_t FLUSH_INTERVAL_US = 100 * 1000;
+
+    //! Conversion to a FileDescriptor by returning the underlying AdapterT
+    operator const FileDescriptor &() const { return _adapter; }
+
+    //! \brief Construct from an AdapterT, capturing to a new file at `path`
+    //! \param[in] adapter is the adapter to wrap
+    //! \param[in] path is the pcap file to create (or truncate)
+    PcapWriterAdapter(AdapterT &&adapter, const std::string &path)
+        : _adapter(std::move(adapter)), _pcap(std::make_unique<PcapWriter>(path)) {}
+
+    //! \brief Read from the underlying AdapterT instance, recording the segment if there is one
+    //! \returns std::optional<TCPSegment> that is empty if the underlying AdapterT returned an empty value
+    std::optional<TCPSegment> read() {
+        auto ret = _adapter.read();
+        // the read may have filled in the peer's address (when listening)
+        if (ret.has_value()) {
+            _pcap->write(ret.value(), config().destination.ipv4_numeric(), config().source.ipv4_numeric());
+        }
+        return ret;
+    }
+
+    //! \brief Write to the underlying AdapterT instance, then record the segment
+    //! \param[in] seg is the packet to write; the AdapterT sets its ports
+    void write(TCPSegment &seg) {
+        _adapter.write(seg);
+        _pcap->write(seg, config().source.ipv4_numeric(), config().destination.ipv4_numeric());
+    }
+
+    //! Hand the records captured so far to the writer thread
+    void flush() { _pcap->flush(); }
+
+    //! \name
+    //! Passthrough functions to the underlying AdapterT instance
+
+    //!@{
+    void set_listening(const bool l) { _adapter.set_listening(l); }      //!< FdAdapterBase::set_listening passthrough
+    const FdAdapterConfig &config() const { return _adapter.config(); }  //!< FdAdapterBase::config passthrough
+    FdAdapterConfig &config_mut() { return _adapter.config_mut(); }      //!< FdAdapterBase::config_mut passthrough
+    //! FdAdapterBase::tick_us passthrough, which also flushes the capture every FLUSH_INTERVAL_US
+    void tick_us(const uint64_t us_since_last_tick) {
+        _adapter.tick_us(us_since_last_tick);
+        _us_since_flush += us_since_last_tick;
+        if (_us_since_flush >= FLUSH_INTERVAL_US) {
+            _us_since_flush = 0;
+            flush();
+        }
+    }
+    //!@}
+};
+
+//! \class PcapWriterAdapter
+//! Segments are captured as the TCPConnection sees them: outside any LossyFdAdapter it wraps,
+//! downlink losses are never read and uplink losses still appear as sent. Addresses come from
+//! the adapter's FdAdapterConfig; an unbound source appears as 0.0.0.0.
+
+//! Typedef for a pcap-recording LossyTCPOverUDPSocketAdapter
+using PcapLossyTCPOverUDPSocketAdapter = PcapWriterAdapter<LossyTCPOverUDPSocketAdapter>;
+
+//! Typedef for a pcap-recording LossyTCPOverIPv4OverTunFdAdapter
+using PcapLossyTCPOverIPv4OverTunFdAdapter = PcapWriterAdapter<LossyTCPOverIPv4OverTunFdAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_PCAP_WRITER_ADAPTER_HH
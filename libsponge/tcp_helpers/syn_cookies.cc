@@ -0,0 +1,81 @@
+#include "syn_cookies.hh"
+
+#include <random>
+
+using namespace std;
+
+static uint64_t rotate_left(const uint64_t x, const unsigned bits) { return (x << bits) | (x >> (64 - bits)); }
+
+//! One SipRound, on the four words of state
+static void sip_round(array<uint64_t, 4> &v) {
+    v[0] += v[1];
+    v[1] = rotate_left(v[1], 13) ^ v[0];
+    v[0] = rotate_left(v[0], 32);
+    v[2] += v[3];
+    v[3] = rotate_left(v[3], 16) ^ v[2];
+    v[0] += v[3];
+    v[3] = rotate_left(v[3], 21) ^ v[0];
+    v[2] += v[1];
+    v[1] = rotate_left(v[1], 17) ^ v[2];
+    v[2] = rotate_left(v[2], 32);
+}
+
+//! SipHash-2-4 of three little-endian 64-bit words (a 24-byte message)
+static uint64_t siphash24(const array<uint64_t, 2> &key, const array<uint64_t, 3> &message) {
+    array<uint64_t, 4> v{key[0] ^ 0x736f6d6570736575ULL,
+                         key[1] ^ 0x646f72616e646f6dULL,
+                         key[0] ^ 0x6c7967656e657261ULL,
+                         key[1] ^ 0x7465646279746573ULL};
+
+    // the message, then a last block holding just its length
+    const array<uint64_t, 4> blocks{message[0], message[1], message[2], uint64_t{24} << 56};
+    for (const uint64_t m : blocks) {
+        v[3] ^= m;
+        sip_round(v);
+        sip_round(v);
+        v[0] ^= m;
+    }
+
+    v[2] ^= 0xff;
+    for (unsigned i = 0; i < 4; i++) {
+        sip_round(v);
+    }
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+SynCookies::SynCookies() : _key() {
+    random_device rd;
+    for (auto &word : _key) {
+        word = (uint64_t{rd()} << 32) | rd();
+    }
+}
+
+uint32_t SynCookies::_hash(const TCPFlow &flow, const WrappingInt32 peer_isn, const uint64_t period) const {
+    const uint64_t addrs = (uint64_t{flow.local_address} << 32) | flow.remote_address;
+    const uint64_t ports_isn =
+        (uint64_t{flow.local_port} << 48) | (uint64_t{flow.remote_port} << 32) | peer_isn.raw_value();
+    return siphash24(_key, {addrs, ports_isn, period}) & ((uint32_t{1} << HASH_BITS) - 1);
+}
+
+WrappingInt32 SynCookies::make(const TCPFlow &flow, const WrappingInt32 peer_isn, const uint64_t now_ms) const {
+    const uint64_t period = now_ms / PERIOD_MS;
+    return WrappingInt32{uint32_t(period << HASH_BITS) | _hash(flow, peer_isn, period)};
+}
+
+bool SynCookies::check(const TCPFlow &flow,
+                       const WrappingInt32 peer_isn,
+                       const WrappingInt32 isn,
+                       const uint64_t now_ms) const {
+    const uint64_t now_period = now_ms / PERIOD_MS;
+    const uint32_t period_bits = isn.raw_value() >> HASH_BITS;
+
+    // the cookie only has the low bits of its period: try this period and the one before
+    for (uint64_t age = 0; age < 2 and age <= now_period; age++) {
+        const uint64_t period = now_period - age;
+        if ((period & (uint32_t{0xffffffff} >> HASH_BITS)) == period_bits and
+            (isn.raw_value() & ((uint32_t{1} << HASH_BITS) - 1)) == _hash(flow, peer_isn, period)) {
+            return true;
+        }
+    }
+    return false;
+}
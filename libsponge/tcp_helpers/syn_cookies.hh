@@ -0,0 +1,46 @@
+#ifndef SPONGE_LIBSPONGE_SYN_COOKIES_HH
+#define SPONGE_LIBSPONGE_SYN_COOKIES_HH
+
+#include "tcp_flow.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstdint>
+
+//! \brief Initial sequence numbers that let a listener check a handshake without remembering the SYN
+//! \details A cookie is a keyed hash ([SipHash-2-4](https://www.aumasson.jp/siphash/siphash.pdf))
+//! of the 4-tuple, the peer's ISN and a coarse clock, sent as the ISN of a SYN/ACK. A peer that
+//! completes the handshake echoes it back (plus one) as its ackno, and only a peer that received
+//! the SYN/ACK can do that. The top five bits of the cookie hold the low bits of the clock, so that
+//! a cookie expires after one to two periods; the other 27 are the hash.
+class SynCookies {
+  public:
+    static constexpr uint64_t PERIOD_MS = 64 * 1000;  //!< Granularity of the clock in a cookie
+
+  private:
+    static constexpr unsigned HASH_BITS = 27;  //!< Bits of the cookie taken by the hash
+
+    std::array<uint64_t, 2> _key;  //!< Secret key for the hash, chosen at random
+
+    //! The low HASH_BITS of the keyed hash
+    uint32_t _hash(const TCPFlow &flow, const WrappingInt32 peer_isn, const uint64_t period) const;
+
+  public:
+    //! Choose a new random key
+    SynCookies();
+
+    //! \brief The ISN to answer a SYN with
+    //! \param[in] flow is the connection, as seen from the listener
+    //! \param[in] peer_isn is the SYN's sequence number
+    //! \param[in] now_ms is the current time, in milliseconds
+    WrappingInt32 make(const TCPFlow &flow, const WrappingInt32 peer_isn, const uint64_t now_ms) const;
+
+    //! \brief Whether `isn` is a cookie that make() gave for the same SYN, no more than two periods ago
+    //! \param[in] flow is the connection, as seen from the listener
+    //! \param[in] peer_isn is the peer's ISN (one less than the seqno of its first ACK)
+    //! \param[in] isn is the candidate cookie (one less than the ackno of the peer's first ACK)
+    //! \param[in] now_ms is the current time, in milliseconds
+    bool check(const TCPFlow &flow, const WrappingInt32 peer_isn, const WrappingInt32 isn, const uint64_t now_ms) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_SYN_COOKIES_HH
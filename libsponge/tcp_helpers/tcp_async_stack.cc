@@ -0,0 +1,186 @@
+#include "tcp_async_stack.hh"
+
+#include "byte_stream.hh"
+#include "tcp_state.hh"
+
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! \param[in] limit is the largest number of bytes to return
+//! \returns the bytes read, or an empty string once the inbound stream has ended
+//! \throws std::runtime_error if the connection was reset
+Task<string> AsyncTCPConnection::read(const size_t limit) {
+    AsyncTCPStack &stack = *_stack;
+    const TCPFlow flow = _flow;
+
+    co_await stack._until_readable(flow, [&] {
+        if (not stack.contains(flow)) {
+            return true;
+        }
+        const ByteStream &inbound = stack.connection(flow).inbound_stream();
+        return inbound.buffer_size() > 0 or inbound.input_ended() or inbound.error();
+    });
+
+    if (not stack.contains(flow)) {
+        co_return string{};
+    }
+    if (stack.connection(flow).inbound_stream().error()) {
+        throw runtime_error("AsyncTCPConnection::read: connection " + flow.to_string() + " was reset");
+    }
+    co_return stack.read(flow, limit);
+}
+
+//! \param[in] data is the string to write
+//! \throws std::runtime_error if the connection closes before everything is written
+Task<> AsyncTCPConnection::write(string data) {
+    AsyncTCPStack &stack = *_stack;
+    const TCPFlow flow = _flow;
+
+    const auto closed = [&] { return not stack.contains(flow) or not stack.connection(flow).active(); };
+
+    size_t written = 0;
+    while (true) {
+        if (closed()) {
+            throw runtime_error("AsyncTCPConnection::write: connection " + flow.to_string() + " is closed");
+        }
+        written += stack.write(flow, data.substr(written));
+        if (written == data.size()) {
+            co_return;
+        }
+
+        co_await stack._until_writable(
+            flow, [&] { return closed() or stack.connection(flow).remaining_outbound_capacity() > 0; });
+    }
+}
+
+void AsyncTCPConnection::close() {
+    if (_stack->contains(_flow)) {
+        _stack->end_input_stream(_flow);
+    }
+}
+
+void AsyncTCPConnection::abort() { _stack->abort(_flow); }
+
+//! \param[in] local is the listening address passed to listen()
+Task<AsyncTCPConnection> AsyncTCPStack::accept(const Address local) {
+    optional<TCPFlow> flow;
+    const uint16_t port = local.port();
+    co_await Until{[this, port]() -> Waiters & { return _acceptors[port]; },
+                   [&] {
+                       flow = TCPDemux::accept(local);
+                       return flow.has_value();
+                   }};
+    co_return AsyncTCPConnection{*this, flow.value()};
+}
+
+//! \param[in] local is the source address; port 0 selects an unused ephemeral port
+//! \param[in] remote is the peer to connect to
+//! \throws std::runtime_error if the peer refuses the connection
+Task<AsyncTCPConnection> AsyncTCPStack::connect(const Address local, const Address remote) {
+    const TCPFlow flow = TCPDemux::connect(local, remote);
+
+    const auto handshaking = [&] {
+        return contains(flow) and connection(flow).active() and
+               connection(flow).state() == TCPState::State::SYN_SENT;
+    };
+    co_await _until_writable(flow, [&] { return not handshaking(); });
+
+    if (not contains(flow) or not connection(flow).active()) {
+        throw runtime_error("AsyncTCPStack::connect: connection to " + remote.to_string() + " failed");
+    }
+    co_return AsyncTCPConnection{*this, flow};
+}
+
+AsyncTCPStack::Detached AsyncTCPStack::_run(AsyncTCPStack &stack, Task<> task) {
+    try {
+        co_await task;
+    } catch (...) {
+        stack._failures.push_back(current_exception());
+    }
+}
+
+//! \param[in] task is the coroutine to start; the stack keeps it until it finishes
+void AsyncTCPStack::spawn(Task<> task) { _run(*this, move(task)); }
+
+AsyncTCPStack::Until AsyncTCPStack::_until_readable(const TCPFlow &flow, function<bool()> ready) {
+    return {[this, flow]() -> Waiters & { return _readers[flow]; }, move(ready)};
+}
+
+AsyncTCPStack::Until AsyncTCPStack::_until_writable(const TCPFlow &flow, function<bool()> ready) {
+    return {[this, flow]() -> Waiters & { return _writers[flow]; }, move(ready)};
+}
+
+void AsyncTCPStack::_take_ready(Waiters &waiters, vector<coroutine_handle<>> &ready) {
+    for (auto it = waiters.begin(); it != waiters.end();) {
+        ++_checks;
+        if (it->ready()) {
+            ready.push_back(it->handle);
+            it = waiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+template <typename Table, typename Key>
+void AsyncTCPStack::_take_ready(Table &table, const Key &key, vector<coroutine_handle<>> &ready) {
+    const auto it = table.find(key);
+    if (it == table.end()) {
+        return;
+    }
+    _take_ready(it->second, ready);
+    if (it->second.empty()) {
+        table.erase(it);
+    }
+}
+
+void AsyncTCPStack::_resume_ready() {
+    // resuming one coroutine can make another ready (e.g. accept() after a connect()), so repeat
+    vector<coroutine_handle<>> ready;
+    do {
+        ready.clear();
+        for (const TCPFlow &flow : take_touched()) {
+            _take_ready(_readers, flow, ready);
+            _take_ready(_writers, flow, ready);
+            _take_ready(_acceptors, flow.local_port, ready);
+        }
+        _take_ready(_waiters, ready);
+        for (const auto handle : ready) {
+            handle.resume();
+        }
+    } while (not ready.empty());
+
+    if (not _failures.empty()) {
+        const auto failure = _failures.front();
+        _failures.erase(_failures.begin());
+        rethrow_exception(failure);
+    }
+}
+
+//! \param[in] timeout_ms is the longest time to wait for an event (negative for no limit besides the
+//!                       connections' timers)
+void AsyncTCPStack::poll(const int timeout_ms) {
+    _resume_ready();
+    wait_next_event(timeout_ms);
+    _resume_ready();
+}
+
+void AsyncTCPStack::run() {
+    // a waiting task can only become ready after a datagram arrives or a timer expires
+    while (running() > 0) {
+        poll(-1);
+    }
+}
+
+AsyncTCPStack::~AsyncTCPStack() {
+    _waiters.clear();
+    _readers.clear();
+    _writers.clear();
+    _acceptors.clear();
+    // destroying a spawned task's frame destroys every Task it is awaiting, and unregisters it
+    while (not _tasks.empty()) {
+        _tasks.front().destroy();
+    }
+}
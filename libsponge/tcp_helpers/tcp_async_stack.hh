@@ -0,0 +1,211 @@
+#ifndef SPONGE_LIBSPONGE_TCP_ASYNC_STACK_HH
+#define SPONGE_LIBSPONGE_TCP_ASYNC_STACK_HH
+
+#include "address.hh"
+#include "file_descriptor.hh"
+#include "task.hh"
+#include "tcp_config.hh"
+#include "tcp_flow.hh"
+#include "tcp_stack.hh"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AsyncTCPStack;
+
+//! A connection of an AsyncTCPStack, used from coroutines
+class AsyncTCPConnection {
+  private:
+    AsyncTCPStack *_stack;  //!< The stack serving this connection
+    TCPFlow _flow;          //!< The connection's 4-tuple
+
+  public:
+    //! Construct a handle on the connection `flow` of `stack`
+    AsyncTCPConnection(AsyncTCPStack &stack, const TCPFlow &flow) : _stack(&stack), _flow(flow) {}
+
+    //! The connection's 4-tuple
+    const TCPFlow &flow() const { return _flow; }
+
+    //! Read up to `limit` bytes, suspending until some arrive; an empty string means the inbound stream ended
+    Task<std::string> read(const size_t limit);
+
+    //! Write all of `data`, suspending while the outbound stream is full
+    Task<> write(std::string data);
+
+    //! Finish the outbound stream
+    void close();
+
+    //! Reset the connection
+    void abort();
+};
+
+//! \brief A TCPStack whose connections are served by C++20 coroutines on the owner's thread
+//! \details Coroutines started with spawn() co_await accept(), connect(), and the read() and
+//! write() of AsyncTCPConnection. Each suspends until its connection can make progress; the
+//! stack resumes it after the EventLoop round in which that happened. No thread or socket
+//! pair is needed per connection, and a round costs in proportion to the connections it
+//! touched, not to the number of suspended coroutines.
+class AsyncTCPStack : public TCPStack {
+  private:
+    //! A suspended coroutine, and what it is waiting for
+    struct Waiter {
+        std::function<bool()> ready;     //!< Returns true once the coroutine can continue
+        std::coroutine_handle<> handle;  //!< The coroutine to resume
+    };
+
+    //! Suspended coroutines that the same change can make ready
+    using Waiters = std::list<Waiter>;
+
+    //! Suspends the awaiting coroutine until a condition holds
+    class Until {
+      private:
+        std::function<Waiters &()> _waiters;  //!< Where to wait: found only if the coroutine suspends
+        std::function<bool()> _ready;         //!< The condition
+
+      public:
+        Until(std::function<Waiters &()> waiters, std::function<bool()> ready)
+            : _waiters(std::move(waiters)), _ready(std::move(ready)) {}
+        bool await_ready() const { return _ready(); }
+        void await_suspend(const std::coroutine_handle<> handle) { _waiters().push_back({_ready, handle}); }
+        void await_resume() const {}
+    };
+
+    //! A coroutine started by spawn(), which destroys its own frame when it finishes
+    struct Detached {
+        class promise_type {
+          private:
+            AsyncTCPStack &_stack;                                //!< Stack that tracks this coroutine
+            std::list<std::coroutine_handle<>>::iterator _entry;  //!< This coroutine in AsyncTCPStack::_tasks
+
+          public:
+            //! Register the coroutine with the stack (receives the arguments of _run())
+            promise_type(AsyncTCPStack &stack, Task<> &)
+                : _stack(stack)
+                , _entry(_stack._tasks.insert(_stack._tasks.end(),
+                                              std::coroutine_handle<promise_type>::from_promise(*this))) {}
+
+            //! Unregister the coroutine, whether it finished or the stack destroyed it
+            ~promise_type() { _stack._tasks.erase(_entry); }
+
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+
+            promise_type(const promise_type &) = delete;
+            promise_type &operator=(const promise_type &) = delete;
+        };
+    };
+
+    //! \name Suspended coroutines
+    //! Those waiting on a connection are checked only after the TCPDemux touches its flow (see
+    //! TCPDemux::take_touched()); those waiting in until() are checked every round.
+    //!@{
+    Waiters _waiters{};                                            //!< In until()
+    std::unordered_map<TCPFlow, Waiters, TCPFlowHash> _readers{};  //!< For a connection to have data or close
+    std::unordered_map<TCPFlow, Waiters, TCPFlowHash> _writers{};  //!< For room, establishment, or closing
+    std::unordered_map<uint16_t, Waiters> _acceptors{};            //!< In accept(), by local port
+    //!@}
+
+    uint64_t _checks = 0;                         //!< Conditions of suspended coroutines evaluated
+    std::list<std::coroutine_handle<>> _tasks{};  //!< Spawned tasks that haven't finished
+    std::vector<std::exception_ptr> _failures{};  //!< Exceptions that escaped spawned tasks
+
+    //! Run `task` to completion, recording its failure
+    static Detached _run(AsyncTCPStack &stack, Task<> task);
+
+    //! Suspend until `ready` returns true, checking it when the connection `flow` is touched
+    Until _until_readable(const TCPFlow &flow, std::function<bool()> ready);
+    Until _until_writable(const TCPFlow &flow, std::function<bool()> ready);
+
+    //! Move the coroutines in `waiters` whose condition holds to `ready`
+    void _take_ready(Waiters &waiters, std::vector<std::coroutine_handle<>> &ready);
+
+    //! As _take_ready(), for the waiters under `key` in `table`, whose entry goes once empty
+    template <typename Table, typename Key>
+    void _take_ready(Table &table, const Key &key, std::vector<std::coroutine_handle<>> &ready);
+
+    //! Resume every waiting coroutine whose condition now holds
+    void _resume_ready();
+
+    friend class AsyncTCPConnection;
+
+  public:
+    //! Construct from the device and the configuration shared by every connection
+    explicit AsyncTCPStack(FileDescriptor &&device, const TCPConfig &cfg = {}) : TCPStack(std::move(device), cfg) {
+        track_touched(true);
+    }
+
+    //! Start `task`, which runs until its first suspension before spawn() returns
+    void spawn(Task<> task);
+
+    //! Number of spawned tasks that haven't finished
+    size_t running() const { return _tasks.size(); }
+
+    //! Wait for the next connection to `local` (listen() first)
+    Task<AsyncTCPConnection> accept(const Address local);
+
+    //! Open a connection from `local` to `remote`, suspending until it is established
+    Task<AsyncTCPConnection> connect(const Address local, const Address remote);
+
+    //! Suspend until `ready` returns true (checked after every round of events)
+    Until until(std::function<bool()> ready) {
+        return {[this]() -> Waiters & { return _waiters; }, std::move(ready)};
+    }
+
+    //! Conditions of suspended coroutines evaluated so far
+    uint64_t waiter_checks() const { return _checks; }
+
+    //! Process one round of events, then resume the coroutines that can make progress
+    void poll(const int timeout_ms);
+
+    //! Process events until every spawned task has finished
+    void run();
+
+    //! \name
+    //! Suspended coroutines refer to this object, so it cannot be moved or copied
+
+    //!@{
+    AsyncTCPStack(const AsyncTCPStack &) = delete;
+    AsyncTCPStack(AsyncTCPStack &&) = delete;
+    AsyncTCPStack &operator=(const AsyncTCPStack &) = delete;
+    AsyncTCPStack &operator=(AsyncTCPStack &&) = delete;
+    //!@}
+
+    //! Destroys the frames of tasks still suspended
+    ~AsyncTCPStack();
+};
+
+//! \class AsyncTCPStack
+//! An echo server, for example:
+//!
+//! ~~~{.cpp}
+//! Task<> echo(AsyncTCPConnection conn) {
+//!     while (true) {
+//!         std::string data = co_await conn.read(4096);
+//!         if (data.empty()) {
+//!             break;
+//!         }
+//!         co_await conn.write(std::move(data));
+//!     }
+//!     conn.close();
+//! }
+//!
+//! Task<> server(AsyncTCPStack &stack, const Address addr) {
+//!     stack.listen(addr);
+//!     while (true) {
+//!         stack.spawn(echo(co_await stack.accept(addr)));
+//!     }
+//! }
+//! ~~~
+//!
+//! Exceptions that escape a spawned task are rethrown from poll() or run().
+
+#endif  // SPONGE_LIBSPONGE_TCP_ASYNC_STACK_HH
@@ -18,9 +18,22 @@ class TCPConfig {
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up 最大重传次数
 
     uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds 超时重传初始值
+    uint32_t rt_timeout_us = 0;               //!< If nonzero, overrides rt_timeout with a value in microseconds
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes 接收窗口大小初始值
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes 发送窗口大小初始值
+    //! If larger than recv_capacity, the receive buffer starts at recv_capacity and grows toward this
+    //! as the application keeps up (see TCPReceiver::tick_us) 接收缓冲区自动调整的上限
+    size_t recv_capacity_max = 0;
+    //! If larger than send_capacity, the send buffer is resized each RTT to about twice the bytes
+    //! in flight, between send_capacity and this (see TCPSender) 发送缓冲区自动调整的上限
+    size_t send_capacity_max = 0;
+    //! Don't read more of the application's data until at least this much outbound capacity is
+    //! free (see TCPConnection::outbound_writable()) 发送缓冲区的低水位
+    size_t send_lowat = 0;
     std::optional<WrappingInt32> fixed_isn{};
+
+    //! Initial value of the retransmission timeout, in microseconds 超时重传初始值（微秒）
+    uint64_t initial_rto_us() const { return rt_timeout_us != 0 ? rt_timeout_us : uint64_t{rt_timeout} * 1000; }
 };
 
 //! Config for classes derived from FdAdapter
@@ -31,6 +44,47 @@ class FdAdapterConfig {
 
     uint16_t loss_rate_dn = 0;  //!< Downlink loss rate (for LossyFdAdapter)
     uint16_t loss_rate_up = 0;  //!< Uplink loss rate (for LossyFdAdapter)
+
+    uint16_t mtu = 0;  //!< Fragment outgoing IPv4 datagrams bigger than this (0 means never)
+};
+
+//! Config for one direction of an EmulatedLink; the defaults are an ideal link
+class EmulatedLinkConfig {
+  public:
+    //! How a full or filling bottleneck queue drops arrivals
+    enum class QueueDiscipline { DropTail, RED };
+
+    uint64_t seed = 1;  //!< Seeds the link's random number generator
+
+    //! \name Delay
+    //!@{
+    uint64_t delay_us = 0;   //!< One-way propagation delay
+    uint64_t jitter_us = 0;  //!< Extra delay, uniform in [0, jitter_us]; doesn't reorder segments
+    //!@}
+
+    //! \name Bottleneck
+    //!@{
+    uint64_t rate_bps = 0;                                   //!< Bottleneck rate in bits/s (0 for unlimited)
+    size_t queue_bytes = 64 * 1500;                          //!< Capacity of the bottleneck queue
+    QueueDiscipline discipline = QueueDiscipline::DropTail;  //!< What to do as the queue fills
+    size_t red_min_bytes = 5 * 1500;                         //!< RED: average queue where early drops begin
+    size_t red_max_bytes = 15 * 1500;                        //!< RED: average queue where every arrival drops
+    double red_max_p = 0.1;                                  //!< RED: drop probability at red_max_bytes
+    double red_weight = 0.002;                               //!< RED: weight of each sample in the average
+    //!@}
+
+    //! \name Gilbert-Elliott loss
+    //! A two-state Markov chain, stepped once per segment; loss_good alone is independent loss
+    //!@{
+    double p_good_to_bad = 0;  //!< Probability of moving from the good state to the bad state
+    double p_bad_to_good = 1;  //!< Probability of moving from the bad state to the good state
+    double loss_good = 0;      //!< Loss probability in the good state
+    double loss_bad = 1;       //!< Loss probability in the bad state
+    //!@}
+
+    double duplicate_rate = 0;          //!< Probability of delivering a segment twice
+    double reorder_rate = 0;            //!< Probability of holding a segment back so later ones overtake it
+    uint64_t reorder_delay_us = 10000;  //!< How long a reordered segment is held back
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_CONFIG_HH
@@ -0,0 +1,391 @@
+#include "tcp_demux.hh"
+
+#include "ipv4_header.hh"
+#include "memory_accountant.hh"
+#include "parser.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//! \param[in] cfg is the TCPConfig given to every new TCPConnection
+TCPDemux::TCPDemux(const TCPConfig &cfg) : _cfg(cfg), _rand(get_random_generator()) {}
+
+//! \param[in] local is the address and port to accept connections on
+//! \param[in] backlog is the limit on half-open connections, and separately on established-but-unaccepted ones
+void TCPDemux::listen(const Address &local, const size_t backlog) {
+    Listener &l = _listeners[local.port()];
+    l.address = local.ipv4_numeric();
+    l.backlog = backlog;
+}
+
+//! \param[in] local is the listening address passed to listen()
+//! \returns the 4-tuple of the next established connection, or an empty value if there is none
+optional<TCPFlow> TCPDemux::accept(const Address &local) {
+    const auto l = _listeners.find(local.port());
+    if (l == _listeners.end()) {
+        throw runtime_error("TCPDemux::accept: not listening on " + local.to_string());
+    }
+
+    auto &queue = l->second.accept_queue;
+    while (not queue.empty()) {
+        const TCPFlow flow = queue.front();
+        queue.pop_front();
+        // skip connections that were aborted while waiting in the queue
+        if (contains(flow)) {
+            return flow;
+        }
+    }
+    return {};
+}
+
+//! \param[in] local is the source address; port 0 selects an unused ephemeral port
+//! \param[in] remote is the peer to connect to
+//! \param[in] port_ok, if set, must return true for the 4-tuple with the chosen ephemeral port
+//! \returns the 4-tuple identifying the new connection
+TCPFlow TCPDemux::connect(const Address &local, const Address &remote, const function<bool(const TCPFlow &)> &port_ok) {
+    TCPFlow flow{local.ipv4_numeric(), local.port(), remote.ipv4_numeric(), remote.port()};
+    if (flow.local_address == 0) {
+        throw runtime_error("TCPDemux::connect: the local address must be specified");
+    }
+
+    if (flow.local_port == 0) {
+        // ephemeral port range from RFC 6335
+        uniform_int_distribution<uint16_t> port_dist{49152, 65535};
+        do {
+            flow.local_port = port_dist(_rand);
+        } while (contains(flow) or (port_ok and not port_ok(flow)));
+    } else if (contains(flow)) {
+        throw runtime_error("TCPDemux::connect: " + flow.to_string() + " is already in use");
+    }
+
+    Entry &entry = _emplace(flow, _cfg);
+    entry.conn.connect();
+    _collect(entry);
+    return flow;
+}
+
+TCPDemux::Entry &TCPDemux::_find(const TCPFlow &flow) {
+    const auto it = _connections.find(flow);
+    if (it == _connections.end()) {
+        throw out_of_range("TCPDemux: no connection " + flow.to_string());
+    }
+    return it->second;
+}
+
+TCPDemux::Entry &TCPDemux::_emplace(const TCPFlow &flow, const TCPConfig &cfg) {
+    return _connections.emplace(piecewise_construct, forward_as_tuple(flow), forward_as_tuple(cfg, flow))
+        .first->second;
+}
+
+const TCPConnection &TCPDemux::connection(const TCPFlow &flow) const {
+    const auto it = _connections.find(flow);
+    if (it == _connections.end()) {
+        throw out_of_range("TCPDemux: no connection " + flow.to_string());
+    }
+    return it->second.conn;
+}
+
+size_t TCPDemux::write(const TCPFlow &flow, const string &data) {
+    Entry &entry = _find(flow);
+    const size_t written = entry.conn.write(data);
+    _collect(entry);
+    return written;
+}
+
+string TCPDemux::read(const TCPFlow &flow, const size_t len) {
+    return _find(flow).conn.inbound_stream().read(len);
+}
+
+void TCPDemux::end_input_stream(const TCPFlow &flow) {
+    Entry &entry = _find(flow);
+    entry.conn.end_input_stream();
+    _collect(entry);
+}
+
+void TCPDemux::abort(const TCPFlow &flow) {
+    const auto it = _connections.find(flow);
+    if (it == _connections.end()) {
+        return;
+    }
+
+    Entry &entry = it->second;
+    if (entry.conn.active()) {
+        entry.conn.send_rst_segment();
+        entry.conn.unclean_shutdown();
+        _collect(entry);
+    }
+    _touch(flow);
+    _connections.erase(it);
+}
+
+//! \param[in] dgram is an IPv4 datagram read from the wire
+//! \details Datagrams that don't carry a valid TCP segment are silently ignored.
+void TCPDemux::datagram_received(const InternetDatagram &dgram) {
+    if (dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return;
+    }
+
+    TCPSegment seg;
+    if (ParseResult::NoError != seg.parse(dgram.payload(), dgram.header().pseudo_cksum())) {
+        return;
+    }
+
+    const TCPFlow flow{dgram.header().dst, seg.header().dport, dgram.header().src, seg.header().sport};
+
+    // an existing connection?
+    const auto it = _connections.find(flow);
+    if (it != _connections.end()) {
+        Entry &entry = it->second;
+        entry.conn.segment_received(seg);
+        _collect(entry);
+        _touch(flow);
+        return;
+    }
+
+    // a handshake with a listener?
+    const auto l = _listeners.find(flow.local_port);
+    if (l != _listeners.end() and (l->second.address == 0 or l->second.address == flow.local_address)) {
+        _listener_segment_received(l->second, flow, seg);
+        return;
+    }
+
+    if (not seg.header().rst) {
+        _send_rst(flow, seg);
+    }
+}
+
+//! \details A SYN is recorded in the half-open table if there is room, and otherwise answered with
+//! a cookie. An ACK completes the handshake if it acknowledges the SYN/ACK: the ISN comes from the
+//! half-open table or, failing that, must be a valid cookie.
+void TCPDemux::_listener_segment_received(Listener &listener, const TCPFlow &flow, const TCPSegment &seg) {
+    const auto half_open = _half_open.find(flow);
+    if (seg.header().rst) {
+        if (half_open != _half_open.end() and seg.header().seqno == half_open->second.peer_isn + 1) {
+            --listener.half_open;
+            _half_open.erase(half_open);
+        }
+        return;
+    }
+
+    if (seg.header().syn and not seg.header().ack) {
+        if (half_open != _half_open.end()) {
+            // the peer didn't get our SYN/ACK (or it's slow): answer again
+            _send_syn_ack(flow, half_open->second.isn, half_open->second.peer_isn);
+        } else if (not _admits(listener)) {
+            if (MemoryAccountant::under_pressure()) {
+                ++_refused;
+            }
+            return;
+        } else if (listener.half_open < listener.backlog) {
+            // a cookie makes a good ISN anyway: unpredictable, without another source of randomness
+            HalfOpen &entry = _half_open[flow];
+            entry.isn = _cookies.make(flow, seg.header().seqno, _now_us / 1000);
+            entry.peer_isn = seg.header().seqno;
+            entry.deadline_us = _now_us + _cfg.initial_rto_us();
+            ++listener.half_open;
+            _send_syn_ack(flow, entry.isn, entry.peer_isn);
+        } else {
+            _send_syn_ack(flow, _cookies.make(flow, seg.header().seqno, _now_us / 1000), seg.header().seqno);
+        }
+        return;
+    }
+
+    if (seg.header().ack and not seg.header().syn) {
+        const WrappingInt32 isn = seg.header().ackno - 1;
+        const WrappingInt32 peer_isn = seg.header().seqno - 1;
+        if (half_open != _half_open.end() and half_open->second.isn == isn and
+            half_open->second.peer_isn == peer_isn) {
+            if (_admits(listener)) {
+                --listener.half_open;
+                _half_open.erase(half_open);
+                _establish(listener, flow, isn, seg);
+            }
+            return;
+        }
+        if (half_open == _half_open.end() and _cookies.check(flow, peer_isn, isn, _now_us / 1000)) {
+            if (_admits(listener)) {
+                _establish(listener, flow, isn, seg);
+            }
+            return;
+        }
+    }
+
+    _send_rst(flow, seg);
+}
+
+bool TCPDemux::_admits(const Listener &listener) const {
+    return listener.accept_queue.size() < listener.backlog and not MemoryAccountant::under_pressure();
+}
+
+void TCPDemux::_send_syn_ack(const TCPFlow &flow, const WrappingInt32 isn, const WrappingInt32 peer_isn) {
+    TCPSegment syn_ack;
+    syn_ack.header().syn = true;
+    syn_ack.header().seqno = isn;
+    syn_ack.header().ack = true;
+    syn_ack.header().ackno = peer_isn + 1;
+    syn_ack.header().win = min(_cfg.recv_capacity, size_t{numeric_limits<uint16_t>::max()});
+    _send(TCPHeaderTemplate{flow}, syn_ack);
+}
+
+//! \details The new TCPConnection is given the peer's SYN (whose SYN/ACK reply is discarded,
+//! since ours has already been sent) and then `ack`, which takes it to ESTABLISHED.
+void TCPDemux::_establish(Listener &listener, const TCPFlow &flow, const WrappingInt32 isn, const TCPSegment &ack) {
+    TCPConfig cfg = _cfg;
+    cfg.fixed_isn = isn;
+    Entry &entry = _emplace(flow, cfg);
+
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = ack.header().seqno - 1;
+    syn.header().win = ack.header().win;
+    entry.conn.segment_received(syn);
+    entry.conn.segments_out() = {};
+
+    entry.conn.segment_received(ack);
+    _collect(entry);
+    listener.accept_queue.push_back(flow);
+    _touch(flow);
+}
+
+//! \param[in] ms_since_last_tick is the number of milliseconds since the last call to this method
+void TCPDemux::tick(const size_t ms_since_last_tick) { tick_us(uint64_t{ms_since_last_tick} * 1000); }
+
+//! \param[in] us_since_last_tick is the number of microseconds since the last call to this method
+void TCPDemux::tick_us(const uint64_t us_since_last_tick) {
+    _now_us += us_since_last_tick;
+
+    // retransmit SYN/ACKs with exponential backoff, and give up on peers that never answer
+    for (auto it = _half_open.begin(); it != _half_open.end();) {
+        HalfOpen &entry = it->second;
+        if (entry.deadline_us > _now_us) {
+            ++it;
+            continue;
+        }
+        if (entry.retransmissions == MAX_SYN_ACK_RETX) {
+            --_listeners.at(it->first.local_port).half_open;
+            it = _half_open.erase(it);
+            continue;
+        }
+        ++entry.retransmissions;
+        entry.deadline_us = _now_us + (_cfg.initial_rto_us() << entry.retransmissions);
+        _send_syn_ack(it->first, entry.isn, entry.peer_isn);
+        ++it;
+    }
+
+    for (auto it = _connections.begin(); it != _connections.end();) {
+        Entry &entry = it->second;
+
+        const bool active = entry.conn.active();
+        const size_t capacity = entry.conn.remaining_outbound_capacity();
+        entry.conn.tick_us(us_since_last_tick);
+        _collect(entry);
+        if (entry.conn.active() != active or entry.conn.remaining_outbound_capacity() != capacity) {
+            _touch(it->first);
+        }
+
+        ByteStream &inbound = entry.conn.inbound_stream();
+        if (not entry.conn.active() and (inbound.buffer_empty() or inbound.error())) {
+            _touch(it->first);
+            it = _connections.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+
+    _relieve_pressure();
+}
+
+//! \details Storage that drained streams kept for their next burst goes first, since giving it
+//! back loses nothing. Then only connections holding out-of-order data are candidates; the one
+//! with the largest memory_usage() goes first, so the few connections responsible for the
+//! pressure pay for it.
+void TCPDemux::_relieve_pressure() {
+    if (not MemoryAccountant::under_pressure()) {
+        return;
+    }
+
+    for (auto &connection : _connections) {
+        connection.second.conn.release_idle_storage();
+    }
+    if (not MemoryAccountant::under_pressure()) {
+        return;
+    }
+
+    vector<pair<size_t, TCPConnection *>> holders;
+    for (auto &connection : _connections) {
+        TCPConnection &conn = connection.second.conn;
+        if (conn.unassembled_bytes() > 0) {
+            holders.emplace_back(conn.memory_usage(), &conn);
+        }
+    }
+    sort(holders.begin(), holders.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    for (const auto &holder : holders) {
+        if (not MemoryAccountant::under_pressure()) {
+            break;
+        }
+        holder.second->drop_unassembled();
+    }
+}
+
+//! \returns the time until the earliest timer of any connection expires, or nothing if no timer is running
+optional<uint64_t> TCPDemux::time_until_next_timeout_us() const {
+    optional<uint64_t> next;
+    for (const auto &half_open : _half_open) {
+        const uint64_t until = half_open.second.deadline_us - _now_us;
+        if (not next.has_value() or until < next.value()) {
+            next = until;
+        }
+    }
+    for (const auto &connection : _connections) {
+        const auto conn_next = connection.second.conn.time_until_next_timeout_us();
+        if (conn_next.has_value() and (not next.has_value() or conn_next.value() < next.value())) {
+            next = conn_next;
+        }
+    }
+    return next;
+}
+
+int64_t TCPDemux::wait_timeout_us(const int64_t limit_us, const uint64_t us_since_last_tick) const {
+    const auto next = time_until_next_timeout_us();
+    if (not next.has_value()) {
+        return limit_us;
+    }
+    const auto until_deadline = int64_t(next.value() > us_since_last_tick ? next.value() - us_since_last_tick : 0);
+    return limit_us < 0 ? until_deadline : min(limit_us, until_deadline);
+}
+
+void TCPDemux::_collect(Entry &entry) {
+    auto &segments = entry.conn.segments_out();
+    while (not segments.empty()) {
+        _send(entry.headers, segments.front());
+        segments.pop();
+    }
+}
+
+void TCPDemux::_send(const TCPHeaderTemplate &headers, const TCPSegment &seg) {
+    _datagrams_out.push(headers.serialize(seg));
+}
+
+//! \details Follows the reset generation rules of [RFC 793](\ref rfc::rfc793), section 3.4:
+//! if the offending segment has an ACK, the RST takes its sequence number from that ACK;
+//! otherwise the RST has sequence number zero and acknowledges the offending segment.
+void TCPDemux::_send_rst(const TCPFlow &flow, const TCPSegment &seg) {
+    TCPSegment rst;
+    rst.header().rst = true;
+    if (seg.header().ack) {
+        rst.header().seqno = seg.header().ackno;
+    } else {
+        rst.header().ack = true;
+        rst.header().ackno = seg.header().seqno + seg.length_in_sequence_space();
+    }
+    _send(TCPHeaderTemplate{flow}, rst);
+}
@@ -0,0 +1,243 @@
+#ifndef SPONGE_LIBSPONGE_TCP_DEMUX_HH
+#define SPONGE_LIBSPONGE_TCP_DEMUX_HH
+
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "syn_cookies.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_flow.hh"
+#include "tcp_header_template.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! \brief Many TCPConnections sharing one stream of IPv4 datagrams
+//! \details Incoming datagrams are demultiplexed to their TCPConnection by a hash table keyed
+//! on the TCPFlow 4-tuple; outgoing segments from every connection are wrapped in IPv4 datagrams
+//! and queued in a single outbound queue. Like TCPConnection, this class does no I/O of its own:
+//! its owner feeds it with datagram_received() and tick(), and drains datagrams_out().
+class TCPDemux {
+  public:
+    static constexpr size_t DEFAULT_BACKLOG = 128;   //!< Default limit on half-open, and on unaccepted, connections
+    static constexpr unsigned MAX_SYN_ACK_RETX = 5;  //!< Retransmissions of a SYN/ACK before giving up on the peer
+
+  private:
+    //! A connection in the demultiplexing table
+    struct Entry {
+        TCPConnection conn;         //!< The connection itself
+        TCPHeaderTemplate headers;  //!< Prebuilt headers for the connection's outgoing segments
+
+        //! Constructed in place, since a moved-from TCPConnection would complain when destroyed
+        Entry(const TCPConfig &cfg, const TCPFlow &flow) : conn(cfg), headers(flow) {}
+    };
+
+    //! A handshake in progress: all that is kept until the peer's ACK arrives
+    struct HalfOpen {
+        WrappingInt32 isn{0};          //!< Our ISN, sent in the SYN/ACK
+        WrappingInt32 peer_isn{0};     //!< The peer's ISN, from its SYN
+        uint64_t deadline_us = 0;      //!< When the SYN/ACK is next retransmitted
+        unsigned retransmissions = 0;  //!< SYN/ACK retransmissions so far
+    };
+
+    //! A listening port and its accept queue
+    struct Listener {
+        uint32_t address = 0;                //!< Local address to accept on (0 accepts on any address)
+        size_t backlog = DEFAULT_BACKLOG;    //!< Limit on half_open, and on accept_queue.size()
+        size_t half_open = 0;                //!< Handshakes in progress (in the half-open table)
+        std::deque<TCPFlow> accept_queue{};  //!< Established connections not yet returned by accept()
+    };
+
+    TCPConfig _cfg;
+
+    //! All connections, keyed by 4-tuple
+    std::unordered_map<TCPFlow, Entry, TCPFlowHash> _connections{};
+
+    //! Listeners, keyed by local port
+    std::unordered_map<uint16_t, Listener> _listeners{};
+
+    //! Handshakes in progress with a listener, keyed by 4-tuple
+    std::unordered_map<TCPFlow, HalfOpen, TCPFlowHash> _half_open{};
+
+    //! Answers SYNs that don't fit in the half-open table
+    SynCookies _cookies{};
+
+    //! Time since construction, as of the last tick
+    uint64_t _now_us = 0;
+
+    //! SYNs dropped because of memory pressure
+    uint64_t _refused = 0;
+
+    //! Flows touched since the last take_touched(), if tracking is on (see track_touched())
+    std::vector<TCPFlow> _touched{};
+    bool _tracking = false;
+
+    //! Record that the connection for `flow` may have changed in a way its owner cares about
+    void _touch(const TCPFlow &flow) {
+        if (_tracking) {
+            _touched.push_back(flow);
+        }
+    }
+
+    //! Outbound queue of (serialized) datagrams from all connections
+    std::queue<BufferList> _datagrams_out{};
+
+    //! Used to pick ephemeral ports in connect()
+    std::mt19937 _rand;
+
+    //! Wrap a segment in an IPv4 datagram with `headers` and queue it for transmission
+    void _send(const TCPHeaderTemplate &headers, const TCPSegment &seg);
+
+    //! Move every segment queued by a connection to the outbound datagram queue
+    void _collect(Entry &entry);
+
+    //! Answer a segment that matches neither a connection nor a listener
+    void _send_rst(const TCPFlow &flow, const TCPSegment &seg);
+
+    //! Send the SYN/ACK of a handshake with a listener
+    void _send_syn_ack(const TCPFlow &flow, const WrappingInt32 isn, const WrappingInt32 peer_isn);
+
+    //! Handle a segment to a listener, for which there is no connection yet
+    void _listener_segment_received(Listener &listener, const TCPFlow &flow, const TCPSegment &seg);
+
+    //! Whether a listener may take on another connection: its accept queue has room, and memory isn't short
+    bool _admits(const Listener &listener) const;
+
+    //! Under memory pressure, release drained streams' storage, then drop out-of-order data,
+    //! largest consumers first, until the pressure is gone
+    void _relieve_pressure();
+
+    //! Create the connection for a completed handshake, and add it to the accept queue
+    void _establish(Listener &listener, const TCPFlow &flow, const WrappingInt32 isn, const TCPSegment &ack);
+
+    //! Look up a connection, throwing std::out_of_range if there is none
+    Entry &_find(const TCPFlow &flow);
+
+    //! Add a new connection to the table
+    Entry &_emplace(const TCPFlow &flow, const TCPConfig &cfg);
+
+  public:
+    //! Construct with the configuration shared by every connection
+    explicit TCPDemux(const TCPConfig &cfg = {});
+
+    //! \name Socket-like interface for the owner
+    //!@{
+
+    //! Accept connections to `local` (address "0" accepts on any local address)
+    void listen(const Address &local, const size_t backlog = DEFAULT_BACKLOG);
+
+    //! Pop the next established connection to the listening port of `local`, if any
+    std::optional<TCPFlow> accept(const Address &local);
+
+    //! Open a connection from `local` (port 0 picks an ephemeral port) to `remote`
+    //! \param port_ok, if given, restricts the choice of ephemeral port to 4-tuples it accepts
+    TCPFlow connect(const Address &local,
+                    const Address &remote,
+                    const std::function<bool(const TCPFlow &)> &port_ok = {});
+
+    //! Write to the outbound stream of a connection; returns the number of bytes accepted
+    size_t write(const TCPFlow &flow, const std::string &data);
+
+    //! Read up to `len` bytes from the inbound stream of a connection
+    std::string read(const TCPFlow &flow, const size_t len);
+
+    //! Close the outbound stream of a connection
+    void end_input_stream(const TCPFlow &flow);
+
+    //! Reset a connection (if still active) and remove it from the table
+    void abort(const TCPFlow &flow);
+    //!@}
+
+    //! \name Accessors
+    //!@{
+
+    //! Is there a connection for this 4-tuple?
+    bool contains(const TCPFlow &flow) const { return _connections.count(flow) != 0; }
+
+    //! The connection for a 4-tuple (throws std::out_of_range if there is none)
+    const TCPConnection &connection(const TCPFlow &flow) const;
+
+    //! Number of connections in the table
+    size_t size() const { return _connections.size(); }
+
+    //! Number of handshakes in progress with listeners (which have no connection yet)
+    size_t half_open() const { return _half_open.size(); }
+
+    //! Number of SYNs dropped because of memory pressure
+    uint64_t refused() const { return _refused; }
+    //!@}
+
+    //! \name Change tracking, for owners that wait on many connections
+    //!@{
+
+    //! Start (or stop) recording which flows are touched
+    void track_touched(const bool on) {
+        _tracking = on;
+        _touched.clear();
+    }
+
+    //! The flows touched since the last call (possibly repeated): a connection received a segment,
+    //! was established or aborted, or on a tick became inactive, gained outbound capacity, or was reaped
+    std::vector<TCPFlow> take_touched() { return std::exchange(_touched, {}); }
+    //!@}
+
+    //! \name Methods for the owner or operating system
+    //!@{
+
+    //! Demultiplex an incoming datagram to its connection (or listener)
+    void datagram_received(const InternetDatagram &dgram);
+
+    //! Called periodically when time elapses; also reaps connections that have finished,
+    //! and relieves memory pressure
+    void tick(const size_t ms_since_last_tick);
+
+    //! Like tick(), with the elapsed time in microseconds
+    void tick_us(const uint64_t us_since_last_tick);
+
+    //! Microseconds until the next connection timer expires, as of the last tick
+    std::optional<uint64_t> time_until_next_timeout_us() const;
+
+    //! How long the owner may wait for datagrams before it has to tick() again
+    //! \param limit_us is the longest wait the owner wants, in microseconds (negative for no limit)
+    //! \param us_since_last_tick is the time that has passed since the last tick
+    //! \returns a timeout in microseconds for EventLoop::wait_next_event_us (negative for no limit)
+    int64_t wait_timeout_us(const int64_t limit_us, const uint64_t us_since_last_tick) const;
+
+    //! Serialized datagrams queued for transmission, from all connections
+    std::queue<BufferList> &datagrams_out() { return _datagrams_out; }
+    //!@}
+};
+
+//! \class TCPDemux
+//! A connection is removed from the table once it is no longer active and the owner has
+//! read everything in its inbound stream (or the connection was reset), or when the owner
+//! calls abort().
+//!
+//! A SYN to a listening port is answered with a SYN/ACK, and recorded in a compact half-open
+//! table: no TCPConnection (nor its buffers) exists until the peer's ACK completes the handshake,
+//! at which point the connection joins the listener's accept queue. Unanswered SYN/ACKs are
+//! retransmitted up to MAX_SYN_ACK_RETX times.
+//!
+//! Once the listener has `backlog` handshakes in progress, further SYNs are answered statelessly,
+//! with a SynCookies ISN that the ACK must echo, so a SYN flood can't use up memory or lock out
+//! real peers. While the accept queue holds `backlog` connections, new SYNs and completing ACKs
+//! are dropped (and will be retransmitted by the peer), as Linux does.
+//!
+//! The same goes while the MemoryAccountant is under pressure, so that many stalled connections
+//! can't push memory use up further by being joined by more. Each tick under pressure also makes
+//! every connection give back the storage its drained streams keep, and then drops the
+//! out-of-order data of the connections using the most memory, one at a time, until usage is
+//! back under the limit: those bytes were never acknowledged, so the peers will send them again.
+//! (Each connection also shrinks its receive window under pressure; see TCPReceiver::tick_us.)
+//! Segments matching neither a connection nor a listener are answered with a RST.
+
+#endif  // SPONGE_LIBSPONGE_TCP_DEMUX_HH
@@ -0,0 +1,52 @@
+#ifndef SPONGE_LIBSPONGE_TCP_FLOW_HH
+#define SPONGE_LIBSPONGE_TCP_FLOW_HH
+
+#include <arpa/inet.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//! \brief The 4-tuple that identifies one TCP connection, as seen from the local endpoint
+//! \details Addresses and ports are in host byte order, like IPv4Header::src and TCPHeader::sport.
+struct TCPFlow {
+    uint32_t local_address = 0;   //!< Our IPv4 address
+    uint16_t local_port = 0;      //!< Our TCP port
+    uint32_t remote_address = 0;  //!< The peer's IPv4 address
+    uint16_t remote_port = 0;     //!< The peer's TCP port
+
+    //! The same flow seen from the other endpoint
+    TCPFlow reversed() const { return {remote_address, remote_port, local_address, local_port}; }
+
+    bool operator==(const TCPFlow &other) const {
+        return local_address == other.local_address and local_port == other.local_port and
+               remote_address == other.remote_address and remote_port == other.remote_port;
+    }
+
+    bool operator!=(const TCPFlow &other) const { return not operator==(other); }
+
+    //! Human-readable string, e.g., "169.254.144.9:1234 <-> 10.0.0.1:80"
+    std::string to_string() const {
+        return std::string(inet_ntoa({htobe32(local_address)})) + ":" + std::to_string(local_port) + " <-> " +
+               inet_ntoa({htobe32(remote_address)}) + ":" + std::to_string(remote_port);
+    }
+};
+
+//! \brief Hash functor for TCPFlow, for use as the key of a std::unordered_map
+//! \details Packs the 96 bits of the 4-tuple into two words and mixes them with the
+//! [splitmix64](http://xoshiro.di.unimi.it/splitmix64.c) finalizer, so that flows differing
+//! only in the (low-entropy) port numbers still land in different buckets.
+struct TCPFlowHash {
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    size_t operator()(const TCPFlow &flow) const {
+        const uint64_t addrs = (uint64_t(flow.local_address) << 32) | flow.remote_address;
+        const uint64_t ports = (uint64_t(flow.local_port) << 16) | flow.remote_port;
+        return mix(addrs ^ mix(ports));
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_FLOW_HH
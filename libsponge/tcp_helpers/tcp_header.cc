@@ -1,5 +1,6 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -49,32 +50,37 @@ ParseResult TCPHeader::parse(NetParser &p) {
 
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
+    string ret(4 * doff, 0);
+    serialize(ret.data());
+    return ret;
+}
+
+void TCPHeader::serialize(char *out) const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
+    char *const end = out + 4 * doff;
 
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    NetUnparser::u16(out, sport);              // source port
+    NetUnparser::u16(out, dport);              // destination port
+    NetUnparser::u32(out, seqno.raw_value());  // sequence number
+    NetUnparser::u32(out, ackno.raw_value());  // ack number
+    NetUnparser::u8(out, doff << 4);           // data offset
+    NetUnparser::u8(out, flags());             // flags
+    NetUnparser::u16(out, win);  // window size
 
-    const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
-                         (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
+    NetUnparser::u16(out, cksum);  // checksum
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u16(out, uptr);  // urgent pointer
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
-
-    ret.resize(4 * doff);  // expand header to advertised size
+    fill(out, end, 0);  // expand header to advertised size
+}
 
-    return ret;
+uint8_t TCPHeader::flags() const {
+    return (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) | (rst ? 0b0000'0100 : 0) |
+           (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
 }
 
 //! \returns A string with the header's contents
@@ -56,6 +56,12 @@ struct TCPHeader {
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! Serialize the TCP fields into the `4 * doff` bytes at `out`
+    void serialize(char *out) const;
+
+    //! The byte holding the URG, ACK, PSH, RST, SYN and FIN flags, as it appears on the wire
+    uint8_t flags() const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
@@ -0,0 +1,81 @@
+#include "tcp_header_template.hh"
+
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "util.hh"
+
+#include <cstring>
+
+using namespace std;
+
+//! \param[in] flow the connection's 4-tuple, as seen from the sender
+TCPHeaderTemplate::TCPHeaderTemplate(const TCPFlow &flow) : _flow(flow) {
+    IPv4Header ip;
+    ip.src = flow.local_address;
+    ip.dst = flow.remote_address;
+    ip.serialize(_headers.data());
+
+    TCPHeader tcp;
+    tcp.sport = flow.local_port;
+    tcp.dport = flow.remote_port;
+    tcp.serialize(_headers.data() + IPv4Header::LENGTH);
+
+    // len, cksum, seqno, ackno, flags, win and uptr are still zero, so they add nothing; the data offset
+    // shares a word with the flags, so serialize() adds it back in with them
+    for (size_t i = 0; i < LENGTH; i += 2) {
+        const uint32_t word = uint8_t(_headers[i]) << 8 | uint8_t(_headers[i + 1]);
+        (i < IPv4Header::LENGTH ? _ip_sum : _tcp_sum) += word;
+    }
+    _tcp_sum -= TCPHeader::LENGTH / 4 << 12;
+    _tcp_sum += (ip.src >> 16) + (ip.src & 0xffff) + (ip.dst >> 16) + (ip.dst & 0xffff) + ip.proto;
+}
+
+//! \param[in] seg the segment to serialize; its header's doff, ports and cksum are ignored
+//! \details The payload is referenced, not copied. Segments with TCP options (doff > 5) don't fit the
+//! template, and take the general path.
+BufferList TCPHeaderTemplate::serialize(const TCPSegment &seg) const {
+    const TCPHeader &tcp = seg.header();
+    const uint16_t tcp_length = TCPHeader::LENGTH + seg.payload().size();
+    const uint16_t ip_length = IPv4Header::LENGTH + tcp_length;
+
+    if (tcp.doff != TCPHeader::LENGTH / 4) {
+        InternetDatagram dgram;
+        dgram.header().src = _flow.local_address;
+        dgram.header().dst = _flow.remote_address;
+        dgram.header().len = dgram.header().hlen * 4 + tcp.doff * 4 + seg.payload().size();
+
+        TCPSegment copy = seg;
+        copy.header().sport = _flow.local_port;
+        copy.header().dport = _flow.remote_port;
+        dgram.payload() = copy.serialize(dgram.header().pseudo_cksum());
+        return dgram.serialize();
+    }
+
+    Buffer headers = Buffer::make(LENGTH, [&](char *data) {
+        memcpy(data, _headers.data(), LENGTH);
+
+        char *out = data + 2;
+        NetUnparser::u16(out, ip_length);
+        out = data + 10;
+        NetUnparser::u16(out, InternetChecksum(_ip_sum + ip_length).value());
+
+        const uint32_t seqno = tcp.seqno.raw_value();
+        const uint32_t ackno = tcp.ackno.raw_value();
+        const uint16_t offset_and_flags = uint16_t(TCPHeader::LENGTH / 4 << 12 | tcp.flags());
+        InternetChecksum check(_tcp_sum + tcp_length + (seqno >> 16) + (seqno & 0xffff) + (ackno >> 16) +
+                               (ackno & 0xffff) + offset_and_flags + tcp.win + tcp.uptr);
+        check.add(seg.payload());
+
+        out = data + IPv4Header::LENGTH + 4;
+        NetUnparser::u32(out, seqno);
+        NetUnparser::u32(out, ackno);
+        NetUnparser::u16(out, offset_and_flags);
+        NetUnparser::u16(out, tcp.win);
+        NetUnparser::u16(out, check.value());
+        NetUnparser::u16(out, tcp.uptr);
+    });
+
+    BufferList ret{std::move(headers)};
+    ret.append(seg.payload());
+    return ret;
+}
@@ -0,0 +1,46 @@
+#ifndef SPONGE_LIBSPONGE_TCP_HEADER_TEMPLATE_HH
+#define SPONGE_LIBSPONGE_TCP_HEADER_TEMPLATE_HH
+
+#include "buffer.hh"
+#include "ipv4_header.hh"
+#include "tcp_flow.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+
+#include <array>
+#include <cstdint>
+
+//! \brief Prebuilt IPv4 and TCP headers for the segments of one TCPFlow
+//! \details Most header fields never change over a connection: the addresses, the ports, the
+//! protocol, the TTL and the flags. They are written once, along with their contribution to both
+//! checksums. serialize() copies the 40 bytes, stores the fields that do change (the lengths,
+//! seqno, ackno, TCP flags, window and urgent pointer) and completes each checksum by adding just
+//! those fields (and, for TCP, the payload) to the precomputed sum, as in
+//! [RFC 1624](https://tools.ietf.org/html/rfc1624). No IPv4Header, IPv4Datagram or pseudo-header
+//! is built, and the IPv4 header is never summed.
+class TCPHeaderTemplate {
+  public:
+    //! Length of the prebuilt headers
+    static constexpr size_t LENGTH = IPv4Header::LENGTH + TCPHeader::LENGTH;
+
+  private:
+    TCPFlow _flow{};
+    std::array<char, LENGTH> _headers{};
+    uint32_t _ip_sum = 0;   //!< Sum of the 16-bit words of the IPv4 header that never change
+    uint32_t _tcp_sum = 0;  //!< Same, for the TCP header and the pseudo-header
+
+  public:
+    //! An empty template, which must be replaced before use
+    TCPHeaderTemplate() = default;
+
+    //! Build the headers for segments sent from `flow.local_*` to `flow.remote_*`
+    explicit TCPHeaderTemplate(const TCPFlow &flow);
+
+    //! The flow whose headers these are
+    const TCPFlow &flow() const { return _flow; }
+
+    //! Serialize `seg` (whose ports are ignored) into a complete IPv4 datagram
+    BufferList serialize(const TCPSegment &seg) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_HEADER_TEMPLATE_HH
@@ -18,12 +18,25 @@ using namespace std;
 //! current connection. When a TCP connection has been established, this means
 //! checking that the source and destination ports in the TCP header are correct.
 //!
+//! Fragments are handed to an IPv4Reassembler, and the datagram is unwrapped once it is whole.
+//!
 //! If the TCP connection is listening (i.e., TCPOverIPv4OverTunFdAdapter::_listen is `true`)
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and records the source and destination addresses and port numbers
 //! from the TCP header; it uses this information to filter future reads.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram) {
+    // a fragment? hold on to it until the rest arrive
+    if (ip_dgram.header().mf or ip_dgram.header().offset != 0) {
+        optional<InternetDatagram> whole = _reassembler.push(ip_dgram);
+        if (not whole.has_value()) {
+            return {};
+        }
+        // the segment parser wants its bytes in one piece
+        whole->payload() = whole->payload().concatenate();
+        return unwrap_tcp_in_ip(whole.value());
+    }
+
     // is the IPv4 datagram for us?
     // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
     if (not listening() and (ip_dgram.header().dst != config().source.ipv4_numeric())) {
@@ -88,3 +101,92 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
 
     return ip_dgram;
 }
+
+//! \param[in] seg is the TCP segment to convert
+//! \details Sets the segment's port numbers, as wrap_tcp_in_ip() does.
+BufferList TCPOverIPv4Adapter::serialize_tcp_in_ip(TCPSegment &seg) {
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+
+    const TCPFlow flow{config().source.ipv4_numeric(),
+                       seg.header().sport,
+                       config().destination.ipv4_numeric(),
+                       seg.header().dport};
+    if (flow != _headers.flow()) {
+        _headers = TCPHeaderTemplate{flow};
+    }
+    return _headers.serialize(seg);
+}
+
+//! \param[in] us_since_last_tick the number of microseconds since the last call to this method
+void TCPOverIPv4Adapter::tick_us(const uint64_t us_since_last_tick) {
+    // the reassembler keeps time in milliseconds; carry the remainder over to the next tick
+    _leftover_us += us_since_last_tick;
+    if (_leftover_us >= 1000) {
+        _reassembler.tick(_leftover_us / 1000);
+        _leftover_us %= 1000;
+    }
+}
+
+//! \details Works as TCPOverIPv4Adapter::unwrap_tcp_in_ip() does, with IPv6 addresses.
+//! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
+optional<TCPSegment> TCPOverIPv6Adapter::unwrap_tcp_in_ip(const IPv6Datagram &ip_dgram) {
+    // is the IPv6 datagram for us, and from our peer?
+    if (not listening() and (ip_dgram.header().dst != config().source.ipv6_numeric() or
+                             ip_dgram.header().src != config().destination.ipv6_numeric())) {
+        return {};
+    }
+
+    // is the payload (immediately) a TCP segment?
+    if (ip_dgram.header().next_header != IPv6Header::PROTO_TCP) {
+        return {};
+    }
+
+    // is the payload a valid TCP segment?
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+        return {};
+    }
+
+    // is the TCP segment for us?
+    if (tcp_seg.header().dport != config().source.port()) {
+        return {};
+    }
+
+    // should we target this source addr/port (and use its destination addr as our source) in reply?
+    if (listening()) {
+        if (tcp_seg.header().syn and not tcp_seg.header().rst) {
+            config_mutable().source = Address::from_ipv6_numeric(ip_dgram.header().dst, config().source.port());
+            config_mutable().destination = Address::from_ipv6_numeric(ip_dgram.header().src, tcp_seg.header().sport);
+            set_listening(false);
+        } else {
+            return {};
+        }
+    }
+
+    // is the TCP segment from our peer?
+    if (tcp_seg.header().sport != config().destination.port()) {
+        return {};
+    }
+
+    return tcp_seg;
+}
+
+//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv6 datagram
+//! \param[in] seg is the TCP segment to convert
+IPv6Datagram TCPOverIPv6Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    // set the port numbers in the TCP segment
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+
+    // create an IPv6 datagram and set its addresses and length
+    IPv6Datagram ip_dgram;
+    ip_dgram.header().src = config().source.ipv6_numeric();
+    ip_dgram.header().dst = config().destination.ipv6_numeric();
+    ip_dgram.header().payload_len = seg.header().doff * 4 + seg.payload().size();
+
+    // set payload, calculating TCP checksum using information from IP header
+    ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
+
+    return ip_dgram;
+}
@@ -4,16 +4,68 @@
 #include "buffer.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "ipv4_reassembler.hh"
+#include "ipv6_datagram.hh"
+#include "tcp_header_template.hh"
 #include "tcp_segment.hh"
 
+#include <cstdint>
 #include <optional>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    //! Headers for the current connection, rebuilt whenever the configured addresses change
+    TCPHeaderTemplate _headers{};
+
+    //! Puts incoming fragments back together
+    IPv4Reassembler _reassembler{};
+    uint64_t _leftover_us = 0;  //!< Time passed to tick_us() that hasn't added up to a millisecond yet
+
+    //! Identification for the next datagram that has to be fragmented
+    uint16_t _next_fragmented_id = 0;
+
   public:
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! Like wrap_tcp_in_ip(), but goes straight to the serialized datagram using cached headers
+    BufferList serialize_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief Serialize a segment as serialize_tcp_in_ip() does, and hand the datagram to `write_datagram`
+    //! \details If the datagram is bigger than config().mtu, it is split into fragments, and
+    //!          `write_datagram` is called with each one.
+    template <typename WriteDatagram>
+    void write_tcp_in_ip(TCPSegment &seg, WriteDatagram &&write_datagram) {
+        const size_t mtu = config().mtu;
+        if (mtu == 0 or IPv4Header::LENGTH + 4 * seg.header().doff + seg.payload().size() <= mtu) {
+            write_datagram(serialize_tcp_in_ip(seg));
+            return;
+        }
+
+        InternetDatagram ip_dgram = wrap_tcp_in_ip(seg);
+        ip_dgram.header().id = _next_fragmented_id++;
+        for (const InternetDatagram &fragment : ip_dgram.fragment(mtu)) {
+            write_datagram(fragment.serialize());
+        }
+    }
+
+    //! Advances the reassembly timers
+    void tick_us(const uint64_t us_since_last_tick);
+
+    //! Access the reassembler for incoming fragments
+    const IPv4Reassembler &reassembler() const { return _reassembler; }
+};
+
+//! \brief A converter from TCP segments to serialized IPv6 datagrams
+//! \details Extension headers aren't supported, so datagrams that carry any are dropped (and IPv6
+//!          routers never fragment, so there is nothing to reassemble).
+class TCPOverIPv6Adapter : public FdAdapterBase {
+  public:
+    std::optional<TCPSegment> unwrap_tcp_in_ip(const IPv6Datagram &ip_dgram);
+
+    IPv6Datagram wrap_tcp_in_ip(TCPSegment &seg);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
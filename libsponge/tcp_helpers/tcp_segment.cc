@@ -27,18 +27,25 @@ size_t TCPSegment::length_in_sequence_space() const {
 }
 
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+//! \details The header is written once, straight into pooled storage, and the payload is
+//! referenced rather than copied, so the result can go to the kernel in one gathered write.
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
 
-    // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
+    const size_t header_size = 4 * header_out.doff;
+    Buffer header = Buffer::make(header_size, [&](char *data) {
+        header_out.serialize(data);
+
+        // calculate checksum -- taken over entire segment -- and write it into place
+        InternetChecksum check(datagram_layer_checksum);
+        check.add({data, header_size});
+        check.add(_payload);
+        char *cksum_field = data + 16;
+        NetUnparser::u16(cksum_field, check.value());
+    });
 
-    BufferList ret;
-    ret.append(header_out.serialize());
+    BufferList ret{std::move(header)};
     ret.append(_payload);
 
     return ret;
@@ -2,9 +2,11 @@
 #define SPONGE_LIBSPONGE_TCP_SEGMENT_HH
 
 #include "buffer.hh"
+#include "ring_buffer.hh"
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <queue>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 //! 定义报文段
@@ -40,4 +42,8 @@ class TCPSegment {
     size_t length_in_sequence_space() const;
 };
 
+//! \brief A queue of segments that stops allocating once it has grown to its working size
+//! 报文段队列：环形缓冲区实现，稳定传输时不再分配内存
+using TCPSegmentQueue = std::queue<TCPSegment, RingBuffer<TCPSegment>>;
+
 #endif  // SPONGE_LIBSPONGE_TCP_SEGMENT_HH
@@ -0,0 +1,231 @@
+#include "tcp_sharded_stack.hh"
+
+#include "parser.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+//! Longest wait of a worker while none of its timers is running, so its callback still runs now and then
+static constexpr int64_t IDLE_TIMEOUT_US = 100000;
+
+//! \brief Toeplitz key whose 16-bit period makes the hash symmetric
+//! \details See Woo and Park, "Scalable TCP Session Monitoring with Symmetric Receive-side Scaling" (2012).
+static constexpr array<uint8_t, 16> RSS_KEY{
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a};
+
+//! \details The input is laid out as for TCP/IPv4 RSS on a NIC: source address, destination
+//! address, source port, destination port, all in network byte order.
+uint32_t TCPShardedStack::rss_hash(const TCPFlow &flow) {
+    const array<uint8_t, 12> input{uint8_t(flow.local_address >> 24),
+                                   uint8_t(flow.local_address >> 16),
+                                   uint8_t(flow.local_address >> 8),
+                                   uint8_t(flow.local_address),
+                                   uint8_t(flow.remote_address >> 24),
+                                   uint8_t(flow.remote_address >> 16),
+                                   uint8_t(flow.remote_address >> 8),
+                                   uint8_t(flow.remote_address),
+                                   uint8_t(flow.local_port >> 8),
+                                   uint8_t(flow.local_port),
+                                   uint8_t(flow.remote_port >> 8),
+                                   uint8_t(flow.remote_port)};
+
+    // the 32-bit window of the key starting at the current input bit
+    uint32_t window = (uint32_t(RSS_KEY[0]) << 24) | (uint32_t(RSS_KEY[1]) << 16) | (uint32_t(RSS_KEY[2]) << 8) |
+                      uint32_t(RSS_KEY[3]);
+    uint32_t hash = 0;
+    for (size_t i = 0; i < input.size(); ++i) {
+        const uint8_t next_key_byte = RSS_KEY[(i + 4) % RSS_KEY.size()];
+        for (int bit = 7; bit >= 0; --bit) {
+            if (input[i] & (1 << bit)) {
+                hash ^= window;
+            }
+            window = (window << 1) | ((next_key_byte >> bit) & 1);
+        }
+    }
+    return hash;
+}
+
+//! \param[in] index is the position of this worker
+//! \param[in] n_workers is the total number of workers
+//! \param[in] device is this worker's descriptor for the shared device
+//! \param[in] cfg is the TCPConfig given to every new TCPConnection
+TCPShardedStack::Worker::Worker(const size_t index,
+                                const size_t n_workers,
+                                FileDescriptor &&device,
+                                const TCPConfig &cfg)
+    : _index(index)
+    , _n_workers(n_workers)
+    , _device(move(device))
+    , _demux(cfg) {
+    // rule 1: take the datagrams steered here by the dispatcher
+    _eventloop.add_rule(_wakeup, Direction::In, [&] {
+        _wakeup.drain();
+        {
+            lock_guard<mutex> lock(_inbound_mutex);
+            swap(_inbound, _inbound_batch);
+        }
+        for (const auto &dgram : _inbound_batch) {
+            _demux.datagram_received(dgram);
+        }
+        _inbound_batch.clear();
+    });
+
+    // rule 2: write the datagrams queued by this worker's connections, until the device pushes back
+    _eventloop.add_rule(_device,
+                        Direction::Out,
+                        [&] {
+                            auto &datagrams = _demux.datagrams_out();
+                            while (not datagrams.empty()) {
+                                try {
+                                    _device.write(datagrams.front());
+                                } catch (const unix_error &e) {
+                                    if (e.code().value() == EAGAIN) {
+                                        break;
+                                    }
+                                    throw;
+                                }
+                                datagrams.pop();
+                            }
+                        },
+                        [&] { return not _demux.datagrams_out().empty(); });
+}
+
+//! \param[in] local is the source address; its port is ignored in favour of a suitable ephemeral port
+//! \param[in] remote is the peer to connect to
+TCPFlow TCPShardedStack::Worker::connect(const Address &local, const Address &remote) {
+    const Address any_port{local.ip(), 0};
+    return _demux.connect(
+        any_port, remote, [&](const TCPFlow &flow) { return worker_for(flow, _n_workers) == _index; });
+}
+
+void TCPShardedStack::Worker::_enqueue(InternetDatagram &&dgram) {
+    bool was_empty = false;
+    {
+        lock_guard<mutex> lock(_inbound_mutex);
+        was_empty = _inbound.empty();
+        _inbound.push_back(move(dgram));
+    }
+
+    // one wakeup per batch: the worker takes everything queued when it reads the eventfd
+    if (was_empty) {
+        _wakeup.signal();
+    }
+}
+
+void TCPShardedStack::Worker::_main(const atomic_bool &stop, const WorkerCallback &callback) {
+    // the worker's own segments stay on this thread (the dispatcher's datagrams aren't confined)
+    Buffer::set_thread_confined(true);
+    uint64_t base_time = timestamp_us();
+    while (not stop) {
+        // sleep until the next datagram or the next timer, whichever comes first
+        _eventloop.wait_next_event_us(_demux.wait_timeout_us(IDLE_TIMEOUT_US, timestamp_us() - base_time));
+
+        const auto next_time = timestamp_us();
+        _demux.tick_us(next_time - base_time);
+        base_time = next_time;
+
+        if (callback) {
+            callback(*this);
+        }
+    }
+}
+
+//! \param[in] device is the FileDescriptor carrying one IPv4 datagram per read or write
+//! \param[in] n_workers is the number of worker threads (at least one)
+//! \param[in] cfg is the TCPConfig given to every new TCPConnection
+//! \param[in] callback is the application code run by every worker
+TCPShardedStack::TCPShardedStack(FileDescriptor &&device,
+                                 const size_t n_workers,
+                                 const TCPConfig &cfg,
+                                 WorkerCallback callback)
+    : _device(move(device)), _workers(), _callback(move(callback)) {
+    if (n_workers == 0) {
+        throw runtime_error("TCPShardedStack: need at least one worker");
+    }
+
+    // the descriptors share one open file description, so this applies to every worker's too
+    _device.set_blocking(false);
+
+    // each worker gets its own descriptor, so no FileDescriptor is shared between threads
+    for (size_t i = 0; i < n_workers; ++i) {
+        FileDescriptor worker_device{SystemCall("dup", ::dup(_device.fd_num()))};
+        _workers.push_back(make_unique<Worker>(i, n_workers, move(worker_device), cfg));
+    }
+}
+
+//! \param[in] local is the address and port to accept connections on
+//! \param[in] backlog is the per-worker limit on half-open plus unaccepted connections
+void TCPShardedStack::listen(const Address &local, const size_t backlog) {
+    if (_dispatcher.joinable()) {
+        throw runtime_error("TCPShardedStack::listen: must be called before start()");
+    }
+    for (auto &worker : _workers) {
+        worker->demux().listen(local, backlog);
+    }
+}
+
+void TCPShardedStack::start() {
+    if (_dispatcher.joinable()) {
+        throw runtime_error("TCPShardedStack::start: already started");
+    }
+    _stop = false;
+    for (auto &worker : _workers) {
+        Worker &w = *worker;
+        w._thread = thread([&] { w._main(_stop, _callback); });
+    }
+    _dispatcher = thread([&] { _dispatch_main(); });
+}
+
+void TCPShardedStack::_dispatch_main() {
+    EventLoop eventloop;
+    // stop() signals _wakeup, so the loop below can block until there is work
+    eventloop.add_rule(_wakeup, Direction::In, [&] { _wakeup.drain(); });
+    eventloop.add_rule(_device, Direction::In, [&] {
+        InternetDatagram dgram;
+        if (dgram.parse(_device.read_buffer()) != ParseResult::NoError) {
+            return;
+        }
+
+        // steer by the 4-tuple; anything else goes to worker 0, whose demux answers or drops it
+        size_t index = 0;
+        const Buffer payload = dgram.payload();
+        if (dgram.header().proto == IPv4Header::PROTO_TCP and payload.size() >= 4) {
+            const uint16_t sport = (payload.at(0) << 8) | payload.at(1);
+            const uint16_t dport = (payload.at(2) << 8) | payload.at(3);
+            index = worker_for({dgram.header().dst, dport, dgram.header().src, sport}, _workers.size());
+        }
+        _workers[index]->_enqueue(move(dgram));
+    });
+
+    while (not _stop) {
+        if (eventloop.wait_next_event(-1) == EventLoop::Result::Exit) {
+            break;
+        }
+    }
+}
+
+void TCPShardedStack::stop() {
+    _stop = true;
+    _wakeup.signal();
+    if (_dispatcher.joinable()) {
+        _dispatcher.join();
+    }
+    // only now, so the dispatcher and this thread never signal a worker at the same time
+    for (auto &worker : _workers) {
+        worker->_wakeup.signal();
+    }
+    for (auto &worker : _workers) {
+        if (worker->_thread.joinable()) {
+            worker->_thread.join();
+        }
+    }
+}
+
+TCPShardedStack::~TCPShardedStack() { stop(); }
@@ -0,0 +1,125 @@
+#ifndef SPONGE_LIBSPONGE_TCP_SHARDED_STACK_HH
+#define SPONGE_LIBSPONGE_TCP_SHARDED_STACK_HH
+
+#include "address.hh"
+#include "eventfd.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "tcp_flow.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! \brief N worker threads, each serving its own share of the TCP connections on one datagram device
+//! \details A dispatcher thread reads datagrams from the device and steers each one to a worker
+//! by a Toeplitz hash of its 4-tuple, as RSS-capable NICs do in hardware. Each worker owns an
+//! EventLoop, a TCPDemux and an inbound queue, so per-connection state is only ever touched by
+//! the worker thread it hashes to. Workers write their outbound datagrams straight to the device.
+class TCPShardedStack {
+  public:
+    class Worker;
+
+    //! Application code, called on a worker's thread after each round of events
+    using WorkerCallback = std::function<void(Worker &)>;
+
+    //! One shard: a thread with its own EventLoop and connection table
+    class Worker {
+        friend class TCPShardedStack;
+
+      private:
+        size_t _index;                                   //!< Position of this worker in TCPShardedStack::_workers
+        size_t _n_workers;                               //!< Total number of workers
+        FileDescriptor _device;                          //!< This worker's own descriptor for the shared device
+        EventFD _wakeup{};                               //!< Signalled by the dispatcher on enqueue
+        TCPDemux _demux;                                 //!< The connections steered to this worker
+        EventLoop _eventloop{};                          //!< Serves _wakeup and _device
+        std::mutex _inbound_mutex{};                     //!< Protects _inbound
+        std::vector<InternetDatagram> _inbound{};        //!< Datagrams steered here by the dispatcher
+        std::vector<InternetDatagram> _inbound_batch{};  //!< Datagrams being processed (worker thread only)
+        std::thread _thread{};                           //!< The worker thread
+
+        //! Called by the dispatcher thread
+        void _enqueue(InternetDatagram &&dgram);
+
+        //! Main loop of the worker thread
+        void _main(const std::atomic_bool &stop, const WorkerCallback &callback);
+
+      public:
+        Worker(const size_t index, const size_t n_workers, FileDescriptor &&device, const TCPConfig &cfg);
+
+        //! The connections served by this worker
+        TCPDemux &demux() { return _demux; }
+
+        //! Position of this worker, in [0, number of workers)
+        size_t index() const { return _index; }
+
+        //! Open a connection from `local` to `remote`, with an ephemeral port chosen so that
+        //! the peer's replies are steered back to this worker
+        TCPFlow connect(const Address &local, const Address &remote);
+    };
+
+  private:
+    FileDescriptor _device;                         //!< The dispatcher's descriptor for the device
+    std::vector<std::unique_ptr<Worker>> _workers;  //!< The shards
+    WorkerCallback _callback;                       //!< Application code run by every worker
+    std::atomic_bool _stop{false};                  //!< Set to ask every thread to exit
+    EventFD _wakeup{};                              //!< Signalled by stop() to wake the dispatcher
+    std::thread _dispatcher{};                      //!< Reads the device and steers datagrams to workers
+
+    //! Main loop of the dispatcher thread
+    void _dispatch_main();
+
+  public:
+    //! Construct `n_workers` workers sharing `device`; threads are not started until start()
+    TCPShardedStack(FileDescriptor &&device, const size_t n_workers, const TCPConfig &cfg, WorkerCallback callback);
+
+    //! Accept connections to `local` on every worker (call before start())
+    void listen(const Address &local, const size_t backlog = TCPDemux::DEFAULT_BACKLOG);
+
+    //! Start the dispatcher and worker threads
+    void start();
+
+    //! Ask every thread to exit, and wait for them
+    void stop();
+
+    //! Stops the threads if they are still running
+    ~TCPShardedStack();
+
+    //! Number of workers
+    size_t size() const { return _workers.size(); }
+
+    //! \brief Toeplitz hash of a 4-tuple with a symmetric key
+    //! \details Both directions of a connection hash to the same value, so a flow seen
+    //! from the local side (TCPFlow) and its incoming datagrams agree on their worker.
+    static uint32_t rss_hash(const TCPFlow &flow);
+
+    //! The worker that datagrams of `flow` are steered to
+    static size_t worker_for(const TCPFlow &flow, const size_t n_workers) { return rss_hash(flow) % n_workers; }
+
+    //! \name
+    //! This object cannot be moved or copied, since it is in use by several threads
+
+    //!@{
+    TCPShardedStack(const TCPShardedStack &) = delete;
+    TCPShardedStack(TCPShardedStack &&) = delete;
+    TCPShardedStack &operator=(const TCPShardedStack &) = delete;
+    TCPShardedStack &operator=(TCPShardedStack &&) = delete;
+    //!@}
+};
+
+//! \class TCPShardedStack
+//! The application runs inside the workers: the WorkerCallback is called on each worker's
+//! thread after every round of events, and can accept(), read(), write() and connect() on
+//! that worker's TCPDemux without any locking. Connections opened with Worker::connect()
+//! pick an ephemeral port that steers the peer's replies to the same worker.
+
+#endif  // SPONGE_LIBSPONGE_TCP_SHARDED_STACK_HH
@@ -4,6 +4,8 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <exception>
 #include <iostream>
@@ -17,22 +19,43 @@
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
+//! Longest wait while no timer is running, so the thread notices _abort
+static constexpr uint64_t IDLE_TIMEOUT_US = 10000;
 
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
-    auto base_time = timestamp_ms();
+    auto base_time = timestamp_us();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        if (_ring) {
+            // announce that we may sleep before the last look at the rings, so an owner
+            // that makes progress after that look knows to wake us (see _wake_tcp())
+            _ring->tcp_sleeping = true;
+            atomic_thread_fence(memory_order_seq_cst);
+            _pump_rings();
+        }
+
+        // sleep until the next event or the connection's next timer, whichever comes first
+        uint64_t timeout_us = IDLE_TIMEOUT_US;
+        const auto next_timeout = _tcp.value().time_until_next_timeout_us();
+        if (next_timeout.has_value()) {
+            const uint64_t elapsed = timestamp_us() - base_time;
+            timeout_us = min(timeout_us, next_timeout.value() > elapsed ? next_timeout.value() - elapsed : 0);
+        }
+
+        auto ret = _eventloop.wait_next_event_us(int64_t(timeout_us));
+
+        if (_ring) {
+            _ring->tcp_sleeping = false;
+        }
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
 
         if (_tcp.value().active()) {
-            const auto next_time = timestamp_ms();
-            _tcp.value().tick(next_time - base_time);
-            _datagram_adapter.tick(next_time - base_time);
+            const auto next_time = timestamp_us();
+            _tcp.value().tick_us(next_time - base_time);
+            _datagram_adapter.tick_us(next_time - base_time);
             base_time = next_time;
         }
     }
@@ -40,12 +63,15 @@ void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
+//! \param[in] channel selects how the owner's data reaches the TCPConnection thread
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> data_socket_pair,
-                                         AdaptT &&datagram_interface)
+                                         AdaptT &&datagram_interface,
+                                         const TCPDataChannel channel)
     : LocalStreamSocket(move(data_socket_pair.first))
     , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
+    , _datagram_adapter(move(datagram_interface))
+    , _channel(channel) {
     _thread_data.set_blocking(false);
 }
 
@@ -53,6 +79,12 @@ template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     _tcp.emplace(config);
 
+    if (_channel == TCPDataChannel::Ring) {
+        // room for as much as the send and receive buffers might grow to hold
+        _ring = make_unique<RingChannel>(max(config.send_capacity, config.send_capacity_max),
+                                         max(config.recv_capacity, config.recv_capacity_max));
+    }
+
     // Set up the event loop
 
     // There are four possible events to handle:
@@ -81,7 +113,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                             }
 
                             // debugging output:
-                            if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
+                            if (_outbound_shutdown and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
                                 cerr << "DEBUG: Outbound stream to "
                                      << _datagram_adapter.config().destination.to_string()
                                      << " has been fully acknowledged.\n";
@@ -90,64 +122,78 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                         },
                         [&] { return _tcp->active(); });
 
-    // rule 2: read from pipe into outbound buffer
-    _eventloop.add_rule(
-        _thread_data,
-        Direction::In,
-        [&] {
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
-            const auto len = data.size();
-            const auto amount_written = _tcp->write(move(data));
-            if (amount_written != len) {
-                throw runtime_error("TCPConnection::write() accepted less than advertised length");
-            }
+    if (_ring) {
+        // rules 2 and 3 for the in-process channel: the rings are pumped on every pass
+        // through _tcp_loop(), and the owner signals tcp_wakeup to start a pass early
+        _eventloop.add_rule(
+            _ring->tcp_wakeup,
+            Direction::In,
+            [&] { _ring->tcp_wakeup.drain(); },
+            [&] { return _tcp->active() or not _inbound_shutdown; });
+    } else {
+        // rule 2: read from pipe into outbound buffer
+        _eventloop.add_rule(
+            _thread_data,
+            Direction::In,
+            [&] {
+                // read straight into pooled chunks, then copy each into the outbound stream
+                const BufferList data = _thread_data.read_buffers(_tcp->remaining_outbound_capacity());
+                for (const Buffer &buffer : data.buffers()) {
+                    if (_tcp->write(buffer.str()) != buffer.size()) {
+                        throw runtime_error("TCPConnection::write() accepted less than advertised length");
+                    }
+                }
+
+                if (_thread_data.eof()) {
+                    _tcp->end_input_stream();
+                    _outbound_shutdown = true;
 
-            if (_thread_data.eof()) {
+                    // debugging output:
+                    cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
+                         << " finished (" << _tcp.value().bytes_in_flight() << " byte"
+                         << (_tcp.value().bytes_in_flight() == 1 ? "" : "s") << " still in flight).\n";
+                }
+            },
+            [&] {
+                return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->outbound_writable());
+            },
+            [&] {
                 _tcp->end_input_stream();
                 _outbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
-                     << " finished (" << _tcp.value().bytes_in_flight() << " byte"
-                     << (_tcp.value().bytes_in_flight() == 1 ? "" : "s") << " still in flight).\n";
-            }
-        },
-        [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
-        [&] {
-            _tcp->end_input_stream();
-            _outbound_shutdown = true;
-        });
-
-    // rule 3: read from inbound buffer into pipe
-    _eventloop.add_rule(
-        _thread_data,
-        Direction::Out,
-        [&] {
-            ByteStream &inbound = _tcp->inbound_stream();
-            // Write from the inbound_stream into
-            // the pipe, handling the possibility of a partial
-            // write (i.e., only pop what was actually written).
-            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
-            inbound.pop_output(bytes_written);
-
-            if (inbound.eof() or inbound.error()) {
-                _thread_data.shutdown(SHUT_WR);
-                _inbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string()
-                     << " finished " << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
-                if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
-                    cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
+            });
+
+        // rule 3: read from inbound buffer into pipe
+        _eventloop.add_rule(
+            _thread_data,
+            Direction::Out,
+            [&] {
+                ByteStream &inbound = _tcp->inbound_stream();
+                // Write from the inbound_stream into
+                // the pipe, handling the possibility of a partial
+                // write (i.e., only pop what was actually written).
+                const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+                const std::string buffer = inbound.peek_output(amount_to_write);
+                const auto bytes_written = _thread_data.write(move(buffer), false);
+                inbound.pop_output(bytes_written);
+
+                if (inbound.eof() or inbound.error()) {
+                    _thread_data.shutdown(SHUT_WR);
+                    _inbound_shutdown = true;
+
+                    // debugging output:
+                    cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string()
+                         << " finished " << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
+                    if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
+                        cerr
+                            << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
+                    }
                 }
-            }
-        },
-        [&] {
-            return (not _tcp->inbound_stream().buffer_empty()) or
-                   ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
-        });
+            },
+            [&] {
+                return (not _tcp->inbound_stream().buffer_empty()) or
+                       ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
+            });
+    }
 
     // rule 4: read outbound segments from TCPConnection and send as datagrams
     _eventloop.add_rule(_datagram_adapter,
@@ -171,9 +217,143 @@ static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int
 }
 
 //! \param[in] datagram_interface is the underlying interface (e.g. to UDP, IP, or Ethernet)
+//! \param[in] channel selects how the owner's data reaches the TCPConnection thread
+template <typename AdaptT>
+TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface, const TCPDataChannel channel)
+    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), move(datagram_interface), channel) {}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_pump_rings() {
+    bool outbound_progress = false;
+    bool inbound_progress = false;
+
+    // owner -> outbound stream
+    SPSCByteRing &outbound = _ring->outbound;
+    if (not _outbound_shutdown and _tcp->active()) {
+        const auto data = _tcp->outbound_writable() ? outbound.pop(_tcp->remaining_outbound_capacity()) : string{};
+        if (not data.empty()) {
+            if (_tcp->write(data) != data.size()) {
+                throw runtime_error("TCPConnection::write() accepted less than advertised length");
+            }
+            outbound_progress = true;
+        }
+
+        if (outbound.eof()) {
+            _tcp->end_input_stream();
+            _outbound_shutdown = true;
+        }
+    }
+
+    // inbound stream -> owner
+    SPSCByteRing &inbound_ring = _ring->inbound;
+    ByteStream &inbound = _tcp->inbound_stream();
+    if (not _inbound_shutdown) {
+        const size_t amount_to_push = min(inbound.buffer_size(), inbound_ring.remaining_capacity());
+        if (amount_to_push > 0) {
+            inbound.pop_output(inbound_ring.push(inbound.peek_output(amount_to_push)));
+            inbound_progress = true;
+        }
+
+        if (inbound.eof() or inbound.error()) {
+            inbound_ring.close();
+            _inbound_shutdown = true;
+            inbound_progress = true;
+        }
+    }
+
+    if (outbound_progress or inbound_progress) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (outbound_progress and _ring->sender_sleeping) {
+            _ring->sender_wakeup.signal();
+        }
+        if (inbound_progress and _ring->receiver_sleeping) {
+            _ring->receiver_wakeup.signal();
+        }
+    }
+}
+
+//! \details Pairs with the fence in _tcp_loop(): either the TCPConnection thread sees the
+//! owner's progress before it sleeps, or the owner sees `tcp_sleeping` and wakes it.
 template <typename AdaptT>
-TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface)
-    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), move(datagram_interface)) {}
+void TCPSpongeSocket<AdaptT>::_wake_tcp() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (_ring->tcp_sleeping) {
+        _ring->tcp_wakeup.signal();
+    }
+}
+
+//! \param[in] wakeup is the blocking EventFD the TCPConnection thread will signal
+//! \param[in] sleeping is the flag telling the TCPConnection thread to signal `wakeup`
+//! \param[in] ready is checked after setting `sleeping`, so a wakeup can't be missed
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_wait_owner(EventFD &wakeup, atomic_bool &sleeping, const function<bool()> &ready) {
+    sleeping = true;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (not ready()) {
+        wakeup.drain();
+    }
+    sleeping = false;
+}
+
+template <typename AdaptT>
+typename TCPSpongeSocket<AdaptT>::RingChannel &TCPSpongeSocket<AdaptT>::_ring_channel(const char *function_name) {
+    if (_channel != TCPDataChannel::Ring) {
+        throw runtime_error(string("TCPSpongeSocket::") + function_name + "() requires TCPDataChannel::Ring");
+    }
+    if (not _ring or not _tcp_thread.joinable()) {
+        throw runtime_error(string("TCPSpongeSocket::") + function_name + "() before connect or accept");
+    }
+    return *_ring;
+}
+
+//! \param[in] data is the string to write
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::send(string_view data) {
+    RingChannel &ring = _ring_channel("send");
+    while (not data.empty()) {
+        if (ring.tcp_finished) {
+            throw runtime_error("TCPSpongeSocket::send(): connection is closed");
+        }
+
+        const size_t pushed = ring.outbound.push(data);
+        if (pushed > 0) {
+            data.remove_prefix(pushed);
+            _wake_tcp();
+            continue;
+        }
+
+        _wait_owner(ring.sender_wakeup, ring.sender_sleeping, [&] {
+            return ring.outbound.remaining_capacity() > 0 or ring.tcp_finished;
+        });
+    }
+}
+
+//! \param[in] limit is the largest number of bytes to return
+//! \returns the bytes read, or an empty string once the inbound stream has ended
+template <typename AdaptT>
+string TCPSpongeSocket<AdaptT>::recv(const size_t limit) {
+    RingChannel &ring = _ring_channel("recv");
+    while (true) {
+        auto data = ring.inbound.pop(limit);
+        if (not data.empty()) {
+            _wake_tcp();
+            return data;
+        }
+        if (ring.inbound.eof() or ring.tcp_finished) {
+            return {};
+        }
+
+        _wait_owner(ring.receiver_wakeup, ring.receiver_sleeping, [&] {
+            return ring.inbound.size() > 0 or ring.inbound.eof() or ring.tcp_finished;
+        });
+    }
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::shutdown_send() {
+    _ring_channel("shutdown_send").outbound.close();
+    _wake_tcp();
+}
 
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
@@ -191,6 +371,9 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
 
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::wait_until_closed() {
+    if (_ring and _tcp_thread.joinable()) {
+        shutdown_send();
+    }
     shutdown(SHUT_RDWR);
     if (_tcp_thread.joinable()) {
         cerr << "DEBUG: Waiting for clean shutdown... ";
@@ -250,8 +433,21 @@ void TCPSpongeSocket<AdaptT>::listen_and_accept(const TCPConfig &c_tcp, const Fd
     _tcp_thread = thread(&TCPSpongeSocket::_tcp_main, this);
 }
 
+//! \details Lets an owner blocked in send() or recv() see that the TCPConnection thread is gone
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_finish_ring() {
+    if (_ring) {
+        _ring->inbound.close();
+        _ring->tcp_finished = true;
+        _ring->sender_wakeup.signal();
+        _ring->receiver_wakeup.signal();
+    }
+}
+
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_main() {
+    // this thread's segments never leave it, so their Buffers can skip atomic refcounting
+    Buffer::set_thread_confined(true);
     try {
         if (not _tcp.has_value()) {
             throw runtime_error("no TCP");
@@ -263,8 +459,10 @@ void TCPSpongeSocket<AdaptT>::_tcp_main() {
                  << (_tcp.value().state() == TCPState::State::RESET ? "uncleanly" : "cleanly.\n");
         }
         _tcp.reset();
+        _finish_ring();
     } catch (const exception &e) {
         cerr << "Exception in TCPConnection runner thread: " << e.what() << "\n";
+        _finish_ring();
         throw e;
     }
 }
@@ -281,6 +479,21 @@ template class TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 //! Specialization of TCPSpongeSocket for LossyTCPOverIPv4OverTunFdAdapter
 template class TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+//! Specialization of TCPSpongeSocket for PcapLossyTCPOverUDPSocketAdapter
+template class TCPSpongeSocket<PcapLossyTCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPSpongeSocket for PcapLossyTCPOverIPv4OverTunFdAdapter
+template class TCPSpongeSocket<PcapLossyTCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPSpongeSocket for TCPOverIPv4OverEthernetAdapter
+template class TCPSpongeSocket<TCPOverIPv4OverEthernetAdapter>;
+
+//! Specialization of TCPSpongeSocket for TCPOverIPv6OverTunFdAdapter
+template class TCPSpongeSocket<TCPOverIPv6OverTunFdAdapter>;
+
+//! Specialization of TCPSpongeSocket for LossyTCPOverIPv6OverTunFdAdapter
+template class TCPSpongeSocket<LossyTCPOverIPv6OverTunFdAdapter>;
+
 CS144TCPSocket::CS144TCPSocket() : TCPOverIPv4SpongeSocket(TCPOverIPv4OverTunFdAdapter(TunFD("tun144"))) {}
 
 void CS144TCPSocket::connect(const Address &address) {
@@ -293,3 +506,35 @@ void CS144TCPSocket::connect(const Address &address) {
 
     TCPOverIPv4SpongeSocket::connect(tcp_config, multiplexer_config);
 }
+
+static const string LOCAL_TAP_IP_ADDRESS = "169.254.10.9";
+static const string LOCAL_TAP_NEXT_HOP_ADDRESS = "169.254.10.1";
+
+//! A random private Ethernet address (locally administered, unicast)
+static EthernetAddress random_private_ethernet_address() {
+    EthernetAddress addr;
+    for (auto &byte : addr) {
+        byte = random_device()();  // use a random local Ethernet address
+    }
+    addr.at(0) |= 0x02;  // "10" in last two binary digits marks a private Ethernet address
+    addr.at(0) &= 0xfe;
+
+    return addr;
+}
+
+FullStackSocket::FullStackSocket()
+    : TCPOverIPv4OverEthernetSpongeSocket(TCPOverIPv4OverEthernetAdapter(TapFD("tap10"),
+                                                                         random_private_ethernet_address(),
+                                                                         Address(LOCAL_TAP_IP_ADDRESS, "0"),
+                                                                         Address(LOCAL_TAP_NEXT_HOP_ADDRESS, "0"))) {}
+
+void FullStackSocket::connect(const Address &address) {
+    TCPConfig tcp_config;
+    tcp_config.rt_timeout = 100;
+
+    FdAdapterConfig multiplexer_config;
+    multiplexer_config.source = {LOCAL_TAP_IP_ADDRESS, to_string(uint16_t(random_device()()))};
+    multiplexer_config.destination = address;
+
+    TCPOverIPv4OverEthernetSpongeSocket::connect(tcp_config, multiplexer_config);
+}
@@ -2,9 +2,12 @@
 #define SPONGE_LIBSPONGE_TCP_SPONGE_SOCKET_HH
 
 #include "byte_stream.hh"
+#include "eventfd.hh"
 #include "eventloop.hh"
 #include "fd_adapter.hh"
 #include "file_descriptor.hh"
+#include "pcap_writer_adapter.hh"
+#include "spsc_byte_ring.hh"
 #include "tcp_config.hh"
 #include "tcp_connection.hh"
 #include "tcp_over_ip.hh"
@@ -12,10 +15,19 @@
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
+//! How application data travels between the owner thread and the TCPConnection thread
+enum class TCPDataChannel {
+    SocketPair,  //!< Through the socket itself: the owner uses the FileDescriptor interface
+    Ring         //!< Through in-process lock-free rings: the owner uses send() and recv()
+};
+
 //! Multithreaded wrapper around TCPConnection that approximates the Unix sockets API
 template <typename AdaptT>
 class TCPSpongeSocket : public LocalStreamSocket {
@@ -45,7 +57,46 @@ class TCPSpongeSocket : public LocalStreamSocket {
     std::thread _tcp_thread{};
 
     //! Construct LocalStreamSocket fds from socket pair, initialize eventloop
-    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair, AdaptT &&datagram_interface);
+    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair,
+                    AdaptT &&datagram_interface,
+                    const TCPDataChannel channel);
+
+    //! Channel carrying the owner's data
+    TCPDataChannel _channel;
+
+    //! The in-process channel, with one ring per direction
+    struct RingChannel {
+        SPSCByteRing outbound;                    //!< Owner to TCPConnection thread
+        SPSCByteRing inbound;                     //!< TCPConnection thread to owner
+        EventFD tcp_wakeup{};                     //!< Wakes the TCPConnection thread from its EventLoop
+        EventFD sender_wakeup{true};              //!< Wakes an owner blocked in send()
+        EventFD receiver_wakeup{true};            //!< Wakes an owner blocked in recv()
+        std::atomic_bool tcp_sleeping{false};     //!< Is the TCPConnection thread (about to be) waiting for events?
+        std::atomic_bool sender_sleeping{false};  //!< Is send() (about to be) blocked on sender_wakeup?
+        std::atomic_bool receiver_sleeping{false};  //!< Is recv() (about to be) blocked on receiver_wakeup?
+        std::atomic_bool tcp_finished{false};       //!< Has the TCPConnection thread exited?
+
+        RingChannel(const size_t outbound_capacity, const size_t inbound_capacity)
+            : outbound(outbound_capacity), inbound(inbound_capacity) {}
+    };
+
+    //! Present with TCPDataChannel::Ring, once a connection is initialized
+    std::unique_ptr<RingChannel> _ring{};
+
+    //! Move data between the rings and the TCPConnection (TCPConnection thread)
+    void _pump_rings();
+
+    //! Wake the TCPConnection thread if it is waiting for events (owner thread)
+    void _wake_tcp();
+
+    //! Block on `wakeup` until `ready` returns true, or the TCPConnection thread makes progress (owner thread)
+    static void _wait_owner(EventFD &wakeup, std::atomic_bool &sleeping, const std::function<bool()> &ready);
+
+    //! Close the in-process channel when the TCPConnection thread exits
+    void _finish_ring();
+
+    //! Throw unless the owner's data goes through the in-process channel
+    RingChannel &_ring_channel(const char *function_name);
 
     std::atomic_bool _abort{false};  //!< Flag used by the owner to force the TCPConnection thread to shut down
 
@@ -57,7 +108,8 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
   public:
     //! Construct from the interface that the TCPConnection thread will use to read and write datagrams
-    explicit TCPSpongeSocket(AdaptT &&datagram_interface);
+    explicit TCPSpongeSocket(AdaptT &&datagram_interface,
+                             const TCPDataChannel channel = TCPDataChannel::SocketPair);
 
     //! Close socket, and wait for TCPConnection to finish
     //! \note Calling this function is only advisable if the socket has reached EOF,
@@ -73,6 +125,25 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! When a connected socket is destructed, it will send a RST
     ~TCPSpongeSocket();
 
+    //! \name
+    //! Owner's interface to the in-process channel (TCPDataChannel::Ring only)
+
+    //!@{
+
+    //! Write all of `data` to the outbound stream, blocking while the ring is full
+    //! \note send() and shutdown_send() may be called from a different thread than recv()
+    void send(std::string_view data);
+
+    //! Read up to `limit` bytes of the inbound stream, blocking until some arrive or the stream ends
+    std::string recv(const size_t limit = 65536);
+
+    //! Finish the outbound stream
+    void shutdown_send();
+
+    //! Has the inbound stream ended, with every byte returned by recv()?
+    bool recv_eof() const { return _ring and _ring->inbound.eof(); }
+    //!@}
+
     //! \name
     //! This object cannot be safely moved or copied, since it is in use by two threads simultaneously
 
@@ -98,6 +169,11 @@ using TCPOverUDPSpongeSocket = TCPSpongeSocket<TCPOverUDPSocketAdapter>;
 using TCPOverIPv4SpongeSocket = TCPSpongeSocket<TCPOverIPv4OverTunFdAdapter>;
 using LossyTCPOverUDPSpongeSocket = TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
+using PcapLossyTCPOverUDPSpongeSocket = TCPSpongeSocket<PcapLossyTCPOverUDPSocketAdapter>;
+using PcapLossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<PcapLossyTCPOverIPv4OverTunFdAdapter>;
+using TCPOverIPv4OverEthernetSpongeSocket = TCPSpongeSocket<TCPOverIPv4OverEthernetAdapter>;
+using TCPOverIPv6SpongeSocket = TCPSpongeSocket<TCPOverIPv6OverTunFdAdapter>;
+using LossyTCPOverIPv6SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv6OverTunFdAdapter>;
 
 //! \class TCPSpongeSocket
 //! This class involves the simultaneous operation of two threads.
@@ -118,6 +194,11 @@ using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAd
 //!   and [accept(2)](\ref man2::accept)
 //! - if TCPSpongeSocket is destructed while a TCP connection is open, the connection is
 //!   immediately terminated with a RST (call `wait_until_closed` to avoid this)
+//!
+//! With TCPDataChannel::Ring, the owner's data skips the socket pair: send() and recv() copy it
+//! straight into and out of lock-free single-producer/single-consumer rings that the
+//! TCPConnection thread moves to and from the TCPConnection. Each side only makes a system
+//! call (an [eventfd(2)](\ref man2::eventfd) signal) when the other one is asleep.
 
 //! Helper class that makes a TCPOverIPv4SpongeSocket behave more like a (kernel) TCPSocket
 class CS144TCPSocket : public TCPOverIPv4SpongeSocket {
@@ -126,4 +207,14 @@ class CS144TCPSocket : public TCPOverIPv4SpongeSocket {
     void connect(const Address &address);
 };
 
+//! Helper class that makes a TCPOverIPv4OverEthernetSpongeSocket behave more like a (kernel) TCPSocket
+class FullStackSocket : public TCPOverIPv4OverEthernetSpongeSocket {
+  public:
+    //! Construct a TCP (stream) socket, using the CS144 TCPConnection object,
+    //! that encapsulates TCP segments in IP datagrams, then encapsulates
+    //! those IP datagrams in Ethernet frames sent to the Ethernet address of the next hop.
+    FullStackSocket();
+    void connect(const Address &address);
+};
+
 #endif  // SPONGE_LIBSPONGE_TCP_SPONGE_SOCKET_HH
@@ -0,0 +1,70 @@
+#include "tcp_stack.hh"
+
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+using namespace std;
+
+//! Longest wait in loop() while no timer is running, so its condition is checked now and then
+static constexpr int IDLE_TIMEOUT_MS = 100;
+
+//! \param[in] device is the FileDescriptor carrying one IPv4 datagram per read or write
+//! \param[in] cfg is the TCPConfig given to every new TCPConnection
+TCPStack::TCPStack(FileDescriptor &&device, const TCPConfig &cfg)
+    : TCPDemux(cfg), _device(move(device)), _base_time(timestamp_us()) {
+    // a full device queue must not block the one thread serving every connection
+    _device.set_blocking(false);
+
+    // rule 1: read one datagram from the device and demultiplex it to its connection
+    _eventloop.add_rule(_device, Direction::In, [&] {
+        InternetDatagram dgram;
+        if (dgram.parse(_device.read_buffer()) == ParseResult::NoError) {
+            datagram_received(dgram);
+        }
+    });
+
+    // rule 2: write the datagrams queued by every connection, until the device pushes back
+    _eventloop.add_rule(_device,
+                        Direction::Out,
+                        [&] {
+                            while (not datagrams_out().empty()) {
+                                try {
+                                    _device.write(datagrams_out().front());
+                                } catch (const unix_error &e) {
+                                    if (e.code().value() == EAGAIN) {
+                                        break;
+                                    }
+                                    throw;
+                                }
+                                datagrams_out().pop();
+                            }
+                        },
+                        [&] { return not datagrams_out().empty(); });
+}
+
+//! \param[in] timeout_ms is the longest time to wait for an event (negative for no limit); the wait
+//!                       also ends when the earliest connection timer expires
+EventLoop::Result TCPStack::wait_next_event(const int timeout_ms) {
+    const int64_t limit_us = timeout_ms < 0 ? -1 : int64_t{timeout_ms} * 1000;
+    const auto ret = _eventloop.wait_next_event_us(wait_timeout_us(limit_us, timestamp_us() - _base_time));
+
+    const auto next_time = timestamp_us();
+    tick_us(next_time - _base_time);
+    _base_time = next_time;
+
+    return ret;
+}
+
+//! \param[in] condition is a function returning true if loop should continue
+void TCPStack::loop(const function<bool()> &condition) {
+    while (condition()) {
+        if (wait_next_event(IDLE_TIMEOUT_MS) == EventLoop::Result::Exit) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SPONGE_LIBSPONGE_TCP_STACK_HH
+#define SPONGE_LIBSPONGE_TCP_STACK_HH
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+
+#include <cstdint>
+#include <functional>
+
+//! \brief A TCPDemux driven by a single EventLoop over one datagram device
+//! \details The device is any FileDescriptor on which each read() returns one IPv4 datagram
+//! and each write() sends one, e.g. a TunFD, or one end of a SOCK_DGRAM socket pair in tests.
+//! All connections are served by the thread that calls wait_next_event() or loop().
+class TCPStack : public TCPDemux {
+  private:
+    //! The device datagrams are read from and written to
+    FileDescriptor _device;
+
+    //! eventloop that handles inbound and outbound datagrams for every connection
+    EventLoop _eventloop{};
+
+    //! Time of the last tick, from timestamp_us()
+    uint64_t _base_time;
+
+  public:
+    //! Construct from the device and the configuration shared by every connection
+    explicit TCPStack(FileDescriptor &&device, const TCPConfig &cfg = {});
+
+    //! The EventLoop serving the device; the owner may add rules for its own file descriptors
+    EventLoop &eventloop() { return _eventloop; }
+
+    //! Wait up to `timeout_ms`, or until the next connection timer expires, for datagrams to arrive
+    //! or become writable, then tick all connections
+    EventLoop::Result wait_next_event(const int timeout_ms);
+
+    //! Process events while specified condition is true
+    void loop(const std::function<bool()> &condition);
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_STACK_HH
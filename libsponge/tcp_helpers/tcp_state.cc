@@ -108,3 +108,99 @@ string TCPState::state_summary(const TCPSender &sender) {
         return TCPSenderStateSummary::FIN_ACKED;
     }
 }
+
+optional<TCPState::State> TCPState::official_state(const TCPSender &sender,
+                                                   const TCPReceiver &receiver,
+                                                   const bool active,
+                                                   const bool linger) {
+    // the same tests as state_summary(), without building the strings
+    enum class Rx { ERROR, LISTEN, SYN_RECV, FIN_RECV };
+    enum class Tx { ERROR, CLOSED, SYN_SENT, SYN_ACKED, FIN_SENT, FIN_ACKED };
+
+    Rx rx = Rx::SYN_RECV;
+    if (receiver.stream_out().error()) {
+        rx = Rx::ERROR;
+    } else if (not receiver.ackno().has_value()) {
+        rx = Rx::LISTEN;
+    } else if (receiver.stream_out().input_ended()) {
+        rx = Rx::FIN_RECV;
+    }
+
+    Tx tx = Tx::FIN_ACKED;
+    if (sender.stream_in().error()) {
+        tx = Tx::ERROR;
+    } else if (sender.next_seqno_absolute() == 0) {
+        tx = Tx::CLOSED;
+    } else if (sender.next_seqno_absolute() == sender.bytes_in_flight()) {
+        tx = Tx::SYN_SENT;
+    } else if (not sender.stream_in().eof() or
+               sender.next_seqno_absolute() < sender.stream_in().bytes_written() + 2) {
+        tx = Tx::SYN_ACKED;
+    } else if (sender.bytes_in_flight()) {
+        tx = Tx::FIN_SENT;
+    }
+
+    // the inactive states ignore the linger bit (see the constructor)
+    if (not active) {
+        if (rx == Rx::ERROR and tx == Tx::ERROR) {
+            return State::RESET;
+        }
+        if (rx == Rx::FIN_RECV and tx == Tx::FIN_ACKED) {
+            return State::CLOSED;
+        }
+        return {};
+    }
+
+    struct Entry {
+        State state;
+        Rx rx;
+        Tx tx;
+        bool linger;
+    };
+    static constexpr Entry active_states[] = {{State::LISTEN, Rx::LISTEN, Tx::CLOSED, true},
+                                              {State::SYN_RCVD, Rx::SYN_RECV, Tx::SYN_SENT, true},
+                                              {State::SYN_SENT, Rx::LISTEN, Tx::SYN_SENT, true},
+                                              {State::ESTABLISHED, Rx::SYN_RECV, Tx::SYN_ACKED, true},
+                                              {State::CLOSE_WAIT, Rx::FIN_RECV, Tx::SYN_ACKED, false},
+                                              {State::LAST_ACK, Rx::FIN_RECV, Tx::FIN_SENT, false},
+                                              {State::CLOSING, Rx::FIN_RECV, Tx::FIN_SENT, true},
+                                              {State::FIN_WAIT_1, Rx::SYN_RECV, Tx::FIN_SENT, true},
+                                              {State::FIN_WAIT_2, Rx::SYN_RECV, Tx::FIN_ACKED, true},
+                                              {State::TIME_WAIT, Rx::FIN_RECV, Tx::FIN_ACKED, true}};
+    for (const auto &entry : active_states) {
+        if (entry.rx == rx and entry.tx == tx and entry.linger == linger) {
+            return entry.state;
+        }
+    }
+    return {};
+}
+
+string TCPState::state_name(const State state) {
+    switch (state) {
+        case State::LISTEN:
+            return "LISTEN";
+        case State::SYN_RCVD:
+            return "SYN_RCVD";
+        case State::SYN_SENT:
+            return "SYN_SENT";
+        case State::ESTABLISHED:
+            return "ESTABLISHED";
+        case State::CLOSE_WAIT:
+            return "CLOSE_WAIT";
+        case State::LAST_ACK:
+            return "LAST_ACK";
+        case State::FIN_WAIT_1:
+            return "FIN_WAIT_1";
+        case State::FIN_WAIT_2:
+            return "FIN_WAIT_2";
+        case State::CLOSING:
+            return "CLOSING";
+        case State::TIME_WAIT:
+            return "TIME_WAIT";
+        case State::CLOSED:
+            return "CLOSED";
+        case State::RESET:
+            return "RESET";
+    }
+    return "unknown";
+}
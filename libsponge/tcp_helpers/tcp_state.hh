@@ -4,6 +4,7 @@
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 
+#include <optional>
 #include <string>
 
 //! \brief Summary of a TCPConnection's internal state
@@ -61,6 +62,16 @@ class TCPState {
 
     //! \brief Summarize the state of a TCPSender in a string
     static std::string state_summary(const TCPSender &receiver);
+
+    //! \brief The official state of a sender, a receiver, and the TCPConnection's active and linger bits, if
+    //! they match one; unlike the constructor, this builds no strings
+    static std::optional<State> official_state(const TCPSender &sender,
+                                               const TCPReceiver &receiver,
+                                               const bool active,
+                                               const bool linger);
+
+    //! \brief The name of an official state, e.g. "ESTABLISHED"
+    static std::string state_name(const State state);
 };
 
 namespace TCPReceiverStateSummary {
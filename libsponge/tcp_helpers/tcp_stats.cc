@@ -0,0 +1,25 @@
+#include "tcp_stats.hh"
+
+#include <sstream>
+
+using namespace std;
+
+string TCPStats::to_string() const {
+    ostringstream ss;
+    ss << "segments_sent=" << segments_sent << " bytes_sent=" << bytes_sent
+       << " segments_received=" << segments_received << " bytes_received=" << bytes_received
+       << " retransmitted_segments=" << retransmitted_segments << " rto_expirations=" << rto_expirations
+       << " dupacks=" << dupacks << " duplicate_bytes=" << duplicate_bytes
+       << " out_of_window_bytes=" << out_of_window_bytes << " dropped_bytes=" << dropped_bytes
+       << " rwnd_limited_us=" << rwnd_limited_us
+       << " app_limited_us=" << app_limited_us << " srtt_us=";
+    if (srtt_us.has_value()) {
+        ss << srtt_us.value();
+    } else {
+        ss << "-";
+    }
+    ss << " rttvar_us=" << rttvar_us << " rto_us=" << rto_us << " bytes_in_flight=" << bytes_in_flight
+       << " unassembled_bytes=" << unassembled_bytes << " recv_capacity=" << recv_capacity
+       << " send_capacity=" << send_capacity << " memory_bytes=" << memory_bytes;
+    return ss.str();
+}
@@ -0,0 +1,59 @@
+#ifndef SPONGE_LIBSPONGE_TCP_STATS_HH
+#define SPONGE_LIBSPONGE_TCP_STATS_HH
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+//! \brief A snapshot of a TCPConnection's counters, in the spirit of Linux's `struct tcp_info`
+//! \details Every counter is a plain integer updated on a path the connection already takes,
+//! so they are always on. Times are in microseconds of tick() time.
+struct TCPStats {
+    //! \name Traffic
+    //!@{
+    uint64_t segments_sent = 0;      //!< Segments queued for transmission, including retransmissions
+    uint64_t bytes_sent = 0;         //!< Payload bytes in those segments
+    uint64_t segments_received = 0;  //!< Segments received while the connection was active
+    uint64_t bytes_received = 0;     //!< Payload bytes in those segments
+    //!@}
+
+    //! \name Loss and recovery
+    //!@{
+    uint64_t retransmitted_segments = 0;  //!< Segments sent again
+    uint64_t rto_expirations = 0;         //!< Times the retransmission timer expired
+    uint64_t dupacks = 0;                 //!< Pure ACKs that acknowledged nothing new while data was in flight
+    uint64_t duplicate_bytes = 0;         //!< Received bytes dropped because they had already arrived
+    uint64_t out_of_window_bytes = 0;     //!< Received bytes dropped because they were beyond the window
+    uint64_t dropped_bytes = 0;           //!< Out-of-order bytes dropped under memory pressure
+    //!@}
+
+    //! \name What limited the sender
+    //!@{
+    uint64_t rwnd_limited_us = 0;  //!< Time with data to send but the peer's window full
+    uint64_t app_limited_us = 0;   //!< Time with room in the window but nothing to send
+    //!@}
+
+    //! \name Current state
+    //!@{
+    std::optional<uint64_t> srtt_us{};  //!< Smoothed round-trip time, once a sample has been taken
+    uint64_t rttvar_us = 0;             //!< Round-trip time variation
+    uint64_t rto_us = 0;                //!< Current retransmission timeout
+    uint64_t bytes_in_flight = 0;       //!< Sequence numbers sent but not yet acknowledged
+    uint64_t unassembled_bytes = 0;     //!< Bytes received out of order, waiting for a gap to fill
+    uint64_t recv_capacity = 0;         //!< Size of the receive buffer (see TCPConfig::recv_capacity_max)
+    uint64_t send_capacity = 0;         //!< Size of the send buffer (see TCPConfig::send_capacity_max)
+    uint64_t memory_bytes = 0;          //!< Buffer memory charged to the MemoryAccountant
+    //!@}
+
+    //! One line of `name=value` pairs, for logs
+    std::string to_string() const;
+};
+
+//! \struct TCPStats
+//! The RTT is measured as in Karn's algorithm (one segment timed at a time, never a retransmitted
+//! one) and smoothed as in RFC 6298. It is reported only: the RTO still starts at
+//! TCPConfig::rt_timeout and doubles on each expiration.
+//!
+//! This TCPSender has no congestion window, so time is never cwnd-limited.
+
+#endif  // SPONGE_LIBSPONGE_TCP_STATS_HH
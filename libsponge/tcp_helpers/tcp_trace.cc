@@ -0,0 +1,333 @@
+#include "tcp_trace.hh"
+
+#include "spsc_byte_ring.hh"
+#include "tcp_state.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+atomic_bool TCPTracer::_enabled{false};
+atomic<uint32_t> TCPTracer::_next_connection_id{0};
+
+static constexpr array<char, 8> TRACE_MAGIC{'S', 'P', 'N', 'G', 'T', 'R', 'C', 'E'};
+static constexpr uint32_t TRACE_VERSION = 1;
+
+//! How often the collector empties the rings
+static constexpr auto COLLECT_INTERVAL = chrono::milliseconds(1);
+
+//! A recording thread's ring; the collector holds a reference so events outlive the thread
+struct TraceRing {
+    SPSCByteRing ring{TCPTracer::RING_CAPACITY};  //!< Written by the thread, read by the collector
+    uint16_t thread = 0;                          //!< The thread's index in the trace
+    atomic_bool exited{false};                    //!< Set once the thread will record no more
+};
+
+//! The state behind TCPTracer's static interface
+struct TraceCollector {
+    mutex lock{};                           //!< Protects everything below except `running` and `dropped`
+    vector<shared_ptr<TraceRing>> rings{};  //!< Rings of threads that have recorded (see drain())
+    size_t threads = 0;                     //!< Threads that have ever recorded an event
+    ofstream out{};                         //!< The trace file
+    thread collector{};                     //!< Empties the rings into `out` while tracing
+    atomic_bool running{false};             //!< Tells `collector` to keep going
+    atomic<uint64_t> dropped{0};            //!< Events lost to a full ring
+
+    //! Empty the rings, writing the events to the file if `keep`, and free the rings of threads
+    //! that have exited (call with `lock` held)
+    void drain(const bool keep = true) {
+        for (auto it = rings.begin(); it != rings.end();) {
+            // a thread that had exited before the ring was emptied has nothing more to add
+            const bool exited = (*it)->exited.load(memory_order_acquire);
+            const string events = (*it)->ring.pop((*it)->ring.capacity());
+            if (keep) {
+                out.write(events.data(), events.size());
+            }
+            it = exited ? rings.erase(it) : next(it);
+        }
+    }
+
+    //! A program that never called TCPTracer::stop() still gets its trace
+    ~TraceCollector() {
+        running = false;
+        if (collector.joinable()) {
+            collector.join();
+            drain();
+        }
+    }
+};
+
+static TraceCollector &trace_collector() {
+    static TraceCollector collector;
+    return collector;
+}
+
+//! The calling thread's ring, which it marks as exited when the thread ends
+class ThreadRing {
+  private:
+    shared_ptr<TraceRing> _ring{};
+
+  public:
+    ThreadRing() = default;
+    ThreadRing(const ThreadRing &other) = delete;
+    ThreadRing &operator=(const ThreadRing &other) = delete;
+    ~ThreadRing() {
+        if (_ring) {
+            _ring->exited.store(true, memory_order_release);
+        }
+    }
+
+    TraceRing &get() {
+        if (not _ring) {
+            TraceCollector &collector = trace_collector();
+            lock_guard<mutex> lock(collector.lock);
+            _ring = make_shared<TraceRing>();
+            _ring->thread = uint16_t(min(collector.threads++, size_t{TCPTraceEvent::MANY_THREADS}));
+            collector.rings.push_back(_ring);
+        }
+        return *_ring;
+    }
+};
+
+static thread_local ThreadRing this_thread_ring{};
+
+void TCPTracer::_record(TCPTraceEvent &event) {
+    TraceRing &ring = this_thread_ring.get();
+    event.time_us = timestamp_us();
+    event.thread = ring.thread;
+    if (not ring.ring.push_all({reinterpret_cast<const char *>(&event), sizeof(event)})) {
+        trace_collector().dropped.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void TCPTracer::_segment(const TCPTraceEvent::Type type, const uint32_t connection, const TCPSegment &seg) {
+    const TCPHeader &header = seg.header();
+    TCPTraceEvent event;
+    event.type = type;
+    event.connection = connection;
+    event.seqno = header.seqno.raw_value();
+    event.ackno = header.ackno.raw_value();
+    event.window = header.win;
+    event.value = uint32_t(seg.payload().size());
+    event.flags = (header.fin ? TCPTraceEvent::FIN : 0) | (header.syn ? TCPTraceEvent::SYN : 0) |
+                  (header.rst ? TCPTraceEvent::RST : 0) | (header.psh ? TCPTraceEvent::PSH : 0) |
+                  (header.ack ? TCPTraceEvent::ACK : 0) | (header.urg ? TCPTraceEvent::URG : 0);
+    _record(event);
+}
+
+void TCPTracer::_event(const TCPTraceEvent::Type type,
+                       const uint32_t connection,
+                       const uint32_t value,
+                       const uint8_t state) {
+    TCPTraceEvent event;
+    event.type = type;
+    event.connection = connection;
+    event.value = value;
+    event.state = state;
+    _record(event);
+}
+
+//! \param[in] path is the file to write; it is truncated
+//! \throws std::runtime_error if a trace is already being recorded, or the file can't be opened
+void TCPTracer::start(const string &path) {
+    TraceCollector &collector = trace_collector();
+    lock_guard<mutex> lock(collector.lock);
+    if (collector.running) {
+        throw runtime_error("TCPTracer::start: already tracing");
+    }
+
+    collector.out.open(path, ios::binary | ios::trunc);
+    if (not collector.out) {
+        throw runtime_error("TCPTracer::start: can't open " + path);
+    }
+    const uint32_t event_size = sizeof(TCPTraceEvent);
+    collector.out.write(TRACE_MAGIC.data(), TRACE_MAGIC.size());
+    collector.out.write(reinterpret_cast<const char *>(&TRACE_VERSION), sizeof(TRACE_VERSION));
+    collector.out.write(reinterpret_cast<const char *>(&event_size), sizeof(event_size));
+
+    // leftovers from an earlier trace belong to that one
+    collector.drain(false);
+
+    collector.running = true;
+    _enabled = true;
+    collector.collector = thread([&collector] {
+        while (collector.running) {
+            this_thread::sleep_for(COLLECT_INTERVAL);
+            lock_guard<mutex> collector_lock(collector.lock);
+            collector.drain();
+        }
+    });
+}
+
+void TCPTracer::stop() {
+    TraceCollector &collector = trace_collector();
+    if (not collector.running) {
+        return;
+    }
+    _enabled = false;
+    collector.running = false;
+    collector.collector.join();
+
+    lock_guard<mutex> lock(collector.lock);
+    collector.drain();
+    collector.out.close();
+}
+
+uint64_t TCPTracer::dropped() { return trace_collector().dropped; }
+
+size_t TCPTracer::rings() {
+    TraceCollector &collector = trace_collector();
+    lock_guard<mutex> lock(collector.lock);
+    return collector.rings.size();
+}
+
+//! Read a trace file, with events from all threads merged in time order
+static vector<TCPTraceEvent> read_trace(istream &trace) {
+    array<char, 8> magic{};
+    uint32_t version = 0, event_size = 0;
+    trace.read(magic.data(), magic.size());
+    trace.read(reinterpret_cast<char *>(&version), sizeof(version));
+    trace.read(reinterpret_cast<char *>(&event_size), sizeof(event_size));
+    if (not trace or magic != TRACE_MAGIC) {
+        throw runtime_error("not a TCP trace file");
+    }
+    if (version != TRACE_VERSION or event_size != sizeof(TCPTraceEvent)) {
+        throw runtime_error("unsupported TCP trace version " + to_string(version));
+    }
+
+    vector<TCPTraceEvent> events;
+    TCPTraceEvent event;
+    while (trace.read(reinterpret_cast<char *>(&event), sizeof(event))) {
+        events.push_back(event);
+    }
+    stable_sort(events.begin(), events.end(), [](const TCPTraceEvent &a, const TCPTraceEvent &b) {
+        return a.time_us < b.time_us;
+    });
+    return events;
+}
+
+static string flags_string(const uint8_t flags) {
+    string ret;
+    ret += (flags & TCPTraceEvent::SYN) ? "S" : "";
+    ret += (flags & TCPTraceEvent::ACK) ? "A" : "";
+    ret += (flags & TCPTraceEvent::RST) ? "R" : "";
+    ret += (flags & TCPTraceEvent::FIN) ? "F" : "";
+    ret += (flags & TCPTraceEvent::PSH) ? "P" : "";
+    ret += (flags & TCPTraceEvent::URG) ? "U" : "";
+    return ret;
+}
+
+static string state_string(const uint8_t state) {
+    if (state == TCPTraceEvent::UNNAMED_STATE) {
+        return "(unnamed state)";
+    }
+    return TCPState::state_name(TCPState::State(state));
+}
+
+//! \param[in] trace is the trace file
+//! \param[out] out receives one line per event
+//! \throws std::runtime_error if `trace` is not a trace file
+void TCPTracer::decode_text(istream &trace, ostream &out) {
+    const auto events = read_trace(trace);
+    const uint64_t start = events.empty() ? 0 : events.front().time_us;
+
+    for (const auto &event : events) {
+        const uint64_t t = event.time_us - start;
+        out << setw(5) << t / 1000000 << '.' << setw(6) << setfill('0') << t % 1000000 << setfill(' ')
+            << " thread " << event.thread << " conn " << event.connection << ' ';
+        switch (event.type) {
+            case TCPTraceEvent::Type::SegmentSent:
+            case TCPTraceEvent::Type::SegmentReceived:
+                out << (event.type == TCPTraceEvent::Type::SegmentSent ? "tx" : "rx")
+                    << " flags=" << flags_string(event.flags) << " seqno=" << event.seqno
+                    << " ackno=" << event.ackno << " win=" << event.window << " len=" << event.value;
+                break;
+            case TCPTraceEvent::Type::StateChange:
+                out << "state " << state_string(event.state);
+                break;
+            case TCPTraceEvent::Type::TimerFired:
+                out << "timer fired, rto=" << event.value << "us";
+                break;
+            case TCPTraceEvent::Type::WindowUpdate:
+                out << "peer window " << event.value;
+                break;
+            default:
+                out << "unknown event " << unsigned(event.type);
+        }
+        out << '\n';
+    }
+}
+
+//! \param[in] trace is the trace file
+//! \param[out] out receives a JSON object in the Trace Event Format
+//! \throws std::runtime_error if `trace` is not a trace file
+void TCPTracer::decode_chrome_json(istream &trace, ostream &out) {
+    const auto events = read_trace(trace);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    const auto begin = [&](const string &name, const char phase, const TCPTraceEvent &event) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"" << phase
+            << "\",\"ts\":" << event.time_us << ",\"pid\":0,\"tid\":" << event.connection;
+        if (phase == 'i') {
+            out << ",\"s\":\"t\"";
+        }
+        first = false;
+    };
+
+    // one track per connection
+    vector<uint32_t> connections;
+    for (const auto &event : events) {
+        connections.push_back(event.connection);
+    }
+    sort(connections.begin(), connections.end());
+    connections.erase(unique(connections.begin(), connections.end()), connections.end());
+    for (const auto connection : connections) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << connection
+            << ",\"args\":{\"name\":\"connection " << connection << "\"}}";
+        first = false;
+    }
+
+    for (const auto &event : events) {
+        switch (event.type) {
+            case TCPTraceEvent::Type::SegmentSent:
+            case TCPTraceEvent::Type::SegmentReceived:
+                begin(string(event.type == TCPTraceEvent::Type::SegmentSent ? "tx " : "rx ") +
+                          flags_string(event.flags),
+                      'i',
+                      event);
+                out << ",\"args\":{\"seqno\":" << event.seqno << ",\"ackno\":" << event.ackno
+                    << ",\"win\":" << event.window << ",\"len\":" << event.value << ",\"thread\":" << event.thread
+                    << "}}";
+                break;
+            case TCPTraceEvent::Type::StateChange:
+                begin(state_string(event.state), 'i', event);
+                out << "}";
+                break;
+            case TCPTraceEvent::Type::TimerFired:
+                begin("timer fired", 'i', event);
+                out << ",\"args\":{\"rto_us\":" << event.value << "}}";
+                break;
+            case TCPTraceEvent::Type::WindowUpdate:
+                begin("peer window " + to_string(event.connection), 'C', event);
+                out << ",\"args\":{\"window\":" << event.value << "}}";
+                break;
+            default:
+                break;
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,151 @@
+#ifndef SPONGE_LIBSPONGE_TCP_TRACE_HH
+#define SPONGE_LIBSPONGE_TCP_TRACE_HH
+
+#include "tcp_segment.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+//! One binary trace event, as stored in a trace file
+struct TCPTraceEvent {
+    //! What happened
+    enum class Type : uint8_t {
+        SegmentSent = 1,  //!< A connection queued a segment
+        SegmentReceived,  //!< A connection was given a segment
+        StateChange,      //!< The connection's TCPState changed
+        TimerFired,       //!< The retransmission timer expired
+        WindowUpdate,     //!< The peer advertised a different window
+    };
+
+    //! \name TCP flag bits, as in the header
+    //!@{
+    static constexpr uint8_t FIN = 0x01;
+    static constexpr uint8_t SYN = 0x02;
+    static constexpr uint8_t RST = 0x04;
+    static constexpr uint8_t PSH = 0x08;
+    static constexpr uint8_t ACK = 0x10;
+    static constexpr uint8_t URG = 0x20;
+    //!@}
+
+    //! `state` of a StateChange into a state with no official name
+    static constexpr uint8_t UNNAMED_STATE = 0xff;
+
+    //! `thread` of the 65536th thread to record events, and of every one after it
+    static constexpr uint16_t MANY_THREADS = 0xffff;
+
+    uint64_t time_us = 0;           //!< timestamp_us() when the event was recorded
+    uint32_t connection = 0;        //!< Connection id, from TCPTracer::new_connection_id()
+    uint32_t seqno = 0;             //!< Segment's sequence number
+    uint32_t ackno = 0;             //!< Segment's acknowledgment number
+    uint32_t value = 0;             //!< Payload length (segments), RTO in us (timer), or window (window update)
+    uint16_t window = 0;            //!< Segment's window
+    uint16_t thread = 0;            //!< Index of the thread that recorded the event (at most MANY_THREADS)
+    Type type = Type::SegmentSent;  //!< What happened
+    uint8_t flags = 0;              //!< Segment's flags
+    uint8_t state = 0;              //!< New TCPState::State (state change)
+    uint8_t reserved = 0;           //!< Padding, always zero
+};
+
+static_assert(sizeof(TCPTraceEvent) == 32, "trace events are written to files as-is");
+
+//! \brief Records TCPTraceEvent%s into per-thread lock-free rings, which a collector thread writes to a file
+//! \details While tracing is off, each hook costs one relaxed atomic load. While it is on, recording
+//! an event takes a timestamp and a 32-byte copy into the calling thread's SPSCByteRing; nothing is
+//! formatted and no lock is taken. If a ring fills up before the collector empties it, the event
+//! is dropped and counted.
+class TCPTracer {
+  private:
+    static std::atomic_bool _enabled;                  //!< Is a trace being recorded?
+    static std::atomic<uint32_t> _next_connection_id;  //!< Next id for new_connection_id()
+
+    //! Timestamp `event`, and push it to the calling thread's ring
+    static void _record(TCPTraceEvent &event);
+
+    //! Record a segment event
+    static void _segment(const TCPTraceEvent::Type type, const uint32_t connection, const TCPSegment &seg);
+
+    //! Record an event that isn't about a segment
+    static void _event(const TCPTraceEvent::Type type,
+                       const uint32_t connection,
+                       const uint32_t value,
+                       const uint8_t state);
+
+  public:
+    //! Bytes of ring per recording thread (512 Ki events), allocated when the thread first records
+    static constexpr size_t RING_CAPACITY = 16 << 20;
+
+    //! Is a trace being recorded?
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    //! A new id to tag a connection's events with
+    static uint32_t new_connection_id() { return _next_connection_id.fetch_add(1, std::memory_order_relaxed); }
+
+    //! \name Hooks
+    //!@{
+    static void segment_sent(const uint32_t connection, const TCPSegment &seg) {
+        if (enabled()) {
+            _segment(TCPTraceEvent::Type::SegmentSent, connection, seg);
+        }
+    }
+    static void segment_received(const uint32_t connection, const TCPSegment &seg) {
+        if (enabled()) {
+            _segment(TCPTraceEvent::Type::SegmentReceived, connection, seg);
+        }
+    }
+    static void state_change(const uint32_t connection, const uint8_t state) {
+        if (enabled()) {
+            _event(TCPTraceEvent::Type::StateChange, connection, 0, state);
+        }
+    }
+    static void timer_fired(const uint32_t connection, const uint64_t rto_us) {
+        if (enabled()) {
+            _event(TCPTraceEvent::Type::TimerFired, connection, uint32_t(rto_us), 0);
+        }
+    }
+    static void window_update(const uint32_t connection, const uint16_t window) {
+        if (enabled()) {
+            _event(TCPTraceEvent::Type::WindowUpdate, connection, window, 0);
+        }
+    }
+    //!@}
+
+    //! Start writing a trace to the file at `path`
+    static void start(const std::string &path);
+
+    //! Stop tracing, write out every recorded event, and close the file
+    static void stop();
+
+    //! Events dropped so far because a ring was full
+    static uint64_t dropped();
+
+    //! Rings allocated now: one per thread that has recorded, until it exits and its ring is emptied
+    static size_t rings();
+
+    //! \name Offline decoding of a trace file
+    //!@{
+
+    //! One line per event, in time order
+    static void decode_text(std::istream &trace, std::ostream &out);
+
+    //! JSON for the Chrome trace viewer (chrome://tracing or Perfetto), one track per connection
+    static void decode_chrome_json(std::istream &trace, std::ostream &out);
+    //!@}
+};
+
+//! \class TCPTracer
+//! A trace file is a 16-byte header (the magic string "SPNGTRCE", then the format version and
+//! the event size as native 32-bit integers) followed by TCPTraceEvent%s in native byte order.
+//! Each thread's events are in order; decode_text() and decode_chrome_json() merge the threads.
+//!
+//! Events recorded while stop() runs may be lost.
+//!
+//! A thread's ring is freed once the thread has exited and the collector (or stop(), or the
+//! next start()) has emptied it, so a program that keeps starting threads doesn't keep their
+//! rings. Threads are numbered in the order they first record, from 0; numbers are not reused,
+//! and saturate at TCPTraceEvent::MANY_THREADS.
+
+#endif  // SPONGE_LIBSPONGE_TCP_TRACE_HH
@@ -4,3 +4,65 @@ using namespace std;
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
 template class LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialize LossyFdAdapter to TCPOverIPv6OverTunFdAdapter
+template class LossyFdAdapter<TCPOverIPv6OverTunFdAdapter>;
+
+//! \param[in] tap Raw Ethernet device
+//! \param[in] eth_address Ethernet address of the local interface
+//! \param[in] ip_address IP address of the local interface
+//! \param[in] next_hop IP address of the next hop (typically a router or default gateway)
+TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
+                                                               const EthernetAddress &eth_address,
+                                                               const Address &ip_address,
+                                                               const Address &next_hop)
+    : _tap(move(tap)), _interface(eth_address, ip_address), _next_hop(next_hop) {
+    // Linux seems to ignore the first frame sent on a TAP device, so send a dummy frame to prime the pump :-(
+    EthernetFrame dummy_frame;
+    _tap.write(dummy_frame.serialize());
+}
+
+optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
+    // Read the frame straight into a pooled chunk
+    EthernetFrame frame;
+    if (frame.parse(_tap.read_buffer()) != ParseResult::NoError) {
+        return {};
+    }
+
+    // Give the frame to the NetworkInterface. Get back an Internet datagram if frame was carrying one.
+    optional<InternetDatagram> ip_dgram = _interface.recv_frame(frame);
+
+    // The incoming frame may have caused the NetworkInterface to send a frame (an ARP reply or queued datagrams)
+    send_pending();
+
+    // Try to interpret IPv4 datagram as TCP
+    if (ip_dgram) {
+        return unwrap_tcp_in_ip(ip_dgram.value());
+    }
+    return {};
+}
+
+void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
+    write_tcp_in_ip(seg, [&](BufferList ip_dgram) { _interface.send_serialized(std::move(ip_dgram), _next_hop); });
+    send_pending();
+}
+
+//! \param[in] us_since_last_tick the number of microseconds since the last call to this method
+void TCPOverIPv4OverEthernetAdapter::tick_us(const uint64_t us_since_last_tick) {
+    TCPOverIPv4Adapter::tick_us(us_since_last_tick);
+
+    // The interface keeps time in milliseconds; carry the remainder over to the next tick
+    _leftover_us += us_since_last_tick;
+    if (_leftover_us >= 1000) {
+        _interface.tick(_leftover_us / 1000);
+        _leftover_us %= 1000;
+    }
+    send_pending();
+}
+
+void TCPOverIPv4OverEthernetAdapter::send_pending() {
+    while (not _interface.frames_out().empty()) {
+        _tap.write(_interface.frames_out().front().serialize());
+        _interface.frames_out().pop();
+    }
+}
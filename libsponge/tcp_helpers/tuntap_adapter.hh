@@ -1,9 +1,11 @@
 #ifndef SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
 #define SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
 
+#include "network_interface.hh"
 #include "tcp_over_ip.hh"
 #include "tun.hh"
 
+#include <cstdint>
 #include <optional>
 #include <unordered_map>
 #include <utility>
@@ -20,14 +22,16 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
     std::optional<TCPSegment> read() {
         InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+        if (ip_dgram.parse(_tun.read_buffer()) != ParseResult::NoError) {
             return {};
         }
         return unwrap_tcp_in_ip(ip_dgram);
     }
 
-    //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device (in fragments, if it's too big)
+    void write(TCPSegment &seg) {
+        write_tcp_in_ip(seg, [&](BufferList ip_dgram) { _tun.write(std::move(ip_dgram)); });
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
@@ -39,4 +43,69 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
 //! Typedef for TCPOverIPv4OverTunFdAdapter
 using LossyTCPOverIPv4OverTunFdAdapter = LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
 
+//! \brief A FD adapter for IPv6 datagrams read from and written to a TUN device
+class TCPOverIPv6OverTunFdAdapter : public TCPOverIPv6Adapter {
+  private:
+    TunFD _tun;
+
+  public:
+    //! Construct from a TunFD
+    explicit TCPOverIPv6OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
+
+    //! Attempts to read and parse an IPv6 datagram containing a TCP segment related to the current connection
+    std::optional<TCPSegment> read() {
+        IPv6Datagram ip_dgram;
+        if (ip_dgram.parse(_tun.read_buffer()) != ParseResult::NoError) {
+            return {};
+        }
+        return unwrap_tcp_in_ip(ip_dgram);
+    }
+
+    //! Creates an IPv6 datagram from a TCP segment and writes it to the TUN device
+    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+
+    //! Access the underlying TUN device
+    operator TunFD &() { return _tun; }
+
+    //! Access the underlying TUN device
+    operator const TunFD &() const { return _tun; }
+};
+
+//! Typedef for TCPOverIPv6OverTunFdAdapter
+using LossyTCPOverIPv6OverTunFdAdapter = LossyFdAdapter<TCPOverIPv6OverTunFdAdapter>;
+
+//! \brief A FD adapter for IPv4 datagrams read from and written to a TAP device, via a NetworkInterface
+class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
+  private:
+    TapFD _tap;                   //!< Raw Ethernet connection
+    NetworkInterface _interface;  //!< NIC abstraction, which resolves next hops with ARP
+    Address _next_hop;            //!< IP address of the next hop (the other end of the TAP device)
+    uint64_t _leftover_us = 0;    //!< Time passed to tick_us() that hasn't added up to a millisecond yet
+
+    //! Write every frame the interface has queued to the TAP device
+    void send_pending();
+
+  public:
+    //! Construct from a TapFD, the interface's own addresses, and the next hop to send every datagram to
+    TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
+                                   const EthernetAddress &eth_address,
+                                   const Address &ip_address,
+                                   const Address &next_hop);
+
+    //! Attempts to read and parse an Ethernet frame containing an IPv4 datagram that contains a TCP segment
+    std::optional<TCPSegment> read();
+
+    //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame)
+    void write(TCPSegment &seg);
+
+    //! Advances the interface's ARP timers, and sends any frames that became ready
+    void tick_us(const uint64_t us_since_last_tick);
+
+    //! Access the underlying TAP device
+    operator TapFD &() { return _tap; }
+
+    //! Access the underlying TAP device
+    operator const TapFD &() const { return _tap; }
+};
+
 #endif  // SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
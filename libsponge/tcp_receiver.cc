@@ -1,5 +1,9 @@
 #include "tcp_receiver.hh"
 
+#include "memory_accountant.hh"
+
+#include <algorithm>
+
 // TCP接收器的虚拟实现
 
 // 在实验2中，请用能够通过`make check_lab2`自动检查的真实实现替换此虚拟实现。
@@ -25,7 +29,7 @@ void TCPReceiver::segment_received(const TCPSegment &seg)
         _syn = seg.header().syn;
 
         // 将段的载荷推入重新组装器，起始索引为 0，结束标志为段的 FIN 标志
-        _reassembler.push_substring(seg.payload().copy(), 0, seg.header().fin);
+        _reassembler.push_substring(seg.payload().str(), 0, seg.header().fin);
         return;
     }
 
@@ -33,7 +37,7 @@ void TCPReceiver::segment_received(const TCPSegment &seg)
     uint64_t abs_seqno = unwrap(seg.header().seqno, _isn, _reassembler.first_unassembled());
 
     // 将段的载荷推入重新组装器，起始索引为 abs_seqno - 1，结束标志为段的 FIN 标志
-    _reassembler.push_substring(seg.payload().copy(), abs_seqno - 1, seg.header().fin);
+    _reassembler.push_substring(seg.payload().str(), abs_seqno - 1, seg.header().fin);
 }
 
 
@@ -61,6 +65,44 @@ optional<WrappingInt32> TCPReceiver::ackno() const
 // 函数功能：计算TCP接收器当前的窗口大小
 size_t TCPReceiver::window_size() const 
 { 
+    // 窗口大小会被通告给对端，记下它的右沿
+    _right_edge = max(_right_edge, uint64_t{_reassembler.first_unacceptable()});
+
     // 窗口大小为第一个不可以接受的索引位置  减去  第一个未重组的索引位置
     return _reassembler.first_unacceptable() - _reassembler.first_unassembled(); 
 }
+
+
+
+// 函数功能：接收缓冲区自动调整（dynamic right-sizing）
+void TCPReceiver::tick_us(const uint64_t us_since_last_tick, const uint64_t rtt_us)
+{
+    // 未开启自动调整，也没有因为内存紧张缩小过
+    const bool pressure = MemoryAccountant::under_pressure();
+    if (_max_capacity == _min_capacity && _capacity == _min_capacity && !pressure)
+        return;
+
+    _epoch_elapsed += us_since_last_tick;
+    if (_epoch_elapsed < rtt_us)
+        return;
+
+    // 这一轮（一个 RTT）中应用读走的字节数
+    const uint64_t bytes_read = stream_out().bytes_read();
+    const uint64_t consumed = bytes_read - _epoch_bytes_read;
+    _epoch_elapsed = 0;
+    _epoch_bytes_read = bytes_read;
+
+    // 没有压力时至少恢复到初始容量
+    size_t target = max(_capacity, _min_capacity);
+    if (pressure)
+        target = max(min(_min_capacity, PRESSURE_MIN_CAPACITY), _capacity / 2);
+    else if (2 * consumed > _capacity)
+        target = max(target, min(_max_capacity, size_t(2 * consumed)));
+
+    // 不让已经通告的窗口右沿后退
+    target = max(target, size_t(_right_edge - _reassembler.first_unread()));
+    if (target != _capacity) {
+        _reassembler.set_capacity(target);
+        _capacity = _reassembler.capacity();
+    }
+}
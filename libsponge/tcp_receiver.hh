@@ -7,6 +7,7 @@
 #include "wrapping_integers.hh"
 
 
+#include <algorithm>
 #include <optional>
 
 // TCP 实现中的 "接收方" 部分
@@ -15,6 +16,11 @@
 
 
 class TCPReceiver {
+  public:
+    // 内存紧张时容量最多缩到这么小（初始容量更小时缩到初始容量）
+    static constexpr size_t PRESSURE_MIN_CAPACITY = 4096;
+
+  private:
     // 我们用于重新组装字节的数据结构。
     // 重组器
     StreamReassembler _reassembler;
@@ -22,6 +28,18 @@ class TCPReceiver {
     // 我们将存储的最大字节数量。
     size_t _capacity;
 
+    // 接收缓冲区自动调整（dynamic right-sizing）：容量在 [_min_capacity, _max_capacity] 之间变化，
+    // 两者相等时不调整
+    size_t _min_capacity;
+    size_t _max_capacity;
+
+    // 当前这一轮测量（约一个 RTT）已经过去的时间，以及这一轮开始时应用已经读取的字节数
+    uint64_t _epoch_elapsed{0};
+    uint64_t _epoch_bytes_read{0};
+
+    // 通告过的最远的窗口右沿（绝对索引），由 window_size() 记录：缩小容量时不能让它后退
+    mutable uint64_t _right_edge{0};
+
 
     // 表示这个TCP段是否是一个SYN包。
     // 在建立连接时，SYN段用于在发送方和接收方之间同步序列号。
@@ -44,9 +62,12 @@ class TCPReceiver {
     // _capacity: 接收器的缓冲区最大容量，即最多可以存储的字节数
     // _syn: 是否已接收到 SYN 标志的状态，初始为 false，表示尚未接收到 SYN 标志
     // _isn: 初始序列号，初始为 0，用于确定数据流的起始序列号
-    TCPReceiver(const size_t capacity)
+    // max_capacity 大于 capacity 时开启自动调整，容量从 capacity 开始，最多长到 max_capacity
+    TCPReceiver(const size_t capacity, const size_t max_capacity = 0)
         : _reassembler(capacity), 
           _capacity(capacity), 
+          _min_capacity(capacity),
+          _max_capacity(std::max(capacity, max_capacity)),
           _syn(false), 
           _isn(0) 
         {}
@@ -60,7 +81,7 @@ class TCPReceiver {
 
 
     // 这是接收窗口的起始，或者说，接收器尚未接收到的流中第一个字节的序列号。
-    optional<WrappingInt32> ackno() const;
+    std::optional<WrappingInt32> ackno() const;
     
 
     // 应发送给对等方的窗口大小
@@ -79,10 +100,28 @@ class TCPReceiver {
     // 存储但尚未重新组装的字节数量
     size_t unassembled_bytes() const { return _reassembler.unassembled_bytes(); }
 
+    // 重组器丢弃的重复字节数、窗口外字节数，以及内存紧张时丢弃的乱序字节数
+    uint64_t duplicate_bytes() const { return _reassembler.duplicate_bytes(); }
+    uint64_t out_of_window_bytes() const { return _reassembler.out_of_window_bytes(); }
+    uint64_t dropped_bytes() const { return _reassembler.dropped_bytes(); }
+
+    // 丢弃乱序片段（内存紧张时使用），返回丢弃的字节数
+    size_t drop_unassembled() { return _reassembler.drop_unassembled(); }
+
 
     // 处理传入的段
     void segment_received(const TCPSegment &seg);
 
+    // 自动调整接收缓冲区。每过一个 RTT，看应用读走了多少字节：
+    // 读走的超过容量的一半，说明窗口限制了对端，容量长到读走量的两倍（不超过 _max_capacity）；
+    // 内存紧张时（见 MemoryAccountant::under_pressure()）容量减半，但不小于 PRESSURE_MIN_CAPACITY
+    // （不开启自动调整的接收器也是这样），压力过去后再回到初始容量。
+    // 容量缩小时窗口右沿不后退，随着应用读取逐渐收拢
+    void tick_us(const uint64_t us_since_last_tick, const uint64_t rtt_us);
+
+    // 当前容量
+    size_t capacity() const { return _capacity; }
+
 
     // 读取器的“输出”接口
     ByteStream &stream_out() { return _reassembler.stream_out(); }
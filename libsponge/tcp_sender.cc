@@ -1,7 +1,10 @@
 #include "tcp_sender.hh"
 
+#include "memory_accountant.hh"
 #include "tcp_config.hh"
 
+#include <algorithm>
+
 // 头文件用处：生成随机数
 #include <random>
 // 一个TCP发送器的虚拟实现
@@ -17,8 +20,18 @@ using namespace std;
 // 如果设置，则使用初始序列号（否则使用随机 ISN）
 TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
     : _isn(fixed_isn.value_or(WrappingInt32{random_device()()}))
-    , _initial_retransmission_timeout{retx_timeout}
-    , _stream(capacity) {}
+    , _initial_retransmission_timeout{uint64_t{retx_timeout} * 1000}
+    , _stream(capacity)
+    , _min_capacity(capacity)
+    , _max_capacity(capacity) {}
+
+// 发送容量、超时重传初始值（微秒）和初始序列号都取自配置
+TCPSender::TCPSender(const TCPConfig &cfg)
+    : _isn(cfg.fixed_isn.value_or(WrappingInt32{random_device()()}))
+    , _initial_retransmission_timeout{cfg.initial_rto_us()}
+    , _stream(cfg.send_capacity)
+    , _min_capacity(cfg.send_capacity)
+    , _max_capacity(max(cfg.send_capacity, cfg.send_capacity_max)) {}
 
 
 // 函数功能：返回当前发送方在网络中保留的字节数
@@ -59,7 +72,7 @@ void TCPSender::fill_window()
         {
             // 根据窗口大小，调整发送的数据大小
             size_t payload_size = min(TCPConfig::MAX_PAYLOAD_SIZE, remaining_win);
-            seg.payload() = Buffer(stream_in().read(payload_size));
+            seg.payload() = stream_in().read_buffer(payload_size);
 
             // 如果流结束且长度小于剩余窗口，设置FIN标志
             if (stream_in().eof() && seg.length_in_sequence_space() < remaining_win)
@@ -86,7 +99,8 @@ void TCPSender::fill_window()
 
 // 远程接收方的确认号
 // 远程接收方公布的窗口大小
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+// 该段是否为纯 ACK
+void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size, const bool pure_ack) {
     uint64_t abs_ack = unwrap(ackno, _isn, _last_ackno);
     //解包出绝对确认号
 
@@ -94,15 +108,25 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     if (abs_ack > _next_seqno)
         return;
 
+    // 确认号和窗口都没变，且还有数据在飞行中：重复 ACK（RFC 5681）
+    if (pure_ack && abs_ack == _last_ackno && window_size == _last_win && bytes_in_flight() > 0)
+        _dupacks++;
+
     // 若确认序列号大于前一次确认序列号，则更新
     if (abs_ack > _last_ackno) {
         _last_ackno = abs_ack;
 
+        // 计时的段已被确认，得到一个 RTT 样本
+        if (_rtt_timing && abs_ack >= _rtt_seqno) {
+            _rtt_timing = false;
+            rtt_sample(_now - _rtt_start);
+        }
+
         // 若未发送数据段队列不为空
         while (!_outstanding_seg.empty()) {
             const TCPSegment &seg = _outstanding_seg.front();
-            // 队首已发送
-            if (seg.header().seqno.raw_value() + seg.length_in_sequence_space() <= ackno.raw_value())
+            // 队首已被完全确认：用绝对序列号比较，32 位序列号回绕时也成立
+            if (unwrap(seg.header().seqno, _isn, _last_ackno) + seg.length_in_sequence_space() <= abs_ack)
                 _outstanding_seg.pop();
             else
                 break;
@@ -126,12 +150,33 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
 
 
 // 自上次调用此方法以来的毫秒数
-void TCPSender::tick(const size_t ms_since_last_tick) {
+void TCPSender::tick(const size_t ms_since_last_tick) { tick_us(uint64_t{ms_since_last_tick} * 1000); }
+
+// 自上次调用此方法以来的微秒数
+void TCPSender::tick_us(const uint64_t us_since_last_tick) {
+    _now += us_since_last_tick;
+    autotune(us_since_last_tick);
+
+    // 这段时间受什么限制：有数据没发出去但窗口已满，还是窗口有空间但应用没有数据（握手完成后才统计）
+    if (_last_ackno > 0) {
+        const uint64_t win = _last_win == 0 ? 1 : _last_win;
+        const bool has_unsent = stream_in().buffer_size() > 0 || 
+                                (stream_in().input_ended() && next_seqno_absolute() < stream_in().bytes_written() + 2);
+        if (has_unsent && bytes_in_flight() >= win)
+            _rwnd_limited_time += us_since_last_tick;
+        else if (!has_unsent && !stream_in().input_ended())
+            _app_limited_time += us_since_last_tick;
+    }
+
     // 判断是否超时
-    _timer.tick(ms_since_last_tick);
+    _timer.tick(us_since_last_tick);
 
     // 若未发送队列不为空，且时间时间已过期
     if (!_outstanding_seg.empty() && _timer.is_expired()) {
+        _rto_expirations++;
+        _retransmitted_segments++;
+        // Karn 算法：重传后的确认无法区分是哪一次发送的，放弃本次计时
+        _rtt_timing = false;
         _segments_out.push(_outstanding_seg.front());
         if (_last_win > 0) {
             _retransmission_count++;
@@ -146,15 +191,78 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
 }
 
 
+// 函数功能：发送缓冲区自动调整。
+// 缓冲区里的字节还没有发出，要让应用在一个 RTT 内写入的量跟得上发送量，
+// 容量取上一个 RTT 在途字节数的两倍；内存紧张时（见 MemoryAccountant::under_pressure()）退回初始容量
+void TCPSender::autotune(const uint64_t us_since_last_tick) {
+    if (_max_capacity == _min_capacity) {
+        return;
+    }
+
+    _epoch_elapsed += us_since_last_tick;
+    if (_epoch_elapsed < _srtt.value_or(_initial_retransmission_timeout)) {
+        return;
+    }
+
+    const size_t target = MemoryAccountant::under_pressure()
+                              ? _min_capacity
+                              : clamp(size_t(2 * _epoch_max_in_flight), _min_capacity, _max_capacity);
+    _stream.set_capacity(target);
+    _epoch_elapsed = 0;
+    _epoch_max_in_flight = bytes_in_flight();
+}
+
+
+// 计时器启动时，返回距离超时的微秒数
+optional<uint64_t> TCPSender::time_until_timeout_us() const {
+    if (!_timer.is_start()) {
+        return {};
+    }
+    return _timer.remaining_time();
+}
+
+// 队列空了就换成一个没有分配存储的新队列
+void TCPSender::release_idle_storage() {
+    _stream.release_storage();
+    if (_segments_out.empty()) {
+        TCPSegmentQueue{}.swap(_segments_out);
+    }
+    if (_outstanding_seg.empty()) {
+        TCPSegmentQueue{}.swap(_outstanding_seg);
+    }
+}
+
 // 返回连续重传次数
 unsigned int TCPSender::consecutive_retransmissions() const { return _retransmission_count; }
 
+// 按 RFC 6298 更新平滑 RTT 和 RTT 偏差（只用于统计，RTO 仍按原规则计算）
+void TCPSender::rtt_sample(const uint64_t rtt) {
+    if (!_srtt.has_value()) {
+        _srtt = rtt;
+        _rttvar = rtt / 2;
+        return;
+    }
+    const uint64_t srtt = _srtt.value();
+    const uint64_t err = srtt > rtt ? srtt - rtt : rtt - srtt;
+    _rttvar = (3 * _rttvar + err) / 4;
+    _srtt = (7 * srtt + rtt) / 8;
+}
+
 void TCPSender::send_segment(TCPSegment &seg) {
     seg.header().seqno = next_seqno();
     _next_seqno += seg.length_in_sequence_space();
 
-    _segments_out.push(seg);// 待发送队列
+    // 两个队列共享同一份载荷（只增加引用计数，不复制数据）
     _outstanding_seg.push(seg);// 未发送队列
+    _segments_out.push(move(seg));// 待发送队列
+    _epoch_max_in_flight = max(_epoch_max_in_flight, bytes_in_flight());
+
+    // 若没有段在计时，则对这个段计时
+    if (!_rtt_timing) {
+        _rtt_timing = true;
+        _rtt_seqno = _next_seqno;
+        _rtt_start = _now;
+    }
 
     if (!_timer.is_start()) {
         _timer.start(_RTO);
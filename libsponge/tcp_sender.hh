@@ -6,17 +6,19 @@
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <queue>
 
 
-//重传计时器
+//重传计时器（以微秒计时）
 class RetransmissionTimer {
   public:
-    void start(const unsigned int rto) {  // 开始计时
+    void start(const uint64_t rto_us) {  // 开始计时
         _is_started = true;
         _is_expired = false;
-        _remaining_time = rto;
+        _remaining_time = rto_us;
     }
 
     void stop() {  //停止计时
@@ -26,8 +28,8 @@ class RetransmissionTimer {
     }
 
     // 超时重传 若超出剩余时间，则设定已超时
-    // 自上次计时以来
-    void tick(const size_t ms_since_last_tick) 
+    // 自上次计时以来的微秒数
+    void tick(const uint64_t us_since_last_tick) 
     {
         // 未开始计时
         if (!is_start()) 
@@ -35,25 +37,29 @@ class RetransmissionTimer {
             return;
         }
         // 超时
-        if (ms_since_last_tick >= _remaining_time) {
+        if (us_since_last_tick >= _remaining_time) {
             _is_expired = true;
+            _remaining_time = 0;
         }
         // 未超时 
         else 
         {
-            _remaining_time -= ms_since_last_tick;
+            _remaining_time -= us_since_last_tick;
         }
     }
 
     // 超时
-    bool is_expired() { return _is_expired && _is_started; }
-    bool is_start() { return _is_started; }
+    bool is_expired() const { return _is_expired && _is_started; }
+    bool is_start() const { return _is_started; }
+
+    // 距离超时还剩多少微秒
+    uint64_t remaining_time() const { return _remaining_time; }
 
 
   
   private:
-    // 剩余时间 
-    unsigned int _remaining_time{0};
+    // 剩余时间（微秒）
+    uint64_t _remaining_time{0};
     // 已超时
     bool _is_expired{false};
     // 已开始计时
@@ -73,10 +79,10 @@ class TCPSender {
     WrappingInt32 _isn;
 
     // TCPSender 想要发送的段的出向队列
-    std::queue<TCPSegment> _segments_out{};
+    TCPSegmentQueue _segments_out{};
 
-    // 此连接的重传定时器的时间
-    unsigned int _initial_retransmission_timeout;
+    // 此连接的重传定时器的时间（微秒）
+    uint64_t _initial_retransmission_timeout;
 
     // 尚未发送的传出字节流
     ByteStream _stream;
@@ -85,7 +91,7 @@ class TCPSender {
     uint64_t _next_seqno{0};
 
   private:
-    unsigned int _RTO{_initial_retransmission_timeout};  // 当前超时重传
+    uint64_t _RTO{_initial_retransmission_timeout};      // 当前超时重传（微秒）
     unsigned int _retransmission_count{0};               // 连续重传的次数
 
     // 上一次接收到的
@@ -97,7 +103,35 @@ class TCPSender {
     RetransmissionTimer _timer{};
 
     // 尚未发送的段
-    std::queue<TCPSegment> _outstanding_seg{};
+    TCPSegmentQueue _outstanding_seg{};
+
+    // 统计信息：都只是计数器，开销很小，可以一直开着
+    uint64_t _now{0};                      // 所有 tick 累计的时间（微秒），用于测量 RTT
+    uint64_t _retransmitted_segments{0};   // 重传的段数
+    uint64_t _rto_expirations{0};          // 重传计时器超时的次数
+    uint64_t _dupacks{0};                  // 重复 ACK 的个数
+    uint64_t _rwnd_limited_time{0};        // 有数据要发但接收窗口已满的时间（微秒）
+    uint64_t _app_limited_time{0};         // 窗口有空间但应用没有数据可发的时间（微秒）
+
+    // RTT 测量（Karn 算法：一次只对一个段计时，重传过的段不计）
+    bool _rtt_timing{false};               // 是否有段正在计时
+    uint64_t _rtt_seqno{0};                // 计时段之后的绝对序列号，确认到这里即得到一个样本
+    uint64_t _rtt_start{0};                // 计时段的发送时间
+    std::optional<uint64_t> _srtt{};       // 平滑 RTT（微秒），RFC 6298
+    uint64_t _rttvar{0};                   // RTT 偏差（微秒）
+
+    // 记录一个 RTT 样本
+    void rtt_sample(const uint64_t rtt);
+
+    // 发送缓冲区自动调整：容量在 [_min_capacity, _max_capacity] 之间（两者相等时不调整），
+    // 取上一个 RTT 中在途字节数最大值的两倍
+    size_t _min_capacity;
+    size_t _max_capacity;
+    uint64_t _epoch_elapsed{0};        // 这一轮测量（约一个 RTT）已经过去的时间
+    uint64_t _epoch_max_in_flight{0};  // 这一轮中在途字节数的最大值
+
+    // 每个 RTT 调整一次发送缓冲区的容量
+    void autotune(const uint64_t us_since_last_tick);
     
     // 发送段
     void send_segment(TCPSegment &seg);
@@ -108,6 +142,9 @@ class TCPSender {
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
               const std::optional<WrappingInt32> fixed_isn = {});
 
+    // 根据配置初始化TCPSender（超时重传初始值可精确到微秒）
+    explicit TCPSender(const TCPConfig &cfg);
+
     // \name "Input" interface for the writer 输入接口
     // 
     ByteStream &stream_in() { return _stream; }
@@ -116,7 +153,8 @@ class TCPSender {
     // 使TCPSender发送段的方法
 
     // 收到新的ACK消息
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    // pure_ack 表示该段不携带数据、SYN 或 FIN（只有这样的段才可能算作重复 ACK）
+    void ack_received(const WrappingInt32 ackno, const uint16_t window_size, const bool pure_ack = true);
 
     // 生成空有效载荷段（用于创建空 ACK 段）
     void send_empty_segment();
@@ -127,6 +165,15 @@ class TCPSender {
     //! 通知 TCPSender 超时时间已到
     void tick(const size_t ms_since_last_tick);
 
+    //! 同 tick()，以微秒为单位
+    void tick_us(const uint64_t us_since_last_tick);
+
+    //! 距离重传计时器超时还剩多少微秒（计时器未启动时为空）
+    std::optional<uint64_t> time_until_timeout_us() const;
+
+    //! 已经清空的队列和读空的流释放它们的存储（连接空闲时由 TCPConnection 调用）
+    void release_idle_storage();
+
 
     //! \name Accessors 访问器
 
@@ -140,10 +187,22 @@ class TCPSender {
     //! 返回连续重传的次数
     unsigned int consecutive_retransmissions() const;
 
+    //! 统计信息（见 TCPStats）
+    //!@{
+    uint64_t retransmitted_segments() const { return _retransmitted_segments; }
+    uint64_t rto_expirations() const { return _rto_expirations; }
+    uint64_t dupacks() const { return _dupacks; }
+    uint64_t rwnd_limited_us() const { return _rwnd_limited_time; }
+    uint64_t app_limited_us() const { return _app_limited_time; }
+    std::optional<uint64_t> srtt_us() const { return _srtt; }
+    uint64_t rttvar_us() const { return _rttvar; }
+    uint64_t rto_us() const { return _RTO; }
+    //!@}
+
     //! 排队等待传输的 TCPSegments。
     //! 这些必须由 TCPConnection 出队并发送，
     //! TCPConnection 需要在发送之前填写由 TCPReceiver 设置的字段（ackno 和窗口大小）。
-    std::queue<TCPSegment> &segments_out() { return _segments_out; }
+    TCPSegmentQueue &segments_out() { return _segments_out; }
 
 
 
@@ -3,6 +3,7 @@
 #include "util.hh"
 
 #include <arpa/inet.h>
+#include <array>
 #include <cstring>
 #include <memory>
 #include <netdb.h>
@@ -80,11 +81,11 @@ static inline addrinfo make_hints(const int ai_flags, const int ai_family) {
 Address::Address(const string &hostname, const string &service)
     : Address(hostname, service, make_hints(AI_ALL, AF_INET)) {}
 
-//! \param[in] ip address as a dotted quad ("1.1.1.1")
+//! \param[in] ip address as a dotted quad ("1.1.1.1") or in IPv6 notation ("2001:db8::1")
 //! \param[in] port number
 Address::Address(const string &ip, const uint16_t port)
     // tell getaddrinfo that we don't want to resolve anything
-    : Address(ip, ::to_string(port), make_hints(AI_NUMERICHOST | AI_NUMERICSERV, AF_INET)) {}
+    : Address(ip, ::to_string(port), make_hints(AI_NUMERICHOST | AI_NUMERICSERV, AF_UNSPEC)) {}
 
 // accessors
 pair<string, uint16_t> Address::ip_port() const {
@@ -102,6 +103,9 @@ pair<string, uint16_t> Address::ip_port() const {
 
 string Address::to_string() const {
     const auto ip_and_port = ip_port();
+    if (is_ipv6()) {
+        return "[" + ip_and_port.first + "]:" + ::to_string(ip_and_port.second);
+    }
     return ip_and_port.first + ":" + ::to_string(ip_and_port.second);
 }
 
@@ -124,6 +128,28 @@ Address Address::from_ipv4_numeric(const uint32_t ip_address) {
     return {reinterpret_cast<sockaddr *>(&ipv4_addr), sizeof(ipv4_addr)};
 }
 
+IPv6Numeric Address::ipv6_numeric() const {
+    if (not is_ipv6() or _size != sizeof(sockaddr_in6)) {
+        throw runtime_error("ipv6_numeric called on non-IPV6 address");
+    }
+
+    sockaddr_in6 ipv6_addr{};
+    memcpy(&ipv6_addr, &_address.storage, _size);
+
+    IPv6Numeric ret{};
+    memcpy(ret.data(), &ipv6_addr.sin6_addr, ret.size());
+    return ret;
+}
+
+Address Address::from_ipv6_numeric(const IPv6Numeric &ip_address, const uint16_t port) {
+    sockaddr_in6 ipv6_addr{};
+    ipv6_addr.sin6_family = AF_INET6;
+    ipv6_addr.sin6_port = htobe16(port);
+    memcpy(&ipv6_addr.sin6_addr, ip_address.data(), ip_address.size());
+
+    return {reinterpret_cast<sockaddr *>(&ipv6_addr), sizeof(ipv6_addr)};
+}
+
 // equality
 bool Address::operator==(const Address &other) const {
     if (_size != other._size) {
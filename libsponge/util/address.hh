@@ -1,6 +1,7 @@
 #ifndef SPONGE_LIBSPONGE_ADDRESS_HH
 #define SPONGE_LIBSPONGE_ADDRESS_HH
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <netdb.h>
@@ -9,7 +10,10 @@
 #include <sys/socket.h>
 #include <utility>
 
-//! Wrapper around [IPv4 addresses](@ref man7::ip) and DNS operations.
+//! An [IPv6](\ref rfc::rfc8200) address, as 16 bytes in network byte order
+using IPv6Numeric = std::array<uint8_t, 16>;
+
+//! Wrapper around [IPv4](@ref man7::ip) and [IPv6](@ref man7::ipv6) addresses and DNS operations.
 class Address {
   public:
     //! \brief Wrapper around [sockaddr_storage](@ref man7::socket).
@@ -32,7 +36,7 @@ class Address {
     //! Construct by resolving a hostname and servicename.
     Address(const std::string &hostname, const std::string &service);
 
-    //! Construct from dotted-quad string ("18.243.0.1") and numeric port.
+    //! Construct from dotted-quad ("18.243.0.1") or IPv6 ("2001:db8::1") string and numeric port.
     Address(const std::string &ip, const std::uint16_t port = 0);
 
     //! Construct from a [sockaddr *](@ref man7::socket).
@@ -45,9 +49,9 @@ class Address {
     //! \name Conversions
     //!@{
 
-    //! Dotted-quad IP address string ("18.243.0.1") and numeric port.
+    //! IP address string ("18.243.0.1" or "2001:db8::1") and numeric port.
     std::pair<std::string, uint16_t> ip_port() const;
-    //! Dotted-quad IP address string ("18.243.0.1").
+    //! IP address string ("18.243.0.1" or "2001:db8::1").
     std::string ip() const { return ip_port().first; }
     //! Numeric port (host byte order).
     uint16_t port() const { return ip_port().second; }
@@ -55,7 +59,13 @@ class Address {
     uint32_t ipv4_numeric() const;
     //! Create an Address from a 32-bit raw numeric IP address
     static Address from_ipv4_numeric(const uint32_t ip_address);
-    //! Human-readable string, e.g., "8.8.8.8:53".
+    //! Whether this is an IPv6 address.
+    bool is_ipv6() const { return _address.storage.ss_family == AF_INET6; }
+    //! Numeric IPv6 address, in network byte order.
+    IPv6Numeric ipv6_numeric() const;
+    //! Create an Address from a raw numeric IPv6 address and a port.
+    static Address from_ipv6_numeric(const IPv6Numeric &ip_address, const uint16_t port = 0);
+    //! Human-readable string, e.g., "8.8.8.8:53" or "[2001:db8::1]:53".
     std::string to_string() const;
     //!@}
 
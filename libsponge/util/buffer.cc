@@ -1,14 +1,198 @@
 #include "buffer.hh"
 
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 using namespace std;
 
+namespace {
+// storage can be released by destructors that run after the thread's pool has gone; it's then just freed
+thread_local bool pool_destroyed = false;
+
+// set by Buffer::set_thread_confined()
+thread_local bool thread_confined = false;
+
+// chunks shared between threads, and every slab ever allocated (so none is ever reported as leaked)
+class SlabDepot {
+  private:
+    std::mutex _mutex{};
+    std::vector<char *> _free{};
+    std::vector<std::unique_ptr<char[]>> _slabs{};
+
+  public:
+    // up to `n` chunks into `out`, from the depot or a new slab
+    void take(std::vector<char *> &out, const size_t n) {
+        lock_guard lock{_mutex};
+        if (_free.empty()) {
+            constexpr size_t slab_size = SlabAllocator::CHUNK_SIZE * SlabAllocator::CHUNKS_PER_SLAB;
+            auto &slab = _slabs.emplace_back(make_unique<char[]>(slab_size));
+            for (size_t i = 0; i < SlabAllocator::CHUNKS_PER_SLAB; i++) {
+                _free.push_back(slab.get() + i * SlabAllocator::CHUNK_SIZE);
+            }
+        }
+        const size_t count = min(n, _free.size());
+        out.insert(out.end(), _free.end() - count, _free.end());
+        _free.resize(_free.size() - count);
+    }
+
+    // the last `n` chunks of `chunks`
+    void give(std::vector<char *> &chunks, const size_t n) {
+        lock_guard lock{_mutex};
+        _free.insert(_free.end(), chunks.end() - n, chunks.end());
+        chunks.resize(chunks.size() - n);
+    }
+};
+
+// never destroyed, so chunks can be freed during static destruction
+SlabDepot &depot() {
+    static SlabDepot *const depot = new SlabDepot;
+    return *depot;
+}
+
+// as pool_destroyed, for the thread's chunk cache
+thread_local bool cache_destroyed = false;
+
+// a thread's free chunks, exchanged with the depot a slab's worth at a time
+class ChunkCache {
+  private:
+    std::vector<char *> _free{};
+
+  public:
+    ChunkCache() { _free.reserve(2 * SlabAllocator::CHUNKS_PER_SLAB); }
+    ChunkCache(const ChunkCache &other) = delete;
+    ChunkCache &operator=(const ChunkCache &other) = delete;
+    ~ChunkCache() {
+        cache_destroyed = true;
+        depot().give(_free, _free.size());
+    }
+
+    char *allocate() {
+        if (_free.empty()) {
+            depot().take(_free, SlabAllocator::CHUNKS_PER_SLAB);
+        }
+        char *chunk = _free.back();
+        _free.pop_back();
+        return chunk;
+    }
+
+    void free(char *chunk) {
+        if (_free.size() == 2 * SlabAllocator::CHUNKS_PER_SLAB) {
+            depot().give(_free, SlabAllocator::CHUNKS_PER_SLAB);
+        }
+        _free.push_back(chunk);
+    }
+};
+
+thread_local ChunkCache chunk_cache{};
+}  // namespace
+
+char *SlabAllocator::allocate() {
+    if (cache_destroyed) {
+        vector<char *> one;
+        depot().take(one, 1);
+        return one.front();
+    }
+    return chunk_cache.allocate();
+}
+
+void SlabAllocator::free(char *chunk) {
+    if (cache_destroyed) {
+        vector<char *> one{chunk};
+        depot().give(one, 1);
+        return;
+    }
+    chunk_cache.free(chunk);
+}
+
+//! A thread's BufferStorage%s waiting to be reused
+class BufferPool {
+  private:
+    BufferStorage *_free = nullptr;
+    size_t _size = 0;
+
+  public:
+    //! Most storage a pool keeps; more is freed
+    static constexpr size_t MAX_SIZE = 4096;
+    //! Larger strings are freed rather than kept, so one big Buffer doesn't pin its memory
+    static constexpr size_t MAX_CAPACITY = 64 * 1024;
+
+    BufferPool() = default;
+    BufferPool(const BufferPool &other) = delete;
+    BufferPool &operator=(const BufferPool &other) = delete;
+
+    ~BufferPool() {
+        pool_destroyed = true;
+        while (_free) {
+            delete exchange(_free, _free->_next_free);
+        }
+    }
+
+    BufferStorage *take() {
+        if (not _free) {
+            return new BufferStorage;
+        }
+        BufferStorage *storage = exchange(_free, _free->_next_free);
+        _size--;
+        storage->_references.store(1, memory_order_relaxed);
+        return storage;
+    }
+
+    void give(BufferStorage *storage) {
+        if (storage->_chunk) {
+            SlabAllocator::free(exchange(storage->_chunk, nullptr));
+            storage->_chunk_size = 0;
+        }
+        if (_size == MAX_SIZE or storage->_string.capacity() > MAX_CAPACITY) {
+            delete storage;
+            return;
+        }
+        storage->_string.clear();
+        storage->_next_free = exchange(_free, storage);
+        _size++;
+    }
+};
+
+static thread_local BufferPool pool{};
+
+BufferStorage *BufferStorage::acquire() {
+    BufferStorage *storage = pool_destroyed ? new BufferStorage : pool.take();
+    storage->_confined = thread_confined;
+    return storage;
+}
+
+void BufferStorage::release() {
+    if (_confined) {
+        const size_t references = _references.load(memory_order_relaxed) - 1;
+        _references.store(references, memory_order_relaxed);
+        if (references != 0) {
+            return;
+        }
+    } else if (_references.fetch_sub(1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    if (not pool_destroyed) {
+        pool.give(this);
+        return;
+    }
+    if (_chunk) {
+        SlabAllocator::free(_chunk);
+    }
+    delete this;
+}
+
+void Buffer::set_thread_confined(const bool confined) { thread_confined = confined; }
+
 void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
-        _storage.reset();
+    if (_storage and _starting_offset == _storage->view().size()) {
+        _reset();
+        _starting_offset = 0;
     }
 }
 
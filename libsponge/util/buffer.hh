@@ -2,26 +2,166 @@
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
 #include <vector>
 
+//! \brief Fixed-size chunks of memory for Buffer%s, carved from large slabs
+//! \details Each thread keeps a cache of free chunks, so allocating and freeing one is a few
+//! instructions and no lock. A thread whose cache runs dry takes a batch from a shared depot
+//! (or a new slab), and gives a batch back when its cache overflows or it exits. Slabs are
+//! never returned to the system, so a chunk can be freed on any thread.
+class SlabAllocator {
+  public:
+    static constexpr size_t CHUNK_SIZE = 2048;    //!< Room for an Ethernet-MTU datagram
+    static constexpr size_t CHUNKS_PER_SLAB = 64;  //!< Chunks carved from each slab
+
+    //! \brief A free chunk of CHUNK_SIZE bytes
+    static char *allocate();
+
+    //! \brief Return a chunk obtained from allocate()
+    static void free(char *chunk);
+};
+
+//! \brief Storage shared by Buffer%s, with an intrusive reference count
+//! \details The bytes live in a slab chunk when they fit (see SlabAllocator), or else in a
+//! string. Storage whose last reference goes away returns to a pool for the thread that
+//! released it, so a steady flow of Buffer%s reuses the same memory instead of allocating.
+class BufferStorage {
+  private:
+    std::string _string{};     //!< The bytes, unless they're in `_chunk`
+    char *_chunk{nullptr};     //!< Slab chunk holding the bytes, if any
+    size_t _chunk_size{0};     //!< Number of bytes in `_chunk`
+    bool _confined{false};     //!< Allocated by a thread that keeps its Buffer%s to itself?
+    std::atomic<size_t> _references{1};
+    BufferStorage *_next_free{nullptr};  //!< Next in the pool, while this is in it
+
+    friend class BufferPool;
+    friend class Buffer;
+    friend class BufferList;
+
+  public:
+    //! \brief Empty storage, from this thread's pool if it has any
+    static BufferStorage *acquire();
+
+    //! \brief Add a reference
+    void retain() {
+        // plain arithmetic when confined to one thread; the atomic type just keeps it well-defined
+        if (_confined) {
+            _references.store(_references.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            _references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    //! \brief Drop a reference, returning the storage to the pool if it was the last
+    void release();
+
+    //! \brief The stored bytes
+    std::string_view view() const {
+        return _chunk ? std::string_view{_chunk, _chunk_size} : std::string_view{_string};
+    }
+};
+
 //! \brief A reference-counted read-only string that can discard bytes from the front
 class Buffer {
   private:
-    std::shared_ptr<std::string> _storage{};
+    BufferStorage *_storage{nullptr};
     size_t _starting_offset{};
 
+    friend class BufferList;
+
+    void _reset() {
+        if (_storage) {
+            _storage->release();
+            _storage = nullptr;
+        }
+    }
+
   public:
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    Buffer(std::string &&str) noexcept : _storage(BufferStorage::acquire()) { _storage->_string = std::move(str); }
+
+    //! \brief Construct from up to `max_size` bytes that `fill(char *)` writes in place,
+    //! returning how many it wrote
+    //! \details Up to SlabAllocator::CHUNK_SIZE bytes go in a slab chunk, so in steady state
+    //! this doesn't allocate.
+    template <typename Fill>
+    static Buffer make_up_to(const size_t max_size, Fill &&fill) {
+        Buffer ret;
+        ret._storage = BufferStorage::acquire();
+        BufferStorage &storage = *ret._storage;
+        if (max_size <= SlabAllocator::CHUNK_SIZE) {
+            storage._chunk = SlabAllocator::allocate();
+            storage._chunk_size = std::min<size_t>(fill(storage._chunk), max_size);
+        } else {
+            storage._string.resize(max_size);
+            storage._string.resize(std::min<size_t>(fill(storage._string.data()), max_size));
+        }
+        return ret;
+    }
+
+    //! \brief Construct from `size` bytes that `fill(char *)` writes in place (see make_up_to())
+    template <typename Fill>
+    static Buffer make(const size_t size, Fill &&fill) {
+        return make_up_to(size, [&](char *data) {
+            fill(data);
+            return size;
+        });
+    }
+
+    //! \brief Promise that Buffer%s this thread allocates will only be used on this thread
+    //! \details Their reference counts then use plain rather than atomic arithmetic. It's still
+    //! fine to hand all of a Buffer's copies to another thread, but not to copy or release them
+    //! on two threads at once.
+    static void set_thread_confined(const bool confined);
+
+    //! \name Copying shares the storage; moving transfers it
+    //!@{
+    Buffer(const Buffer &other) noexcept : _storage(other._storage), _starting_offset(other._starting_offset) {
+        if (_storage) {
+            _storage->retain();
+        }
+    }
+
+    Buffer(Buffer &&other) noexcept : _storage(other._storage), _starting_offset(other._starting_offset) {
+        other._storage = nullptr;
+        other._starting_offset = 0;
+    }
+
+    Buffer &operator=(const Buffer &other) noexcept {
+        if (other._storage) {
+            other._storage->retain();
+        }
+        _reset();
+        _storage = other._storage;
+        _starting_offset = other._starting_offset;
+        return *this;
+    }
+
+    Buffer &operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            _reset();
+            _storage = other._storage;
+            _starting_offset = other._starting_offset;
+            other._storage = nullptr;
+            other._starting_offset = 0;
+        }
+        return *this;
+    }
+
+    ~Buffer() { _reset(); }
+    //!@}
 
     //! \name Expose contents as a std::string_view
     //!@{
@@ -29,7 +169,7 @@ class Buffer {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return _storage->view().substr(_starting_offset);
     }
 
     operator std::string_view() const { return str(); }
@@ -74,6 +214,34 @@ class BufferList {
     }
     //!@}
 
+    //! Most slab chunks make_up_to() will fill in one go
+    static constexpr size_t MAX_CHUNKS = 32;
+
+    //! \brief Construct from up to `max_size` bytes that one scatter read writes into slab chunks
+    //! \details `read_into(iovec *, int)` is given up to MAX_CHUNKS iovecs, none of them
+    //! zero-filled, and returns how many bytes it wrote. Chunks it didn't reach go back to the pool.
+    template <typename ReadInto>
+    static BufferList make_up_to(const size_t max_size, ReadInto &&read_into) {
+        std::array<Buffer, MAX_CHUNKS> chunks{};
+        std::array<iovec, MAX_CHUNKS> iovecs{};
+        size_t count = 0;
+        for (size_t room = max_size; room > 0 and count < MAX_CHUNKS; count++) {
+            chunks[count]._storage = BufferStorage::acquire();
+            chunks[count]._storage->_chunk = SlabAllocator::allocate();
+            iovecs[count] = {chunks[count]._storage->_chunk, std::min(room, SlabAllocator::CHUNK_SIZE)};
+            room -= iovecs[count].iov_len;
+        }
+
+        size_t remaining = std::min<size_t>(read_into(iovecs.data(), int(count)), max_size);
+        BufferList ret;
+        for (size_t i = 0; i < count and remaining > 0; i++) {
+            chunks[i]._storage->_chunk_size = std::min(remaining, iovecs[i].iov_len);
+            remaining -= chunks[i]._storage->_chunk_size;
+            ret._buffers.push_back(std::move(chunks[i]));
+        }
+        return ret;
+    }
+
     //! \brief Access the underlying queue of Buffers
     const std::deque<Buffer> &buffers() const { return _buffers; }
 
@@ -125,6 +293,20 @@ class BufferViewList {
     //! \note used for system calls that write discontiguous buffers,
     //! e.g. [writev(2)](\ref man2::writev) and [sendmsg(2)](\ref man2::sendmsg)
     std::vector<iovec> as_iovecs() const;
+
+    //! \brief Convert to `iovec` structures in caller-provided storage, without allocating
+    //! \returns the number of iovecs used, or std::nullopt if there are more than `N` pieces
+    template <size_t N>
+    std::optional<size_t> as_iovecs(std::array<iovec, N> &iovecs) const {
+        if (_views.size() > N) {
+            return std::nullopt;
+        }
+        size_t count = 0;
+        for (const auto &view : _views) {
+            iovecs[count++] = {const_cast<char *>(view.data()), view.size()};
+        }
+        return count;
+    }
 };
 
 #endif  // SPONGE_LIBSPONGE_BUFFER_HH
@@ -0,0 +1,28 @@
+#include "eventfd.hh"
+
+#include "util.hh"
+
+#include <cerrno>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! \param[in] blocking is `true` if drain() should wait until the counter is nonzero
+EventFD::EventFD(const bool blocking)
+    : FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_CLOEXEC | (blocking ? 0 : EFD_NONBLOCK)))) {}
+
+//! \details Several threads may signal the same EventFD, so this doesn't touch the write count
+void EventFD::signal() {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(fd_num(), &one, sizeof(one)));
+}
+
+uint64_t EventFD::drain() {
+    uint64_t count = 0;
+    if (SystemCall("read", ::read(fd_num(), &count, sizeof(count)), EAGAIN) < 0) {
+        return 0;
+    }
+    register_read();
+    return count;
+}
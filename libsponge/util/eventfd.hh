@@ -0,0 +1,26 @@
+#ifndef SPONGE_LIBSPONGE_EVENTFD_HH
+#define SPONGE_LIBSPONGE_EVENTFD_HH
+
+#include "file_descriptor.hh"
+
+#include <cstdint>
+
+//! A FileDescriptor to an [eventfd(2)](\ref man2::eventfd) counter, used to wake up another thread
+class EventFD : public FileDescriptor {
+  public:
+    //! Create a counter starting at zero; a blocking EventFD makes drain() wait for a signal()
+    explicit EventFD(const bool blocking = false);
+
+    //! Add one to the counter, making the descriptor readable
+    void signal();
+
+    //! Read and reset the counter; returns 0 if a non-blocking EventFD had not been signalled
+    uint64_t drain();
+};
+
+//! \class EventFD
+//! Unlike FileDescriptor::read(), drain() reads only the eight-byte counter, so a wakeup
+//! costs one small system call on each side. A drain() counts as a read for EventLoop's
+//! busy-wait detection. signal() is safe to call from any thread.
+
+#endif  // SPONGE_LIBSPONGE_EVENTFD_HH
@@ -3,6 +3,7 @@
 #include "util.hh"
 
 #include <cerrno>
+#include <ctime>
 #include <stdexcept>
 #include <system_error>
 #include <utility>
@@ -28,8 +29,15 @@ void EventLoop::add_rule(const FileDescriptor &fd,
     _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
 }
 
-//! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll); `wait_next_event`
-//!                       returns Result::Timeout if no fd is ready after the timeout expires.
+//! \param[in] timeout_ms is the longest time to wait, in milliseconds (negative to wait indefinitely)
+//! \returns the result of EventLoop::wait_next_event_us
+EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+    return wait_next_event_us(timeout_ms < 0 ? -1 : int64_t{timeout_ms} * 1000);
+}
+
+//! \param[in] timeout_us is the timeout passed to [ppoll(2)](\ref man2::poll), in microseconds (negative
+//!                       to wait indefinitely); `wait_next_event_us` returns Result::Timeout if no fd is
+//!                       ready after the timeout expires.
 //! \returns Eventloop::Result indicating success, timeout, or no more Rule objects to poll.
 //!
 //! For each Rule, this function first calls Rule::interest; if `true`, Rule::fd is added to the
@@ -37,7 +45,7 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //! writability (if Rule::direction == Direction::Out) unless Rule::fd has reached EOF, in which case
 //! the Rule is canceled (i.e., deleted from EventLoop::_rules).
 //!
-//! Next, this function calls [poll(2)](\ref man2::poll) with timeout value `timeout_ms`.
+//! Next, this function calls [ppoll(2)](\ref man2::poll) with timeout value `timeout_us`.
 //!
 //! Then, for each ready file descriptor, this function calls Rule::callback. If fd reaches EOF or
 //! if the Rule was registered using EventLoop::add_cancelable_rule and Rule::callback returns true,
@@ -58,7 +66,7 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //! because [poll(2)](\ref man2::poll) is level triggered, so failing to act on a ready file descriptor
 //! will result in a busy loop (poll returns on a ready file descriptor; file descriptor is not read or
 //! written, so it is still ready; the next call to poll will immediately return).
-EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+EventLoop::Result EventLoop::wait_next_event_us(const int64_t timeout_us) {
     vector<pollfd> pollfds{};
     pollfds.reserve(_rules.size());
     bool something_to_poll = false;
@@ -93,9 +101,11 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
         return Result::Exit;
     }
 
-    // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
+    // call ppoll -- wait until one of the fds satisfies one of the rules (writeable/readable)
+    const timespec timeout{timeout_us / 1000000, (timeout_us % 1000000) * 1000};
+    const timespec *const timeout_or_forever = timeout_us < 0 ? nullptr : &timeout;
     try {
-        if (0 == SystemCall("poll", ::poll(pollfds.data(), pollfds.size(), timeout_ms))) {
+        if (0 == SystemCall("ppoll", ::ppoll(pollfds.data(), pollfds.size(), timeout_or_forever, nullptr))) {
             return Result::Timeout;
         }
     } catch (unix_error const &e) {
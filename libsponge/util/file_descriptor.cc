@@ -73,13 +73,52 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+char *FileDescriptor::spill_area() {
+    thread_local array<char, SPILL_SIZE> area;
+    return area.data();
+}
+
+//! \param[in] limit is the maximum number of bytes to read; fewer bytes may be returned
+//! \returns the bytes read, in a slab chunk if they fit in one
+Buffer FileDescriptor::read_buffer(const size_t limit) {
+    Buffer ret = read_pooled(limit, [&](iovec *iovecs, const int count) {
+        return size_t(SystemCall("readv", ::readv(fd_num(), iovecs, count)));
+    });
+    if (limit > 0 && ret.size() == 0) {
+        _internal_fd->_eof = true;
+    }
+
+    register_read();
+    return ret;
+}
+
+//! \param[in] limit is the maximum number of bytes to read; fewer bytes may be returned
+//! \returns the bytes read, in up to BufferList::MAX_CHUNKS slab chunks
+BufferList FileDescriptor::read_buffers(const size_t limit) {
+    BufferList ret = BufferList::make_up_to(limit, [&](iovec *iovecs, const int count) {
+        return size_t(SystemCall("readv", ::readv(fd_num(), iovecs, count)));
+    });
+    if (limit > 0 && ret.size() == 0) {
+        _internal_fd->_eof = true;
+    }
+
+    register_read();
+    return ret;
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
+    array<iovec, MAX_STACK_IOVECS> stack_iovecs;
     do {
-        auto iovecs = buffer.as_iovecs();
-
-        const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovecs.size()));
+        // a header or two plus a payload fits on the stack; only long lists need a vector
+        ssize_t bytes_written = 0;
+        if (const auto count = buffer.as_iovecs(stack_iovecs)) {
+            bytes_written = SystemCall("writev", ::writev(fd_num(), stack_iovecs.data(), *count));
+        } else {
+            const auto iovecs = buffer.as_iovecs();
+            bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovecs.size()));
+        }
         if (bytes_written == 0 and buffer.size() != 0) {
             throw runtime_error("write returned 0 given non-empty input buffer");
         }
@@ -3,10 +3,12 @@
 
 #include "buffer.hh"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <sys/uio.h>
 
 //! A reference-counted handle to a file descriptor
 class FileDescriptor {
@@ -48,7 +50,38 @@ class FileDescriptor {
     void register_read() { ++_internal_fd->_read_count; }    //!< increment read count
     void register_write() { ++_internal_fd->_write_count; }  //!< increment write count
 
+    //! Size of the per-thread spill area that catches reads too big for a slab chunk
+    static constexpr size_t SPILL_SIZE = 64 * 1024;
+
+    //! This thread's spill area, SPILL_SIZE bytes
+    static char *spill_area();
+
+    //! \brief Read up to `limit` bytes into a slab chunk, spilling anything more into spill_area()
+    //! \details `read_into(iovec *, int)` makes a readv-like call and returns the number of bytes
+    //! it read. Reads that fit in a chunk (all of them, on an Ethernet-MTU link) are handed over
+    //! without a copy; larger ones are gathered into a string.
+    template <typename ReadInto>
+    static Buffer read_pooled(const size_t limit, ReadInto &&read_into) {
+        const size_t in_chunk = std::min(limit, SlabAllocator::CHUNK_SIZE);
+        const size_t in_spill = std::min(limit - in_chunk, SPILL_SIZE);
+        size_t bytes_read = 0;
+        Buffer ret = Buffer::make_up_to(in_chunk, [&](char *chunk) {
+            std::array<iovec, 2> iovecs{{{chunk, in_chunk}, {spill_area(), in_spill}}};
+            bytes_read = read_into(iovecs.data(), in_spill > 0 ? 2 : 1);
+            return bytes_read;
+        });
+        if (bytes_read <= in_chunk) {
+            return ret;
+        }
+        std::string whole{ret.str()};
+        whole.append(spill_area(), std::min(bytes_read, in_chunk + in_spill) - in_chunk);
+        return Buffer{std::move(whole)};
+    }
+
   public:
+    //! Gathered writes of up to this many pieces build their iovecs on the stack
+    static constexpr size_t MAX_STACK_IOVECS = 16;
+
     //! Construct from a file descriptor number returned by the kernel
     explicit FileDescriptor(const int fd);
 
@@ -61,6 +94,12 @@ class FileDescriptor {
     //! Read up to `limit` bytes into `str` (caller can allocate storage)
     void read(std::string &str, const size_t limit = std::numeric_limits<size_t>::max());
 
+    //! Read up to `limit` bytes into pooled storage (see read_pooled())
+    Buffer read_buffer(const size_t limit = std::numeric_limits<size_t>::max());
+
+    //! Read up to `limit` bytes into slab chunks with [readv(2)](\ref man2::readv), zero-filling nothing
+    BufferList read_buffers(const size_t limit = std::numeric_limits<size_t>::max());
+
     //! Write a string, possibly blocking until all is written
     size_t write(const char *str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
 
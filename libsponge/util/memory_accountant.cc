@@ -0,0 +1,25 @@
+#include "memory_accountant.hh"
+
+#include <atomic>
+
+using namespace std;
+
+namespace {
+atomic<size_t> charged{0};
+atomic<size_t> limit_bytes{0};
+}  // namespace
+
+void MemoryAccountant::charge(const size_t bytes) { charged.fetch_add(bytes, memory_order_relaxed); }
+
+void MemoryAccountant::uncharge(const size_t bytes) { charged.fetch_sub(bytes, memory_order_relaxed); }
+
+size_t MemoryAccountant::usage() { return charged.load(memory_order_relaxed); }
+
+void MemoryAccountant::set_limit(const size_t bytes) { limit_bytes.store(bytes, memory_order_relaxed); }
+
+size_t MemoryAccountant::limit() { return limit_bytes.load(memory_order_relaxed); }
+
+bool MemoryAccountant::under_pressure() {
+    const size_t limit = MemoryAccountant::limit();
+    return limit != 0 and usage() > limit;
+}
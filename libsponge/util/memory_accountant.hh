@@ -0,0 +1,71 @@
+#ifndef SPONGE_LIBSPONGE_MEMORY_ACCOUNTANT_HH
+#define SPONGE_LIBSPONGE_MEMORY_ACCOUNTANT_HH
+
+#include <cstddef>
+#include <utility>
+
+//! \brief Process-wide count of the bytes that stream buffers hold
+//! \details Every StreamStorage block and every byte a StreamReassembler keeps out of order is
+//! charged here, in every thread. Once a limit is set and the total goes over it, the process is
+//! under pressure: receivers shrink their windows, senders their buffers, and TCPDemux drops
+//! out-of-order data and refuses new connections until usage is back under the limit.
+class MemoryAccountant {
+  public:
+    //! Add `bytes` to the total
+    static void charge(const size_t bytes);
+
+    //! Take `bytes` off the total
+    static void uncharge(const size_t bytes);
+
+    //! Bytes charged now, in every thread
+    static size_t usage();
+
+    //! \name Memory pressure
+    //!@{
+
+    //! Set the limit, in bytes (0, the default, for none)
+    static void set_limit(const size_t bytes);
+
+    //! The limit, or 0 if there is none
+    static size_t limit();
+
+    //! Whether usage() is over the limit
+    static bool under_pressure();
+    //!@}
+};
+
+//! \brief Bytes charged to the MemoryAccountant on behalf of one owner, and uncharged with it
+//! \details A copy charges its own bytes; a move hands them over.
+class MemoryCharge {
+  private:
+    size_t _bytes{0};  //!< Bytes charged
+
+  public:
+    MemoryCharge() = default;
+
+    MemoryCharge(const MemoryCharge &other) : _bytes(other._bytes) { MemoryAccountant::charge(_bytes); }
+
+    MemoryCharge(MemoryCharge &&other) noexcept : _bytes(std::exchange(other._bytes, 0)) {}
+
+    MemoryCharge &operator=(MemoryCharge other) noexcept {
+        std::swap(_bytes, other._bytes);
+        return *this;
+    }
+
+    ~MemoryCharge() { MemoryAccountant::uncharge(_bytes); }
+
+    //! Charge `bytes` in place of what was charged before
+    void set(const size_t bytes) {
+        if (bytes == _bytes) {
+            return;
+        }
+        MemoryAccountant::charge(bytes);
+        MemoryAccountant::uncharge(_bytes);
+        _bytes = bytes;
+    }
+
+    //! Bytes charged
+    size_t bytes() const { return _bytes; }
+};
+
+#endif  // SPONGE_LIBSPONGE_MEMORY_ACCOUNTANT_HH
@@ -0,0 +1,62 @@
+#include "prefix_table.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+PrefixTable::PrefixTable() {
+    _levels[0].entries.resize(size_t{1} << END_BIT[0]);
+    _levels[0].lengths.resize(size_t{1} << END_BIT[0]);
+}
+
+void PrefixTable::insert(const uint32_t prefix, const uint8_t length, const uint32_t value) {
+    if (length > 32) {
+        throw runtime_error("PrefixTable::insert: prefix length must be at most 32");
+    }
+    if (value > MAX_VALUE) {
+        throw runtime_error("PrefixTable::insert: value must be at most 2^31 - 2");
+    }
+    const uint32_t mask = length == 0 ? 0 : ~uint32_t{0} << (32 - length);
+    _insert(0, 0, prefix & mask, length, value + 1);
+}
+
+//! \details Walks down to the level whose stride contains the prefix's last bit, splitting entries
+//! into chunks on the way, then overwrites the (1 << unused bits) entries that the prefix covers.
+void PrefixTable::_insert(
+    const size_t level, const size_t base, const uint32_t prefix, const uint8_t length, const uint32_t entry) {
+    const size_t index = _index(level, base, prefix);
+    if (length <= END_BIT[level]) {
+        const size_t count = size_t{1} << (END_BIT[level] - length);
+        for (size_t i = index; i < index + count; i++) {
+            _overwrite(level, i, length, entry);
+        }
+        return;
+    }
+
+    Level &current = _levels[level];
+    if (not(current.entries[index] & CHUNK_FLAG)) {
+        // a new chunk starts out with what the entry it replaces held
+        Level &next = _levels[level + 1];
+        const size_t chunk = next.entries.size() >> 8;
+        next.entries.resize(next.entries.size() + 256, current.entries[index]);
+        next.lengths.resize(next.lengths.size() + 256, current.lengths[index]);
+        current.entries[index] = CHUNK_FLAG | chunk;
+        current.lengths[index] = 0;
+    }
+    _insert(level + 1, (current.entries[index] & ~CHUNK_FLAG) << 8, prefix, length, entry);
+}
+
+//! \details Only replaces values of prefixes that are no longer than this one, so that a short prefix
+//! inserted after a longer one doesn't hide it.
+void PrefixTable::_overwrite(const size_t level, const size_t index, const uint8_t length, const uint32_t entry) {
+    Level &current = _levels[level];
+    if (current.entries[index] & CHUNK_FLAG) {
+        const size_t base = (current.entries[index] & ~CHUNK_FLAG) << 8;
+        for (size_t i = base; i < base + 256; i++) {
+            _overwrite(level + 1, i, length, entry);
+        }
+    } else if (current.lengths[index] <= length) {
+        current.entries[index] = entry;
+        current.lengths[index] = length;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef SPONGE_LIBSPONGE_PREFIX_TABLE_HH
+#define SPONGE_LIBSPONGE_PREFIX_TABLE_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//! \brief Longest-prefix-match table for IPv4 addresses, with lookups in at most three memory accesses
+
+//! The table is a multibit trie with fixed strides of 16, 8 and 8 bits (a "DIR-16-8-8" layout).
+//! The first level is an array indexed by the top 16 bits of the address. Each entry holds the value
+//! of the longest prefix (of length 16 or less) that covers it, or, if some longer prefix falls
+//! inside it, the index of a 256-entry chunk in the second level, which is indexed by the next
+//! 8 bits; the second level points into the third in the same way. Prefixes are expanded into
+//! every entry they cover when they are inserted, so a lookup never backtracks, and its cost
+//! doesn't depend on how many prefixes there are.
+//!
+//! The first level takes 256 KiB; each chunk takes 1 KiB more (plus 256 bytes that are only
+//! touched by insert()).
+class PrefixTable {
+  private:
+    //! Entries with this bit set point to a chunk in the next level
+    static constexpr uint32_t CHUNK_FLAG = uint32_t{1} << 31;
+
+    //! Number of levels, and the bit of the address that each one's index ends at
+    static constexpr size_t LEVELS = 3;
+    static constexpr std::array<uint8_t, LEVELS> END_BIT{16, 24, 32};
+
+    struct Level {
+        //! 0 if no prefix covers the entry, CHUNK_FLAG | chunk number, or else 1 + the value
+        std::vector<uint32_t> entries{};
+        //! Length of the prefix whose value is in the corresponding entry
+        std::vector<uint8_t> lengths{};
+    };
+
+    std::array<Level, LEVELS> _levels{};
+
+    //! Index of the entry for `address` in the chunk that starts at `base` in `level`
+    static size_t _index(const size_t level, const size_t base, const uint32_t address) {
+        const uint8_t stride = level == 0 ? END_BIT[0] : END_BIT[level] - END_BIT[level - 1];
+        return base + (address >> (32 - END_BIT[level]) & ((uint32_t{1} << stride) - 1));
+    }
+
+    void _insert(
+        const size_t level, const size_t base, const uint32_t prefix, const uint8_t length, const uint32_t entry);
+    void _overwrite(const size_t level, const size_t index, const uint8_t length, const uint32_t entry);
+
+  public:
+    //! Largest value insert() accepts: entries store 1 + the value, which must not set CHUNK_FLAG
+    static constexpr uint32_t MAX_VALUE = CHUNK_FLAG - 2;
+
+    PrefixTable();
+
+    //! \brief Add (or replace) a prefix
+    //! \param[in] prefix the prefix's address; bits beyond the first `length` are ignored
+    //! \param[in] length the prefix length, 0 to 32
+    //! \param[in] value what lookup() returns for addresses that this prefix matches best; at most MAX_VALUE
+    void insert(const uint32_t prefix, const uint8_t length, const uint32_t value);
+
+    //! The value of the longest prefix matching `address`, if there is one
+    std::optional<uint32_t> lookup(const uint32_t address) const {
+        uint32_t entry = _levels[0].entries[address >> 16];
+        if (entry & CHUNK_FLAG) {
+            entry = _levels[1].entries[(entry & ~CHUNK_FLAG) << 8 | (address >> 8 & 0xff)];
+            if (entry & CHUNK_FLAG) {
+                entry = _levels[2].entries[(entry & ~CHUNK_FLAG) << 8 | (address & 0xff)];
+            }
+        }
+        if (entry == 0) {
+            return std::nullopt;
+        }
+        return entry - 1;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_PREFIX_TABLE_HH
@@ -0,0 +1,73 @@
+#ifndef SPONGE_LIBSPONGE_RING_BUFFER_HH
+#define SPONGE_LIBSPONGE_RING_BUFFER_HH
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! \brief A FIFO sequence in a circular array that grows but never shrinks
+//! \details Meets the requirements std::queue has of its container. Unlike std::deque, which
+//! allocates and frees a block every few elements as a queue slides along, it stops allocating
+//! once it has grown to the largest size it has held.
+template <typename T>
+class RingBuffer {
+  private:
+    std::vector<T> _slots{};  //!< Elements, starting at `_head` and wrapping around; other slots hold T{}
+    size_t _head = 0;         //!< Index of the front element
+    size_t _size = 0;         //!< Number of elements
+
+    size_t _index(const size_t i) const { return (_head + i) % _slots.size(); }
+
+    void _grow() {
+        std::vector<T> slots(_slots.empty() ? 8 : 2 * _slots.size());
+        for (size_t i = 0; i < _size; i++) {
+            slots[i] = std::move(_slots[_index(i)]);
+        }
+        _slots = std::move(slots);
+        _head = 0;
+    }
+
+  public:
+    //! \name Types used by std::queue
+    //!@{
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T &;
+    using const_reference = const T &;
+    //!@}
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+    //! \name Ends of the sequence
+    //!@{
+    T &front() { return _slots[_head]; }
+    const T &front() const { return _slots[_head]; }
+    T &back() { return _slots[_index(_size - 1)]; }
+    const T &back() const { return _slots[_index(_size - 1)]; }
+    //!@}
+
+    //! \brief Construct an element at the back
+    template <typename... Args>
+    T &emplace_back(Args &&... args) {
+        if (_size == _slots.size()) {
+            _grow();
+        }
+        T &slot = _slots[_index(_size)];
+        slot = T(std::forward<Args>(args)...);
+        _size++;
+        return slot;
+    }
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+
+    //! \brief Remove the front element, resetting its slot so it lets go of what it held
+    void pop_front() {
+        _slots[_head] = T{};
+        _head = (_head + 1) % _slots.size();
+        _size--;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_RING_BUFFER_HH
@@ -2,6 +2,8 @@
 
 #include "util.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <stdexcept>
 #include <unistd.h>
@@ -112,17 +114,45 @@ UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
     return ret;
 }
 
+UDPSocket::received_buffer UDPSocket::recv_buffer(const size_t mtu) {
+    Address::Raw datagram_source_address;
+    msghdr message{};
+    ssize_t recv_len = 0;
+
+    Buffer payload = read_pooled(mtu, [&](iovec *iovecs, const int count) {
+        message.msg_name = &datagram_source_address.storage;
+        message.msg_namelen = sizeof(datagram_source_address.storage);
+        message.msg_iov = iovecs;
+        message.msg_iovlen = count;
+        recv_len = SystemCall("recvmsg", ::recvmsg(fd_num(), &message, MSG_TRUNC));
+        return min(size_t(recv_len), mtu);
+    });
+
+    if (recv_len > ssize_t(mtu)) {
+        throw runtime_error("recvmsg (oversized datagram)");
+    }
+
+    register_read();
+    return {{datagram_source_address, message.msg_namelen}, move(payload)};
+}
+
 void sendmsg_helper(const int fd_num,
                     const sockaddr *destination_address,
                     const socklen_t destination_address_len,
                     const BufferViewList &payload) {
-    auto iovecs = payload.as_iovecs();
+    // a header plus a payload fits on the stack; only long lists need a vector
+    array<iovec, FileDescriptor::MAX_STACK_IOVECS> stack_iovecs;
+    vector<iovec> heap_iovecs;
+    const auto count = payload.as_iovecs(stack_iovecs);
+    if (not count) {
+        heap_iovecs = payload.as_iovecs();
+    }
 
     msghdr message{};
     message.msg_name = const_cast<sockaddr *>(destination_address);
     message.msg_namelen = destination_address_len;
-    message.msg_iov = iovecs.data();
-    message.msg_iovlen = iovecs.size();
+    message.msg_iov = count ? stack_iovecs.data() : heap_iovecs.data();
+    message.msg_iovlen = count ? *count : heap_iovecs.size();
 
     const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num, &message, 0));
 
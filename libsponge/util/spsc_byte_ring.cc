@@ -0,0 +1,88 @@
+#include "spsc_byte_ring.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+static size_t round_up_to_power_of_two(const size_t n) {
+    size_t ret = 1;
+    while (ret < n) {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+//! \param[in] capacity is the smallest acceptable number of bytes the ring can hold
+SPSCByteRing::SPSCByteRing(const size_t capacity)
+    : _storage(round_up_to_power_of_two(capacity)), _mask(_storage.size() - 1) {
+    if (capacity == 0) {
+        throw runtime_error("SPSCByteRing: capacity must be positive");
+    }
+}
+
+size_t SPSCByteRing::remaining_capacity() const {
+    return _storage.size() - (_tail.load(memory_order_relaxed) - _head.load(memory_order_acquire));
+}
+
+//! \param[in] data is the string to append
+//! \returns the number of bytes appended, which is less than `data.size()` if the ring filled up
+size_t SPSCByteRing::push(const string_view data) {
+    const uint64_t tail = _tail.load(memory_order_relaxed);
+
+    // only reload the consumer's index (a shared cache line) if the cached one says we're full
+    if (_storage.size() - (tail - _cached_head) < data.size()) {
+        _cached_head = _head.load(memory_order_acquire);
+    }
+    const size_t n = min(data.size(), size_t(_storage.size() - (tail - _cached_head)));
+    if (n == 0) {
+        return 0;
+    }
+
+    const size_t offset = tail & _mask;
+    const size_t first = min(n, _storage.size() - offset);
+    memcpy(_storage.data() + offset, data.data(), first);
+    memcpy(_storage.data(), data.data() + first, n - first);
+
+    _tail.store(tail + n, memory_order_release);
+    return n;
+}
+
+//! \param[in] data is the string to append
+//! \returns `true` if all of `data` was appended, `false` if there was no room and nothing was
+bool SPSCByteRing::push_all(const string_view data) {
+    const uint64_t tail = _tail.load(memory_order_relaxed);
+    if (_storage.size() - (tail - _cached_head) < data.size()) {
+        _cached_head = _head.load(memory_order_acquire);
+        if (_storage.size() - (tail - _cached_head) < data.size()) {
+            return false;
+        }
+    }
+    return push(data) == data.size();
+}
+
+//! \param[in] limit is the largest number of bytes to return
+//! \returns up to `limit` bytes, or an empty string if the ring is empty
+string SPSCByteRing::pop(const size_t limit) {
+    const uint64_t head = _head.load(memory_order_relaxed);
+
+    // only reload the producer's index if the cached one can't satisfy the request
+    if (_cached_tail - head < limit) {
+        _cached_tail = _tail.load(memory_order_acquire);
+    }
+    const size_t n = min(limit, size_t(_cached_tail - head));
+    if (n == 0) {
+        return {};
+    }
+
+    const size_t offset = head & _mask;
+    const size_t first = min(n, _storage.size() - offset);
+    string ret;
+    ret.reserve(n);
+    ret.append(_storage.data() + offset, first);
+    ret.append(_storage.data(), n - first);
+
+    _head.store(head + n, memory_order_release);
+    return ret;
+}
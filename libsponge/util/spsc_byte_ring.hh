@@ -0,0 +1,75 @@
+#ifndef SPONGE_LIBSPONGE_SPSC_BYTE_RING_HH
+#define SPONGE_LIBSPONGE_SPSC_BYTE_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! \brief A lock-free byte queue between exactly one producer thread and one consumer thread
+//! \details The producer calls push() and close(); the consumer calls pop() and eof().
+//! Neither call blocks or makes a system call: threads that need to sleep until the
+//! other side makes progress should pair the ring with an EventFD.
+class SPSCByteRing {
+  private:
+    //! Size of a cache line, to keep the producer's and consumer's indices apart
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::vector<char> _storage;  //!< Ring storage; its size is a power of two
+    uint64_t _mask;              //!< `_storage.size() - 1`
+
+    //! \name Consumer side
+    //!@{
+    alignas(CACHE_LINE) std::atomic<uint64_t> _head{0};  //!< Total bytes ever popped
+    uint64_t _cached_tail{0};                            //!< Consumer's last view of _tail
+    //!@}
+
+    //! \name Producer side
+    //!@{
+    alignas(CACHE_LINE) std::atomic<uint64_t> _tail{0};  //!< Total bytes ever pushed
+    uint64_t _cached_head{0};                            //!< Producer's last view of _head
+    std::atomic_bool _closed{false};                     //!< Has the producer finished?
+    //!@}
+
+  public:
+    //! Construct with room for at least `capacity` bytes (rounded up to a power of two)
+    explicit SPSCByteRing(const size_t capacity);
+
+    //! \name Producer
+    //!@{
+
+    //! Append as much of `data` as fits; returns the number of bytes appended
+    size_t push(const std::string_view data);
+
+    //! Append all of `data` if it fits, or nothing, so records pushed whole are popped whole
+    bool push_all(const std::string_view data);
+
+    //! Signal that nothing more will be pushed
+    void close() { _closed.store(true, std::memory_order_release); }
+
+    //! Free space, as seen by the producer
+    size_t remaining_capacity() const;
+    //!@}
+
+    //! \name Consumer
+    //!@{
+
+    //! Remove and return up to `limit` bytes from the front
+    std::string pop(const size_t limit);
+
+    //! Has the producer closed the ring, and has everything been popped?
+    bool eof() const { return _closed.load(std::memory_order_acquire) and size() == 0; }
+    //!@}
+
+    //! Bytes pushed but not yet popped (a snapshot when called from either thread)
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    //! Total capacity in bytes
+    size_t capacity() const { return _storage.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_SPSC_BYTE_RING_HH
@@ -0,0 +1,160 @@
+#include "stream_storage.hh"
+
+#include "memory_accountant.hh"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// index of a block size's free list
+size_t size_class(const size_t size) {
+    size_t index = 0;
+    while ((StreamStorage::MIN_SIZE << index) < size) {
+        index++;
+    }
+    return index;
+}
+
+constexpr size_t NUM_CLASSES = 9;
+static_assert((StreamStorage::MIN_SIZE << (NUM_CLASSES - 1)) == StreamStorage::MAX_POOLED_SIZE);
+
+// free blocks shared between threads, one list per size
+class StorageDepot {
+  private:
+    mutex _mutex{};
+    array<vector<char *>, NUM_CLASSES> _free{};
+    size_t _bytes = 0;
+
+  public:
+    // a block of `size` bytes, or nullptr if there is none
+    char *take(const size_t size) {
+        lock_guard lock{_mutex};
+        auto &blocks = _free[size_class(size)];
+        if (blocks.empty()) {
+            return nullptr;
+        }
+        _bytes -= size;
+        char *block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    void give(char *block, const size_t size) {
+        {
+            lock_guard lock{_mutex};
+            if (_bytes + size <= StreamStorage::MAX_POOLED_BYTES) {
+                _free[size_class(size)].push_back(block);
+                _bytes += size;
+                return;
+            }
+        }
+        delete[] block;
+    }
+
+    size_t bytes() {
+        lock_guard lock{_mutex};
+        return _bytes;
+    }
+};
+
+// never destroyed, so blocks can be given back during static destruction
+StorageDepot &depot() {
+    static StorageDepot *const depot = new StorageDepot;
+    return *depot;
+}
+
+// storage can be released by destructors that run after the thread's cache has gone; it then goes to the depot
+thread_local bool cache_destroyed = false;
+
+// a thread's free blocks, in front of the depot
+class StorageCache {
+  private:
+    array<vector<char *>, NUM_CLASSES> _free{};
+    size_t _bytes = 0;
+
+  public:
+    StorageCache() = default;
+    StorageCache(const StorageCache &other) = delete;
+    StorageCache &operator=(const StorageCache &other) = delete;
+
+    ~StorageCache() {
+        cache_destroyed = true;
+        for (size_t index = 0; index < NUM_CLASSES; index++) {
+            for (char *block : _free[index]) {
+                depot().give(block, StreamStorage::MIN_SIZE << index);
+            }
+        }
+    }
+
+    char *take(const size_t size) {
+        auto &blocks = _free[size_class(size)];
+        if (blocks.empty()) {
+            return depot().take(size);
+        }
+        _bytes -= size;
+        char *block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    void give(char *block, const size_t size) {
+        if (_bytes + size > StreamStorage::MAX_CACHED_BYTES) {
+            depot().give(block, size);
+            return;
+        }
+        _free[size_class(size)].push_back(block);
+        _bytes += size;
+    }
+
+    size_t bytes() const { return _bytes; }
+};
+
+thread_local StorageCache cache{};
+
+char *take_block(const size_t size) {
+    char *block = nullptr;
+    if (size <= StreamStorage::MAX_POOLED_SIZE) {
+        block = cache_destroyed ? depot().take(size) : cache.take(size);
+    }
+    return block ? block : new char[size];
+}
+
+void give_block(char *block, const size_t size) {
+    if (size > StreamStorage::MAX_POOLED_SIZE) {
+        delete[] block;
+    } else if (cache_destroyed) {
+        depot().give(block, size);
+    } else {
+        cache.give(block, size);
+    }
+}
+}  // namespace
+
+StreamStorage::StreamStorage(const size_t size) : _size(StreamStorage::MIN_SIZE << size_class(size)) {
+    _data = take_block(_size);
+    MemoryAccountant::charge(_size);
+}
+
+StreamStorage::StreamStorage(const StreamStorage &other) : StreamStorage() {
+    if (other._data) {
+        StreamStorage copy(other._size);
+        copy_n(other._data, other._size, copy._data);
+        *this = move(copy);
+    }
+}
+
+void StreamStorage::reset() {
+    if (not _data) {
+        return;
+    }
+    MemoryAccountant::uncharge(_size);
+    give_block(_data, _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+size_t StreamStorage::pooled_bytes() { return (cache_destroyed ? 0 : cache.bytes()) + depot().bytes(); }
@@ -0,0 +1,64 @@
+#ifndef SPONGE_LIBSPONGE_STREAM_STORAGE_HH
+#define SPONGE_LIBSPONGE_STREAM_STORAGE_HH
+
+#include <cstddef>
+#include <utility>
+
+//! \brief A block of bytes backing a stream's buffer, reused through a pool
+//! \details Blocks come in power-of-two sizes, from MIN_SIZE up. A stream takes one when data
+//! arrives and keeps it while it is busy; an idle connection gives its empty streams' blocks
+//! back (see TCPConnection::release_idle_storage), so idle streams hold no storage and busy ones
+//! reuse the same few blocks instead of going to the allocator. Blocks in use (not pooled ones)
+//! are charged to the MemoryAccountant.
+//!
+//! Like SlabAllocator, each thread keeps a small cache of free blocks, in front of a depot shared
+//! by all threads: a block freed on one thread can be reused on another, and the pool as a whole
+//! is bounded, not each thread's share of it. Unlike slab chunks, blocks beyond the bound are freed.
+class StreamStorage {
+  private:
+    char *_data{nullptr};  //!< The bytes, or nullptr if there are none
+    size_t _size{0};       //!< Size of the block at `_data`
+
+  public:
+    static constexpr size_t MIN_SIZE = 4096;              //!< Smallest block
+    static constexpr size_t MAX_POOLED_SIZE = 1 << 20;    //!< Larger blocks are freed rather than pooled
+    static constexpr size_t MAX_POOLED_BYTES = 16 << 20;  //!< Most the shared depot keeps; more is freed
+    static constexpr size_t MAX_CACHED_BYTES = 1 << 20;   //!< Most a thread keeps before using the depot
+
+    //! No storage
+    StreamStorage() = default;
+
+    //! \brief A block of at least `size` bytes
+    //! \details The size is rounded up to a power of two, and to at least MIN_SIZE.
+    //! The contents are unspecified.
+    explicit StreamStorage(const size_t size);
+
+    //! A block of the same size, with a copy of the bytes
+    StreamStorage(const StreamStorage &other);
+
+    StreamStorage(StreamStorage &&other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+    StreamStorage &operator=(StreamStorage other) noexcept {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        return *this;
+    }
+
+    ~StreamStorage() { reset(); }
+
+    //! Give the block back to the pool, leaving no storage
+    void reset();
+
+    //! \name The block
+    //!@{
+    char *data() { return _data; }
+    const char *data() const { return _data; }
+    size_t size() const { return _size; }
+    //!@}
+
+    //! Bytes waiting for reuse, in this thread's cache and the shared depot
+    static size_t pooled_bytes();
+};
+
+#endif  // SPONGE_LIBSPONGE_STREAM_STORAGE_HH
@@ -0,0 +1,143 @@
+#ifndef SPONGE_LIBSPONGE_TASK_HH
+#define SPONGE_LIBSPONGE_TASK_HH
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+template <typename T>
+class Task;
+
+//! Parts of the promise of a Task that don't depend on its result type
+class TaskPromiseBase {
+  private:
+    std::coroutine_handle<> _continuation{};  //!< The coroutine awaiting this one, resumed when it finishes
+    std::exception_ptr _exception{};          //!< Exception that escaped the coroutine, rethrown to the awaiter
+
+    //! Transfers control to the awaiting coroutine, if any, when a Task finishes
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept {
+            const auto continuation = static_cast<TaskPromiseBase &>(finished.promise())._continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+  public:
+    //! A Task does not start running until it is awaited
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    //! Resume the awaiter when the Task finishes
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    //! Keep an escaping exception for the awaiter
+    void unhandled_exception() { _exception = std::current_exception(); }
+
+    //! Remember who to resume on completion
+    void set_continuation(const std::coroutine_handle<> continuation) { _continuation = continuation; }
+
+    //! Rethrow an exception that escaped the coroutine, if any
+    void rethrow_if_failed() const {
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+    }
+};
+
+//! Promise of a Task with a result
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+  private:
+    std::optional<T> _value{};  //!< The value given to co_return
+
+  public:
+    Task<T> get_return_object();
+
+    //! Store the value given to co_return
+    void return_value(T value) { _value.emplace(std::move(value)); }
+
+    //! The result, or the exception that escaped the coroutine
+    T result() {
+        rethrow_if_failed();
+        return std::move(_value.value());
+    }
+};
+
+//! Promise of a Task without a result
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+  public:
+    Task<void> get_return_object();
+
+    //! Reached co_return or the end of the coroutine
+    void return_void() const noexcept {}
+
+    //! Rethrow the exception that escaped the coroutine, if any
+    void result() const { rethrow_if_failed(); }
+};
+
+//! \brief A lazily started coroutine that produces a `T` (or nothing) for the coroutine awaiting it
+//! \details `co_await task` starts the task, suspends the awaiter until the task finishes,
+//! then returns its co_return value (or rethrows the exception that escaped it). Control
+//! passes directly from the finished task to its awaiter, so chains of Tasks never grow the stack.
+template <typename T = void>
+class Task {
+  public:
+    using promise_type = TaskPromise<T>;  //!< Tells the compiler how to build the coroutine
+
+  private:
+    std::coroutine_handle<promise_type> _handle;  //!< The coroutine frame, owned by this Task
+
+  public:
+    //! Take ownership of a coroutine frame
+    explicit Task(const std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    //! Destroys the coroutine frame
+    ~Task() {
+        if (_handle) {
+            _handle.destroy();
+        }
+    }
+
+    //! \name Awaiter interface
+    //!@{
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiter) {
+        _handle.promise().set_continuation(awaiter);
+        return _handle;
+    }
+    T await_resume() { return _handle.promise().result(); }
+    //!@}
+
+    //! \name
+    //! A Task can be moved but not copied, since it owns the coroutine frame
+
+    //!@{
+    Task(Task &&other) noexcept : _handle(std::exchange(other._handle, {})) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (_handle) {
+                _handle.destroy();
+            }
+            _handle = std::exchange(other._handle, {});
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    //!@}
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+}
+
+#endif  // SPONGE_LIBSPONGE_TASK_HH
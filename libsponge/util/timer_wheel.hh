@@ -0,0 +1,84 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief A hashed timing wheel: timers identified by a 64-bit key, each with a deadline in ms
+//! \details A timer lives in the slot its deadline falls in, modulo the number of slots, so
+//! scheduling one is O(1) and advancing time visits only the slots passed over (at most all of
+//! them) and the timers in them. Timers can't be cancelled; the owner should instead ignore one
+//! that fires after it stopped caring, e.g. by checking the deadline against its own records.
+class TimerWheel {
+  public:
+    //! A timer that has come due
+    struct Timer {
+        uint64_t key;          //!< Identifies what the timer is for
+        uint64_t deadline_ms;  //!< When it was scheduled to fire
+    };
+
+  private:
+    std::vector<std::vector<Timer>> _slots;  //!< Timers by (deadline / `_granularity_ms`) mod slot count
+    uint64_t _granularity_ms;                //!< Span of time covered by one slot
+    uint64_t _now_ms = 0;                    //!< Current time
+    size_t _size = 0;                        //!< Number of timers scheduled
+    std::vector<Timer> _due{};               //!< Scratch space for timers firing in advance()
+
+    std::vector<Timer> &_slot_for(const uint64_t time_ms) {
+        return _slots[(time_ms / _granularity_ms) % _slots.size()];
+    }
+
+  public:
+    //! \param[in] slots is the number of slots in the wheel
+    //! \param[in] granularity_ms is the span of time each slot covers
+    explicit TimerWheel(const size_t slots = 256, const uint64_t granularity_ms = 64)
+        : _slots(std::max<size_t>(slots, 1)), _granularity_ms(std::max<uint64_t>(granularity_ms, 1)) {}
+
+    //! \brief Set a timer to fire once time reaches `deadline_ms` (or on the next advance() if it already has)
+    void schedule(const uint64_t key, const uint64_t deadline_ms) {
+        _slot_for(std::max(deadline_ms, _now_ms)).push_back({key, deadline_ms});
+        _size++;
+    }
+
+    //! \brief Move time forward by `ms`, calling `on_expired(const Timer &)` for each timer that comes due
+    //! \details Timers fire after the wheel has been updated, so `on_expired` may schedule more.
+    template <typename OnExpired>
+    void advance(const uint64_t ms, OnExpired &&on_expired) {
+        const uint64_t first_tick = _now_ms / _granularity_ms;
+        _now_ms += ms;
+        const uint64_t ticks = std::min<uint64_t>(_now_ms / _granularity_ms - first_tick + 1, _slots.size());
+
+        for (uint64_t tick = first_tick; tick < first_tick + ticks; tick++) {
+            auto &slot = _slots[tick % _slots.size()];
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].deadline_ms <= _now_ms) {
+                    _due.push_back(slot[i]);
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        _size -= _due.size();
+        std::vector<Timer> due = std::move(_due);
+        _due.clear();
+        for (const Timer &timer : due) {
+            on_expired(timer);
+        }
+        due.clear();
+        _due = std::move(due);  // keep the capacity for next time
+    }
+
+    //! \name Accessors
+    //!@{
+    uint64_t now_ms() const { return _now_ms; }
+    size_t size() const { return _size; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
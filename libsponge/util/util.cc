@@ -11,11 +11,14 @@
 using namespace std;
 
 //! \returns the number of milliseconds since the program started
-uint64_t timestamp_ms() {
+uint64_t timestamp_ms() { return timestamp_us() / 1000; }
+
+//! \returns the number of microseconds since the program started, from the monotonic clock
+uint64_t timestamp_us() {
     using time_point = std::chrono::steady_clock::time_point;
     static const time_point program_start = std::chrono::steady_clock::now();
     const time_point now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now - program_start).count();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now - program_start).count();
 }
 
 //! \param[in] attempt is the name of the syscall to try (for error reporting)
@@ -107,6 +110,16 @@ uint16_t InternetChecksum::value() const {
     return ~ret;
 }
 
+//! \details Computes HC' = ~(~HC + ~m + m') (eqn. 3 of RFC 1624), which, unlike the older
+//! formula of RFC 1141, never yields 0x0000 for a header whose checksum should be 0xffff.
+uint16_t InternetChecksum::update(const uint16_t checksum, const uint16_t old_word, const uint16_t new_word) {
+    uint32_t sum = uint32_t{uint16_t(~checksum)} + uint16_t(~old_word) + new_word;
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
 //! \param[in] data is a pointer to the bytes to show
 //! \param[in] len is the number of bytes to show
 //! \param[in] indent is the number of spaces to indent
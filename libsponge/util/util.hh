@@ -51,6 +51,9 @@ std::mt19937 get_random_generator();
 //! Get the time in milliseconds since the program began.
 uint64_t timestamp_ms();
 
+//! Get the time in microseconds since the program began.
+uint64_t timestamp_us();
+
 //! The internet checksum algorithm
 class InternetChecksum {
   private:
@@ -61,6 +64,9 @@ class InternetChecksum {
     InternetChecksum(const uint32_t initial_sum = 0);
     void add(std::string_view data);
     uint16_t value() const;
+
+    //! Checksum after one 16-bit word it covers changes from `old_word` to `new_word` (RFC 1624)
+    static uint16_t update(const uint16_t checksum, const uint16_t old_word, const uint16_t new_word);
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
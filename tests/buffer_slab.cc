@@ -0,0 +1,148 @@
+#include "buffer.hh"
+#include "socket.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static string pattern(const size_t size) {
+    string ret(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        ret[i] = char(i * 13 % 251);
+    }
+    return ret;
+}
+
+static Buffer copy_of(const string &str) {
+    return Buffer::make(str.size(), [&](char *data) { memcpy(data, str.data(), str.size()); });
+}
+
+int main() {
+    try {
+        // a freed chunk is the next one handed out
+        {
+            char *chunk = SlabAllocator::allocate();
+            SlabAllocator::free(chunk);
+            test_err_if(SlabAllocator::allocate() != chunk, "freed chunk should be reused");
+            SlabAllocator::free(chunk);
+        }
+
+        // a Buffer that fits in a chunk keeps its bytes there, and copies and prefixes share them
+        {
+            const string data = pattern(SlabAllocator::CHUNK_SIZE);
+            Buffer buffer = copy_of(data);
+            test_err_if(buffer.str() != data, "chunk-backed Buffer has the wrong contents");
+            Buffer copy = buffer;
+            copy.remove_prefix(100);
+            test_err_if(copy.str().data() != buffer.str().data() + 100, "copies should share storage");
+            test_err_if(copy.str() != data.substr(100), "prefix wasn't removed");
+
+            const string big = pattern(SlabAllocator::CHUNK_SIZE + 1);
+            test_err_if(copy_of(big).str() != big, "string-backed Buffer has the wrong contents");
+        }
+
+        // make_up_to() keeps only what was filled in
+        {
+            const Buffer buffer = Buffer::make_up_to(1500, [](char *data) {
+                memcpy(data, "hello", 5);
+                return 5;
+            });
+            test_err_if(buffer.str() != "hello", "make_up_to() should keep the bytes written");
+        }
+
+        // Buffers can be released on a thread other than the one that made them
+        {
+            for (const bool confined : {false, true}) {
+                vector<Buffer> buffers;
+                thread maker([&] {
+                    Buffer::set_thread_confined(confined);
+                    for (size_t i = 0; i < 1000; i++) {
+                        buffers.push_back(copy_of(pattern(1 + i % 1500)));
+                    }
+                });
+                maker.join();
+
+                thread user([&] {
+                    for (size_t i = 0; i < buffers.size(); i++) {
+                        test_err_if(buffers[i].str() != pattern(1 + i % 1500), "Buffer changed across threads");
+                    }
+                    buffers.clear();
+                });
+                user.join();
+            }
+        }
+
+        // reads fill a chunk directly, and larger reads spill into a string
+        {
+            int fds[2];
+            test_err_if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0, "socketpair failed");
+            FileDescriptor a{fds[0]}, b{fds[1]};
+            for (const size_t size : {size_t(1), size_t(1500), SlabAllocator::CHUNK_SIZE, size_t(10000)}) {
+                const string data = pattern(size);
+                a.write(data);
+                string received;
+                while (received.size() < size) {
+                    received += b.read_buffer().str();
+                }
+                test_err_if(received != data, "read_buffer() returned the wrong bytes");
+            }
+
+            // a scatter read fills as many chunks as it needs, and no more than `limit` bytes
+            const string data = pattern(BufferList::MAX_CHUNKS * SlabAllocator::CHUNK_SIZE + 5000);
+            a.write(data);
+            const BufferList first = b.read_buffers(3 * SlabAllocator::CHUNK_SIZE + 10);
+            test_err_if(first.buffers().size() != 4 or first.size() != 3 * SlabAllocator::CHUNK_SIZE + 10,
+                        "read_buffers() should stop at the limit");
+            string received = first.concatenate();
+            while (received.size() < data.size()) {
+                const BufferList more = b.read_buffers();
+                test_err_if(more.buffers().size() > BufferList::MAX_CHUNKS, "too many chunks");
+                for (const Buffer &buffer : more.buffers()) {
+                    test_err_if(buffer.size() > SlabAllocator::CHUNK_SIZE, "chunk overfilled");
+                }
+                received += more.concatenate();
+            }
+            test_err_if(received != data, "read_buffers() returned the wrong bytes");
+
+            a.close();
+            test_err_if(b.read_buffer().size() != 0 or not b.eof(), "read_buffer() should reach EOF");
+            test_err_if(b.read_buffers().size() != 0, "read_buffers() should return nothing at EOF");
+        }
+
+        // so do datagrams
+        {
+            UDPSocket receiver, sender;
+            receiver.bind(Address{"127.0.0.1", 0});
+            sender.connect(receiver.local_address());
+            for (const size_t size : {size_t(0), size_t(1472), SlabAllocator::CHUNK_SIZE + 1, size_t(60000)}) {
+                const string data = pattern(size);
+                sender.send(data);
+                const auto datagram = receiver.recv_buffer();
+                test_err_if(datagram.payload.str() != data, "recv_buffer() returned the wrong payload");
+                test_err_if(datagram.source_address != sender.local_address(), "wrong source address");
+            }
+
+            sender.send(pattern(2000));
+            bool threw = false;
+            try {
+                receiver.recv_buffer(1000);
+            } catch (const exception &) {
+                threw = true;
+            }
+            test_err_if(not threw, "recv_buffer() should reject a datagram bigger than the mtu");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
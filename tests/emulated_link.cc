@@ -0,0 +1,293 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "test_err_if.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// a segment carrying `payload_size` bytes, numbered by its seqno
+static TCPSegment numbered(const uint32_t n, const size_t payload_size = 0) {
+    TCPSegment seg;
+    seg.header().seqno = WrappingInt32{n};
+    seg.payload() = string(payload_size, 'x');
+    return seg;
+}
+
+// the seqnos of every segment that has arrived
+static vector<uint32_t> receive_all(EmulatedLink &link) {
+    vector<uint32_t> ret;
+    while (auto seg = link.receive()) {
+        ret.push_back(seg->header().seqno.raw_value());
+    }
+    return ret;
+}
+
+static bool near(const double value, const double expected, const double tolerance) {
+    return abs(value - expected) <= tolerance * expected;
+}
+
+// (arrival time, seqno) of each segment over a link using every feature
+static vector<pair<uint64_t, uint32_t>> trace(const uint64_t seed) {
+    EmulatedLinkConfig cfg{};
+    cfg.seed = seed;
+    cfg.delay_us = 2000;
+    cfg.jitter_us = 500;
+    cfg.rate_bps = 1000 * 1000;
+    cfg.discipline = EmulatedLinkConfig::QueueDiscipline::RED;
+    cfg.p_good_to_bad = 0.05;
+    cfg.p_bad_to_good = 0.5;
+    cfg.loss_good = 0.01;
+    cfg.duplicate_rate = 0.02;
+    cfg.reorder_rate = 0.05;
+    EmulatedLink link{cfg};
+
+    vector<pair<uint64_t, uint32_t>> ret;
+    for (uint32_t i = 0; i < 2000; i++) {
+        link.send(numbered(i, 100 + i % 900));
+        link.tick_us(700);
+        for (const uint32_t n : receive_all(link)) {
+            ret.emplace_back(link.now_us(), n);
+        }
+    }
+    return ret;
+}
+
+// transfer `size` bytes between TCPConnections over a lossy, delayed, rate-limited path;
+// returns the bytes received and the virtual time taken
+static pair<string, uint64_t> transfer(const uint64_t seed, const size_t size) {
+    EmulatedLinkConfig path{};
+    path.seed = seed;
+    path.delay_us = 5000;
+    path.rate_bps = 10 * 1000 * 1000;
+    path.loss_good = 0.02;
+    EmulatedLinkConfig reverse = path;
+    reverse.seed = seed + 1;
+    auto [client_end, server_end] = EmulatedLinkAdapter::make_pair(path, reverse);
+
+    TCPConfig cfg{};
+    cfg.rt_timeout = 50;
+    cfg.fixed_isn = WrappingInt32{1};
+    TCPConnection client{cfg}, server{cfg};
+    client.connect();
+
+    const string data = [&] {
+        string ret(size, 0);
+        for (size_t i = 0; i < size; i++) {
+            ret[i] = char(i * 7 % 251);
+        }
+        return ret;
+    }();
+    size_t written = 0;
+    string received;
+    bool server_closed = false;
+
+    const uint64_t step_us = 1000;
+    uint64_t elapsed_us = 0;
+    while ((client.active() or server.active()) and elapsed_us < 60 * 1000 * 1000) {
+        if (written < size) {
+            written += client.write(data.substr(written, 4 * TCPConfig::MAX_PAYLOAD_SIZE));
+            if (written == size) {
+                client.end_input_stream();
+            }
+        }
+        for (auto [conn, end] : {pair{&client, &client_end}, pair{&server, &server_end}}) {
+            while (auto seg = end->read()) {
+                conn->segment_received(seg.value());
+            }
+            while (not conn->segments_out().empty()) {
+                end->write(conn->segments_out().front());
+                conn->segments_out().pop();
+            }
+        }
+        received += server.inbound_stream().read(server.inbound_stream().buffer_size());
+        if (server.inbound_stream().eof() and not server_closed) {
+            server.end_input_stream();
+            server_closed = true;
+        }
+
+        for (auto [conn, end] : {pair{&client, &client_end}, pair{&server, &server_end}}) {
+            conn->tick_us(step_us);
+            end->tick_us(step_us);
+        }
+        elapsed_us += step_us;
+    }
+
+    test_err_if(client.active() or server.active(), "transfer should finish");
+    test_err_if(client_end.outgoing().stats().lost == 0, "some segments should have been lost");
+    return {received, elapsed_us};
+}
+
+int main() {
+    try {
+        // propagation delay
+        {
+            EmulatedLinkConfig cfg{};
+            cfg.delay_us = 5000;
+            EmulatedLink link{cfg};
+            link.send(numbered(1));
+            test_err_if(link.time_until_next_arrival_us() != 5000u, "segment should arrive after the delay");
+            link.tick_us(4999);
+            test_err_if(link.receive().has_value(), "segment arrived early");
+            link.tick_us(1);
+            test_err_if(not link.receive().has_value(), "segment should have arrived");
+            test_err_if(link.time_until_next_arrival_us().has_value(), "nothing should be in flight");
+        }
+
+        // an unconfigured link delivers at once
+        {
+            EmulatedLink link{EmulatedLinkConfig{}};
+            link.send(numbered(1));
+            test_err_if(not link.receive().has_value(), "ideal link should deliver at once");
+        }
+
+        // a bottleneck of one byte per microsecond, with room for three segments
+        {
+            const TCPSegment seg = numbered(0, 980);
+            const size_t size = EmulatedLink::wire_size(seg);
+            test_err_if(size != 1020, "wire size counts IPv4 and TCP headers");
+
+            EmulatedLinkConfig cfg{};
+            cfg.rate_bps = 8 * 1000 * 1000;
+            cfg.queue_bytes = 3 * size;
+            EmulatedLink link{cfg};
+            for (uint32_t i = 0; i < 5; i++) {
+                link.send(numbered(i, 980));
+            }
+            test_err_if(link.stats().queue_drops != 2, "drop-tail should drop what doesn't fit");
+            test_err_if(link.queue_bytes() != 3 * size, "queue should be full");
+            test_err_if(link.stats().max_queue_delay_us != 2 * size, "third segment waits for two");
+
+            for (uint32_t i = 0; i < 3; i++) {
+                link.tick_us(size - 1);
+                test_err_if(link.receive().has_value(), "segment arrived before it was serialized");
+                link.tick_us(1);
+                test_err_if(link.receive()->header().seqno.raw_value() != i, "segments should arrive in turn");
+            }
+            test_err_if(link.queue_bytes() != 0, "queue should have drained");
+        }
+
+        // RED drops early, before a large queue fills
+        {
+            EmulatedLinkConfig cfg{};
+            cfg.rate_bps = 8 * 1000 * 1000;
+            cfg.queue_bytes = 1000 * 1000;
+            cfg.red_weight = 0.02;
+            EmulatedLink drop_tail{cfg};
+            cfg.discipline = EmulatedLinkConfig::QueueDiscipline::RED;
+            EmulatedLink red{cfg};
+            for (uint32_t i = 0; i < 200; i++) {
+                drop_tail.send(numbered(i, 980));
+                red.send(numbered(i, 980));
+            }
+            test_err_if(drop_tail.stats().queue_drops + drop_tail.stats().red_drops != 0, "queue has room for all");
+            test_err_if(red.stats().red_drops == 0, "RED should drop as the average grows");
+            test_err_if(red.stats().queue_drops != 0, "RED shouldn't reach the queue limit");
+            test_err_if(red.stats().max_queue_bytes >= 200 * 1020, "RED should keep the queue shorter");
+        }
+
+        // Gilbert-Elliott losses come in bursts of the expected length
+        {
+            EmulatedLinkConfig cfg{};
+            cfg.seed = 42;
+            cfg.p_good_to_bad = 0.01;
+            cfg.p_bad_to_good = 0.25;
+            EmulatedLink link{cfg};
+
+            const size_t n = 200000;
+            size_t bursts = 0;
+            bool last_lost = false;
+            for (uint32_t i = 0; i < n; i++) {
+                const uint64_t lost_before = link.stats().lost;
+                link.send(numbered(i));
+                link.receive();
+                const bool lost = link.stats().lost != lost_before;
+                bursts += lost and not last_lost;
+                last_lost = lost;
+            }
+            const double loss_rate = double(link.stats().lost) / n;
+            const double mean_burst = double(link.stats().lost) / double(bursts);
+            test_err_if(not near(loss_rate, 0.01 / (0.01 + 0.25), 0.1), "wrong long-run loss rate");
+            test_err_if(not near(mean_burst, 1 / 0.25, 0.1), "wrong mean burst length");
+        }
+
+        // duplication
+        {
+            EmulatedLinkConfig cfg{};
+            cfg.duplicate_rate = 0.1;
+            EmulatedLink link{cfg};
+            for (uint32_t i = 0; i < 20000; i++) {
+                link.send(numbered(i));
+            }
+            test_err_if(receive_all(link).size() != 20000 + link.stats().duplicated, "duplicates should arrive");
+            test_err_if(not near(double(link.stats().duplicated), 2000, 0.1), "wrong duplication rate");
+        }
+
+        // jitter alone never reorders; reordering holds some segments back
+        {
+            EmulatedLinkConfig cfg{};
+            cfg.delay_us = 1000;
+            cfg.jitter_us = 5000;
+            EmulatedLink jittery{cfg};
+            cfg.jitter_us = 0;
+            cfg.reorder_rate = 0.1;
+            EmulatedLink reordering{cfg};
+
+            vector<uint32_t> from_jittery, from_reordering;
+            for (uint32_t i = 0; i < 10000; i++) {
+                jittery.send(numbered(i));
+                reordering.send(numbered(i));
+                jittery.tick_us(100);
+                reordering.tick_us(100);
+                for (const uint32_t n : receive_all(jittery)) {
+                    from_jittery.push_back(n);
+                }
+                for (const uint32_t n : receive_all(reordering)) {
+                    from_reordering.push_back(n);
+                }
+            }
+
+            size_t jittery_inversions = 0, reordering_inversions = 0;
+            for (size_t i = 1; i < from_jittery.size(); i++) {
+                jittery_inversions += from_jittery[i] < from_jittery[i - 1];
+            }
+            for (size_t i = 1; i < from_reordering.size(); i++) {
+                reordering_inversions += from_reordering[i] < from_reordering[i - 1];
+            }
+            test_err_if(jittery_inversions != 0, "jitter shouldn't reorder");
+            test_err_if(reordering_inversions == 0, "segments should be reordered");
+            test_err_if(not near(double(reordering.stats().reordered), 1000, 0.15), "wrong reordering rate");
+        }
+
+        // a seed determines the whole run
+        {
+            const auto first = trace(7);
+            test_err_if(first.empty(), "trace should deliver segments");
+            test_err_if(trace(7) != first, "same seed should give the same trace");
+            test_err_if(trace(8) == first, "different seeds should give different traces");
+        }
+
+        // TCP recovers from the link's losses, reproducibly
+        {
+            const size_t size = 200 * 1000;
+            const auto [received, elapsed_us] = transfer(3, size);
+            test_err_if(received.size() != size, "server should receive every byte");
+            for (size_t i = 0; i < size; i++) {
+                test_err_if(received[i] != char(i * 7 % 251), "server received the wrong data");
+            }
+            test_err_if(transfer(3, size).second != elapsed_us, "same seed should take the same time");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+#include "ipv4_reassembler.hh"
+#include "tcp_over_ip.hh"
+#include "test_err_if.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static string random_string(const size_t size, mt19937 &rng) {
+    string ret(size, 0);
+    for (auto &ch : ret) {
+        ch = char(rng());
+    }
+    return ret;
+}
+
+static IPv4Datagram make_datagram(const uint16_t id, const string &payload) {
+    IPv4Datagram dgram;
+    dgram.header().src = 0x0a000001;
+    dgram.header().dst = 0x0a000002;
+    dgram.header().id = id;
+    dgram.header().proto = 17;  // UDP
+    dgram.header().len = dgram.header().hlen * 4 + payload.size();
+    dgram.payload() = string(payload);
+    return dgram;
+}
+
+// what the datagram would look like after crossing a wire
+static IPv4Datagram reparse(const IPv4Datagram &dgram) {
+    IPv4Datagram ret;
+    test_err_if(ret.parse(dgram.serialize().concatenate()) != ParseResult::NoError, "fragment doesn't parse");
+    return ret;
+}
+
+// push fragments until a datagram comes out (any left over would start the datagram again)
+static optional<IPv4Datagram> push_all(IPv4Reassembler &reassembler, const vector<IPv4Datagram> &fragments) {
+    for (const auto &fragment : fragments) {
+        auto out = reassembler.push(reparse(fragment));
+        if (out.has_value()) {
+            return out;
+        }
+    }
+    return {};
+}
+
+int main() {
+    try {
+        mt19937 rng{11};
+
+        // a datagram that isn't a fragment passes straight through
+        {
+            IPv4Reassembler reassembler;
+            const auto out = reassembler.push(make_datagram(1, "hello"));
+            test_err_if(not out.has_value() or out->payload().concatenate() != "hello", "datagram should pass through");
+        }
+
+        // fragments in any order, duplicated, or overlapping with different boundaries
+        for (unsigned int round = 0; round < 100; round++) {
+            IPv4Reassembler reassembler;
+            const string payload = random_string(1 + rng() % 9000, rng);
+            const IPv4Datagram dgram = make_datagram(uint16_t(round), payload);
+
+            vector<IPv4Datagram> fragments = dgram.fragment(68 + rng() % 1500);
+            for (const auto &fragment : fragments) {
+                test_err_if(fragment.header().len > 1568, "fragment too big");
+            }
+            if (round % 3 == 1) {
+                const auto more = dgram.fragment(68 + rng() % 1500);
+                fragments.insert(fragments.end(), more.begin(), more.end());
+            }
+            shuffle(fragments.begin(), fragments.end(), rng);
+
+            const auto out = push_all(reassembler, fragments);
+            test_err_if(not out.has_value(), "datagram wasn't reassembled");
+            test_err_if(out->payload().concatenate() != payload, "reassembled payload is wrong");
+            test_err_if(out->header().len != dgram.header().len or out->header().mf or out->header().offset != 0,
+                        "reassembled header is wrong");
+            test_err_if(reparse(*out).payload().concatenate() != payload, "reassembled datagram doesn't serialize");
+            test_err_if(reassembler.partial_datagrams() != 0 or reassembler.memory_used() != 0,
+                        "reassembler should be empty");
+        }
+
+        // interleaved datagrams are kept apart by their ids
+        {
+            IPv4Reassembler reassembler;
+            const string a = random_string(3000, rng), b = random_string(3000, rng);
+            vector<IPv4Datagram> fragments = make_datagram(7, a).fragment(576);
+            const auto more = make_datagram(8, b).fragment(576);
+            fragments.insert(fragments.end(), more.begin(), more.end());
+            shuffle(fragments.begin(), fragments.end(), rng);
+
+            vector<string> payloads;
+            for (const auto &fragment : fragments) {
+                const auto out = reassembler.push(reparse(fragment));
+                if (out.has_value()) {
+                    payloads.push_back(out->payload().concatenate());
+                }
+            }
+            sort(payloads.begin(), payloads.end());
+            test_err_if(payloads != (vector<string>{min(a, b), max(a, b)}), "interleaved datagrams were mixed up");
+        }
+
+        // partial datagrams time out
+        {
+            IPv4Reassembler reassembler{IPv4Reassembler::DEFAULT_MEMORY_LIMIT, 1000};
+            const auto fragments = make_datagram(9, random_string(3000, rng)).fragment(576);
+            reassembler.push(reparse(fragments.at(0)));
+            reassembler.tick(999);
+            test_err_if(reassembler.partial_datagrams() != 1, "partial datagram expired early");
+            reassembler.push(reparse(fragments.at(1)));
+            reassembler.tick(999);
+            test_err_if(reassembler.partial_datagrams() != 1, "a new fragment should restart the timeout");
+            reassembler.tick(1);
+            test_err_if(reassembler.partial_datagrams() != 0 or reassembler.memory_used() != 0,
+                        "partial datagram should have expired");
+        }
+
+        // malformed fragments are dropped
+        {
+            IPv4Reassembler reassembler;
+            IPv4Datagram odd = make_datagram(10, string(13, 'x'));
+            odd.header().mf = true;
+            test_err_if(reassembler.push(reparse(odd)).has_value() or reassembler.partial_datagrams() != 0,
+                        "a fragment that isn't a multiple of 8 bytes should be dropped");
+
+            const auto fragments = make_datagram(11, random_string(3000, rng)).fragment(576);
+            reassembler.push(reparse(fragments.at(1)));
+            IPv4Datagram short_last = make_datagram(11, string(8, 'x'));
+            short_last.header().offset = 1;
+            test_err_if(reassembler.push(reparse(short_last)).has_value() or reassembler.partial_datagrams() != 0,
+                        "a last fragment before data already held should drop the datagram");
+        }
+
+        // a flood of fragments that never complete stays within the budget, and real datagrams still get through
+        {
+            const size_t budget = 256 * 1024;
+            IPv4Reassembler reassembler{budget};
+            for (unsigned int i = 0; i < 20000; i++) {
+                IPv4Datagram junk = make_datagram(uint16_t(i), string(8, 'j'));
+                junk.header().src = rng();
+                junk.header().mf = true;
+                reassembler.push(reparse(junk));
+                test_err_if(reassembler.memory_used() > budget, "reassembler went over budget");
+
+                if (i % 1000 == 999) {
+                    const string payload = random_string(4000, rng);
+                    const auto out = push_all(reassembler, make_datagram(uint16_t(i), payload).fragment(1500));
+                    test_err_if(not out.has_value() or out->payload().concatenate() != payload,
+                                "datagram should be reassembled during a flood");
+                }
+            }
+        }
+
+        // a segment bigger than the MTU goes out in fragments, and comes back together at the other end
+        {
+            TCPOverIPv4Adapter sender, receiver;
+            sender.config_mut().source = {"10.0.0.1", 1000};
+            sender.config_mut().destination = {"10.0.0.2", 2000};
+            sender.config_mut().mtu = 576;
+            receiver.config_mut().source = {"10.0.0.2", 2000};
+            receiver.config_mut().destination = {"10.0.0.1", 1000};
+
+            TCPSegment seg;
+            seg.header().ack = true;
+            seg.payload() = random_string(1452, rng);
+            vector<string> wire;
+            sender.write_tcp_in_ip(seg, [&](BufferList ip_dgram) { wire.push_back(ip_dgram.concatenate()); });
+            test_err_if(wire.size() != 3, "segment should have been split in three");
+
+            optional<TCPSegment> out;
+            for (const auto &bytes : wire) {
+                test_err_if(bytes.size() > 576, "fragment bigger than the MTU");
+                InternetDatagram ip_dgram;
+                test_err_if(ip_dgram.parse(string(bytes)) != ParseResult::NoError, "fragment doesn't parse");
+                test_err_if(out.has_value(), "segment came out before its last fragment");
+                out = receiver.unwrap_tcp_in_ip(ip_dgram);
+            }
+            test_err_if(not out.has_value() or out->payload().str() != seg.payload().str(),
+                        "segment wasn't reassembled");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+#include "byte_stream.hh"
+#include "ipv4_datagram.hh"
+#include "memory_accountant.hh"
+#include "stream_reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "tcp_receiver.hh"
+#include "test_err_if.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// deliver every queued datagram from `x` to `y`
+static void move_datagrams(TCPDemux &x, TCPDemux &y) {
+    while (not x.datagrams_out().empty()) {
+        InternetDatagram dgram;
+        test_err_if(dgram.parse(x.datagrams_out().front().concatenate()) != ParseResult::NoError,
+                    "bad datagram");
+        x.datagrams_out().pop();
+        y.datagram_received(dgram);
+    }
+}
+
+int main() {
+    try {
+        // streams and reassemblers charge what they hold, and give it back
+        {
+            const size_t base = MemoryAccountant::usage();
+
+            ByteStream stream{10000};
+            stream.write(string(5000, 'x'));
+            test_err_if(MemoryAccountant::usage() != base + stream.storage_size(), "stream should be charged");
+            stream.pop_output(5000);
+            stream.release_storage();
+            test_err_if(MemoryAccountant::usage() != base, "released stream should be uncharged");
+
+            StreamReassembler reassembler{10000};
+            reassembler.push_substring(string(1000, 'x'), 1000, false);
+            reassembler.push_substring(string(1000, 'x'), 1500, false);
+            test_err_if(MemoryAccountant::usage() != base + 1500, "out-of-order bytes should be charged once");
+            {
+                const StreamReassembler copy = reassembler;
+                test_err_if(MemoryAccountant::usage() != base + 3000, "a copy should be charged too");
+            }
+            test_err_if(MemoryAccountant::usage() != base + 1500, "destroyed copy should be uncharged");
+
+            test_err_if(reassembler.drop_unassembled() != 1500, "should drop what was buffered");
+            test_err_if(reassembler.dropped_bytes() != 1500, "dropped bytes should be counted");
+            test_err_if(MemoryAccountant::usage() != base, "dropped bytes should be uncharged");
+
+            // the dropped bytes arrive again
+            reassembler.push_substring(string(2500, 'x'), 0, false);
+            test_err_if(reassembler.stream_out().buffer_size() != 2500, "stream should be whole after the drop");
+        }
+
+        // under pressure, even a fixed receive window shrinks, and it grows back after
+        {
+            ByteStream hog{1 << 20};
+            hog.write(string(100000, 'x'));
+
+            TCPReceiver receiver{64000};
+            TCPSegment syn;
+            syn.header().syn = true;
+            receiver.segment_received(syn);
+
+            MemoryAccountant::set_limit(50000);
+            for (unsigned i = 0; i < 10; i++) {
+                receiver.tick_us(1000, 1000);
+            }
+            test_err_if(receiver.capacity() != TCPReceiver::PRESSURE_MIN_CAPACITY, "window should shrink");
+
+            MemoryAccountant::set_limit(0);
+            receiver.tick_us(1000, 1000);
+            test_err_if(receiver.capacity() != 64000, "window should grow back");
+        }
+
+        // a demultiplexer under pressure drops out-of-order data, largest holder first,
+        // and refuses new connections
+        {
+            const Address server_addr{"10.0.0.1", 80};
+            const Address client_addr{"10.0.0.2", 0};
+
+            TCPConfig cfg{};
+            cfg.recv_capacity = 4000;
+            cfg.send_capacity = 4000;
+            TCPDemux server{cfg}, client{cfg};
+            server.listen(server_addr);
+
+            vector<TCPFlow> flows;
+            for (unsigned i = 0; i < 3; i++) {
+                flows.push_back(client.connect(client_addr, server_addr));
+            }
+            move_datagrams(client, server);
+            move_datagrams(server, client);
+            move_datagrams(client, server);
+            vector<TCPFlow> accepted;
+            while (const auto flow = server.accept(server_addr)) {
+                accepted.push_back(flow.value());
+            }
+            test_err_if(accepted.size() != 3, "server should have accepted every connection");
+
+            // each connection loses its first segment, leaving 1000, 2000 and 3000 bytes out of order
+            for (unsigned i = 0; i < 3; i++) {
+                client.write(flows[i], string((i + 2) * 1000, 'a' + i));
+                client.datagrams_out().pop();
+                move_datagrams(client, server);
+            }
+            move_datagrams(server, client);
+
+            auto unassembled = [&] {
+                vector<size_t> bytes;
+                for (const auto &flow : accepted) {
+                    bytes.push_back(server.connection(flow).unassembled_bytes());
+                }
+                sort(bytes.begin(), bytes.end());
+                return bytes;
+            };
+            test_err_if((unassembled() != vector<size_t>{1000, 2000, 3000}), "data should be out of order");
+            for (const auto &flow : accepted) {
+                const TCPConnection &conn = server.connection(flow);
+                test_err_if(conn.memory_usage() != conn.unassembled_bytes(), "usage should count out-of-order data");
+                test_err_if(conn.stats().memory_bytes != conn.memory_usage(), "stats should report usage");
+            }
+
+            // the client's outbound streams have drained but keep their storage, until memory is short
+            for (const auto &flow : flows) {
+                test_err_if(client.connection(flow).memory_usage() == 0, "drained stream should keep its storage");
+            }
+            MemoryAccountant::set_limit(MemoryAccountant::usage() - 1);
+            client.tick(1);
+            for (const auto &flow : flows) {
+                test_err_if(client.connection(flow).memory_usage() != 0, "drained stream should give back storage");
+            }
+            test_err_if(MemoryAccountant::under_pressure(), "released storage should relieve pressure");
+
+            // dropping the largest holder's data is enough
+            MemoryAccountant::set_limit(MemoryAccountant::usage() - 1);
+            server.tick(1);
+            test_err_if((unassembled() != vector<size_t>{0, 1000, 2000}), "only the largest holder should drop");
+            test_err_if(MemoryAccountant::under_pressure(), "pressure should be relieved");
+
+            // a SYN is refused while memory is short, and accepted when the peer tries again later
+            MemoryAccountant::set_limit(1);
+            const TCPFlow late = client.connect(client_addr, server_addr);
+            move_datagrams(client, server);
+            test_err_if(server.half_open() != 0 or server.refused() != 1, "SYN should be refused");
+            test_err_if(not server.datagrams_out().empty(), "refused SYN shouldn't be answered");
+            MemoryAccountant::set_limit(0);
+            client.tick(cfg.rt_timeout);
+            move_datagrams(client, server);
+            test_err_if(server.half_open() != 1, "retransmitted SYN should be accepted");
+            test_err_if(not client.contains(late), "client should still be connecting");
+
+            // the dropped data is retransmitted, and every stream arrives whole
+            vector<string> received(3);
+            for (unsigned round = 0; round < 50; round++) {
+                move_datagrams(client, server);
+                for (unsigned i = 0; i < 3; i++) {
+                    received[i] += server.read(accepted[i], 10000);
+                }
+                move_datagrams(server, client);
+                client.tick(cfg.rt_timeout);
+                server.tick(cfg.rt_timeout);
+            }
+            vector<size_t> sizes;
+            for (const auto &data : received) {
+                test_err_if(data.empty() or data != string(data.size(), data.front()), "wrong data received");
+                sizes.push_back(data.size());
+            }
+            sort(sizes.begin(), sizes.end());
+            test_err_if((sizes != vector<size_t>{2000, 3000, 4000}), "every stream should arrive whole");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
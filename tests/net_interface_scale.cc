@@ -0,0 +1,109 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static const EthernetAddress LOCAL_ETH = {0x02, 0, 0, 0, 0, 1};
+
+static EthernetAddress neighbor_eth(const uint32_t n) {
+    return {0x02, 0, uint8_t(n >> 24), uint8_t(n >> 16), uint8_t(n >> 8), uint8_t(n)};
+}
+
+static uint32_t neighbor_ip(const uint32_t n) { return (10u << 24) + n * 7919; }
+
+static InternetDatagram make_datagram() {
+    InternetDatagram dgram;
+    dgram.header().src = Address("10.0.0.1", 0).ipv4_numeric();
+    dgram.header().dst = Address("1.2.3.4", 0).ipv4_numeric();
+    dgram.payload() = string("hello");
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    return dgram;
+}
+
+// an unsolicited ARP reply from neighbor `n`
+static EthernetFrame announce(const uint32_t n) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = neighbor_eth(n);
+    arp.sender_ip_address = neighbor_ip(n);
+    arp.target_ethernet_address = LOCAL_ETH;
+    arp.target_ip_address = Address("10.0.0.1", 0).ipv4_numeric();
+
+    EthernetFrame frame;
+    frame.header().src = neighbor_eth(n);
+    frame.header().dst = LOCAL_ETH;
+    frame.header().type = EthernetHeader::TYPE_ARP;
+    frame.payload() = arp.serialize();
+    return frame;
+}
+
+// send a datagram to neighbor `n`; returns the frame's destination and type
+static pair<EthernetAddress, uint16_t> send_to(NetworkInterface &interface, const uint32_t n) {
+    interface.send_datagram(make_datagram(), Address::from_ipv4_numeric(neighbor_ip(n)));
+    test_err_if(interface.frames_out().size() != 1, "expected exactly one frame");
+    const auto ret = make_pair(interface.frames_out().front().header().dst, interface.frames_out().front().header().type);
+    interface.frames_out().pop();
+    return ret;
+}
+
+int main() {
+    try {
+        NetworkInterface interface{LOCAL_ETH, Address("10.0.0.1", 0)};
+        const uint32_t n = 5000;
+
+        // learn many mappings, half of them 15 seconds after the rest
+        for (uint32_t i = 0; i < n; i++) {
+            if (i == n / 2) {
+                interface.tick(15000);
+            }
+            interface.recv_frame(announce(i));
+        }
+        test_err_if(not interface.frames_out().empty(), "replies shouldn't be answered");
+        for (uint32_t i = 0; i < n; i++) {
+            test_err_if(send_to(interface, i) != make_pair(neighbor_eth(i), EthernetHeader::TYPE_IPv4),
+                        "every mapping should be known");
+        }
+
+        // the first half expire, which shifts entries around in the table; the rest survive
+        interface.tick(15001);
+        for (uint32_t i = n / 2; i < n; i++) {
+            test_err_if(send_to(interface, i) != make_pair(neighbor_eth(i), EthernetHeader::TYPE_IPv4),
+                        "mappings learned later should still be known");
+        }
+        for (uint32_t i = 0; i < n / 2; i++) {
+            test_err_if(send_to(interface, i) != make_pair(ETHERNET_BROADCAST, EthernetHeader::TYPE_ARP),
+                        "expired mappings should need ARP again");
+        }
+
+        // requests are rate-limited per address, and answered ones release their datagrams
+        for (uint32_t i = 0; i < n / 2; i++) {
+            interface.send_datagram(make_datagram(), Address::from_ipv4_numeric(neighbor_ip(i)));
+        }
+        test_err_if(not interface.frames_out().empty(), "pending requests shouldn't be repeated");
+        for (uint32_t i = 0; i < n / 2; i++) {
+            interface.recv_frame(announce(i));
+            test_err_if(interface.frames_out().size() != 2, "both waiting datagrams should be sent");
+            while (not interface.frames_out().empty()) {
+                test_err_if(interface.frames_out().front().header().dst != neighbor_eth(i), "sent to the wrong address");
+                interface.frames_out().pop();
+            }
+        }
+
+        // everything lapses eventually
+        interface.tick(60000);
+        for (uint32_t i = 0; i < n; i += 97) {
+            test_err_if(send_to(interface, i).second != EthernetHeader::TYPE_ARP, "all mappings should have lapsed");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+#include "router.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static EthernetAddress random_host_ethernet_address() {
+    EthernetAddress addr;
+    for (auto &byte : addr) {
+        byte = random_device()();  // use a random local Ethernet address
+    }
+    addr.at(0) |= 0x02;  // "10" in last two binary digits marks a private Ethernet address
+    addr.at(0) &= 0xfe;
+
+    return addr;
+}
+
+static uint32_t ip(const string &str) { return Address{str}.ipv4_numeric(); }
+
+//! A host with one interface, which sends everything to its default gateway
+class Host {
+    string _name;
+    Address _my_address;
+    AsyncNetworkInterface _interface;
+    Address _next_hop;
+
+    //! Payloads (and the TTL they should arrive with) that this host is waiting for
+    list<pair<string, uint8_t>> _expecting{};
+
+  public:
+    Host(const string &name, const Address &my_address, const Address &next_hop)
+        : _name(name)
+        , _my_address(my_address)
+        , _interface(random_host_ethernet_address(), _my_address)
+        , _next_hop(next_hop) {}
+
+    //! Send a datagram to `destination`, and tell `receiver` to expect it after `hops` routers
+    void send_to(const Address &destination, Host &receiver, const uint8_t hops, const uint8_t ttl = 64) {
+        InternetDatagram dgram;
+        dgram.header().src = _my_address.ipv4_numeric();
+        dgram.header().dst = destination.ipv4_numeric();
+        dgram.header().ttl = ttl;
+        dgram.payload() = string("random payload: {" + to_string(random_device()()) + "}");
+        dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+
+        if (ttl > hops) {
+            receiver._expecting.emplace_back(dgram.payload().concatenate(), ttl - hops);
+        }
+        _interface.send_datagram(dgram, _next_hop);
+    }
+
+    AsyncNetworkInterface &interface() { return _interface; }
+
+    //! Check every datagram that arrived was expected, and report any that didn't arrive
+    void check() {
+        while (not _interface.datagrams_out().empty()) {
+            const InternetDatagram &dgram = _interface.datagrams_out().front();
+            const auto it =
+                find(_expecting.begin(), _expecting.end(), make_pair(dgram.payload().concatenate(), dgram.header().ttl));
+            if (it == _expecting.end()) {
+                throw runtime_error(_name + " received an unexpected datagram: " + dgram.header().summary());
+            }
+            _expecting.erase(it);
+            _interface.datagrams_out().pop();
+        }
+        if (not _expecting.empty()) {
+            throw runtime_error(_name + " is still waiting for " + to_string(_expecting.size()) + " datagram(s)");
+        }
+    }
+};
+
+//! A broadcast domain: every frame sent by one interface is seen by all the others
+class NetworkSegment {
+    vector<AsyncNetworkInterface *> _interfaces{};
+
+  public:
+    void connect(AsyncNetworkInterface &interface) { _interfaces.push_back(&interface); }
+
+    //! Deliver every queued frame; returns whether there were any
+    bool deliver() {
+        bool any = false;
+        for (AsyncNetworkInterface *sender : _interfaces) {
+            while (not sender->frames_out().empty()) {
+                const EthernetFrame frame = sender->frames_out().front();
+                sender->frames_out().pop();
+                for (AsyncNetworkInterface *receiver : _interfaces) {
+                    if (receiver != sender) {
+                        receiver->recv_frame(frame);
+                    }
+                }
+                any = true;
+            }
+        }
+        return any;
+    }
+};
+
+int main() {
+    try {
+        // Topology:
+        //
+        //   applesauce ---- [ default ] ---- dm42, gateway (everything else)
+        //    .0.2/24            |
+        //                  10.0.0.0/30
+        //                       |
+        //   cherrypie ----- [ branch ] ---- plum (192.168.1.128/25)
+        //    .1.2/24
+        Host applesauce{"applesauce", Address{"192.168.0.2"}, Address{"192.168.0.1"}};
+        Host dm42{"dm42", Address{"171.67.76.46"}, Address{"171.67.76.254"}};
+        Host gateway{"gateway", Address{"171.67.76.1"}, Address{"171.67.76.254"}};
+        Host cherrypie{"cherrypie", Address{"192.168.1.2"}, Address{"192.168.1.1"}};
+        Host plum{"plum", Address{"192.168.1.200"}, Address{"192.168.1.129"}};
+
+        Router default_router;
+        const size_t home = default_router.add_interface({random_host_ethernet_address(), Address{"192.168.0.1"}});
+        const size_t uplink = default_router.add_interface({random_host_ethernet_address(), Address{"171.67.76.254"}});
+        const size_t to_branch = default_router.add_interface({random_host_ethernet_address(), Address{"10.0.0.1"}});
+        default_router.add_route(ip("0.0.0.0"), 0, Address{"171.67.76.1"}, uplink);
+        default_router.add_route(ip("192.168.0.0"), 24, {}, home);
+        default_router.add_route(ip("171.67.76.0"), 24, {}, uplink);
+        default_router.add_route(ip("192.168.1.0"), 24, Address{"10.0.0.2"}, to_branch);
+
+        // the more specific route is added first, and mustn't be hidden by the shorter one
+        Router branch_router;
+        const size_t to_default = branch_router.add_interface({random_host_ethernet_address(), Address{"10.0.0.2"}});
+        const size_t lan = branch_router.add_interface({random_host_ethernet_address(), Address{"192.168.1.1"}});
+        const size_t lab = branch_router.add_interface({random_host_ethernet_address(), Address{"192.168.1.129"}});
+        branch_router.add_route(ip("192.168.1.128"), 25, {}, lab);
+        branch_router.add_route(ip("192.168.1.0"), 24, {}, lan);
+        branch_router.add_route(ip("0.0.0.0"), 0, Address{"10.0.0.1"}, to_default);
+
+        vector<NetworkSegment> segments(5);
+        segments[0].connect(applesauce.interface());
+        segments[0].connect(default_router.interface(home));
+        segments[1].connect(dm42.interface());
+        segments[1].connect(gateway.interface());
+        segments[1].connect(default_router.interface(uplink));
+        segments[2].connect(default_router.interface(to_branch));
+        segments[2].connect(branch_router.interface(to_default));
+        segments[3].connect(cherrypie.interface());
+        segments[3].connect(branch_router.interface(lan));
+        segments[4].connect(plum.interface());
+        segments[4].connect(branch_router.interface(lab));
+
+        const auto simulate = [&] {
+            for (bool busy = true; busy;) {
+                busy = false;
+                for (auto &segment : segments) {
+                    busy |= segment.deliver();
+                }
+                default_router.route();
+                branch_router.route();
+            }
+            for (Host *host : {&applesauce, &dm42, &gateway, &cherrypie, &plum}) {
+                host->check();
+            }
+        };
+
+        // one router; the first datagram also exercises ARP at both ends
+        applesauce.send_to(Address{"171.67.76.46"}, dm42, 1);
+        simulate();
+        dm42.send_to(Address{"192.168.0.2"}, applesauce, 1);
+        simulate();
+
+        // two routers, and longest-prefix match
+        applesauce.send_to(Address{"192.168.1.2"}, cherrypie, 2);
+        applesauce.send_to(Address{"192.168.1.200"}, plum, 2);
+        cherrypie.send_to(Address{"192.168.1.200"}, plum, 1);
+        plum.send_to(Address{"192.168.1.2"}, cherrypie, 1);
+        simulate();
+
+        // default routes
+        cherrypie.send_to(Address{"8.8.8.8"}, gateway, 2);
+        plum.send_to(Address{"1.1.1.1"}, gateway, 2);
+        applesauce.send_to(Address{"198.178.229.1"}, gateway, 1);
+        simulate();
+
+        // the TTL runs out at the last router, or just before
+        applesauce.send_to(Address{"192.168.1.2"}, cherrypie, 2, 2);
+        applesauce.send_to(Address{"192.168.1.2"}, cherrypie, 2, 3);
+        applesauce.send_to(Address{"171.67.76.46"}, dm42, 1, 1);
+        applesauce.send_to(Address{"171.67.76.46"}, dm42, 1, 2);
+        simulate();
+
+        // the incrementally updated checksum is right for every TTL
+        for (unsigned int ttl = 3; ttl <= 255; ttl++) {
+            cherrypie.send_to(Address{"171.67.76.46"}, dm42, 2, ttl);
+        }
+        simulate();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
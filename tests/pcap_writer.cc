@@ -0,0 +1,128 @@
+#include "ipv4_datagram.hh"
+#include "pcap_writer_adapter.hh"
+#include "socket.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// read a native-order integer from `in`
+template <typename T>
+static T read_raw(istream &in) {
+    T value{};
+    in.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+}
+
+// every datagram in the pcap file at `path`
+static vector<InternetDatagram> read_pcap(const string &path) {
+    ifstream in{path, ios::binary};
+    test_err_if(read_raw<uint32_t>(in) != 0xa1b2c3d4, "wrong magic number");
+    test_err_if(read_raw<uint16_t>(in) != 2 or read_raw<uint16_t>(in) != 4, "wrong version");
+    in.ignore(12);
+    test_err_if(read_raw<uint32_t>(in) != PcapWriter::LINKTYPE_RAW, "wrong link type");
+
+    vector<InternetDatagram> ret;
+    while (in.peek() != EOF) {
+        in.ignore(8);
+        const auto captured = read_raw<uint32_t>(in);
+        test_err_if(read_raw<uint32_t>(in) != captured, "whole datagrams should be captured");
+        string packet(captured, 0);
+        in.read(packet.data(), packet.size());
+        test_err_if(not in, "truncated record");
+
+        InternetDatagram dgram;
+        test_err_if(dgram.parse(move(packet)) != ParseResult::NoError, "bad IPv4 datagram");
+        ret.push_back(move(dgram));
+    }
+    return ret;
+}
+
+// parse and check the TCP segment in `dgram`, including its checksum
+static TCPSegment segment_in(const InternetDatagram &dgram) {
+    TCPSegment seg;
+    test_err_if(seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError,
+                "bad TCP segment or checksum");
+    return seg;
+}
+
+int main() {
+    const string prefix = "/tmp/sponge_pcap_" + to_string(getpid());
+    const string client_path = prefix + "_client.pcap", server_path = prefix + "_server.pcap";
+    try {
+        const Address client_addr{"127.0.0.1", 0}, server_addr{"127.0.0.1", 0};
+        UDPSocket client_sock, server_sock;
+        client_sock.bind(client_addr);
+        server_sock.bind(server_addr);
+
+        FdAdapterConfig client_cfg{}, server_cfg{};
+        client_cfg.source = client_sock.local_address();
+        client_cfg.destination = server_sock.local_address();
+        server_cfg.source = server_sock.local_address();
+
+        const size_t n_segments = 300;
+        {
+            PcapLossyTCPOverUDPSocketAdapter client{
+                LossyTCPOverUDPSocketAdapter{TCPOverUDPSocketAdapter{move(client_sock)}}, client_path};
+            PcapLossyTCPOverUDPSocketAdapter server{
+                LossyTCPOverUDPSocketAdapter{TCPOverUDPSocketAdapter{move(server_sock)}}, server_path};
+            client.config_mut() = client_cfg;
+            server.config_mut() = server_cfg;
+            server.set_listening(true);
+
+            // enough data for more than one batch
+            for (size_t i = 0; i < n_segments; i++) {
+                TCPSegment seg;
+                seg.header().syn = i == 0;
+                seg.header().seqno = WrappingInt32{uint32_t(1000 * i)};
+                seg.header().win = 1000;
+                seg.payload() = string(1000, char('a' + i % 26));
+                client.write(seg);
+
+                const auto received = server.read();
+                test_err_if(not received.has_value(), "server should read each segment");
+                test_err_if(received->header().seqno != seg.header().seqno, "server read the wrong segment");
+            }
+
+            // a tick hands the partly-filled batch to the writer thread, as destruction would
+            server.tick_us(PcapWriterAdapter<LossyTCPOverUDPSocketAdapter>::FLUSH_INTERVAL_US);
+        }
+
+        const auto sent = read_pcap(client_path);
+        const auto received = read_pcap(server_path);
+        test_err_if(sent.size() != n_segments, "client should capture every segment it wrote");
+        test_err_if(received.size() != n_segments, "server should capture every segment it read");
+
+        for (size_t i = 0; i < n_segments; i++) {
+            for (const auto &dgram : {sent.at(i), received.at(i)}) {
+                const TCPSegment seg = segment_in(dgram);
+                test_err_if(seg.header().seqno.raw_value() != 1000 * i, "segments should be in order");
+                test_err_if(seg.payload().str() != string(1000, char('a' + i % 26)), "wrong payload");
+                test_err_if(seg.header().syn != (i == 0), "wrong flags");
+                test_err_if(seg.header().sport != client_cfg.source.port(), "wrong source port");
+                test_err_if(seg.header().dport != server_cfg.source.port(), "wrong destination port");
+                test_err_if(dgram.header().src != client_cfg.source.ipv4_numeric(), "wrong source address");
+                test_err_if(dgram.header().dst != server_cfg.source.ipv4_numeric(), "wrong destination address");
+            }
+            test_err_if(sent.at(i).header().id != i, "IPv4 ids should count up");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        remove(client_path.c_str());
+        remove(server_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    remove(client_path.c_str());
+    remove(server_path.c_str());
+    return EXIT_SUCCESS;
+}
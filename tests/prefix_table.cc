@@ -0,0 +1,92 @@
+#include "prefix_table.hh"
+#include "test_err_if.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+struct Prefix {
+    uint32_t prefix;
+    uint8_t length;
+};
+
+static uint32_t mask(const uint8_t length) { return length == 0 ? 0 : ~uint32_t{0} << (32 - length); }
+
+// the index of the longest matching prefix, by linear scan (later ones replace earlier ones of the same length)
+static optional<uint32_t> brute_force(const vector<Prefix> &prefixes, const uint32_t address) {
+    optional<uint32_t> ret;
+    for (uint32_t i = 0; i < prefixes.size(); i++) {
+        const Prefix &p = prefixes[i];
+        if ((address & mask(p.length)) == (p.prefix & mask(p.length)) and
+            (not ret.has_value() or p.length >= prefixes[ret.value()].length)) {
+            ret = i;
+        }
+    }
+    return ret;
+}
+
+int main() {
+    try {
+        // an empty table matches nothing, and a default route matches everything
+        {
+            PrefixTable table;
+            test_err_if(table.lookup(0x01020304).has_value(), "empty table shouldn't match");
+            table.insert(0, 0, 7);
+            test_err_if(table.lookup(0) != 7u or table.lookup(0xffffffff) != 7u, "default route should match");
+        }
+
+        // the largest value survives a split into chunks, and anything larger is rejected
+        {
+            PrefixTable table;
+            table.insert(0x0a000000, 8, PrefixTable::MAX_VALUE);
+            table.insert(0x0a010200, 24, 1);
+            test_err_if(table.lookup(0x0a000001) != PrefixTable::MAX_VALUE, "largest value should be returned");
+            test_err_if(table.lookup(0x0a010201) != 1u, "longer prefix should match");
+            bool rejected = false;
+            try {
+                table.insert(0x0b000000, 8, PrefixTable::MAX_VALUE + 1);
+            } catch (const runtime_error &) {
+                rejected = true;
+            }
+            test_err_if(not rejected, "value that would look like a chunk should be rejected");
+            test_err_if(table.lookup(0x0b000001).has_value(), "rejected prefix shouldn't match");
+        }
+
+        // nested prefixes of every length, inserted in random order, and addresses near their edges
+        mt19937 rng{42};
+        for (unsigned int round = 0; round < 20; round++) {
+            const uint32_t base = rng();
+            vector<Prefix> prefixes;
+            for (uint8_t length = 0; length <= 32; length++) {
+                prefixes.push_back({base, length});
+                prefixes.push_back({base ^ (uint32_t{1} << (32 - max(length, uint8_t{1}))), length});
+            }
+            for (unsigned int i = 0; i < 200; i++) {
+                prefixes.push_back({base ^ (uint32_t(rng()) >> (rng() % 32)), uint8_t(rng() % 33)});
+            }
+            shuffle(prefixes.begin(), prefixes.end(), rng);
+
+            PrefixTable table;
+            for (uint32_t i = 0; i < prefixes.size(); i++) {
+                table.insert(prefixes[i].prefix, prefixes[i].length, i);
+            }
+
+            for (unsigned int i = 0; i < 2000; i++) {
+                const uint32_t address = base ^ (uint32_t(rng()) >> (rng() % 32));
+                test_err_if(table.lookup(address) != brute_force(prefixes, address), "wrong longest match");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
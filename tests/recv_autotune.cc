@@ -0,0 +1,127 @@
+#include "byte_stream.hh"
+#include "memory_accountant.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "test_err_if.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+// a client sending as fast as the server's window allows, over a path with a 10 ms RTT
+class Transfer {
+    TCPConfig _cfg;
+    TCPConnection _client{_cfg}, _server;
+    optional<WrappingInt32> _edge{};  // right edge of the window the server last advertised
+    uint16_t _window = 0;             // and its size
+    bool _edge_retreated = false;
+
+    // deliver `x`'s segments to `y`, then let 5 ms pass
+    void _deliver(TCPConnection &x, TCPConnection &y) {
+        while (not x.segments_out().empty()) {
+            const TCPSegment &seg = x.segments_out().front();
+            if (&x == &_server and seg.header().ack) {
+                const WrappingInt32 edge = seg.header().ackno + seg.header().win;
+                _edge_retreated |= _edge.has_value() and edge - _edge.value() < 0;
+                _edge = edge;
+                _window = seg.header().win;
+            }
+            y.segment_received(seg);
+            x.segments_out().pop();
+        }
+        _client.tick(5);
+        _server.tick(5);
+    }
+
+  public:
+    explicit Transfer(const TCPConfig &server_cfg) : _cfg(), _server(server_cfg) {
+        _client.connect();
+        _deliver(_client, _server);
+        _deliver(_server, _client);
+        _deliver(_client, _server);
+    }
+
+    // one round trip, in which the server's application reads up to `app_read` bytes
+    void round(const size_t app_read) {
+        _client.write(string(_client.remaining_outbound_capacity(), 'x'));
+        _deliver(_client, _server);
+        _server.inbound_stream().pop_output(app_read);
+        _deliver(_server, _client);
+    }
+
+    const TCPConnection &server() const { return _server; }
+    uint16_t advertised_window() const { return _window; }
+    bool edge_retreated() const { return _edge_retreated; }
+};
+
+int main() {
+    try {
+        TCPConfig autotuned{};
+        autotuned.recv_capacity = 4000;
+        autotuned.recv_capacity_max = 64000;
+
+        // without a maximum, the window stays put
+        {
+            TCPConfig fixed{};
+            fixed.recv_capacity = 4000;
+            Transfer t{fixed};
+            for (unsigned i = 0; i < 50; i++) {
+                t.round(string::npos);
+            }
+            test_err_if(t.server().stats().recv_capacity != 4000, "fixed receive buffer shouldn't change");
+        }
+
+        // an application that keeps up lets the window grow to the maximum
+        {
+            Transfer t{autotuned};
+            size_t largest_window = 0;
+            for (unsigned i = 0; i < 50; i++) {
+                t.round(string::npos);
+                largest_window = max<size_t>(largest_window, t.advertised_window());
+            }
+            test_err_if(t.server().stats().recv_capacity != 64000, "receive buffer should grow to the maximum");
+            test_err_if(largest_window < 60000, "the larger buffer should be advertised");
+            test_err_if(t.edge_retreated(), "window's right edge should never move back");
+        }
+
+        // a slow application doesn't
+        {
+            Transfer t{autotuned};
+            for (unsigned i = 0; i < 50; i++) {
+                t.round(200);
+            }
+            test_err_if(t.server().stats().recv_capacity != 4000, "receive buffer shouldn't outgrow a slow reader");
+        }
+
+        // under memory pressure, a grown buffer shrinks back as the application reads, without
+        // taking back any window it advertised
+        {
+            Transfer t{autotuned};
+            for (unsigned i = 0; i < 50; i++) {
+                t.round(string::npos);
+            }
+            test_err_if(t.server().stats().recv_capacity != 64000, "receive buffer should have grown");
+
+            // another stream holding more than the threshold
+            ByteStream hog{1 << 20};
+            hog.write(string(100000, 'x'));
+            MemoryAccountant::set_limit(50000);
+            for (unsigned i = 0; i < 50; i++) {
+                t.round(string::npos);
+            }
+            MemoryAccountant::set_limit(0);
+            test_err_if(t.server().stats().recv_capacity != 4000, "receive buffer should shrink under pressure");
+            test_err_if(t.edge_retreated(), "window's right edge should never move back");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
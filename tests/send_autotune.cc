@@ -0,0 +1,129 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_deliver.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// a config whose receive window is `bytes`
+static TCPConfig window(const size_t bytes) {
+    TCPConfig cfg{};
+    cfg.recv_capacity = bytes;
+    return cfg;
+}
+
+// a client whose application keeps its send buffer full, over a path with a 10 ms RTT
+class Transfer {
+    TCPConnection _client, _server;
+
+    void _tick() {
+        _client.tick(5);
+        _server.tick(5);
+    }
+
+  public:
+    Transfer(const TCPConfig &client_cfg, const size_t server_window)
+        : _client(client_cfg), _server(window(server_window)) {
+        _client.connect();
+        deliver(_client, _server);
+        _tick();
+        deliver(_server, _client);
+        _tick();
+    }
+
+    // one round trip, in which the server's application reads each segment as it arrives
+    void round_trip() {
+        while (not _client.segments_out().empty()) {
+            _server.segment_received(_client.segments_out().front());
+            _client.segments_out().pop();
+            _server.inbound_stream().pop_output(_server.inbound_stream().buffer_size());
+        }
+        _tick();
+        deliver(_server, _client);
+        _tick();
+    }
+
+    // fill the send buffer, then a round trip; returns the number of bytes the client's application wrote
+    size_t round() {
+        const size_t written = _client.write(string(_client.remaining_outbound_capacity(), 'x'));
+        round_trip();
+        return written;
+    }
+
+    TCPConnection &client() { return _client; }
+};
+
+int main() {
+    try {
+        TCPConfig autotuned{};
+        autotuned.send_capacity = 4000;
+        autotuned.send_capacity_max = 64000;
+
+        // without a maximum, the send buffer stays put
+        {
+            TCPConfig fixed{};
+            fixed.send_capacity = 4000;
+            Transfer t{fixed, 64000};
+            for (unsigned i = 0; i < 30; i++) {
+                t.round();
+            }
+            test_err_if(t.client().stats().send_capacity != 4000, "fixed send buffer shouldn't change");
+        }
+
+        // with room in the peer's window, the buffer grows to keep it full
+        {
+            Transfer t{autotuned, 64000};
+            size_t first = t.round(), last = 0;
+            for (unsigned i = 0; i < 30; i++) {
+                last = t.round();
+            }
+            test_err_if(t.client().stats().send_capacity < 32000, "send buffer should grow with the bytes in flight");
+            test_err_if(last < 8 * first, "application should get to write more per round trip");
+        }
+
+        // when the peer's window is what limits the sender, a bigger buffer wouldn't help
+        {
+            Transfer t{autotuned, 1000};
+            for (unsigned i = 0; i < 30; i++) {
+                t.round();
+            }
+            test_err_if(t.client().stats().send_capacity != 4000, "send buffer shouldn't outgrow the window");
+        }
+
+        // the application's data is read only once a low-watermark of space is free
+        {
+            TCPConfig lowat{};
+            lowat.send_capacity = 10000;
+            lowat.send_lowat = 4000;
+            Transfer t{lowat, 3000};
+            TCPConnection &client = t.client();
+            test_err_if(not client.outbound_writable(), "empty send buffer should be writable");
+            client.write(string(10000, 'x'));
+            test_err_if(client.remaining_outbound_capacity() != 3000, "a window's worth should have been sent");
+            test_err_if(client.outbound_writable(), "less than the low-watermark is free");
+            t.round_trip();
+            test_err_if(client.remaining_outbound_capacity() < 4000 or not client.outbound_writable(),
+                        "the low-watermark is free once the peer has read a window's worth");
+
+            // a buffer smaller than the low-watermark has to empty completely
+            TCPConfig small{};
+            small.send_capacity = 3000;
+            small.send_lowat = 4000;
+            Transfer u{small, 2000};
+            u.client().write(string(3000, 'x'));
+            test_err_if(u.client().outbound_writable(), "a partly full small buffer shouldn't be writable");
+            u.round_trip();
+            test_err_if(not u.client().outbound_writable(), "an empty small buffer should be writable");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -20,7 +20,7 @@ const unsigned int DEFAULT_TEST_WINDOW = 137;
 
 struct SenderTestStep {
     virtual operator std::string() const { return "SenderTestStep"; }
-    virtual void execute(TCPSender &, std::queue<TCPSegment> &) const {}
+    virtual void execute(TCPSender &, TCPSegmentQueue &) const {}
     virtual ~SenderTestStep() {}
 };
 
@@ -50,7 +50,7 @@ class SegmentExpectationViolation : public SenderExpectationViolation {
 struct SenderExpectation : public SenderTestStep {
     operator std::string() const { return "Expectation: " + description(); }
     virtual std::string description() const { return "description missing"; }
-    virtual void execute(TCPSender &, std::queue<TCPSegment> &) const {}
+    virtual void execute(TCPSender &, TCPSegmentQueue &) const {}
     virtual ~SenderExpectation() {}
 };
 
@@ -59,7 +59,7 @@ struct ExpectState : public SenderExpectation {
 
     ExpectState(const std::string &state) : _state(state) {}
     std::string description() const { return "in state `" + _state + "`"; }
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         if (TCPState::state_summary(sender) != _state) {
             throw SenderExpectationViolation("The TCPSender was in state `" + TCPState::state_summary(sender) +
                                              "`, but it was expected to be in state `" + _state + "`");
@@ -73,7 +73,7 @@ struct ExpectSeqno : public SenderExpectation {
     ExpectSeqno(WrappingInt32 seqno) : _seqno(seqno) {}
     std::string description() const { return "next seqno " + std::to_string(_seqno.raw_value()); }
 
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         if (sender.next_seqno() != _seqno) {
             std::string reported = std::to_string(sender.next_seqno().raw_value());
             std::string expected = to_string(_seqno);
@@ -89,7 +89,7 @@ struct ExpectBytesInFlight : public SenderExpectation {
     ExpectBytesInFlight(size_t n_bytes) : _n_bytes(n_bytes) {}
     std::string description() const { return std::to_string(_n_bytes) + " bytes in flight"; }
 
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         if (sender.bytes_in_flight() != _n_bytes) {
             std::ostringstream ss;
             ss << "The TCPSender reported " << sender.bytes_in_flight()
@@ -103,7 +103,7 @@ struct ExpectNoSegment : public SenderExpectation {
     ExpectNoSegment() {}
     std::string description() const { return "no (more) segments"; }
 
-    void execute(TCPSender &, std::queue<TCPSegment> &segments) const {
+    void execute(TCPSender &, TCPSegmentQueue &segments) const {
         if (not segments.empty()) {
             std::ostringstream ss;
             ss << "The TCPSender sent a segment, but should not have. Segment info:\n\t";
@@ -118,7 +118,7 @@ struct ExpectNoSegment : public SenderExpectation {
 struct SenderAction : public SenderTestStep {
     operator std::string() const { return "Action:      " + description(); }
     virtual std::string description() const { return "description missing"; }
-    virtual void execute(TCPSender &, std::queue<TCPSegment> &) const {}
+    virtual void execute(TCPSender &, TCPSegmentQueue &) const {}
     virtual ~SenderAction() {}
 };
 
@@ -136,7 +136,7 @@ struct WriteBytes : public SenderAction {
         return ss.str();
     }
 
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         sender.stream_in().write(std::move(_bytes));
         if (_end_input) {
             sender.stream_in().end_input();
@@ -170,7 +170,7 @@ struct Tick : public SenderAction {
         return ss.str();
     }
 
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         sender.tick(_ms);
         if (max_retx_exceeded.has_value() and
             max_retx_exceeded != (sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS)) {
@@ -204,7 +204,7 @@ struct AckReceived : public SenderAction {
         return *this;
     }
 
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW));
         sender.fill_window();
     }
@@ -214,7 +214,7 @@ struct Close : public SenderAction {
     Close() {}
     std::string description() const { return "close"; }
 
-    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+    void execute(TCPSender &sender, TCPSegmentQueue &) const {
         sender.stream_in().end_input();
         sender.fill_window();
     }
@@ -336,7 +336,7 @@ struct ExpectSegment : public SenderExpectation {
 
     virtual std::string description() const { return "segment sent with " + segment_description(); }
 
-    void execute(TCPSender &, std::queue<TCPSegment> &segments) const {
+    void execute(TCPSender &, TCPSegmentQueue &segments) const {
         if (segments.empty()) {
             throw SegmentExpectationViolation::violated_verb("existed");
         }
@@ -379,7 +379,7 @@ struct ExpectSegment : public SenderExpectation {
 };
 
 class TCPSenderTestHarness {
-    std::queue<TCPSegment> outbound_segments;
+    TCPSegmentQueue outbound_segments;
     TCPSender sender;
     std::vector<std::string> steps_executed;
     std::string name;
@@ -0,0 +1,98 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_deliver.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <string>
+
+using namespace std;
+
+// count every allocation made while `counting` is set
+static bool counting = false;
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+    if (counting) {
+        allocations++;
+    }
+    if (void *p = malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// a 10 MiB transfer, after a 1 MiB one to warm up, with both sides' ISN fixed at `isn`
+static void run(const WrappingInt32 isn) {
+    TCPConfig cfg{};
+    cfg.fixed_isn = isn;
+    TCPConnection client{cfg}, server{cfg};
+    client.connect();
+    deliver(client, server);
+    deliver(server, client);
+
+    const string chunk(cfg.send_capacity, 'x');
+    size_t segments = 0;
+    // write as much as fits, exchange segments, and have the application consume what arrived
+    auto transfer = [&](const size_t bytes) {
+        const size_t target = server.inbound_stream().bytes_read() + bytes;
+        while (server.inbound_stream().bytes_read() < target) {
+            client.write(chunk);
+            segments += deliver(client, server);
+            server.inbound_stream().pop_output(server.inbound_stream().buffer_size());
+            deliver(server, client);
+            client.tick_us(100);
+            server.tick_us(100);
+        }
+    };
+
+    // queues, streams and the Buffer pool grow to their working sizes
+    transfer(1024 * 1024);
+
+    allocations = 0;
+    counting = true;
+    segments = 0;
+    transfer(10 * 1024 * 1024);
+    counting = false;
+
+    test_err_if(segments < 10000, "transfer should take many segments");
+    if (allocations != 0) {
+        cerr << allocations << " allocations in " << segments << " segments (ISN " << isn << ")\n";
+    }
+    test_err_if(allocations != 0, "steady-state transfer shouldn't allocate");
+    test_err_if(client.stats().retransmitted_segments != 0, "nothing was lost");
+
+    // close both ends
+    client.end_input_stream();
+    server.end_input_stream();
+    while (client.active() or server.active()) {
+        deliver(client, server);
+        deliver(server, client);
+        client.tick(cfg.rt_timeout);
+        server.tick(cfg.rt_timeout);
+    }
+    test_err_if(client.inbound_stream().error() or server.inbound_stream().error(), "should shut down cleanly");
+}
+
+int main() {
+    try {
+        run(WrappingInt32{0});
+
+        // sequence numbers wrap past 2^32 halfway through the measured transfer
+        run(WrappingInt32{uint32_t(0) - (6 << 20)});
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
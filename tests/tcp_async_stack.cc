@@ -0,0 +1,176 @@
+#include "task.hh"
+#include "tcp_async_stack.hh"
+#include "tcp_config.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned NCONNS = 200;
+static constexpr uint64_t TIMEOUT_MS = 20000;
+
+static Task<> echo(AsyncTCPConnection conn) {
+    while (true) {
+        string data = co_await conn.read(4096);
+        if (data.empty()) {
+            break;
+        }
+        co_await conn.write(move(data));
+    }
+    conn.close();
+}
+
+static Task<> echo_server(AsyncTCPStack &stack, const Address addr) {
+    while (true) {
+        stack.spawn(echo(co_await stack.accept(addr)));
+    }
+}
+
+// larger than the send capacity, so writes have to wait for acknowledgments
+static string message(const unsigned i) { return string(5000 + i, char('a' + i % 26)); }
+
+static Task<> client(AsyncTCPStack &stack, const Address local, const Address server, const unsigned i, string &out) {
+    AsyncTCPConnection conn = co_await stack.connect(local, server);
+    co_await conn.write(message(i));
+    conn.close();
+    while (true) {
+        const string data = co_await conn.read(4096);
+        if (data.empty()) {
+            break;
+        }
+        out += data;
+    }
+}
+
+// connect, then wait for the server to finish the inbound stream
+static Task<> idle_client(AsyncTCPStack &stack, const Address local, const Address server) {
+    AsyncTCPConnection conn = co_await stack.connect(local, server);
+    while (not(co_await conn.read(4096)).empty()) {
+    }
+}
+
+// send EXCHANGES messages, waiting for each to come back before the next
+static constexpr unsigned EXCHANGES = 50;
+
+static Task<> ping_client(AsyncTCPStack &stack, const Address local, const Address server, unsigned &echoed) {
+    AsyncTCPConnection conn = co_await stack.connect(local, server);
+    for (unsigned i = 0; i < EXCHANGES; ++i) {
+        co_await conn.write("ping");
+        string reply;
+        while (reply.size() < 4) {
+            reply += co_await conn.read(4096);
+        }
+        echoed += reply == "ping";
+    }
+    conn.close();
+}
+
+static Task<int> answer() { co_return 42; }
+
+static Task<> fail() {
+    const int x = co_await answer();
+    throw runtime_error("expected failure " + to_string(x));
+}
+
+int main() {
+    try {
+        const Address server_addr{"10.0.0.1", 80};
+        const Address client_addr{"10.0.0.2", 0};
+
+        TCPConfig cfg{};
+        cfg.recv_capacity = 4000;
+        cfg.send_capacity = 4000;
+
+        int fds[2];
+        SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+
+        {
+            AsyncTCPStack server{FileDescriptor{fds[0]}, cfg}, clients{FileDescriptor{fds[1]}, cfg};
+            server.listen(server_addr, NCONNS);
+            server.spawn(echo_server(server, server_addr));
+
+            vector<string> received(NCONNS);
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                clients.spawn(client(clients, client_addr, server_addr, i, received[i]));
+            }
+            test_err_if(clients.running() != NCONNS, "every client should be waiting for its handshake");
+
+            const uint64_t start = timestamp_ms();
+            while (clients.running() > 0 and timestamp_ms() - start < TIMEOUT_MS) {
+                clients.poll(0);
+                server.poll(0);
+            }
+
+            test_err_if(clients.running() != 0, "every client should have finished");
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                test_err_if(received[i] != message(i), "wrong data echoed");
+            }
+            test_err_if(server.running() != 1, "only the accept loop should still be running");
+            // ~AsyncTCPStack destroys the suspended accept loop
+        }
+
+        // traffic on one connection doesn't re-check the coroutines waiting on idle ones
+        {
+            int more_fds[2];
+            SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, more_fds));
+            AsyncTCPStack server{FileDescriptor{more_fds[0]}, cfg}, clients{FileDescriptor{more_fds[1]}, cfg};
+            server.listen(server_addr, NCONNS);
+            server.spawn(echo_server(server, server_addr));
+
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                clients.spawn(idle_client(clients, client_addr, server_addr));
+            }
+            uint64_t start = timestamp_ms();
+            while (server.running() != NCONNS + 1 and timestamp_ms() - start < TIMEOUT_MS) {
+                clients.poll(0);
+                server.poll(0);
+            }
+            test_err_if(server.running() != NCONNS + 1, "every idle connection should have been accepted");
+
+            const uint64_t server_checks = server.waiter_checks(), client_checks = clients.waiter_checks();
+            unsigned echoed = 0;
+            clients.spawn(ping_client(clients, client_addr, server_addr, echoed));
+            start = timestamp_ms();
+            while (clients.running() != NCONNS and timestamp_ms() - start < TIMEOUT_MS) {
+                clients.poll(0);
+                server.poll(0);
+            }
+            test_err_if(echoed != EXCHANGES, "every ping should have been echoed");
+
+            // checking every waiter would cost NCONNS per exchange on each side
+            test_err_if(server.waiter_checks() - server_checks > 20 * EXCHANGES, "server checked idle waiters");
+            test_err_if(clients.waiter_checks() - client_checks > 20 * EXCHANGES, "client checked idle waiters");
+        }
+
+        // an exception escaping a spawned task is rethrown by poll()
+        {
+            int more_fds[2];
+            SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, more_fds));
+            AsyncTCPStack stack{FileDescriptor{more_fds[0]}, cfg};
+            FileDescriptor other_end{more_fds[1]};
+
+            stack.spawn(fail());
+            bool threw = false;
+            try {
+                stack.poll(0);
+            } catch (const runtime_error &e) {
+                threw = string(e.what()) == "expected failure 42";
+            }
+            test_err_if(not threw, "poll() should rethrow the task's exception");
+            test_err_if(stack.running() != 0, "the failed task should have finished");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#include "tcp_deliver.hh"
+
+using namespace std;
+
+size_t deliver(TCPConnection &x, TCPConnection &y) {
+    size_t n = 0;
+    while (not x.segments_out().empty()) {
+        y.segment_received(x.segments_out().front());
+        x.segments_out().pop();
+        ++n;
+    }
+    return n;
+}
@@ -0,0 +1,11 @@
+#ifndef SPONGE_LIBSPONGE_TCP_DELIVER_HH
+#define SPONGE_LIBSPONGE_TCP_DELIVER_HH
+
+#include "tcp_connection.hh"
+
+#include <cstddef>
+
+// deliver every segment queued by `x` to `y`, as over a lossless wire; returns the number delivered
+size_t deliver(TCPConnection &x, TCPConnection &y);
+
+#endif  // SPONGE_LIBSPONGE_TCP_DELIVER_HH
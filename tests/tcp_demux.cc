@@ -0,0 +1,265 @@
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "syn_cookies.hh"
+#include "tcp_demux.hh"
+#include "tcp_header_template.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned NCONNS = 500;
+
+// deliver every queued datagram from `x` to `y`
+static void move_datagrams(TCPDemux &x, TCPDemux &y) {
+    while (not x.datagrams_out().empty()) {
+        // reparse, as the datagram would be after crossing a wire
+        InternetDatagram dgram;
+        test_err_if(dgram.parse(x.datagrams_out().front().concatenate()) != ParseResult::NoError,
+                    "bad datagram");
+        x.datagrams_out().pop();
+        y.datagram_received(dgram);
+    }
+}
+
+int main() {
+    try {
+        const Address server_addr{"10.0.0.1", 80};
+        const Address client_addr{"10.0.0.2", 0};
+
+        TCPConfig cfg{};
+        cfg.recv_capacity = 4000;
+        cfg.send_capacity = 4000;
+
+        // many connections between two demultiplexers, with an echo server on one side
+        {
+            TCPDemux server{cfg}, client{cfg};
+            server.listen(server_addr, NCONNS);
+
+            vector<TCPFlow> flows;
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                const TCPFlow flow = client.connect(client_addr, server_addr);
+                client.write(flow, "hello from connection " + to_string(i));
+                client.end_input_stream(flow);
+                flows.push_back(flow);
+            }
+            test_err_if(client.size() != NCONNS, "client should have one entry per connection");
+
+            vector<TCPFlow> accepted;
+            unordered_set<TCPFlow, TCPFlowHash> finished;
+            vector<string> received(NCONNS);
+            for (unsigned round = 0; round < 1000; ++round) {
+                move_datagrams(client, server);
+
+                while (const auto flow = server.accept(server_addr)) {
+                    accepted.push_back(flow.value());
+                }
+                for (const auto &flow : accepted) {
+                    if (not server.contains(flow)) {
+                        continue;
+                    }
+                    const auto &inbound = server.connection(flow).inbound_stream();
+                    const string data = server.read(flow, inbound.buffer_size());
+                    if (not data.empty()) {
+                        server.write(flow, data);
+                    }
+                    if (inbound.eof() and not finished.count(flow)) {
+                        server.end_input_stream(flow);
+                        finished.insert(flow);
+                    }
+                }
+
+                move_datagrams(server, client);
+
+                for (unsigned i = 0; i < NCONNS; ++i) {
+                    if (client.contains(flows[i])) {
+                        received[i] += client.read(flows[i], 4000);
+                    }
+                }
+
+                server.tick(1);
+                client.tick(1);
+            }
+
+            test_err_if(accepted.size() != NCONNS, "server should have accepted every connection");
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                test_err_if(received[i] != "hello from connection " + to_string(i), "wrong data echoed");
+                test_err_if(flows[i].remote_address != server_addr.ipv4_numeric(), "wrong remote address");
+            }
+
+            // let the TIME_WAIT linger expire, after which every connection is reaped
+            server.tick(10 * cfg.rt_timeout);
+            client.tick(10 * cfg.rt_timeout);
+            test_err_if(server.size() != 0, "server connections should have been reaped");
+            test_err_if(client.size() != 0, "client connections should have been reaped");
+        }
+
+        // a SYN to a port nobody listens on is answered with a RST
+        {
+            TCPDemux server{cfg}, client{cfg};
+            const TCPFlow flow = client.connect(client_addr, {"10.0.0.1", 81});
+            move_datagrams(client, server);
+            test_err_if(server.size() != 0, "server should not create a connection without a listener");
+            move_datagrams(server, client);
+            client.tick(1);
+            test_err_if(client.contains(flow), "client connection should have been reset and reaped");
+        }
+
+        // SYNs beyond the backlog are answered with cookies, and handshakes wait for the accept queue to drain
+        {
+            TCPDemux server{cfg}, client{cfg};
+            server.listen(server_addr, 2);
+            vector<TCPFlow> flows;
+            for (unsigned i = 0; i < 3; ++i) {
+                flows.push_back(client.connect(client_addr, server_addr));
+            }
+            move_datagrams(client, server);
+            test_err_if(server.half_open() != 2, "server should hold only `backlog` half-open handshakes");
+            test_err_if(server.size() != 0, "server shouldn't create connections before the handshake completes");
+            test_err_if(server.datagrams_out().size() != 3, "every SYN should be answered");
+            move_datagrams(server, client);
+            client.write(flows[2], "x");
+            move_datagrams(client, server);
+            test_err_if(server.half_open() != 0, "both half-open handshakes should have completed");
+            test_err_if(not server.accept(server_addr).has_value(), "first connection should be accepted");
+            test_err_if(not server.accept(server_addr).has_value(), "second connection should be accepted");
+            test_err_if(server.accept(server_addr).has_value(), "third connection should not be accepted yet");
+
+            // the third client retransmits its data, which completes the handshake with the cookie
+            client.tick(cfg.rt_timeout);
+            move_datagrams(client, server);
+            const auto third = server.accept(server_addr);
+            test_err_if(not third.has_value() or third.value() != flows[2].reversed(),
+                        "third connection should be accepted");
+            test_err_if(server.read(third.value(), 10) != "x", "data in the completing segment should be received");
+        }
+
+        // a SYN flood can't fill the server, lock out a real client, or forge a connection
+        {
+            TCPDemux server{cfg}, client{cfg};
+            server.listen(server_addr, 8);
+
+            // segments from made-up peers, straight to the server
+            const auto spoof = [&](const TCPFlow &flow, const TCPSegment &seg) {
+                InternetDatagram dgram;
+                test_err_if(dgram.parse(TCPHeaderTemplate{flow}.serialize(seg).concatenate()) != ParseResult::NoError,
+                            "bad spoofed datagram");
+                server.datagram_received(dgram);
+            };
+            const auto attacker = [&](const uint32_t i) {
+                return TCPFlow{0x0b000000 + i, uint16_t(1024 + i % 50000), server_addr.ipv4_numeric(), 80};
+            };
+
+            for (uint32_t i = 0; i < 10000; ++i) {
+                TCPSegment syn;
+                syn.header().syn = true;
+                syn.header().seqno = WrappingInt32{i * 7919};
+                spoof(attacker(i), syn);
+            }
+            test_err_if(server.half_open() != 8 or server.size() != 0, "flood should hold no more than the backlog");
+            test_err_if(server.datagrams_out().size() != 10000, "every SYN should get a SYN/ACK");
+
+            // the cookie for one of them, to replay later
+            InternetDatagram syn_ack_dgram;
+            test_err_if(syn_ack_dgram.parse(server.datagrams_out().back().concatenate()) != ParseResult::NoError,
+                        "bad SYN/ACK");
+            TCPSegment syn_ack;
+            test_err_if(syn_ack.parse(syn_ack_dgram.payload(), syn_ack_dgram.header().pseudo_cksum()) !=
+                            ParseResult::NoError,
+                        "bad SYN/ACK");
+            server.datagrams_out() = {};
+
+            // a real client still gets through
+            const TCPFlow flow = client.connect(client_addr, server_addr);
+            move_datagrams(client, server);
+            move_datagrams(server, client);
+            client.write(flow, "hello");
+            move_datagrams(client, server);
+            const auto accepted = server.accept(server_addr);
+            test_err_if(not accepted.has_value() or server.read(accepted.value(), 10) != "hello",
+                        "real client should connect during the flood");
+
+            // an ACK with a guessed cookie is reset
+            server.datagrams_out() = {};
+            TCPSegment ack;
+            ack.header().ack = true;
+            ack.header().seqno = WrappingInt32{1};
+            ack.header().ackno = WrappingInt32{12345};
+            spoof(attacker(20000), ack);
+            test_err_if(server.size() != 1 or server.datagrams_out().size() != 1, "forged ACK should be reset");
+            server.datagrams_out() = {};
+
+            // a real cookie expires after one to two periods
+            ack.header().seqno = syn_ack.header().ackno;
+            ack.header().ackno = syn_ack.header().seqno + 1;
+            server.tick(2 * SynCookies::PERIOD_MS);
+            server.datagrams_out() = {};
+            spoof(attacker(9999), ack);
+            test_err_if(server.size() != 1, "stale cookie should be rejected");
+
+            // unanswered SYN/ACKs are retransmitted, then given up on
+            server.datagrams_out() = {};
+            for (unsigned i = 0; i < 20; ++i) {
+                server.tick(SynCookies::PERIOD_MS);
+            }
+            test_err_if(server.half_open() != 0, "half-open handshakes should have been given up on");
+        }
+
+        // a lost SYN/ACK is retransmitted with backoff, up to a limit
+        {
+            TCPDemux server{cfg};
+            server.listen(server_addr);
+            TCPSegment syn;
+            syn.header().syn = true;
+            const TCPFlow flow{client_addr.ipv4_numeric(), 5555, server_addr.ipv4_numeric(), 80};
+            InternetDatagram dgram;
+            test_err_if(dgram.parse(TCPHeaderTemplate{flow}.serialize(syn).concatenate()) != ParseResult::NoError,
+                        "bad datagram");
+            server.datagram_received(dgram);
+            test_err_if(server.datagrams_out().size() != 1 or server.half_open() != 1, "SYN should be answered");
+
+            size_t sent = 1;
+            for (unsigned i = 0; i <= TCPDemux::MAX_SYN_ACK_RETX; ++i) {
+                test_err_if(server.time_until_next_timeout_us() != uint64_t{cfg.rt_timeout} * 1000 << i,
+                            "SYN/ACK timer should back off");
+                server.tick(cfg.rt_timeout << i);
+                sent = server.datagrams_out().size();
+            }
+            test_err_if(sent != 1 + TCPDemux::MAX_SYN_ACK_RETX,
+                        "SYN/ACK should be retransmitted a limited number of times");
+            test_err_if(server.half_open() != 0, "handshake should have been given up on");
+        }
+
+        // a sub-millisecond retransmission timeout, and the deadline reported to the owner
+        {
+            TCPConfig fast_cfg = cfg;
+            fast_cfg.rt_timeout_us = 500;
+            TCPDemux client{fast_cfg};
+            test_err_if(client.time_until_next_timeout_us().has_value(), "no timer should run without connections");
+
+            client.connect(client_addr, server_addr);
+            client.datagrams_out() = {};
+            test_err_if(client.time_until_next_timeout_us() != 500, "SYN should be retransmitted after 500 us");
+            test_err_if(client.wait_timeout_us(-1, 200) != 300, "owner should wake up when the timer expires");
+            test_err_if(client.wait_timeout_us(100, 200) != 100, "owner's own limit should be kept if earlier");
+
+            client.tick_us(499);
+            test_err_if(not client.datagrams_out().empty(), "SYN should not be retransmitted early");
+            client.tick_us(1);
+            test_err_if(client.datagrams_out().size() != 1, "SYN should be retransmitted");
+            test_err_if(client.time_until_next_timeout_us() != 1000, "timeout should double after retransmission");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+#include "ipv4_datagram.hh"
+#include "tcp_header_template.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+// the datagram as wrap_tcp_in_ip() builds it, one field at a time
+static string reference(const TCPFlow &flow, TCPSegment seg) {
+    seg.header().sport = flow.local_port;
+    seg.header().dport = flow.remote_port;
+
+    InternetDatagram dgram;
+    dgram.header().src = flow.local_address;
+    dgram.header().dst = flow.remote_address;
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+    return dgram.serialize().concatenate();
+}
+
+int main() {
+    try {
+        mt19937 rng{7};
+        for (unsigned int i = 0; i < 10000; i++) {
+            const TCPFlow flow{uint32_t(rng()), uint16_t(rng()), uint32_t(rng()), uint16_t(rng())};
+            const TCPHeaderTemplate headers{flow};
+
+            // every field the template patches, payloads of odd and even lengths, and sometimes options
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32{uint32_t(rng())};
+            seg.header().ackno = WrappingInt32{uint32_t(rng())};
+            seg.header().win = uint16_t(rng());
+            seg.header().uptr = i % 16 == 0 ? uint16_t(rng()) : 0;
+            seg.header().urg = rng() % 2;
+            seg.header().ack = rng() % 2;
+            seg.header().psh = rng() % 2;
+            seg.header().rst = rng() % 2;
+            seg.header().syn = rng() % 2;
+            seg.header().fin = rng() % 2;
+            seg.header().doff = i % 10 == 0 ? 5 + rng() % 11 : 5;
+            string payload(rng() % 1500, 0);
+            for (auto &ch : payload) {
+                ch = char(rng());
+            }
+            seg.payload() = Buffer{move(payload)};
+
+            const string wire = headers.serialize(seg).concatenate();
+            test_err_if(wire != reference(flow, seg), "template and reference serializations differ");
+
+            InternetDatagram dgram;
+            test_err_if(dgram.parse(Buffer{string(wire)}) != ParseResult::NoError, "IPv4 header doesn't parse");
+            TCPSegment parsed;
+            test_err_if(parsed.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError,
+                        "TCP segment doesn't parse");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include "byte_stream.hh"
+#include "stream_storage.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_deliver.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// bytes currently allocated with new; each block remembers its size just before the pointer handed out
+static size_t live_bytes = 0;
+static constexpr size_t HEADER = alignof(max_align_t);
+
+void *operator new(size_t size) {
+    if (char *p = static_cast<char *>(malloc(size + HEADER))) {
+        *reinterpret_cast<size_t *>(p) = size;
+        live_bytes += size;
+        return p + HEADER;
+    }
+    throw bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept {
+    if (p) {
+        char *block = static_cast<char *>(p) - HEADER;
+        live_bytes -= *reinterpret_cast<size_t *>(block);
+        free(block);
+    }
+}
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+// connect a pair, send `bytes` from client to server and let the server's application read them
+static void exchange(TCPConnection &client, TCPConnection &server, const size_t bytes) {
+    client.connect();
+    deliver(client, server);
+    deliver(server, client);
+
+    client.write(string(bytes, 'x'));
+    while (server.inbound_stream().bytes_read() < bytes) {
+        deliver(client, server);
+        server.inbound_stream().pop_output(server.inbound_stream().buffer_size());
+        deliver(server, client);
+    }
+}
+
+// close both ends of a pair
+static void close(TCPConnection &client, TCPConnection &server, const TCPConfig &cfg) {
+    client.end_input_stream();
+    server.end_input_stream();
+    while (client.active() or server.active()) {
+        deliver(client, server);
+        deliver(server, client);
+        client.tick(cfg.rt_timeout);
+        server.tick(cfg.rt_timeout);
+    }
+}
+
+int main() {
+    try {
+        // a stream keeps its storage while busy, gives it back when released, and takes it back from the pool
+        {
+            ByteStream stream{64000};
+            test_err_if(stream.storage_size() != 0, "new stream shouldn't have storage");
+            stream.write(string(100, 'x'));
+            test_err_if(stream.storage_size() != StreamStorage::MIN_SIZE, "small write should take a small block");
+            stream.write(string(20000, 'x'));
+            test_err_if(stream.storage_size() < 20100, "stream should grow to fit");
+            stream.pop_output(10000);
+            test_err_if(stream.storage_size() == 0, "stream with bytes should keep its storage");
+            const size_t grown = stream.storage_size();
+            stream.pop_output(stream.buffer_size());
+            test_err_if(stream.storage_size() != grown, "drained stream should keep its storage until released");
+            stream.release_storage();
+            test_err_if(stream.storage_size() != 0, "released stream should give back its storage");
+
+            const size_t pooled = StreamStorage::pooled_bytes();
+            test_err_if(pooled == 0, "released storage should be pooled");
+            const string data(20000, 'y');
+            const size_t before = live_bytes;
+            stream.write(data);
+            const bool allocated = live_bytes != before;  // before test_err_if allocates its message
+            test_err_if(allocated, "storage should come from the pool");
+            test_err_if(StreamStorage::pooled_bytes() >= pooled, "pool should have given a block");
+            test_err_if(stream.read(data.size()) != data, "stream lost bytes");
+
+            // the stream never holds more than its capacity rounds up to
+            ByteStream small{5000};
+            small.write(string(10000, 'z'));
+            test_err_if(small.buffer_size() != 5000 or small.storage_size() != 8192, "capacity should bound storage");
+        }
+
+        // storage released on one thread is reused on another
+        {
+            const string data(300000, 'w');
+            thread other([&] {
+                ByteStream stream{data.size()};
+                stream.write(data);
+                stream.release_storage();
+            });
+            other.join();
+
+            ByteStream stream{data.size()};
+            const size_t before = live_bytes;
+            stream.write(data);
+            const bool allocated = live_bytes != before;
+            test_err_if(allocated, "storage from another thread should be reused");
+        }
+
+        // idle connections that have carried data hold little more than the objects themselves
+        {
+            TCPConfig cfg{};
+            constexpr size_t N = 100;
+            vector<unique_ptr<TCPConnection>> clients, servers;
+            clients.reserve(N);
+            servers.reserve(N);
+
+            // the first pair fills the Buffer and stream pools
+            {
+                TCPConnection client{cfg}, server{cfg};
+                exchange(client, server, 50000);
+                close(client, server, cfg);
+            }
+
+            const size_t before = live_bytes, pooled_before = StreamStorage::pooled_bytes();
+            for (size_t i = 0; i < N; i++) {
+                auto &client = *clients.emplace_back(make_unique<TCPConnection>(cfg));
+                auto &server = *servers.emplace_back(make_unique<TCPConnection>(cfg));
+                exchange(client, server, 50000);
+                test_err_if(client.bytes_in_flight() != 0, "data should be acknowledged");
+                test_err_if(client.remaining_outbound_capacity() != cfg.send_capacity,
+                            "outbound stream should be empty");
+            }
+
+            // after an RTO with nothing received, the connections let go of their empty queues too
+            for (size_t i = 0; i < N; i++) {
+                clients[i]->tick(cfg.rt_timeout);
+                servers[i]->tick(cfg.rt_timeout);
+                test_err_if(not clients[i]->segments_out().empty() or not servers[i]->segments_out().empty(),
+                            "idle connections shouldn't send anything");
+                test_err_if(clients[i]->inbound_stream().storage_size() != 0 or
+                                servers[i]->inbound_stream().storage_size() != 0,
+                            "drained inbound stream shouldn't hold storage");
+            }
+
+            // what the connections hold, not what they left in the pool
+            const size_t pooled = StreamStorage::pooled_bytes() - pooled_before;
+            const size_t per_connection = (live_bytes - before - pooled) / (2 * N);
+            if (per_connection > sizeof(TCPConnection) + 256) {
+                cerr << per_connection << " bytes per idle connection\n";
+            }
+            test_err_if(per_connection > sizeof(TCPConnection) + 256, "idle connections hold too much memory");
+
+            for (size_t i = 0; i < N; i++) {
+                close(*clients[i], *servers[i], cfg);
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
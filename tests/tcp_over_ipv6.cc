@@ -0,0 +1,136 @@
+#include "address.hh"
+#include "ipv6_datagram.hh"
+#include "tcp_over_ip.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// what the datagram looks like after crossing a wire
+static IPv6Datagram reparse(const IPv6Datagram &dgram) {
+    IPv6Datagram ret;
+    test_err_if(ret.parse(dgram.serialize().concatenate()) != ParseResult::NoError, "datagram doesn't parse");
+    return ret;
+}
+
+int main() {
+    try {
+        // addresses in either family
+        {
+            const Address a{"2001:db8::1", 443};
+            test_err_if(not a.is_ipv6() or a.ip() != "2001:db8::1" or a.port() != 443, "IPv6 address wasn't parsed");
+            test_err_if(a.to_string() != "[2001:db8::1]:443", "IPv6 address should be bracketed");
+            const IPv6Numeric numeric = a.ipv6_numeric();
+            test_err_if(numeric[0] != 0x20 or numeric[1] != 0x01 or numeric[2] != 0x0d or numeric[15] != 1,
+                        "numeric IPv6 address is wrong");
+            test_err_if(Address::from_ipv6_numeric(numeric, 443) != a, "IPv6 address doesn't round-trip");
+
+            const Address b{"18.243.0.1", 80};
+            test_err_if(b.is_ipv6() or b.ipv4_numeric() != 0x12f30001 or b.to_string() != "18.243.0.1:80",
+                        "IPv4 addresses should be unchanged");
+            bool threw = false;
+            try {
+                b.ipv6_numeric();
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_err_if(not threw, "ipv6_numeric() of an IPv4 address should throw");
+        }
+
+        // headers round-trip, and bad ones are rejected
+        {
+            IPv6Datagram dgram;
+            dgram.header().tclass = 0xb8;
+            dgram.header().flow_label = 0xabcde;
+            dgram.header().hop_limit = 7;
+            dgram.header().src = Address{"fe80::1"}.ipv6_numeric();
+            dgram.header().dst = Address{"ff02::2"}.ipv6_numeric();
+            dgram.header().next_header = 17;
+            dgram.payload() = string("hello");
+            dgram.header().payload_len = dgram.payload().size();
+
+            const string wire = dgram.serialize().concatenate();
+            test_err_if(wire.size() != IPv6Header::LENGTH + 5, "serialized datagram is the wrong size");
+            const IPv6Datagram parsed = reparse(dgram);
+            const IPv6Header &h = parsed.header();
+            test_err_if(h.tclass != 0xb8 or h.flow_label != 0xabcde or h.hop_limit != 7 or h.next_header != 17 or
+                            h.src != dgram.header().src or h.dst != dgram.header().dst,
+                        "header doesn't round-trip");
+            test_err_if(parsed.payload().concatenate() != "hello", "payload doesn't round-trip");
+
+            IPv6Datagram bad;
+            test_err_if(bad.parse(string(wire, 0, IPv6Header::LENGTH - 1)) != ParseResult::PacketTooShort,
+                        "short header should be rejected");
+            test_err_if(bad.parse(wire + "!") != ParseResult::TruncatedPacket, "wrong length should be rejected");
+            string wrong_version = wire;
+            wrong_version[0] = char(0x45);
+            test_err_if(bad.parse(move(wrong_version)) != ParseResult::WrongIPVersion, "IPv4 should be rejected");
+        }
+
+        // a connection's first segments, through a pair of adapters
+        {
+            TCPOverIPv6Adapter client, server;
+            client.config_mut().source = {"fd00:169:254:144::9", 40000};
+            client.config_mut().destination = {"2001:db8::80", 8080};
+            server.config_mut().source = {"::", 8080};
+            server.set_listening(true);
+
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{12345};
+            const IPv6Datagram syn_dgram = client.wrap_tcp_in_ip(syn);
+
+            // the TCP checksum covers the whole pseudo-header
+            {
+                string pseudo = string(syn_dgram.header().src.begin(), syn_dgram.header().src.end()) +
+                                string(syn_dgram.header().dst.begin(), syn_dgram.header().dst.end());
+                NetUnparser::u32(pseudo, syn_dgram.payload().size());
+                NetUnparser::u32(pseudo, IPv6Header::PROTO_TCP);
+                InternetChecksum check;
+                check.add(pseudo);
+                check.add(syn_dgram.payload().concatenate());
+                test_err_if(check.value() != 0, "TCP checksum is wrong");
+            }
+
+            const optional<TCPSegment> received_syn = server.unwrap_tcp_in_ip(reparse(syn_dgram));
+            test_err_if(not received_syn.has_value() or not received_syn->header().syn, "server didn't get the SYN");
+            test_err_if(server.listening() or server.config().destination != client.config().source or
+                            server.config().source != client.config().destination,
+                        "server should have learned the client's address");
+
+            TCPSegment syn_ack;
+            syn_ack.header().syn = true;
+            syn_ack.header().ack = true;
+            syn_ack.header().ackno = WrappingInt32{12346};
+            syn_ack.payload() = string("payload");
+            const optional<TCPSegment> received_syn_ack =
+                client.unwrap_tcp_in_ip(reparse(server.wrap_tcp_in_ip(syn_ack)));
+            test_err_if(not received_syn_ack.has_value() or received_syn_ack->payload().str() != "payload",
+                        "client didn't get the SYN/ACK");
+
+            // segments from a stranger, or corrupted ones, are dropped
+            TCPOverIPv6Adapter stranger;
+            stranger.config_mut().source = {"2001:db8::666", 8080};
+            stranger.config_mut().destination = client.config().source;
+            test_err_if(client.unwrap_tcp_in_ip(reparse(stranger.wrap_tcp_in_ip(syn_ack))).has_value(),
+                        "segment from the wrong address should be dropped");
+            IPv6Datagram corrupted = server.wrap_tcp_in_ip(syn_ack);
+            corrupted.header().dst[15] ^= 1;
+            client.config_mut().source = Address::from_ipv6_numeric(corrupted.header().dst, 40000);
+            test_err_if(client.unwrap_tcp_in_ip(reparse(corrupted)).has_value(),
+                        "segment with a bad checksum should be dropped");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+#include "tcp_config.hh"
+#include "tcp_sharded_stack.hh"
+#include "tcp_stack.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned NWORKERS = 4;
+static constexpr unsigned NCONNS = 64;
+static constexpr uint64_t TIMEOUT_MS = 10000;
+
+int main() {
+    try {
+        // the hash is symmetric, so both directions of a flow land on the same worker
+        {
+            auto rd = get_random_generator();
+            for (unsigned i = 0; i < 10000; ++i) {
+                const TCPFlow flow{uint32_t(rd()), uint16_t(rd()), uint32_t(rd()), uint16_t(rd())};
+                test_err_if(TCPShardedStack::rss_hash(flow) != TCPShardedStack::rss_hash(flow.reversed()),
+                            "RSS hash should be symmetric");
+            }
+        }
+
+        const Address server_addr{"10.0.0.1", 80};
+        const Address server_local{"10.0.0.1", 0};
+        const Address client_addr{"10.0.0.2", 0};
+        const Address client_listen{"10.0.0.2", 7};
+
+        TCPConfig cfg{};
+        cfg.recv_capacity = 4000;
+        cfg.send_capacity = 4000;
+
+        int fds[2];
+        SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+        FileDescriptor server_device{fds[0]}, client_device{fds[1]};
+
+        // an echo server on every worker; each worker also opens one connection of its own
+        vector<vector<TCPFlow>> accepted(NWORKERS);
+        vector<unordered_set<TCPFlow, TCPFlowHash>> finished(NWORKERS);
+        vector<char> connected(NWORKERS);  // not vector<bool>, whose elements share storage between threads
+        TCPShardedStack server{move(server_device), NWORKERS, cfg, [&](TCPShardedStack::Worker &w) {
+                                   TCPDemux &demux = w.demux();
+                                   auto &flows = accepted[w.index()];
+
+                                   if (not connected[w.index()]) {
+                                       const TCPFlow flow = w.connect(server_local, client_listen);
+                                       demux.write(flow, "worker " + to_string(w.index()));
+                                       demux.end_input_stream(flow);
+                                       connected[w.index()] = true;
+                                   }
+
+                                   while (const auto flow = demux.accept(server_addr)) {
+                                       flows.push_back(flow.value());
+                                   }
+                                   for (const auto &flow : flows) {
+                                       if (not demux.contains(flow)) {
+                                           continue;
+                                       }
+                                       const auto &inbound = demux.connection(flow).inbound_stream();
+                                       const string data = demux.read(flow, inbound.buffer_size());
+                                       if (not data.empty()) {
+                                           demux.write(flow, data);
+                                       }
+                                       if (inbound.eof() and finished[w.index()].insert(flow).second) {
+                                           demux.end_input_stream(flow);
+                                       }
+                                   }
+                               }};
+        server.listen(server_addr);
+        server.start();
+
+        TCPStack client{move(client_device), cfg};
+        client.listen(client_listen);
+
+        vector<TCPFlow> flows;
+        for (unsigned i = 0; i < NCONNS; ++i) {
+            const TCPFlow flow = client.connect(client_addr, server_addr);
+            client.write(flow, "hello from connection " + to_string(i));
+            client.end_input_stream(flow);
+            flows.push_back(flow);
+        }
+
+        vector<string> received(NCONNS);
+        vector<TCPFlow> incoming;
+        string from_workers;
+        const uint64_t start = timestamp_ms();
+        auto done = [&] {
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                if (received[i] != "hello from connection " + to_string(i)) {
+                    return false;
+                }
+            }
+            return from_workers.size() == NWORKERS * string("worker 0").size();
+        };
+        client.loop([&] {
+            for (unsigned i = 0; i < NCONNS; ++i) {
+                if (client.contains(flows[i])) {
+                    received[i] += client.read(flows[i], 4000);
+                }
+            }
+            while (const auto flow = client.accept(client_listen)) {
+                incoming.push_back(flow.value());
+            }
+            for (const auto &flow : incoming) {
+                if (client.contains(flow)) {
+                    from_workers += client.read(flow, 4000);
+                }
+            }
+            return not done() and timestamp_ms() - start < TIMEOUT_MS;
+        });
+        server.stop();
+
+        for (unsigned i = 0; i < NCONNS; ++i) {
+            test_err_if(received[i] != "hello from connection " + to_string(i), "wrong data echoed");
+        }
+        test_err_if(incoming.size() != NWORKERS, "every worker's outgoing connection should be established");
+        for (unsigned i = 0; i < NWORKERS; ++i) {
+            test_err_if(from_workers.find("worker " + to_string(i)) == string::npos, "missing data from a worker");
+        }
+
+        // connections are spread over the workers, and each one stayed on the worker it hashed to
+        size_t total = 0;
+        for (unsigned i = 0; i < NWORKERS; ++i) {
+            test_err_if(accepted[i].empty(), "every worker should have accepted some connections");
+            for (const auto &flow : accepted[i]) {
+                test_err_if(TCPShardedStack::worker_for(flow, NWORKERS) != i, "connection on the wrong worker");
+            }
+            total += accepted[i].size();
+        }
+        test_err_if(total != NCONNS, "server should have accepted every connection exactly once");
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "spsc_byte_ring.hh"
+#include "tcp_config.hh"
+#include "tcp_sponge_socket.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+static constexpr size_t RING_TRANSFER_SIZE = 4 * 1024 * 1024;
+static constexpr size_t SOCKET_TRANSFER_SIZE = 256 * 1024;
+
+static string random_string(const size_t len) {
+    auto rd = get_random_generator();
+    string ret(len, 0);
+    generate(ret.begin(), ret.end(), [&] { return char(rd()); });
+    return ret;
+}
+
+int main() {
+    try {
+        // a producer and a consumer thread on a small ring, with chunk sizes that wrap around unevenly
+        {
+            const string data = random_string(RING_TRANSFER_SIZE);
+            SPSCByteRing ring{1000};
+            test_err_if(ring.capacity() != 1024, "capacity should be rounded up to a power of two");
+
+            thread producer([&] {
+                auto rd = get_random_generator();
+                size_t sent = 0;
+                while (sent < data.size()) {
+                    const size_t len = min(data.size() - sent, size_t(rd() % 1500));
+                    const size_t pushed = ring.push(string_view(data).substr(sent, len));
+                    if (pushed == 0) {
+                        this_thread::yield();  // the ring has no wakeups of its own
+                    }
+                    sent += pushed;
+                }
+                ring.close();
+            });
+
+            auto rd = get_random_generator();
+            string received;
+            received.reserve(data.size());
+            while (not ring.eof()) {
+                const string chunk = ring.pop(rd() % 1500);
+                if (chunk.empty()) {
+                    this_thread::yield();
+                }
+                received += chunk;
+            }
+            producer.join();
+
+            test_err_if(received != data, "bytes should come out of the ring in the order they went in");
+            test_err_if(ring.size() != 0, "ring should be empty after eof");
+        }
+
+        // two TCPSpongeSockets over loopback UDP, with an echo server, exchanging data through the rings
+        {
+            TCPConfig cfg{};
+            cfg.rt_timeout = 20;  // keep the TIME_WAIT linger short
+
+            UDPSocket server_udp;
+            server_udp.bind({"127.0.0.1", 0});
+            FdAdapterConfig server_ad{};
+            server_ad.source = server_udp.local_address();
+
+            FdAdapterConfig client_ad{};
+            client_ad.destination = server_ad.source;
+
+            TCPOverUDPSpongeSocket server{TCPOverUDPSocketAdapter(move(server_udp)), TCPDataChannel::Ring};
+            thread server_thread([&] {
+                server.listen_and_accept(cfg, server_ad);
+                while (true) {
+                    const string data = server.recv();
+                    if (data.empty()) {
+                        break;
+                    }
+                    server.send(data);
+                }
+                test_err_if(not server.recv_eof(), "server's inbound stream should have ended");
+                server.wait_until_closed();
+            });
+
+            const string data = random_string(SOCKET_TRANSFER_SIZE);
+            TCPOverUDPSpongeSocket client{TCPOverUDPSocketAdapter(UDPSocket{}), TCPDataChannel::Ring};
+            client.connect(cfg, client_ad);
+
+            // send from another thread, so the echoes can be read as they arrive
+            thread sender([&] {
+                client.send(data);
+                client.shutdown_send();
+            });
+            string echoed;
+            while (true) {
+                const string chunk = client.recv();
+                if (chunk.empty()) {
+                    break;
+                }
+                echoed += chunk;
+            }
+            sender.join();
+            client.wait_until_closed();
+            server_thread.join();
+
+            test_err_if(echoed != data, "echoed data should match what was sent");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
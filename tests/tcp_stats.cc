@@ -0,0 +1,84 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_deliver.hh"
+#include "tcp_stats.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        TCPConfig client_cfg{};
+        TCPConfig server_cfg{};
+        server_cfg.recv_capacity = 2000;
+
+        TCPConnection client{client_cfg}, server{server_cfg};
+
+        // the handshake takes 3 ms, which is the client's first RTT sample
+        client.connect();
+        client.tick_us(3000);
+        deliver(client, server);
+        deliver(server, client);
+        deliver(client, server);
+        test_err_if(client.stats().srtt_us != 3000, "client should have measured the handshake");
+        test_err_if(client.stats().rttvar_us != 1500, "first rttvar should be half the first sample");
+        test_err_if(server.stats().srtt_us != 0, "server's SYN was acknowledged before any time passed for it");
+
+        // idle with nothing to send
+        client.tick_us(200);
+        test_err_if(client.stats().app_limited_us != 200, "idle time should be application-limited");
+
+        // two segments fill the server's window; the first is lost
+        client.write(string(5000, 'x'));
+        test_err_if(client.segments_out().size() != 2, "client should send a full window");
+        client.segments_out().pop();
+        deliver(client, server);
+        test_err_if(server.unassembled_bytes() != TCPConfig::MAX_PAYLOAD_SIZE, "second segment is out of order");
+
+        // the server acknowledges nothing new, which is a duplicate ACK
+        deliver(server, client);
+        test_err_if(client.stats().dupacks != 1, "client should count a duplicate ACK");
+
+        // with the window full, time is rwnd-limited
+        client.tick_us(500);
+        test_err_if(client.stats().rwnd_limited_us != 500, "full window should be rwnd-limited");
+
+        // the timer expires and the first segment is retransmitted, and delivered twice
+        client.tick(client_cfg.rt_timeout);
+        TCPStats stats = client.stats();
+        test_err_if(stats.rto_expirations != 1, "timer should have expired once");
+        test_err_if(stats.retransmitted_segments != 1, "one segment should have been retransmitted");
+        test_err_if(stats.rto_us != 2000 * 1000, "RTO should have doubled");
+        test_err_if(client.segments_out().size() != 1, "client should retransmit the first segment");
+        server.segment_received(client.segments_out().front());
+        deliver(client, server);
+        test_err_if(server.stats().duplicate_bytes != TCPConfig::MAX_PAYLOAD_SIZE, "second copy is a duplicate");
+        test_err_if(server.inbound_stream().buffer_size() != 2000, "server should have assembled both segments");
+
+        // the window is now closed, so the client probes with one byte beyond it
+        deliver(server, client);
+        test_err_if(client.segments_out().size() != 1, "client should send a one-byte window probe");
+        deliver(client, server);
+        test_err_if(server.stats().out_of_window_bytes != 1, "the probe lies beyond the window");
+
+        stats = client.stats();
+        test_err_if(stats.bytes_sent != 3 * TCPConfig::MAX_PAYLOAD_SIZE + 1, "wrong count of bytes sent");
+        test_err_if(server.stats().bytes_received != 3 * TCPConfig::MAX_PAYLOAD_SIZE + 1, "wrong bytes received");
+        // one segment was lost, and one was delivered twice
+        test_err_if(stats.segments_sent != server.stats().segments_received, "wrong count of segments");
+        test_err_if(stats.segments_received + server.segments_out().size() != server.stats().segments_sent,
+                    "server's segments were all delivered, except those still queued");
+        // the server's ACK of the duplicate copy arrived after the probe was sent, so it is a duplicate ACK too
+        test_err_if(stats.to_string().find("dupacks=2 ") == string::npos, "to_string() should list the counters");
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
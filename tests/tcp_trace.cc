@@ -0,0 +1,142 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_deliver.hh"
+#include "tcp_trace.hh"
+#include "test_err_if.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+static size_t count(const string &haystack, const string &needle) {
+    size_t n = 0;
+    for (size_t pos = haystack.find(needle); pos != string::npos; pos = haystack.find(needle, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+int main() {
+    const string path = "/tmp/sponge_tcp_trace_" + to_string(getpid());
+    try {
+        TCPConfig cfg{};
+        TCPConnection untraced{cfg};
+        untraced.connect();
+
+        TCPTracer::start(path);
+        test_err_if(not TCPTracer::enabled(), "tracing should be on");
+        {
+            TCPConnection client{cfg}, server{cfg};
+
+            // handshake, then a few bytes each way
+            client.connect();
+            deliver(client, server);
+            deliver(server, client);
+            deliver(client, server);
+            client.write("hello");
+            deliver(client, server);
+            deliver(server, client);
+
+            // the server's reply is lost, and the timer fires
+            server.write("world");
+            server.segments_out().pop();
+            server.tick(cfg.rt_timeout);
+            deliver(server, client);
+            deliver(client, server);
+
+            // active close by the client
+            client.end_input_stream();
+            deliver(client, server);
+            deliver(server, client);
+            server.end_input_stream();
+            deliver(server, client);
+            deliver(client, server);
+            server.tick(1);
+        }
+        TCPTracer::stop();
+        test_err_if(TCPTracer::enabled(), "tracing should be off");
+        test_err_if(TCPTracer::dropped() != 0, "nothing should have been dropped");
+
+        // events after stop() are not recorded
+        untraced.tick(cfg.rt_timeout);
+
+        ostringstream text;
+        {
+            ifstream trace{path, ios::binary};
+            TCPTracer::decode_text(trace, text);
+        }
+        const string lines = text.str();
+        cout << lines;
+
+        test_err_if(count(lines, " tx flags=S seqno=") != 1, "client's SYN should be traced once");
+        test_err_if(count(lines, " rx flags=SA ") != 1, "client should receive one SYN/ACK");
+        test_err_if(count(lines, "state SYN_SENT") != 1, "client should enter SYN_SENT");
+        test_err_if(count(lines, "state SYN_RCVD") != 1, "server should enter SYN_RCVD");
+        test_err_if(count(lines, "state ESTABLISHED") != 2, "both sides should reach ESTABLISHED");
+        test_err_if(count(lines, "state FIN_WAIT_1") != 1, "client closes first");
+        test_err_if(count(lines, "state CLOSE_WAIT") != 1, "server is closed passively");
+        test_err_if(count(lines, "state TIME_WAIT") != 1, "client should linger");
+        test_err_if(count(lines, "state CLOSED") != 1, "server should close");
+        test_err_if(count(lines, "state RESET") != 1, "client is destroyed while lingering");
+        test_err_if(count(lines, "timer fired, rto=2000000us") != 1, "server's timer should fire once");
+        test_err_if(count(lines, "peer window ") != 4, "each side should see the peer window open and close");
+        // each write is sent and received, and the server's was also sent once before it was lost
+        test_err_if(count(lines, " len=5") != 5, "wrong count of data segments");
+        test_err_if(lines.find("conn 0 ") != string::npos, "the untraced connection should not appear");
+
+        ostringstream json;
+        {
+            ifstream trace{path, ios::binary};
+            TCPTracer::decode_chrome_json(trace, json);
+        }
+        const string chrome = json.str();
+        test_err_if(chrome.rfind("{\"displayTimeUnit\"", 0) != 0, "JSON should be a Trace Event Format object");
+        test_err_if(count(chrome, "\"ph\":\"M\"") != 2, "one track per connection");
+        test_err_if(count(chrome, "\"name\":\"ESTABLISHED\"") != 2, "state changes should be instant events");
+        test_err_if(count(chrome, "\"ph\":\"C\"") != 4, "window updates should be counters");
+
+        istringstream garbage{"not a trace"};
+        bool threw = false;
+        try {
+            TCPTracer::decode_text(garbage, text);
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_err_if(not threw, "decoding a file that isn't a trace should throw");
+
+        // threads that have exited give up their rings, and each new one gets a new number
+        TCPTracer::start(path);
+        for (unsigned i = 0; i < 3; i++) {
+            thread worker([&] {
+                TCPConnection conn{cfg};
+                conn.connect();
+            });
+            worker.join();
+        }
+        TCPTracer::stop();
+        test_err_if(TCPTracer::rings() != 1, "only the main thread should still have a ring");
+        ostringstream workers;
+        {
+            ifstream trace{path, ios::binary};
+            TCPTracer::decode_text(trace, workers);
+        }
+        for (unsigned i = 1; i <= 3; i++) {
+            test_err_if(count(workers.str(), " thread " + to_string(i) + " ") == 0, "each thread should be numbered");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        remove(path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    remove(path.c_str());
+    return EXIT_SUCCESS;
+}
@@ -9,6 +9,7 @@ start_tun () {
     local TUNNUM="$1" TUNDEV="tun$1"
     ip tuntap add mode tun user "${SUDO_USER}" name "${TUNDEV}"
     ip addr add "${TUN_IP_PREFIX}.${TUNNUM}.1/24" dev "${TUNDEV}"
+    ip -6 addr add "${TUN_IPV6_PREFIX}:${TUNNUM}::1/64" dev "${TUNDEV}" nodad
     ip link set dev "${TUNDEV}" up
     ip route change "${TUN_IP_PREFIX}.${TUNNUM}.0/24" dev "${TUNDEV}" rto_min 10ms
 